@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2023 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 // This file provides a MicroPython runtime to run code in MULTI_MPY_V6 format.
 
@@ -8,13 +8,16 @@
 #include <string.h>
 
 #include <pbio/button.h>
+#include <pbio/inflate.h>
 #include <pbio/main.h>
 #include <pbio/util.h>
 #include <pbsys/main.h>
+#include <pbsys/program_index.h>
 #include <pbsys/program_stop.h>
 
 #include <pybricks/common.h>
 #include <pybricks/util_mp/pb_obj_helper.h>
+#include <pybricks/util_pb/pb_error.h>
 
 #include "shared/readline/readline.h"
 #include "shared/runtime/gchelper.h"
@@ -83,7 +86,37 @@ mp_uint_t mp_vfs_map_minimal_readbyte(void *data) {
     return (blob->cur < blob->end) ? *blob->cur++ : MP_READER_EOF;
 }
 
+#if PYBRICKS_OPT_COMPRESSED_MOD
+
+// Compressed modules start with this byte instead of the 'M' of mpy files.
+#define MPY_COMPRESSED_MAGIC ('z')
+
+static mp_uint_t mpy_compressed_readbyte(void *data) {
+    // The loader never reads past the end of a valid module, so running out
+    // of data or a bad match means the module is corrupt.
+    uint8_t value;
+    pb_assert(pbio_inflate_byte(data, &value));
+    return value;
+}
+
+static void mpy_compressed_close(void *data) {
+    m_del_obj(pbio_inflate_t, data);
+}
+
+#endif // PYBRICKS_OPT_COMPRESSED_MOD
+
 const uint8_t *mp_vfs_map_minimal_read_bytes(mp_reader_t *reader, size_t len) {
+    #if PYBRICKS_OPT_COMPRESSED_MOD
+    // Compressed data can't be used in place, so inflate it into the heap.
+    if (reader->readbyte == mpy_compressed_readbyte) {
+        byte *buf = m_new(byte, len);
+        for (size_t i = 0; i < len; i++) {
+            pb_assert(pbio_inflate_byte(reader->data, &buf[i]));
+        }
+        return buf;
+    }
+    #endif
+
     mp_vfs_map_minimal_t *blob = (mp_vfs_map_minimal_t *)reader->data;
     const uint8_t *ptr = blob->cur;
     blob->cur += len;
@@ -185,15 +218,6 @@ typedef struct {
     /** mpy data follows thereafter. */
 } mpy_info_t;
 
-// Program data is a concatenation of multiple mpy files. This sets a reference
-// to the first script and the total size so we can search for modules.
-static mpy_info_t *mpy_first;
-static mpy_info_t *mpy_end;
-static inline void mpy_data_init(pbsys_main_program_t *program) {
-    mpy_first = (mpy_info_t *)program->code_start;
-    mpy_end = (mpy_info_t *)program->code_end;
-}
-
 /**
  * Gets a reference to the mpy data of a script.
  * @param [in]  info    A pointer to an mpy info header.
@@ -204,6 +228,30 @@ static uint8_t *mpy_data_get_buf(mpy_info_t *info) {
     return (uint8_t *)info + sizeof(info->mpy_size) + strlen(info->mpy_name) + 1;
 }
 
+/**
+ * Gets a reader for the mpy data of a script.
+ * @param [out] reader  The reader.
+ * @param [in]  data    Reader state for data that is used in place.
+ * @param [in]  info    A pointer to an mpy info header.
+ */
+static void mpy_data_new_reader(mp_reader_t *reader, mp_vfs_map_minimal_t *data, mpy_info_t *info) {
+    const byte *buf = mpy_data_get_buf(info);
+    size_t len = pbio_get_uint32_le(info->mpy_size);
+
+    #if PYBRICKS_OPT_COMPRESSED_MOD
+    if (len > 0 && buf[0] == MPY_COMPRESSED_MAGIC) {
+        pbio_inflate_t *z = m_new_obj(pbio_inflate_t);
+        pbio_inflate_init(z, buf + 1, len - 1);
+        reader->data = z;
+        reader->readbyte = mpy_compressed_readbyte;
+        reader->close = mpy_compressed_close;
+        return;
+    }
+    #endif
+
+    mp_vfs_map_minimal_new_reader(reader, data, buf, len);
+}
+
 /**
  * Finds a MicroPython module in the program data.
  * @param [in]  name    The fully qualified name of the module.
@@ -211,16 +259,7 @@ static uint8_t *mpy_data_get_buf(mpy_info_t *info) {
  *                      module was not found.
  */
 static mpy_info_t *mpy_data_find(qstr name) {
-    const char *name_str = qstr_str(name);
-
-    for (mpy_info_t *info = mpy_first; info < mpy_end;
-         info = (mpy_info_t *)(mpy_data_get_buf(info) + pbio_get_uint32_le(info->mpy_size))) {
-        if (strcmp(info->mpy_name, name_str) == 0) {
-            return info;
-        }
-    }
-
-    return NULL;
+    return (mpy_info_t *)pbsys_program_index_find(qstr_str(name), qstr_len(name));
 }
 
 /**
@@ -244,7 +283,7 @@ static void run_user_program(void) {
         // This is similar to __import__ except we don't push/pop globals
         mp_reader_t reader;
         mp_vfs_map_minimal_t data;
-        mp_vfs_map_minimal_new_reader(&reader, &data, mpy_data_get_buf(info), pbio_get_uint32_le(info->mpy_size));
+        mpy_data_new_reader(&reader, &data, info);
         mp_module_context_t *context = m_new_obj(mp_module_context_t);
         context->module.globals = mp_globals_get();
         mp_compiled_module_t compiled_module;
@@ -305,12 +344,10 @@ void pbsys_main_run_program(pbsys_main_program_t *program) {
     mp_stack_set_top(estack);
     mp_stack_set_limit(estack - sstack - 1024);
 
-    // MicroPython heap starts after program data.
-    gc_init(program->code_end, program->data_end);
-
-    // Set program data reference to first script. This is used to run main,
-    // and to set the starting point for finding downloaded modules.
-    mpy_data_init(program);
+    // Index the downloaded modules. This is used to run main, and to find
+    // modules when they are imported. The MicroPython heap starts after the
+    // program data and this index.
+    gc_init(pbsys_program_index_init(program), program->data_end);
 
     // Initialize MicroPython.
     mp_init();
@@ -373,7 +410,7 @@ mp_obj_t pb_builtin_import(size_t n_args, const mp_obj_t *args) {
         // Parse the static script data.
         mp_reader_t reader;
         mp_vfs_map_minimal_t data;
-        mp_vfs_map_minimal_new_reader(&reader, &data, mpy_data_get_buf(info), pbio_get_uint32_le(info->mpy_size));
+        mpy_data_new_reader(&reader, &data, info);
 
         // Create new module and execute in its own context.
         mp_obj_t module_obj = mp_obj_new_module(module_name_qstr);
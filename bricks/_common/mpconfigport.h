@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2019-2023 The Pybricks Authors
+// Copyright (c) 2019-2024 The Pybricks Authors
 
 // Common configuration of Pybricks MicroPython ports.
 
@@ -50,7 +50,7 @@
 #define MICROPY_DEBUG_PRINTERS                  (0)
 #define MICROPY_ENABLE_GC                       (1)
 #define MICROPY_ENABLE_FINALISER                (1)
-#define MICROPY_GC_ALLOC_THRESHOLD              (0)
+#define MICROPY_GC_ALLOC_THRESHOLD              (PYBRICKS_OPT_GC_ALLOC_THRESHOLD)
 #define MICROPY_STACK_CHECK                     (1)
 #define MICROPY_HELPER_REPL                     (1)
 #define MICROPY_HELPER_LEXER_UNIX               (0)
@@ -1,5 +1,5 @@
 # SPDX-License-Identifier: MIT
-# Copyright (c) 2019-2023 The Pybricks Authors
+# Copyright (c) 2019-2024 The Pybricks Authors
 
 # This file contains the sources common to all Pybricks MicroPython ports.
 
@@ -119,6 +119,7 @@ PBIO_SRC_C = $(addprefix lib/pbio/,\
 	drv/battery/battery_nxt.c \
 	drv/battery/battery_test.c \
 	drv/battery/battery_virtual.c \
+	drv/block_device/block_device.c \
 	drv/block_device/block_device_flash_stm32.c \
 	drv/block_device/block_device_test.c \
 	drv/block_device/block_device_w25qxx_stm32.c \
@@ -204,6 +205,7 @@ PBIO_SRC_C = $(addprefix lib/pbio/,\
 	src/error.c \
 	src/geometry.c \
 	src/imu.c \
+	src/inflate.c \
 	src/int_math.c \
 	src/integrator.c \
 	src/light/animation.c \
@@ -231,6 +233,7 @@ PBIO_SRC_C = $(addprefix lib/pbio/,\
 	sys/light_matrix.c \
 	sys/light.c \
 	sys/main.c \
+	sys/program_index.c \
 	sys/program_stop.c \
 	sys/status.c \
 	sys/storage.c \
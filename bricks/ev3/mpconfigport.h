@@ -49,6 +49,8 @@
 #define PYBRICKS_OPT_EXTRA_MOD                  (1)
 #define PYBRICKS_OPT_CUSTOM_IMPORT              (1)
 #define PYBRICKS_OPT_NATIVE_MOD                 (0)
+#define PYBRICKS_OPT_COMPRESSED_MOD             (0)
+#define PYBRICKS_OPT_GC_ALLOC_THRESHOLD         (1)
 
 // Start with config shared by all Pybricks ports.
 #include "../_common/mpconfigport.h"
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2023 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 #include "stm32f070xb.h"
 
@@ -49,5 +49,7 @@
 #define PYBRICKS_OPT_EXTRA_MOD                  (0)
 #define PYBRICKS_OPT_CUSTOM_IMPORT              (1)
 #define PYBRICKS_OPT_NATIVE_MOD                 (0)
+#define PYBRICKS_OPT_COMPRESSED_MOD             (0)
+#define PYBRICKS_OPT_GC_ALLOC_THRESHOLD         (0)
 
 #include "../_common_stm32/mpconfigport.h"
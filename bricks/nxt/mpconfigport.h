@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2023 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 #include <stdint.h>
 
@@ -52,6 +52,8 @@
 #define PYBRICKS_OPT_EXTRA_MOD                  (1)
 #define PYBRICKS_OPT_CUSTOM_IMPORT              (1)
 #define PYBRICKS_OPT_NATIVE_MOD                 (0)
+#define PYBRICKS_OPT_COMPRESSED_MOD             (0)
+#define PYBRICKS_OPT_GC_ALLOC_THRESHOLD         (1)
 
 // Start with config shared by all Pybricks ports.
 #include "../_common/mpconfigport.h"
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2019-2023 The Pybricks Authors
+// Copyright (c) 2019-2024 The Pybricks Authors
 
 #include "stm32f413xx.h"
 
@@ -55,6 +55,8 @@
 #define PYBRICKS_OPT_EXTRA_MOD                  (1)
 #define PYBRICKS_OPT_CUSTOM_IMPORT              (1)
 #define PYBRICKS_OPT_NATIVE_MOD                 (1)
+#define PYBRICKS_OPT_COMPRESSED_MOD             (1)
+#define PYBRICKS_OPT_GC_ALLOC_THRESHOLD         (1)
 
 #include "../_common_stm32/mpconfigport.h"
 
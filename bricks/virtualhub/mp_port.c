@@ -15,6 +15,7 @@
 #include <contiki.h>
 
 #include <pbio/main.h>
+#include <pbdrv/clock.h>
 #include <pbdrv/legodev.h>
 #include <pbsys/core.h>
 #include <pbsys/program_stop.h>
@@ -35,6 +36,12 @@
 // from micropython/ports/unix/main.c
 #define FORCED_EXIT (0x100)
 
+// In lock-step clock mode, time only advances when we would otherwise wait.
+// Busy loops never wait, so each pass through the VM hook is charged this
+// much virtual time instead. This keeps such loops from spinning forever
+// while keeping the simulation deterministic.
+#define LOCKSTEP_VM_HOOK_LOOP_US (10)
+
 // callback for when stop button is pressed in IDE or on hub
 void pbsys_main_stop_program(bool force_stop) {
     static const mp_rom_obj_tuple_t args = {
@@ -89,6 +96,10 @@ void pb_virtualhub_port_deinit(void) {
 void pb_virtualhub_poll(void) {
     while (pbio_do_one_event()) {
     }
+
+    if (pbdrv_clock_linux_lockstep_is_enabled()) {
+        pbdrv_clock_linux_lockstep_tick_us(LOCKSTEP_VM_HOOK_LOOP_US);
+    }
 }
 
 // MICROPY_EVENT_POLL_HOOK
@@ -108,6 +119,13 @@ start:
         return;
     }
 
+    // Nothing else can happen until the next tick, so skip straight to it
+    // instead of sleeping.
+    if (pbdrv_clock_linux_lockstep_is_enabled()) {
+        pbdrv_clock_linux_lockstep_tick_ms();
+        return;
+    }
+
     sigset_t sigmask;
     sigfillset(&sigmask);
 
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2019-2020 The Pybricks Authors
+// Copyright (c) 2019-2024 The Pybricks Authors
 
 // LEGO UART Message Protocol (LUMP) for EV3 and Powered Up I/O devices
 //
@@ -301,6 +301,34 @@ typedef enum {
     LUMP_CMD_VERSION = 0x7,
 } lump_cmd_t;
 
+/**
+ * Mode combination write message. (Powered Up only)
+ *
+ * This is the first byte of the payload of a ::LUMP_CMD_WRITE message that is
+ * sent from the controller to the I/O device to select a mode combination.
+ * It is combined (using bitwise or) with the number of ::LUMP_COMBI_ENTRY
+ * bytes in the payload. The second byte of the payload is the combination
+ * index (always 0) and the entries follow after that. A message without
+ * entries clears the mode combination.
+ *
+ * While a combination is set, ::LUMP_MSG_TYPE_DATA messages from the I/O device
+ * contain the values of all entries, one after the other.
+ */
+#define LUMP_COMBI_WRITE 0x20
+
+/**
+ * Gets a mode combination entry for one value of a mode.
+ *
+ * @param [in]  mode    The mode index number.
+ * @param [in]  dataset The index of the value within the data of the mode.
+ */
+#define LUMP_COMBI_ENTRY(mode, dataset) (((mode) << 4) | (dataset))
+
+/**
+ * Maximum number of mode combinations reported by ::LUMP_INFO_MODE_COMBOS.
+ */
+#define LUMP_MAX_MODE_COMBOS 8
+
 /**
  * Mode information message type.
  *
@@ -378,7 +406,16 @@ typedef enum {
     LUMP_INFO_UNITS         = 0x04,
 
     LUMP_INFO_MAPPING       = 0x05,    // Powered Up only
-    LUMP_INFO_MODE_COMBOS   = 0x06,    // Powered Up only
+    /**
+     * Mode combinations message. (Powered Up only)
+     *
+     * This message is sent from the I/O device to the controller during
+     * syncronization.
+     *
+     * The payload is an array of up to ::LUMP_MAX_MODE_COMBOS little-endian
+     * 16-bit values. Each value is a bit flag of modes that can be combined.
+     */
+    LUMP_INFO_MODE_COMBOS   = 0x06,
     LUMP_INFO_UNK7          = 0x07,    // Powered Up only
     LUMP_INFO_UNK8          = 0x08,    // Powered Up only
     LUMP_INFO_UNK9          = 0x09,    // Powered Up only
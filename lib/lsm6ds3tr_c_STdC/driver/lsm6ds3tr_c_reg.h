@@ -82,6 +82,8 @@ typedef struct {
   void *handle;
   /** Indicates when interrupt callback has completed. */
   volatile bool read_write_done;
+  /** Indicates that the last read could not be started. */
+  bool read_failed;
 } stmdev_ctx_t;
 
 /**
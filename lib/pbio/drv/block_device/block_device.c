@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2024 The Pybricks Authors
+
+// Helpers shared by block device drivers that store data page by page.
+
+#include <pbdrv/config.h>
+
+#if PBDRV_CONFIG_BLOCK_DEVICE
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <pbio/error.h>
+#include <pbio/int_math.h>
+
+#include "block_device.h"
+
+/**
+ * Checks whether a page must be erased and written to hold the given data.
+ *
+ * Writing a page erases it first, so any bytes of the page that come after
+ * the data end up blank (0xFF). The page is compared against that, not just
+ * against the data.
+ *
+ * @param [in]  page        Current page contents.
+ * @param [in]  page_size   Size of the page.
+ * @param [in]  data        Data that goes in this page.
+ * @param [in]  data_size   Size of the data. May be 0 or less than page_size.
+ * @return                  True if the page differs, false if it already
+ *                          holds the data.
+ */
+bool pbdrv_block_device_page_differs(const uint8_t *page, uint32_t page_size, const uint8_t *data, uint32_t data_size) {
+
+    data_size = pbio_int_math_min(data_size, page_size);
+
+    if (data_size && memcmp(page, data, data_size)) {
+        return true;
+    }
+
+    for (uint32_t i = data_size; i < page_size; i++) {
+        if (page[i] != 0xFF) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Stores data in memory-mapped storage, page by page.
+ *
+ * Only the pages that differ from the data are erased and written. This
+ * covers the whole storage area, so any pages after the data that are not
+ * blank are erased too. Some hubs check the storage area with a checksum,
+ * so old data must not be left behind when the new data is smaller.
+ *
+ * @param [in]  storage         Start of the memory-mapped storage area.
+ * @param [in]  storage_size    Size of the storage area.
+ * @param [in]  page_size       Size of one page. Must divide storage_size.
+ * @param [in]  data            Data to store.
+ * @param [in]  data_size       Size of the data.
+ * @param [in]  write_page      Function that erases one page and then writes
+ *                              the given data to it.
+ * @return                      ::PBIO_SUCCESS or the first error returned by
+ *                              @p write_page.
+ */
+pbio_error_t pbdrv_block_device_store_pages(const uint8_t *storage, uint32_t storage_size, uint32_t page_size,
+    const uint8_t *data, uint32_t data_size, pbdrv_block_device_write_page_func_t write_page) {
+
+    for (uint32_t offset = 0; offset < storage_size; offset += page_size) {
+        // Pages after the data should be blank.
+        uint32_t size = offset < data_size ? pbio_int_math_min(data_size - offset, page_size) : 0;
+        const uint8_t *page_data = size ? data + offset : NULL;
+
+        // Skip page if nothing changed.
+        if (!pbdrv_block_device_page_differs(storage + offset, page_size, page_data, size)) {
+            continue;
+        }
+
+        pbio_error_t err = write_page(offset, page_data, size);
+        if (err != PBIO_SUCCESS) {
+            return err;
+        }
+    }
+
+    return PBIO_SUCCESS;
+}
+
+#endif // PBDRV_CONFIG_BLOCK_DEVICE
@@ -1,9 +1,10 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2022 The Pybricks Authors
+// Copyright (c) 2022-2024 The Pybricks Authors
 
 #ifndef _INTERNAL_PBDRV_BLOCK_DEVICE_H_
 #define _INTERNAL_PBDRV_BLOCK_DEVICE_H_
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include <pbdrv/config.h>
@@ -11,8 +12,23 @@
 
 #if PBDRV_CONFIG_BLOCK_DEVICE
 
+/**
+ * Erases one page and then writes the data to it.
+ *
+ * @param [in]  offset  Offset of the page from the start of the storage area.
+ * @param [in]  data    Data to write. Any remaining bytes stay erased.
+ * @param [in]  size    Size of the data. May be 0 to only erase the page.
+ * @return              ::PBIO_SUCCESS or an error if erasing or writing failed.
+ */
+typedef pbio_error_t (*pbdrv_block_device_write_page_func_t)(uint32_t offset, const uint8_t *data, uint32_t size);
+
 void pbdrv_block_device_init(void);
 
+bool pbdrv_block_device_page_differs(const uint8_t *page, uint32_t page_size, const uint8_t *data, uint32_t data_size);
+
+pbio_error_t pbdrv_block_device_store_pages(const uint8_t *storage, uint32_t storage_size, uint32_t page_size,
+    const uint8_t *data, uint32_t data_size, pbdrv_block_device_write_page_func_t write_page);
+
 #else // PBDRV_CONFIG_BLOCK_DEVICE
 
 static inline void pbdrv_block_device_init(void) {
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2022 The Pybricks Authors
+// Copyright (c) 2022-2024 The Pybricks Authors
 
 // Block device driver for internal flash on STM32 boards.
 
@@ -13,6 +13,7 @@
 #include <contiki.h>
 
 #include "../core.h"
+#include "block_device.h"
 
 #include <pbdrv/block_device.h>
 
@@ -48,32 +49,21 @@ typedef union _double_word_t {
     uint64_t dword;
 } double_word_t;
 
-static pbio_error_t block_device_erase_and_write(uint8_t *buffer, uint32_t size) {
+static pbio_error_t block_device_erase_and_write_page(uint32_t offset, const uint8_t *data, uint32_t size) {
 
     static const uint32_t base_address = (uint32_t)(&_pbdrv_block_device_storage_start[0]);
 
-    // Exit if size is 0, too big, or not a multiple of double-word size.
-    if (size == 0 || size > PBDRV_CONFIG_BLOCK_DEVICE_FLASH_STM32_SIZE || size % sizeof(uint64_t)) {
-        return PBIO_ERROR_INVALID_ARG;
-    }
-
-    // Unlock flash for writing.
-    HAL_StatusTypeDef hal_err = HAL_FLASH_Unlock();
-    if (hal_err != HAL_OK) {
-        return PBIO_ERROR_IO;
-    }
-
-    // Erase the whole user storage area.
+    // Erase this page.
     FLASH_EraseInitTypeDef erase_init = {
         #if defined(STM32F0)
-        .PageAddress = base_address,
+        .PageAddress = base_address + offset,
         #elif defined(STM32L4)
         .Banks = FLASH_BANK_1, // Hard coded for STM32L431RC.
-        .Page = (FLASH_SIZE - (PBDRV_CONFIG_BLOCK_DEVICE_FLASH_STM32_SIZE)) / FLASH_PAGE_SIZE,
+        .Page = (FLASH_SIZE - (PBDRV_CONFIG_BLOCK_DEVICE_FLASH_STM32_SIZE) + offset) / FLASH_PAGE_SIZE,
         #else
         #error "Unsupported target."
         #endif
-        .NbPages = PBDRV_CONFIG_BLOCK_DEVICE_FLASH_STM32_SIZE / FLASH_PAGE_SIZE,
+        .NbPages = 1,
         .TypeErase = FLASH_TYPEERASE_PAGES
     };
 
@@ -83,37 +73,54 @@ static pbio_error_t block_device_erase_and_write(uint8_t *buffer, uint32_t size)
 
     // Erase and re-enable interrupts.
     uint32_t page_error;
-    hal_err = HAL_FLASHEx_Erase(&erase_init, &page_error);
+    HAL_StatusTypeDef hal_err = HAL_FLASHEx_Erase(&erase_init, &page_error);
     __set_PRIMASK(state);
     if (hal_err != HAL_OK || page_error != 0xFFFFFFFFU) {
-        HAL_FLASH_Lock();
         return PBIO_ERROR_IO;
     }
 
     // Write data chunk by chunk.
-    uint32_t done = 0;
-    while (done < size) {
+    for (uint32_t done = 0; done < size; done += sizeof(double_word_t)) {
 
         // Disable interrupts while writing as above.
         state = __get_PRIMASK();
         __disable_irq();
 
         // Write the data and re-enable interrupts.
-        hal_err = HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, base_address + done, *(uint64_t *)(buffer + done));
+        hal_err = HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, base_address + offset + done, *(const uint64_t *)(data + done));
         __set_PRIMASK(state);
         if (hal_err != HAL_OK) {
-            HAL_FLASH_Lock();
             return PBIO_ERROR_IO;
         }
+    }
 
-        // Update write progress.
-        done += sizeof(double_word_t);
+    return PBIO_SUCCESS;
+}
+
+static pbio_error_t block_device_erase_and_write(uint8_t *buffer, uint32_t size) {
+
+    // Exit if size is 0, too big, or not a multiple of double-word size.
+    if (size == 0 || size > PBDRV_CONFIG_BLOCK_DEVICE_FLASH_STM32_SIZE || size % sizeof(uint64_t)) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+
+    // Unlock flash for writing.
+    HAL_StatusTypeDef hal_err = HAL_FLASH_Unlock();
+    if (hal_err != HAL_OK) {
+        return PBIO_ERROR_IO;
     }
 
+    // Store page by page, up to the end of the storage area. Pages that
+    // already hold the data are skipped, so only the pages with changes are
+    // erased and written. Stale pages after the data are erased, since the
+    // bootloader checksum covers them on some hubs.
+    pbio_error_t err = pbdrv_block_device_store_pages(_pbdrv_block_device_storage_start,
+        PBDRV_CONFIG_BLOCK_DEVICE_FLASH_STM32_SIZE, FLASH_PAGE_SIZE, buffer, size, block_device_erase_and_write_page);
+
     // Lock flash on completion.
     HAL_FLASH_Lock();
 
-    return PBIO_SUCCESS;
+    return err;
 }
 
 PT_THREAD(pbdrv_block_device_store(struct pt *pt, uint8_t *buffer, uint32_t size, pbio_error_t *err)) {
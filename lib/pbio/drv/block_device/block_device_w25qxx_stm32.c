@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2022 The Pybricks Authors
+// Copyright (c) 2022-2024 The Pybricks Authors
 
 // Block device driver for W25Qxx SPI flash memory chip connected to STM32.
 
@@ -16,6 +16,7 @@
 #include <contiki.h>
 
 #include "../core.h"
+#include "block_device.h"
 #include "block_device_w25qxx_stm32.h"
 
 #include <pbdrv/block_device.h>
@@ -351,6 +352,32 @@ static spi_command_t cmd_data_read = {
     .operation = SPI_RECV,
 };
 
+/**
+ * Read one chunk of data from flash.
+ *
+ * Size must not exceed FLASH_SIZE_READ.
+ */
+static PT_THREAD(flash_read(struct pt *pt, uint32_t address, uint8_t *buffer, uint32_t size, pbio_error_t *err)) {
+
+    static struct pt child;
+
+    PT_BEGIN(pt);
+
+    // Set address for this read request and send it.
+    set_address_be(&cmd_request_read.buffer[1], address);
+    PT_SPAWN(pt, &child, spi_command_thread(&child, &cmd_request_read, err));
+    if (*err != PBIO_SUCCESS) {
+        PT_EXIT(pt);
+    }
+
+    // Receive the data.
+    cmd_data_read.buffer = buffer;
+    cmd_data_read.size = size;
+    PT_SPAWN(pt, &child, spi_command_thread(&child, &cmd_data_read, err));
+
+    PT_END(pt);
+}
+
 PT_THREAD(pbdrv_block_device_read(struct pt *pt, uint32_t offset, uint8_t *buffer, uint32_t size, pbio_error_t *err)) {
 
     static struct pt child;
@@ -375,18 +402,8 @@ PT_THREAD(pbdrv_block_device_read(struct pt *pt, uint32_t offset, uint8_t *buffe
     // Split up reads to maximum chunk size.
     for (size_done = 0; size_done < size; size_done += size_now) {
         size_now = pbio_int_math_min(size - size_done, FLASH_SIZE_READ);
-
-        // Set address for this read request and send it.
-        set_address_be(&cmd_request_read.buffer[1], PBDRV_CONFIG_BLOCK_DEVICE_W25QXX_STM32_START_ADDRESS + offset + size_done);
-        PT_SPAWN(pt, &child, spi_command_thread(&child, &cmd_request_read, err));
-        if (*err != PBIO_SUCCESS) {
-            goto out;
-        }
-
-        // Receive the data.
-        cmd_data_read.buffer = buffer + size_done;
-        cmd_data_read.size = size_now;
-        PT_SPAWN(pt, &child, spi_command_thread(&child, &cmd_data_read, err));
+        PT_SPAWN(pt, &child, flash_read(&child,
+            PBDRV_CONFIG_BLOCK_DEVICE_W25QXX_STM32_START_ADDRESS + offset + size_done, buffer + size_done, size_now, err));
         if (*err != PBIO_SUCCESS) {
             goto out;
         }
@@ -457,10 +474,14 @@ static PT_THREAD(flash_erase_or_write(struct pt *pt, uint32_t address, uint8_t *
     PT_END(pt);
 }
 
+// Flash contents to compare with the data to be stored, one page at a time.
+static uint8_t compare_data[FLASH_SIZE_WRITE];
+
 PT_THREAD(pbdrv_block_device_store(struct pt *pt, uint8_t *buffer, uint32_t size, pbio_error_t *err)) {
 
     static struct pt child;
     static uint32_t offset;
+    static uint32_t sector_size;
     static uint32_t size_now;
     static uint32_t size_done;
 
@@ -479,26 +500,52 @@ PT_THREAD(pbdrv_block_device_store(struct pt *pt, uint8_t *buffer, uint32_t size
 
     bdev.process = PROCESS_CURRENT();
 
-    // Erase sector by sector.
+    // Store sector by sector. Usually only a few bytes have changed since the
+    // data was loaded, so sectors that already hold the data are skipped. This
+    // is much faster than erasing and writing everything, and reduces wear.
     for (offset = 0; offset < size; offset += FLASH_SIZE_ERASE) {
+        sector_size = pbio_int_math_min(size - offset, FLASH_SIZE_ERASE);
+
+        // Compare page by page until a difference is found. This includes the
+        // part of the last sector after the data, which should be blank.
+        for (size_done = 0; size_done < FLASH_SIZE_ERASE; size_done += FLASH_SIZE_WRITE) {
+            PT_SPAWN(pt, &child, flash_read(&child,
+                PBDRV_CONFIG_BLOCK_DEVICE_W25QXX_STM32_START_ADDRESS + offset + size_done, compare_data, FLASH_SIZE_WRITE, err));
+            if (*err != PBIO_SUCCESS) {
+                goto out;
+            }
+            size_now = size_done < sector_size ? sector_size - size_done : 0;
+            if (pbdrv_block_device_page_differs(compare_data, FLASH_SIZE_WRITE,
+                size_now ? buffer + offset + size_done : NULL, size_now)) {
+                break;
+            }
+        }
+
+        // Skip sector if nothing changed.
+        if (size_done == FLASH_SIZE_ERASE) {
+            continue;
+        }
+
         // Writing size 0 means erase.
         PT_SPAWN(pt, &child, flash_erase_or_write(&child,
             PBDRV_CONFIG_BLOCK_DEVICE_W25QXX_STM32_START_ADDRESS + offset, NULL, 0, err));
         if (*err != PBIO_SUCCESS) {
             goto out;
         }
-    }
 
-    // Write page by page.
-    for (size_done = 0; size_done < size; size_done += size_now) {
-        size_now = pbio_int_math_min(size - size_done, FLASH_SIZE_WRITE);
-        PT_SPAWN(pt, &child, flash_erase_or_write(&child,
-            PBDRV_CONFIG_BLOCK_DEVICE_W25QXX_STM32_START_ADDRESS + size_done, buffer + size_done, size_now, err));
-        if (*err != PBIO_SUCCESS) {
-            goto out;
+        // Write page by page.
+        for (size_done = 0; size_done < sector_size; size_done += size_now) {
+            size_now = pbio_int_math_min(sector_size - size_done, FLASH_SIZE_WRITE);
+            PT_SPAWN(pt, &child, flash_erase_or_write(&child,
+                PBDRV_CONFIG_BLOCK_DEVICE_W25QXX_STM32_START_ADDRESS + offset + size_done, buffer + offset + size_done, size_now, err));
+            if (*err != PBIO_SUCCESS) {
+                goto out;
+            }
         }
     }
 
+    *err = PBIO_SUCCESS;
+
 out:
     bdev.process = NULL;
 
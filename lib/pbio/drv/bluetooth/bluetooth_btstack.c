@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2020-2023 The Pybricks Authors
+// Copyright (c) 2020-2024 The Pybricks Authors
 
 // Bluetooth driver using BlueKitchen BTStack.
 
@@ -16,6 +16,7 @@
 #include <contiki-lib.h>
 
 #include <pbdrv/bluetooth.h>
+#include <pbio/int_math.h>
 #include <pbio/protocol.h>
 #include <pbio/task.h>
 #include <pbio/version.h>
@@ -726,6 +727,24 @@ void pbdrv_bluetooth_send(pbdrv_bluetooth_send_context_t *context) {
     }
 }
 
+uint16_t pbdrv_bluetooth_get_max_notification_size(pbdrv_bluetooth_connection_t connection) {
+    hci_con_handle_t con_handle = HCI_CON_HANDLE_INVALID;
+
+    if (connection == PBDRV_BLUETOOTH_CONNECTION_PYBRICKS) {
+        con_handle = pybricks_con_handle;
+    } else if (connection == PBDRV_BLUETOOTH_CONNECTION_UART) {
+        con_handle = uart_con_handle;
+    }
+
+    // This is 0 if there is no connection.
+    uint16_t mtu = att_server_get_mtu(con_handle);
+    if (mtu < ATT_DEFAULT_MTU) {
+        return ATT_DEFAULT_MTU - 3;
+    }
+
+    return pbio_int_math_min(mtu, PBDRV_BLUETOOTH_MAX_MTU_SIZE) - 3;
+}
+
 void pbdrv_bluetooth_set_receive_handler(pbdrv_bluetooth_receive_handler_t handler) {
     receive_handler = handler;
 }
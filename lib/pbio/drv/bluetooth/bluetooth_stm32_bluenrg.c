@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2023 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 // Bluetooth for STM32 MCU with STMicro BlueNRG-MS
 
@@ -412,6 +412,11 @@ void pbdrv_bluetooth_send(pbdrv_bluetooth_send_context_t *context) {
     start_task(&task, send_value_notification, context);
 }
 
+uint16_t pbdrv_bluetooth_get_max_notification_size(pbdrv_bluetooth_connection_t connection) {
+    // The MTU is not negotiated on this chip.
+    return ATT_MTU - 3;
+}
+
 void pbdrv_bluetooth_set_receive_handler(pbdrv_bluetooth_receive_handler_t handler) {
     receive_handler = handler;
 }
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2023 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 // Bluetooth for STM32 MCU with TI CC2640
 
@@ -132,6 +132,8 @@ static bool busy_disconnecting;
 static uint16_t conn_handle = NO_CONNECTION;
 static uint16_t conn_mtu;
 
+_Static_assert(PBDRV_BLUETOOTH_MAX_MTU_SIZE <= ATT_MAX_MTU_SIZE, "notifications must fit in ATT_HandleValueNoti()");
+
 // Bonding status of the peripheral.
 static uint16_t bond_auth_err = NO_AUTH;
 
@@ -485,6 +487,15 @@ void pbdrv_bluetooth_send(pbdrv_bluetooth_send_context_t *context) {
     start_task(&task, send_value_notification, context);
 }
 
+uint16_t pbdrv_bluetooth_get_max_notification_size(pbdrv_bluetooth_connection_t connection) {
+    // There is only one central connection, so the Pybricks and UART services
+    // share the same MTU.
+    if (conn_handle == NO_CONNECTION || conn_mtu < ATT_MTU_SIZE) {
+        return ATT_MTU_SIZE - 3;
+    }
+    return conn_mtu - 3;
+}
+
 void pbdrv_bluetooth_set_receive_handler(pbdrv_bluetooth_receive_handler_t handler) {
     receive_handler = handler;
 }
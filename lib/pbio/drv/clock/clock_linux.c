@@ -5,10 +5,74 @@
 
 #if PBDRV_CONFIG_CLOCK_LINUX
 
+#include <stdbool.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <time.h>
 #include <unistd.h>
 
+#include <contiki.h>
+
+#include <pbdrv/clock.h>
+
+// The LOCKSTEP option adds a mode where the clock does not follow the wall
+// clock. Instead, time advances only when pbdrv_clock_linux_lockstep_tick_us()
+// is called, which the application does whenever it would otherwise wait. This
+// works like pbio_test_clock_tick() in the test clock driver, so simulations
+// run as fast as the CPU allows and give the same result on every run.
+//
+// The mode is enabled at runtime by setting the PBIO_VIRTUAL_CLOCK_LOCKSTEP
+// environment variable to a nonzero value.
+
+#if PBDRV_CONFIG_CLOCK_LINUX_LOCKSTEP
+
+static bool lockstep_enabled;
+static uint64_t lockstep_us;
+
+/**
+ * Tests if the clock is in lock-step mode.
+ *
+ * @return  True if time advances only through pbdrv_clock_linux_lockstep_tick_us().
+ */
+bool pbdrv_clock_linux_lockstep_is_enabled(void) {
+    return lockstep_enabled;
+}
+
+/**
+ * Advances the clock in lock-step mode and polls etimers if a new
+ * millisecond has started.
+ *
+ * @param [in]  us  The number of microseconds to add to the clock.
+ */
+void pbdrv_clock_linux_lockstep_tick_us(uint32_t us) {
+    uint64_t ms_before = lockstep_us / 1000;
+    lockstep_us += us;
+    if (lockstep_us / 1000 != ms_before) {
+        etimer_request_poll();
+    }
+}
+
+/**
+ * Advances the clock in lock-step mode to the start of the next millisecond
+ * and polls etimers.
+ */
+void pbdrv_clock_linux_lockstep_tick_ms(void) {
+    pbdrv_clock_linux_lockstep_tick_us(1000 - lockstep_us % 1000);
+}
+
+static void pbdrv_clock_linux_lockstep_init(void) {
+    const char *value = getenv("PBIO_VIRTUAL_CLOCK_LOCKSTEP");
+    lockstep_enabled = value && atoi(value);
+    lockstep_us = 0;
+}
+
+#else // PBDRV_CONFIG_CLOCK_LINUX_LOCKSTEP
+
+static inline void pbdrv_clock_linux_lockstep_init(void) {
+}
+
+#endif // PBDRV_CONFIG_CLOCK_LINUX_LOCKSTEP
+
 // The SIGNAL option adds a timer that acts as the 1ms tick on embedded systems.
 
 #if PBDRV_CONFIG_CLOCK_LINUX_SIGNAL
@@ -18,8 +82,6 @@
 #include <signal.h>
 #include <stdio.h>
 
-#include <contiki.h>
-
 #define NSEC_PER_MSEC       1000000
 
 #define TIMER_SIGNAL        SIGRTMIN
@@ -45,6 +107,13 @@ void pbdrv_clock_init(void) {
 
     main_thread = pthread_self();
 
+    pbdrv_clock_linux_lockstep_init();
+
+    // In lock-step mode, the application drives the clock instead.
+    if (pbdrv_clock_linux_lockstep_is_enabled()) {
+        return;
+    }
+
     // set up 1ms tick using signal
 
     struct sigaction sa = {
@@ -87,23 +156,39 @@ void pbdrv_clock_init(void) {
 #else // PBDRV_CONFIG_CLOCK_LINUX_SIGNAL
 
 void pbdrv_clock_init(void) {
+    pbdrv_clock_linux_lockstep_init();
 }
 
 #endif // PBDRV_CONFIG_CLOCK_LINUX_SIGNAL
 
 uint32_t pbdrv_clock_get_ms(void) {
+    #if PBDRV_CONFIG_CLOCK_LINUX_LOCKSTEP
+    if (lockstep_enabled) {
+        return lockstep_us / 1000;
+    }
+    #endif
     struct timespec time_val;
     clock_gettime(CLOCK_MONOTONIC_RAW, &time_val);
     return time_val.tv_sec * 1000 + time_val.tv_nsec / 1000000;
 }
 
 uint32_t pbdrv_clock_get_100us(void) {
+    #if PBDRV_CONFIG_CLOCK_LINUX_LOCKSTEP
+    if (lockstep_enabled) {
+        return lockstep_us / 100;
+    }
+    #endif
     struct timespec time_val;
     clock_gettime(CLOCK_MONOTONIC_RAW, &time_val);
     return time_val.tv_sec * 10000 + time_val.tv_nsec / 100000;
 }
 
 uint32_t pbdrv_clock_get_us(void) {
+    #if PBDRV_CONFIG_CLOCK_LINUX_LOCKSTEP
+    if (lockstep_enabled) {
+        return lockstep_us;
+    }
+    #endif
     struct timespec time_val;
     clock_gettime(CLOCK_MONOTONIC_RAW, &time_val);
     return time_val.tv_sec * 1000000 + time_val.tv_nsec / 1000;
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2020-2023 The Pybricks Authors
+// Copyright (c) 2020-2024 The Pybricks Authors
 
 // IMU driver for STMicroelectronics LSM6DS3TR-C accel/gyro connected to STM32 MCU.
 
@@ -27,6 +27,19 @@
 #include "../core.h"
 #include "./imu_lsm6ds3tr_c_stm32.h"
 
+/**
+ * Number of gyro and accelerometer frames in the FIFO that trigger an
+ * interrupt. Each frame is six 16-bit words: gyro XYZ followed by accel XYZ.
+ * Higher values mean fewer interrupts and I2C transfers but more latency.
+ */
+#define LSM6DS3TR_FIFO_FRAMES_WATERMARK (4)
+
+/**
+ * Maximum number of frames read from the FIFO in one burst. Any remaining
+ * frames are read immediately after processing this batch.
+ */
+#define LSM6DS3TR_FIFO_FRAMES_MAX (16)
+
 typedef enum {
     /** Initialization is not complete yet. */
     IMU_INIT_STATE_BUSY,
@@ -49,6 +62,10 @@ struct _pbdrv_imu_dev_t {
     pbdrv_imu_handle_stationary_data_func_t handle_stationary_data;
     /** Raw data. */
     int16_t data[6];
+    /** Raw FIFO status registers FIFO_STATUS1 to FIFO_STATUS4. */
+    uint8_t fifo_status[4];
+    /** Raw data frames read from the FIFO in one burst. */
+    int16_t fifo_data[LSM6DS3TR_FIFO_FRAMES_MAX][6];
     /** Start time of window in which stationary samples are recorded (us)*/
     uint32_t stationary_time_start;
     /** Raw data point to which new samples are compared to detect stationary. */
@@ -67,6 +84,9 @@ struct _pbdrv_imu_dev_t {
     volatile bool int1;
 };
 
+/** FIFO_OVER bit in FIFO_STATUS2. */
+#define FIFO_STATUS2_OVER_RUN (1 << 6)
+
 /** The size of the data field in pbdrv_imu_dev_t in bytes. */
 #define NUM_DATA_BYTES sizeof(((struct _pbdrv_imu_dev_t *)0)->data)
 
@@ -75,6 +95,7 @@ struct _pbdrv_imu_dev_t {
 #define LSM6DS3TR_INITIAL_DATA_RATE (833)
 #define LSM6DS3TR_GYRO_DATA_RATE (LSM6DS3TR_C_GY_ODR_833Hz)
 #define LSM6DS3TR_ACCL_DATA_RATE (LSM6DS3TR_C_XL_ODR_833Hz)
+#define LSM6DS3TR_FIFO_DATA_RATE (LSM6DS3TR_C_FIFO_833Hz)
 
 static pbdrv_imu_dev_t global_imu_dev;
 PROCESS(pbdrv_imu_lsm6ds3tr_c_stm32_process, "LSM6DS3TR-C");
@@ -148,6 +169,10 @@ static void pbdrv_imu_lsm6ds3tr_c_stm32_write_reg(void *handle, uint8_t reg, uin
 static void pbdrv_imu_lsm6ds3tr_c_stm32_read_reg(void *handle, uint8_t reg, uint8_t *data, uint16_t len) {
     HAL_StatusTypeDef ret = HAL_I2C_Mem_Read_IT(&global_imu_dev.hi2c, LSM6DS3TR_C_I2C_ADD_L, reg, I2C_MEMADD_SIZE_8BIT, data, len);
 
+    // If the read did not start, the buffer still holds old data, which the
+    // HAL error flags don't always tell us about.
+    global_imu_dev.ctx.read_failed = ret != HAL_OK;
+
     if (ret != HAL_OK) {
         // If there was an error, the interrupt will never come so we have to set the flag here.
         global_imu_dev.ctx.read_write_done = true;
@@ -233,17 +258,19 @@ static PT_THREAD(pbdrv_imu_lsm6ds3tr_c_stm32_init(struct pt *pt)) {
     imu_dev->config.gyro_stationary_threshold = 0;
     imu_dev->config.accel_stationary_threshold = 0;
 
-    // Configure INT1 to trigger when new gyro data is ready.
+    // Store gyro and accel data in the FIFO at the full data rate, so we can
+    // read several samples at once instead of one sample per interrupt.
+    PT_SPAWN(pt, &child, lsm6ds3tr_c_fifo_gy_batch_set(&child, ctx, LSM6DS3TR_C_FIFO_GY_NO_DEC));
+    PT_SPAWN(pt, &child, lsm6ds3tr_c_fifo_xl_batch_set(&child, ctx, LSM6DS3TR_C_FIFO_XL_NO_DEC));
+    PT_SPAWN(pt, &child, lsm6ds3tr_c_fifo_watermark_set(&child, ctx, LSM6DS3TR_FIFO_FRAMES_WATERMARK * 6));
+    PT_SPAWN(pt, &child, lsm6ds3tr_c_fifo_data_rate_set(&child, ctx, LSM6DS3TR_FIFO_DATA_RATE));
+    PT_SPAWN(pt, &child, lsm6ds3tr_c_fifo_mode_set(&child, ctx, LSM6DS3TR_C_STREAM_MODE));
+
+    // Configure INT1 to trigger when the FIFO watermark is reached.
     PT_SPAWN(pt, &child, lsm6ds3tr_c_pin_int1_route_set(&child, ctx, (lsm6ds3tr_c_int1_route_t) {
-        .int1_drdy_g = 1,
+        .int1_fth = 1,
     }));
 
-    // If we leave the default latched mode, sometimes we don't get the INT1 interrupt.
-    PT_SPAWN(pt, &child, lsm6ds3tr_c_data_ready_mode_set(&child, ctx, LSM6DS3TR_C_DRDY_PULSED));
-
-    // Enable rounding mode so we can get gyro + accel in continuous reads.
-    PT_SPAWN(pt, &child, lsm6ds3tr_c_rounding_mode_set(&child, ctx, LSM6DS3TR_C_ROUND_GY_XL));
-
     if (HAL_I2C_GetError(hi2c) != HAL_I2C_ERROR_NONE) {
         imu_dev->init_state = IMU_INIT_STATE_FAILED;
         PT_EXIT(pt);
@@ -258,14 +285,14 @@ static inline bool is_bounded(int16_t diff, int16_t threshold) {
     return diff < threshold && diff > -threshold;
 }
 
-static void pbdrv_imu_lsm6ds3tr_c_stm32_reset_stationary_buffer(pbdrv_imu_dev_t *imu_dev) {
+static void pbdrv_imu_lsm6ds3tr_c_stm32_reset_stationary_buffer(pbdrv_imu_dev_t *imu_dev, uint32_t time) {
     imu_dev->stationary_sample_count = 0;
-    imu_dev->stationary_time_start = pbdrv_clock_get_us();
+    imu_dev->stationary_time_start = time;
     memset(&imu_dev->stationary_accel_data_sum, 0, sizeof(imu_dev->stationary_accel_data_sum));
     memset(&imu_dev->stationary_gyro_data_sum, 0, sizeof(imu_dev->stationary_gyro_data_sum));
 }
 
-static void pbdrv_imu_lsm6ds3tr_c_stm32_update_stationary_status(pbdrv_imu_dev_t *imu_dev) {
+static void pbdrv_imu_lsm6ds3tr_c_stm32_update_stationary_status(pbdrv_imu_dev_t *imu_dev, uint32_t time) {
 
     // Check whether still stationary compared to constant start sample.
     if (!is_bounded(imu_dev->data[0] - imu_dev->stationary_data_start[0], imu_dev->config.gyro_stationary_threshold) ||
@@ -277,7 +304,7 @@ static void pbdrv_imu_lsm6ds3tr_c_stm32_update_stationary_status(pbdrv_imu_dev_t
         ) {
         // Not stationary anymore, so reset counter and gyro sum data so we can start over.
         imu_dev->stationary_now = false;
-        pbdrv_imu_lsm6ds3tr_c_stm32_reset_stationary_buffer(imu_dev);
+        pbdrv_imu_lsm6ds3tr_c_stm32_reset_stationary_buffer(imu_dev, time);
 
         // Current sample becomes new starting value to compare to.
         memcpy(&imu_dev->stationary_data_start[0], &imu_dev->data[0], NUM_DATA_BYTES);
@@ -302,7 +329,7 @@ static void pbdrv_imu_lsm6ds3tr_c_stm32_update_stationary_status(pbdrv_imu_dev_t
     imu_dev->stationary_now = true;
 
     // The actual sampling rate is slightly different from the configured rate, so measure it.
-    imu_dev->config.sample_time = (pbdrv_clock_get_us() - imu_dev->stationary_time_start) / 1000000.0f / imu_dev->stationary_sample_count;
+    imu_dev->config.sample_time = (time - imu_dev->stationary_time_start) / 1000000.0f / imu_dev->stationary_sample_count;
 
     // Process the data recorded while stationary.
     if (imu_dev->handle_stationary_data) {
@@ -310,15 +337,19 @@ static void pbdrv_imu_lsm6ds3tr_c_stm32_update_stationary_status(pbdrv_imu_dev_t
     }
 
     // Reset counter and gyro sum data so we can start over.
-    pbdrv_imu_lsm6ds3tr_c_stm32_reset_stationary_buffer(imu_dev);
+    pbdrv_imu_lsm6ds3tr_c_stm32_reset_stationary_buffer(imu_dev, time);
 }
 
 PROCESS_THREAD(pbdrv_imu_lsm6ds3tr_c_stm32_process, ev, data) {
     pbdrv_imu_dev_t *imu_dev = &global_imu_dev;
     I2C_HandleTypeDef *hi2c = &imu_dev->hi2c;
+    stmdev_ctx_t *ctx = &imu_dev->ctx;
 
     static struct pt child;
-    static uint8_t buf[NUM_DATA_BYTES];
+    static uint32_t num_frames;
+    static uint32_t num_frames_available;
+    static bool fifo_pending;
+    static uint32_t time_read;
 
     PROCESS_BEGIN();
 
@@ -331,64 +362,86 @@ PROCESS_THREAD(pbdrv_imu_lsm6ds3tr_c_stm32_process, ev, data) {
         PROCESS_EXIT();
     }
 
-retry:
-    // Write the register address of the start of the gyro and accel data.
-    buf[0] = LSM6DS3TR_C_OUTX_L_G;
-    imu_dev->ctx.read_write_done = false;
-    HAL_StatusTypeDef ret = HAL_I2C_Master_Seq_Transmit_IT(
-        &imu_dev->hi2c, LSM6DS3TR_C_I2C_ADD_L, buf, 1, I2C_FIRST_FRAME);
+    // The sensor stores the gyro and accel data in its FIFO. When the number
+    // of samples reaches the watermark, INT1 goes high and we read all
+    // available samples in one I2C burst. This takes far fewer interrupts
+    // and I2C transactions than reading one sample at a time.
 
-    if (ret != HAL_OK) {
-        pbdrv_imu_lsm6ds3tr_c_stm32_i2c_reset(hi2c);
-        goto retry;
-    }
-
-    PROCESS_WAIT_UNTIL(imu_dev->ctx.read_write_done);
-
-    if (HAL_I2C_GetError(hi2c) != HAL_I2C_ERROR_NONE) {
-        pbdrv_imu_lsm6ds3tr_c_stm32_i2c_reset(hi2c);
-        goto retry;
-    }
-
-    // Since we configured the IMU to enable "rounding" on the accel and gyro
-    // data registers, we can just keep reading forever and it automatically
-    // loops around. This way we don't have to keep writing the register
-    // value each time we want to read new data. This saves CPU usage since
-    // we have fewer interrupts per sample.
+    // Read once without waiting, in case the watermark was already reached
+    // before we started waiting for the rising edge of INT1.
+    fifo_pending = true;
 
     for (;;) {
-        PROCESS_WAIT_EVENT_UNTIL(atomic_exchange(&imu_dev->int1, false));
+        // Wait for the watermark, unless the FIFO level was at or above the
+        // watermark when we last read it. INT1 stays high as long as that is
+        // the case, so there may not be another rising edge to wait for.
+        PROCESS_WAIT_EVENT_UNTIL(atomic_exchange(&imu_dev->int1, false) || fifo_pending);
 
-        imu_dev->ctx.read_write_done = false;
-        ret = HAL_I2C_Master_Seq_Receive_IT(
-            &imu_dev->hi2c, LSM6DS3TR_C_I2C_ADD_L, buf, NUM_DATA_BYTES, I2C_NEXT_FRAME);
+        // Read how many words are in the FIFO and which one is next.
+        lsm6ds3tr_c_read_reg(ctx, LSM6DS3TR_C_FIFO_STATUS1, imu_dev->fifo_status, sizeof(imu_dev->fifo_status));
+        PROCESS_WAIT_UNTIL(ctx->read_write_done);
+        time_read = pbdrv_clock_get_us();
 
-        if (ret != HAL_OK) {
+        if (ctx->read_failed || HAL_I2C_GetError(hi2c) != HAL_I2C_ERROR_NONE) {
             pbdrv_imu_lsm6ds3tr_c_stm32_i2c_reset(hi2c);
-            goto retry;
+            fifo_pending = true;
+            continue;
         }
 
-        PROCESS_WAIT_UNTIL(imu_dev->ctx.read_write_done);
+        uint32_t num_words = imu_dev->fifo_status[0] | (imu_dev->fifo_status[1] & 0x07) << 8;
+        uint32_t pattern = imu_dev->fifo_status[2] | (imu_dev->fifo_status[3] & 0x03) << 8;
+
+        // The FIFO should always start with gyro X, since we only read whole
+        // frames. If not, or if the sensor reports that the FIFO overran and
+        // samples were lost, start over.
+        if (pattern != 0 || (imu_dev->fifo_status[1] & FIFO_STATUS2_OVER_RUN)) {
+            PROCESS_PT_SPAWN(&child, lsm6ds3tr_c_fifo_mode_set(&child, ctx, LSM6DS3TR_C_BYPASS_MODE));
+            PROCESS_PT_SPAWN(&child, lsm6ds3tr_c_fifo_mode_set(&child, ctx, LSM6DS3TR_C_STREAM_MODE));
+            fifo_pending = false;
+            continue;
+        }
 
-        if (HAL_I2C_GetError(hi2c) != HAL_I2C_ERROR_NONE) {
-            pbdrv_imu_lsm6ds3tr_c_stm32_i2c_reset(hi2c);
-            goto retry;
+        num_frames_available = num_words / 6;
+        fifo_pending = num_frames_available >= LSM6DS3TR_FIFO_FRAMES_WATERMARK;
+        num_frames = num_frames_available;
+        if (num_frames > LSM6DS3TR_FIFO_FRAMES_MAX) {
+            num_frames = LSM6DS3TR_FIFO_FRAMES_MAX;
+        }
+        if (num_frames == 0) {
+            continue;
         }
 
-        memcpy(&imu_dev->data[0], buf, NUM_DATA_BYTES);
+        // Read all frames in one burst. The register address automatically
+        // wraps around so the whole FIFO can be read from FIFO_DATA_OUT_L.
+        lsm6ds3tr_c_read_reg(ctx, LSM6DS3TR_C_FIFO_DATA_OUT_L, (uint8_t *)imu_dev->fifo_data, num_frames * NUM_DATA_BYTES);
+        PROCESS_WAIT_UNTIL(ctx->read_write_done);
 
-        // Account for mounting orientation in hub. Any other tranformations
-        // are applied at the higher level in pbio.
-        imu_dev->data[0] *= PBDRV_CONFIG_IMU_LSM6S3TR_C_STM32_SIGN_X;
-        imu_dev->data[1] *= PBDRV_CONFIG_IMU_LSM6S3TR_C_STM32_SIGN_Y;
-        imu_dev->data[2] *= PBDRV_CONFIG_IMU_LSM6S3TR_C_STM32_SIGN_Z;
-        imu_dev->data[3] *= PBDRV_CONFIG_IMU_LSM6S3TR_C_STM32_SIGN_X;
-        imu_dev->data[4] *= PBDRV_CONFIG_IMU_LSM6S3TR_C_STM32_SIGN_Y;
-        imu_dev->data[5] *= PBDRV_CONFIG_IMU_LSM6S3TR_C_STM32_SIGN_Z;
+        if (ctx->read_failed || HAL_I2C_GetError(hi2c) != HAL_I2C_ERROR_NONE) {
+            pbdrv_imu_lsm6ds3tr_c_stm32_i2c_reset(hi2c);
+            fifo_pending = true;
+            continue;
+        }
 
-        pbdrv_imu_lsm6ds3tr_c_stm32_update_stationary_status(imu_dev);
-        if (imu_dev->handle_frame_data) {
-            imu_dev->handle_frame_data(imu_dev->data);
+        for (uint32_t i = 0; i < num_frames; i++) {
+            memcpy(&imu_dev->data[0], imu_dev->fifo_data[i], NUM_DATA_BYTES);
+
+            // Account for mounting orientation in hub. Any other tranformations
+            // are applied at the higher level in pbio.
+            imu_dev->data[0] *= PBDRV_CONFIG_IMU_LSM6S3TR_C_STM32_SIGN_X;
+            imu_dev->data[1] *= PBDRV_CONFIG_IMU_LSM6S3TR_C_STM32_SIGN_Y;
+            imu_dev->data[2] *= PBDRV_CONFIG_IMU_LSM6S3TR_C_STM32_SIGN_Z;
+            imu_dev->data[3] *= PBDRV_CONFIG_IMU_LSM6S3TR_C_STM32_SIGN_X;
+            imu_dev->data[4] *= PBDRV_CONFIG_IMU_LSM6S3TR_C_STM32_SIGN_Y;
+            imu_dev->data[5] *= PBDRV_CONFIG_IMU_LSM6S3TR_C_STM32_SIGN_Z;
+
+            // The newest frame in the FIFO was sampled just before we read the
+            // status, and the older frames one period apart before that. We
+            // may read only the oldest frames now, so count from the newest.
+            uint32_t time = time_read - (uint32_t)((num_frames_available - 1 - i) * imu_dev->config.sample_time * 1000000.0f);
+            pbdrv_imu_lsm6ds3tr_c_stm32_update_stationary_status(imu_dev, time);
+            if (imu_dev->handle_frame_data) {
+                imu_dev->handle_frame_data(imu_dev->data);
+            }
         }
     }
 
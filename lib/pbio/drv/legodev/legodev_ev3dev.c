@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2019-2022 The Pybricks Authors
+// Copyright (c) 2019-2024 The Pybricks Authors
 
 #include <pbdrv/config.h>
 
@@ -189,6 +189,10 @@ pbio_error_t pbdrv_legodev_set_mode_with_data(pbdrv_legodev_dev_t *legodev, uint
     return PBIO_ERROR_NOT_SUPPORTED;
 }
 
+pbio_error_t pbdrv_legodev_set_mode_combi(pbdrv_legodev_dev_t *legodev, const uint8_t *modes, uint8_t num_modes) {
+    return PBIO_ERROR_NOT_SUPPORTED;
+}
+
 pbio_error_t pbdrv_legodev_get_data(pbdrv_legodev_dev_t *legodev, uint8_t mode, void **data) {
     if (legodev->is_motor) {
         return PBIO_ERROR_NOT_SUPPORTED;
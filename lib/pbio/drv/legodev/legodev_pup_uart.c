@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT OR GPL-2.0-only
-// Copyright (c) 2018-2023 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 /*
  * Based on:
@@ -62,6 +62,7 @@
 
 #define EV3_UART_DATA_KEEP_ALIVE_TIMEOUT    100 /* msec */
 #define EV3_UART_IO_TIMEOUT                 250 /* msec */
+#define EV3_UART_INFO_CACHE_MAX_SKIP        8   /* connections */
 
 enum ev3_uart_info_bit {
     EV3_UART_INFO_BIT_CMD_TYPE,
@@ -152,6 +153,34 @@ typedef struct {
     uint32_t time;
 } pbdrv_legodev_pup_uart_data_set_t;
 
+#if PBDRV_CONFIG_LEGODEV_MODE_INFO
+typedef struct {
+    /** The modes that are combined, in the order that their data is received. */
+    uint8_t modes[PBDRV_LEGODEV_MAX_COMBI_MODES];
+    /** Offset of the data of each mode in bin_data, aligned at 4 bytes. */
+    uint8_t offsets[PBDRV_LEGODEV_MAX_COMBI_MODES];
+    /** The number of combined modes, or 0 if no combination is set. */
+    uint8_t num_modes;
+    /** Size of the combined data in DATA messages. */
+    uint8_t size;
+    /** Whether the combination needs to be sent to the device. */
+    bool requested;
+    /** Whether the previous combination needs to be cleared on the device. */
+    bool clear_requested;
+    /**
+     * Whether the combination is cleared on the device while data is written
+     * to a single mode. It is set again once the data is sent.
+     */
+    bool suspended;
+    /**
+     * Number of combined DATA messages received since the combination was
+     * sent, up to 2. The first one is discarded because it may still contain
+     * data of the previous mode with the same message size.
+     */
+    uint8_t num_received;
+} pbdrv_legodev_pup_uart_combi_t;
+#endif // PBDRV_CONFIG_LEGODEV_MODE_INFO
+
 /**
  * struct ev3_uart_port_data - Data for EV3/LPF2 UART Sensor communication
  */
@@ -183,6 +212,10 @@ struct _pbdrv_legodev_pup_uart_dev_t {
     pbdrv_legodev_pup_uart_mode_switch_t mode_switch;
     /** Data set buffer and status. */
     pbdrv_legodev_pup_uart_data_set_t *data_set;
+    #if PBDRV_CONFIG_LEGODEV_MODE_INFO
+    /** Mode combination status. */
+    pbdrv_legodev_pup_uart_combi_t combi;
+    #endif
     /** Extra mode adder for Powered Up devices (for modes > LUMP_MAX_MODE). */
     uint8_t ext_mode;
     /** New baud rate that will be set with ev3_uart_change_bitrate. */
@@ -195,6 +228,8 @@ struct _pbdrv_legodev_pup_uart_dev_t {
     uint8_t *rx_msg;
     /** Size of the current message being received. */
     uint8_t rx_msg_size;
+    /** Number of bytes in rx_msg while streaming DATA messages. */
+    uint8_t rx_msg_len;
     /** Total number of errors that have occurred. */
     uint32_t err_count;
     /** Number of bad reads when receiving DATA ludev->msgs. */
@@ -213,6 +248,10 @@ struct _pbdrv_legodev_pup_uart_dev_t {
     /** Flags indicating what information has already been read from the data. */
     uint32_t info_flags;
     #endif // #define PBDRV_CONFIG_LEGODEV_MODE_INFO
+    #if PBDRV_CONFIG_LEGODEV_INFO_CACHE
+    /** The device info was loaded from the cache and no data was received yet. */
+    bool info_from_cache;
+    #endif
 };
 
 enum {
@@ -231,6 +270,131 @@ static pbdrv_legodev_pup_uart_data_set_t data_set_bufs[PBDRV_CONFIG_LEGODEV_PUP_
 
 #define PBIO_PT_WAIT_READY(pt, expr) PT_WAIT_UNTIL((pt), (expr) != PBIO_ERROR_AGAIN)
 
+#if PBDRV_CONFIG_LEGODEV_INFO_CACHE
+
+static pbdrv_legodev_info_cache_t *info_cache;
+static void (*info_cache_changed)(void);
+
+void pbdrv_legodev_set_info_cache(pbdrv_legodev_info_cache_t *cache, void (*changed)(void)) {
+    info_cache = cache;
+    info_cache_changed = changed;
+}
+
+static pbdrv_legodev_info_cache_entry_t *pbdrv_legodev_pup_uart_info_cache_find(pbdrv_legodev_type_id_t type_id) {
+    if (!info_cache) {
+        return NULL;
+    }
+    for (uint8_t i = 0; i < PBDRV_CONFIG_LEGODEV_INFO_CACHE_NUM_ENTRIES; i++) {
+        if (info_cache->entries[i].info.type_id == type_id) {
+            return &info_cache->entries[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Loads the device info from the cache, if the device type was seen before.
+ *
+ * @param [in]  ludev       The LEGO UART device instance, with known type.
+ * @return                  True if the info was loaded, false otherwise.
+ */
+static bool pbdrv_legodev_pup_uart_info_cache_load(pbdrv_legodev_pup_uart_dev_t *ludev) {
+    pbdrv_legodev_info_cache_entry_t *entry = pbdrv_legodev_pup_uart_info_cache_find(ludev->device_info.type_id);
+    if (!entry || entry->num_skip) {
+        return false;
+    }
+    ludev->device_info = entry->info;
+    ludev->device_info.mode = 0;
+    ludev->new_baud_rate = entry->baud_rate;
+    ludev->info_from_cache = true;
+    return true;
+}
+
+/**
+ * Saves the device info that was just received to the cache.
+ *
+ * @param [in]  ludev       The LEGO UART device instance.
+ */
+static void pbdrv_legodev_pup_uart_info_cache_store(pbdrv_legodev_pup_uart_dev_t *ludev) {
+    if (!info_cache) {
+        return;
+    }
+
+    // Use existing entry for this type, or replace the oldest one.
+    pbdrv_legodev_info_cache_entry_t *entry = pbdrv_legodev_pup_uart_info_cache_find(ludev->device_info.type_id);
+    if (!entry) {
+        entry = pbdrv_legodev_pup_uart_info_cache_find(PBDRV_LEGODEV_TYPE_ID_NONE);
+    }
+    if (!entry) {
+        entry = &info_cache->entries[info_cache->next_index];
+        info_cache->next_index = (info_cache->next_index + 1) % PBDRV_CONFIG_LEGODEV_INFO_CACHE_NUM_ENTRIES;
+    }
+
+    // Copy including padding so that unchanged entries compare equal.
+    pbdrv_legodev_info_cache_entry_t new_entry;
+    memset(&new_entry, 0, sizeof(new_entry));
+    memcpy(&new_entry.info, &ludev->device_info, sizeof(new_entry.info));
+    new_entry.info.mode = 0;
+    new_entry.baud_rate = ludev->new_baud_rate;
+    if (entry->info.type_id == ludev->device_info.type_id) {
+        // Keep track of failures, and count down until the cache is retried.
+        new_entry.num_failed = entry->num_failed;
+        new_entry.num_skip = entry->num_skip ? entry->num_skip - 1 : 0;
+    }
+
+    // Only request saving if something changed.
+    if (memcmp(entry, &new_entry, sizeof(new_entry))) {
+        *entry = new_entry;
+        if (info_cache_changed) {
+            info_cache_changed();
+        }
+    }
+}
+
+/**
+ * Marks the cached info as valid, once the device sends data that matches it.
+ *
+ * @param [in]  ludev       The LEGO UART device instance.
+ */
+static void pbdrv_legodev_pup_uart_info_cache_validated(pbdrv_legodev_pup_uart_dev_t *ludev) {
+    ludev->info_from_cache = false;
+    pbdrv_legodev_info_cache_entry_t *entry = pbdrv_legodev_pup_uart_info_cache_find(ludev->device_info.type_id);
+    if (entry && entry->num_failed) {
+        entry->num_failed = 0;
+        if (info_cache_changed) {
+            info_cache_changed();
+        }
+    }
+}
+
+/**
+ * Checks if the device stopped before sending valid data after the info was
+ * loaded from the cache. Then it did not accept the early acknowledgement or
+ * the info was not for this device, so the info will be received in full the
+ * next times this type of device connects. Each consecutive failure makes
+ * this last one connection longer before the cache is tried again.
+ *
+ * @param [in]  ludev       The LEGO UART device instance.
+ */
+static void pbdrv_legodev_pup_uart_info_cache_check_failed(pbdrv_legodev_pup_uart_dev_t *ludev) {
+    if (!ludev->info_from_cache) {
+        return;
+    }
+    ludev->info_from_cache = false;
+    pbdrv_legodev_info_cache_entry_t *entry = pbdrv_legodev_pup_uart_info_cache_find(ludev->device_info.type_id);
+    if (entry) {
+        if (entry->num_failed < EV3_UART_INFO_CACHE_MAX_SKIP) {
+            entry->num_failed++;
+        }
+        entry->num_skip = entry->num_failed;
+        if (info_cache_changed) {
+            info_cache_changed();
+        }
+    }
+}
+
+#endif // PBDRV_CONFIG_LEGODEV_INFO_CACHE
+
 pbdrv_legodev_pup_uart_dev_t *pbdrv_legodev_pup_uart_configure(uint8_t device_index, uint8_t uart_driver_index, pbio_dcmotor_t *dcmotor) {
     pbdrv_legodev_pup_uart_dev_t *ludev = &ludevs[device_index];
     ludev->dcmotor = dcmotor;
@@ -262,6 +426,68 @@ static void pbdrv_legodev_request_data_set(pbdrv_legodev_pup_uart_dev_t *ludev,
     pbdrv_legodev_pup_uart_process_poll();
 }
 
+#if PBDRV_CONFIG_LEGODEV_MODE_INFO
+
+/**
+ * Gets the index of a mode in the current mode combination.
+ *
+ * @param [in]  ludev       The LEGO UART device instance.
+ * @param [in]  mode        The mode to look for.
+ * @return                  The index or -1 if the mode is not combined.
+ */
+static int8_t pbdrv_legodev_pup_uart_combi_get_index(pbdrv_legodev_pup_uart_dev_t *ludev, uint8_t mode) {
+    for (uint8_t i = 0; i < ludev->combi.num_modes; i++) {
+        if (ludev->combi.modes[i] == mode) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Clears the mode combination, if any, so that the device can be set to a
+ * single mode again.
+ *
+ * @param [in]  ludev       The LEGO UART device instance.
+ */
+static void pbdrv_legodev_pup_uart_combi_clear(pbdrv_legodev_pup_uart_dev_t *ludev) {
+    if (ludev->combi.num_modes) {
+        ludev->combi.num_modes = 0;
+        ludev->combi.requested = false;
+        ludev->combi.suspended = false;
+        ludev->combi.clear_requested = true;
+    }
+}
+
+/**
+ * Sets the mode combination again after it was suspended to write data.
+ *
+ * @param [in]  ludev       The LEGO UART device instance.
+ */
+static void pbdrv_legodev_pup_uart_combi_resume(pbdrv_legodev_pup_uart_dev_t *ludev) {
+    if (ludev->combi.suspended) {
+        ludev->combi.suspended = false;
+        ludev->combi.num_received = 0;
+        ludev->combi.requested = true;
+        ludev->mode_switch.desired_mode = ludev->combi.modes[0];
+        ludev->mode_switch.time = pbdrv_clock_get_ms();
+    }
+}
+
+#else // PBDRV_CONFIG_LEGODEV_MODE_INFO
+
+static inline int8_t pbdrv_legodev_pup_uart_combi_get_index(pbdrv_legodev_pup_uart_dev_t *ludev, uint8_t mode) {
+    return -1;
+}
+
+static inline void pbdrv_legodev_pup_uart_combi_clear(pbdrv_legodev_pup_uart_dev_t *ludev) {
+}
+
+static inline void pbdrv_legodev_pup_uart_combi_resume(pbdrv_legodev_pup_uart_dev_t *ludev) {
+}
+
+#endif // PBDRV_CONFIG_LEGODEV_MODE_INFO
+
 static inline bool test_and_set_bit(uint8_t bit, uint32_t *flags) {
     bool result = *flags & (1 << bit);
     *flags |= (1 << bit);
@@ -284,6 +510,56 @@ static uint8_t ev3_uart_get_msg_size(uint8_t header) {
     return size;
 }
 
+// Gets the smallest message payload size that fits the given number of bytes.
+static uint8_t ev3_uart_get_padded_size(uint8_t size) {
+    uint8_t padded = 1;
+    while (padded < size) {
+        padded <<= 1;
+    }
+    return padded;
+}
+
+/**
+ * Gets the size of a data type.
+ * @param [in]  type        The data type
+ * @return                  The size of the type or 0 if the type was not valid
+ */
+size_t pbdrv_legodev_size_of(pbdrv_legodev_data_type_t type) {
+    switch (type) {
+        case PBDRV_LEGODEV_DATA_TYPE_INT8:
+            return 1;
+        case PBDRV_LEGODEV_DATA_TYPE_INT16:
+            return 2;
+        case PBDRV_LEGODEV_DATA_TYPE_INT32:
+        case PBDRV_LEGODEV_DATA_TYPE_FLOAT:
+            return 4;
+    }
+    return 0;
+}
+
+/**
+ * Tests if the message in the receive buffer has a valid checksum.
+ *
+ * @param [in]  ludev       The LEGO UART device instance.
+ * @param [in]  msg_size    The size of the message, including the checksum.
+ * @return                  True if the checksum is valid or may be ignored.
+ */
+static bool pbdrv_legodev_pup_uart_checksum_is_valid(pbdrv_legodev_pup_uart_dev_t *ludev, uint8_t msg_size) {
+    uint8_t checksum = 0xFF;
+    for (int i = 0; i < msg_size - 1; i++) {
+        checksum ^= ludev->rx_msg[i];
+    }
+    if (checksum == ludev->rx_msg[msg_size - 1]) {
+        return true;
+    }
+
+    // The LEGO EV3 color sensor sends bad checksums for RGB-RAW data (mode 4)
+    // once INFO messages are done. The check here could be improved if someone
+    // can find a pattern.
+    return ludev->status == PBDRV_LEGODEV_PUP_UART_STATUS_DATA
+           && ludev->device_info.type_id == PBDRV_LEGODEV_TYPE_ID_EV3_COLOR_SENSOR
+           && ludev->rx_msg[0] == (LUMP_MSG_TYPE_DATA | LUMP_MSG_SIZE_8 | 4);
+}
 
 static void pbdrv_legodev_pup_uart_parse_msg(pbdrv_legodev_pup_uart_dev_t *ludev) {
     uint32_t speed;
@@ -306,28 +582,14 @@ static void pbdrv_legodev_pup_uart_parse_msg(pbdrv_legodev_pup_uart_dev_t *ludev
         mode += ludev->ext_mode;
     }
 
-    if (msg_size > 1) {
-        uint8_t checksum = 0xFF;
-        for (int i = 0; i < msg_size - 1; i++) {
-            checksum ^= ludev->rx_msg[i];
-        }
-        if (checksum != ludev->rx_msg[msg_size - 1]) {
-            DBG_ERR(ludev->last_err = "Bad checksum");
-            // if INFO messages are done and we are now receiving data, it is
-            // OK to occasionally have a bad checksum
-            if (ludev->status == PBDRV_LEGODEV_PUP_UART_STATUS_DATA) {
-
-                // The LEGO EV3 color sensor sends bad checksums
-                // for RGB-RAW data (mode 4). The check here could be
-                // improved if someone can find a pattern.
-                if (ludev->device_info.type_id != PBDRV_LEGODEV_TYPE_ID_EV3_COLOR_SENSOR
-                    || ludev->rx_msg[0] != (LUMP_MSG_TYPE_DATA | LUMP_MSG_SIZE_8 | 4)) {
-                    return;
-                }
-            } else {
-                goto err;
-            }
+    if (msg_size > 1 && !pbdrv_legodev_pup_uart_checksum_is_valid(ludev, msg_size)) {
+        DBG_ERR(ludev->last_err = "Bad checksum");
+        // if INFO messages are done and we are now receiving data, it is
+        // OK to occasionally have a bad checksum
+        if (ludev->status == PBDRV_LEGODEV_PUP_UART_STATUS_DATA) {
+            return;
         }
+        goto err;
     }
 
     switch (msg_type) {
@@ -528,8 +790,10 @@ static void pbdrv_legodev_pup_uart_parse_msg(pbdrv_legodev_pup_uart_dev_t *ludev
                         goto err;
                     }
 
-                    // REVISIT: this is potentially an array of combos
-                    debug_pr("mode combos: %04x\n", ludev->rx_msg[3] << 8 | ludev->rx_msg[2]);
+                    for (uint8_t i = 0; i < LUMP_MAX_MODE_COMBOS && i < (msg_size - 3) / 2; i++) {
+                        ludev->device_info.mode_combos[i] = pbio_get_uint16_le(ludev->rx_msg + 2 + i * 2);
+                        debug_pr("mode combos: %04x\n", ludev->device_info.mode_combos[i]);
+                    }
 
                     break;
                 case LUMP_INFO_UNK9:
@@ -605,6 +869,52 @@ static void pbdrv_legodev_pup_uart_parse_msg(pbdrv_legodev_pup_uart_dev_t *ludev
             }
             #endif
 
+            #if PBDRV_CONFIG_LEGODEV_MODE_INFO
+            // Data for a mode combination has the size of all combined data.
+            if (ludev->combi.num_modes && !ludev->combi.suspended && LUMP_MSG_SIZE(ludev->rx_msg[0]) == ev3_uart_get_padded_size(ludev->combi.size)) {
+                ludev->data_rec = true;
+                if (ludev->num_data_err) {
+                    ludev->num_data_err--;
+                }
+
+                // Discard the first message, see pbdrv_legodev_pup_uart_combi_t.
+                if (ludev->combi.num_received == 0) {
+                    ludev->combi.num_received++;
+                    break;
+                }
+
+                const uint8_t *src = ludev->rx_msg + 1;
+                for (uint8_t i = 0; i < ludev->combi.num_modes; i++) {
+                    const pbdrv_legodev_mode_info_t *mode_info = &ludev->device_info.mode_info[ludev->combi.modes[i]];
+                    uint8_t size = mode_info->num_values * pbdrv_legodev_size_of(mode_info->data_type);
+                    memcpy(ludev->bin_data + ludev->combi.offsets[i], src, size);
+                    src += size;
+                }
+
+                if (ludev->combi.num_received == 1) {
+                    // First time getting combined data, so register time.
+                    ludev->combi.num_received++;
+                    ludev->mode_switch.time = pbdrv_clock_get_ms();
+                }
+                ludev->device_info.mode = ludev->combi.modes[0];
+                break;
+            }
+            #endif
+
+            #if PBDRV_CONFIG_LEGODEV_INFO_CACHE && PBDRV_CONFIG_LEGODEV_MODE_INFO
+            // The first data must match the cached info. If it doesn't, the
+            // info was for another device that reports the same type.
+            if (ludev->info_from_cache) {
+                const pbdrv_legodev_mode_info_t *mode_info = &ludev->device_info.mode_info[mode];
+                uint8_t size = mode_info->num_values * pbdrv_legodev_size_of(mode_info->data_type);
+                if (LUMP_MSG_SIZE(ludev->rx_msg[0]) != ev3_uart_get_padded_size(size)) {
+                    DBG_ERR(ludev->last_err = "Data does not match cached info");
+                    goto err;
+                }
+                pbdrv_legodev_pup_uart_info_cache_validated(ludev);
+            }
+            #endif
+
             // Data is for requested mode.
             if (mode == ludev->mode_switch.desired_mode) {
                 memcpy(ludev->bin_data, ludev->rx_msg + 1, msg_size - 2);
@@ -687,6 +997,31 @@ static void ev3_uart_prepare_tx_msg(pbdrv_legodev_pup_uart_dev_t *ludev, lump_ms
     ludev->tx_msg_size = offset + i + 2;
 }
 
+#if PBDRV_CONFIG_LEGODEV_MODE_INFO
+/**
+ * Prepares the message that selects the current mode combination.
+ *
+ * The combination has one entry for each value of each combined mode.
+ *
+ * @param [in]  ludev       The LEGO UART device instance.
+ */
+static void pbdrv_legodev_pup_uart_prepare_combi_msg(pbdrv_legodev_pup_uart_dev_t *ludev) {
+    uint8_t payload[LUMP_MAX_MSG_SIZE];
+    uint8_t size = 2;
+
+    for (uint8_t i = 0; i < ludev->combi.num_modes; i++) {
+        uint8_t mode = ludev->combi.modes[i];
+        for (uint8_t j = 0; j < ludev->device_info.mode_info[mode].num_values; j++) {
+            payload[size++] = LUMP_COMBI_ENTRY(mode, j);
+        }
+    }
+    payload[0] = LUMP_COMBI_WRITE | (size - 2);
+    payload[1] = 0;
+
+    ev3_uart_prepare_tx_msg(ludev, LUMP_MSG_TYPE_CMD, LUMP_CMD_WRITE, payload, size);
+}
+#endif // PBDRV_CONFIG_LEGODEV_MODE_INFO
+
 static void pbdrv_legodev_pup_uart_reset(pbdrv_legodev_pup_uart_dev_t *ludev) {
     ludev->status = PBDRV_LEGODEV_PUP_UART_STATUS_ERR;
     if (ludev->dcmotor != NULL && ludev->dcmotor->motor_driver != NULL) {
@@ -722,6 +1057,11 @@ static PT_THREAD(pbdrv_legodev_pup_uart_synchronize_thread(pbdrv_legodev_pup_uar
     ludev->ext_mode = 0;
     #if PBDRV_CONFIG_LEGODEV_MODE_INFO
     ludev->device_info.flags = PBDRV_LEGODEV_CAPABILITY_FLAG_NONE;
+    memset(ludev->device_info.mode_combos, 0, sizeof(ludev->device_info.mode_combos));
+    memset(&ludev->combi, 0, sizeof(ludev->combi));
+    #endif
+    #if PBDRV_CONFIG_LEGODEV_INFO_CACHE
+    ludev->info_from_cache = false;
     #endif
     ludev->status = PBDRV_LEGODEV_PUP_UART_STATUS_SYNCING;
 
@@ -823,6 +1163,15 @@ sync:
     #endif
     debug_pr("type id: %d\n", ludev->device_info.type_id);
 
+    #if PBDRV_CONFIG_LEGODEV_INFO_CACHE
+    // If this type of device was connected before, we already know the mode
+    // info, so we can acknowledge right away instead of receiving it again.
+    if (pbdrv_legodev_pup_uart_info_cache_load(ludev)) {
+        debug_pr_str("using cached info\n");
+        ludev->status = PBDRV_LEGODEV_PUP_UART_STATUS_ACK;
+    }
+    #endif
+
     while (ludev->status == PBDRV_LEGODEV_PUP_UART_STATUS_INFO) {
         // read the message header
         PBIO_PT_WAIT_READY(&ludev->pt, ludev->err = pbdrv_uart_read_begin(ludev->uart, ludev->rx_msg, 1, EV3_UART_IO_TIMEOUT));
@@ -877,6 +1226,12 @@ sync:
         PT_EXIT(&ludev->pt);
     }
 
+    #if PBDRV_CONFIG_LEGODEV_INFO_CACHE
+    if (!ludev->info_from_cache) {
+        pbdrv_legodev_pup_uart_info_cache_store(ludev);
+    }
+    #endif
+
     // schedule baud rate change
     etimer_set(&ludev->timer, 10);
     PT_WAIT_UNTIL(&ludev->pt, etimer_expired(&ludev->timer));
@@ -926,7 +1281,11 @@ static PT_THREAD(pbdrv_legodev_pup_uart_send_thread(pbdrv_legodev_pup_uart_dev_t
 
     while (ludev->status == PBDRV_LEGODEV_PUP_UART_STATUS_DATA) {
 
-        PT_WAIT_UNTIL(&ludev->pt, etimer_expired(&ludev->timer) || ludev->mode_switch.requested || ludev->data_set->size > 0);
+        PT_WAIT_UNTIL(&ludev->pt, etimer_expired(&ludev->timer) || ludev->mode_switch.requested || ludev->data_set->size > 0
+            #if PBDRV_CONFIG_LEGODEV_MODE_INFO
+            || ludev->combi.requested || ludev->combi.clear_requested
+            #endif
+            );
 
         // Handle keep alive timeout
         if (etimer_expired(&ludev->timer)) {
@@ -953,8 +1312,42 @@ static PT_THREAD(pbdrv_legodev_pup_uart_send_thread(pbdrv_legodev_pup_uart_dev_t
             if (ludev->device_info.mode != ludev->mode_switch.desired_mode && pbdrv_clock_get_ms() - ludev->mode_switch.time > EV3_UART_IO_TIMEOUT) {
                 ludev->mode_switch.requested = true;
             }
+
+            #if PBDRV_CONFIG_LEGODEV_MODE_INFO
+            // Likewise retry the mode combination.
+            if (ludev->combi.num_modes && !ludev->combi.suspended && ludev->combi.num_received < 2 && pbdrv_clock_get_ms() - ludev->mode_switch.time > EV3_UART_IO_TIMEOUT) {
+                ludev->combi.requested = true;
+            }
+            #endif
         }
 
+        #if PBDRV_CONFIG_LEGODEV_MODE_INFO
+        // Handle requested mode combination changes. The previous combination
+        // is cleared first, before a new combination or single mode is set.
+        if (ludev->combi.clear_requested || ludev->combi.requested) {
+            ludev->combi.clear_requested = false;
+            {
+                uint8_t payload[] = { LUMP_COMBI_WRITE, 0 };
+                ev3_uart_prepare_tx_msg(ludev, LUMP_MSG_TYPE_CMD, LUMP_CMD_WRITE, payload, sizeof(payload));
+            }
+            PT_SPAWN(&ludev->pt, &ludev->write_pt, pbdrv_legodev_pup_uart_send_prepared_msg(ludev, &ludev->err));
+            if (ludev->err != PBIO_SUCCESS) {
+                DBG_ERR(ludev->last_err = "Clearing mode combination failed.");
+                PT_EXIT(&ludev->pt);
+            }
+        }
+        if (ludev->combi.requested) {
+            ludev->combi.requested = false;
+            ludev->mode_switch.time = pbdrv_clock_get_ms();
+            pbdrv_legodev_pup_uart_prepare_combi_msg(ludev);
+            PT_SPAWN(&ludev->pt, &ludev->write_pt, pbdrv_legodev_pup_uart_send_prepared_msg(ludev, &ludev->err));
+            if (ludev->err != PBIO_SUCCESS) {
+                DBG_ERR(ludev->last_err = "Setting mode combination failed.");
+                PT_EXIT(&ludev->pt);
+            }
+        }
+        #endif
+
         // Handle requested mode change
         if (ludev->mode_switch.requested) {
             ludev->mode_switch.requested = false;
@@ -979,6 +1372,7 @@ static PT_THREAD(pbdrv_legodev_pup_uart_send_thread(pbdrv_legodev_pup_uart_dev_t
                     PT_EXIT(&ludev->pt);
                 }
                 ludev->data_set->time = pbdrv_clock_get_ms();
+                pbdrv_legodev_pup_uart_combi_resume(ludev);
             } else if (pbdrv_clock_get_ms() - ludev->data_set->time < 500) {
                 // Not in the right mode yet, try again later for a reasonable amount of time.
                 pbdrv_legodev_pup_uart_process_poll();
@@ -986,6 +1380,7 @@ static PT_THREAD(pbdrv_legodev_pup_uart_send_thread(pbdrv_legodev_pup_uart_dev_t
             } else {
                 // Give up setting data.
                 ludev->data_set->size = 0;
+                pbdrv_legodev_pup_uart_combi_resume(ludev);
             }
         }
     }
@@ -994,61 +1389,99 @@ static PT_THREAD(pbdrv_legodev_pup_uart_send_thread(pbdrv_legodev_pup_uart_dev_t
 }
 
 /**
- * The receive thread for the LEGO UART device.
+ * Tests if a byte is a valid header of a message that may be received after
+ * synchronization is complete.
  *
- * @param [in]  ludev       The LEGO UART device instance.
+ * @param [in]  header      The header byte.
+ * @return                  True if it is the header of a DATA, WRITE or
+ *                          EXT_MODE message.
  */
-static PT_THREAD(pbdrv_legodev_pup_uart_receive_data_thread(pbdrv_legodev_pup_uart_dev_t * ludev)) {
-
-    // REVISIT: This is not the greatest. We can easily get a buffer overrun and
-    // loose data. For now, the retry after bad message size helps get back into
-    // sync with the data stream.
-
-    pbio_error_t err;
+static bool pbdrv_legodev_pup_uart_is_data_header(uint8_t header) {
+    uint8_t msg_type = header & LUMP_MSG_TYPE_MASK;
+    uint8_t cmd = header & LUMP_MSG_CMD_MASK;
+    return msg_type == LUMP_MSG_TYPE_DATA ||
+           (msg_type == LUMP_MSG_TYPE_CMD && (cmd == LUMP_CMD_WRITE || cmd == LUMP_CMD_EXT_MODE));
+}
 
-    PT_BEGIN(&ludev->recv_pt);
+/**
+ * Discards bytes from the start of the receive buffer.
+ *
+ * @param [in]  ludev       The LEGO UART device instance.
+ * @param [in]  size        The number of bytes to discard.
+ */
+static void pbdrv_legodev_pup_uart_discard_rx_bytes(pbdrv_legodev_pup_uart_dev_t *ludev, uint8_t size) {
+    ludev->rx_msg_len -= size;
+    memmove(ludev->rx_msg, ludev->rx_msg + size, ludev->rx_msg_len);
+}
 
-    while (true) {
-        PBIO_PT_WAIT_READY(&ludev->recv_pt,
-            err = pbdrv_uart_read_begin(ludev->uart, ludev->rx_msg, 1, EV3_UART_IO_TIMEOUT));
-        if (err != PBIO_SUCCESS) {
-            DBG_ERR(ludev->last_err = "UART Rx data header begin error");
-            break;
-        }
-        PBIO_PT_WAIT_READY(&ludev->recv_pt, err = pbdrv_uart_read_end(ludev->uart));
-        if (err != PBIO_SUCCESS) {
-            DBG_ERR(ludev->last_err = "UART Rx data header end error");
-            break;
-        }
+/**
+ * Parses all complete messages in the receive buffer.
+ *
+ * Bytes that can't be the start of a valid message are discarded one at a
+ * time, so that we get back in sync with the data stream after a corrupted or
+ * lost byte. Any incomplete message is kept until more data arrives.
+ *
+ * @param [in]  ludev       The LEGO UART device instance.
+ */
+static void pbdrv_legodev_pup_uart_parse_rx_bytes(pbdrv_legodev_pup_uart_dev_t *ludev) {
+    while (ludev->rx_msg_len > 0) {
 
         ludev->rx_msg_size = ev3_uart_get_msg_size(ludev->rx_msg[0]);
-        if (ludev->rx_msg_size < 3 || ludev->rx_msg_size > EV3_UART_MAX_MESSAGE_SIZE) {
-            DBG_ERR(ludev->last_err = "Bad data message size");
+        if (!pbdrv_legodev_pup_uart_is_data_header(ludev->rx_msg[0]) ||
+            ludev->rx_msg_size < 3 || ludev->rx_msg_size > EV3_UART_MAX_MESSAGE_SIZE) {
+            DBG_ERR(ludev->last_err = "Bad data message header");
+            pbdrv_legodev_pup_uart_discard_rx_bytes(ludev, 1);
             continue;
         }
 
-        uint8_t msg_type = ludev->rx_msg[0] & LUMP_MSG_TYPE_MASK;
-        uint8_t cmd = ludev->rx_msg[0] & LUMP_MSG_CMD_MASK;
-        if (msg_type != LUMP_MSG_TYPE_DATA && (msg_type != LUMP_MSG_TYPE_CMD ||
-                                               (cmd != LUMP_CMD_WRITE && cmd != LUMP_CMD_EXT_MODE))) {
-            DBG_ERR(ludev->last_err = "Bad msg type");
+        // Wait for the rest of the message.
+        if (ludev->rx_msg_len < ludev->rx_msg_size) {
+            return;
+        }
+
+        // On a bad checksum, the header was probably not a header at all,
+        // so try again from the next byte.
+        if (!pbdrv_legodev_pup_uart_checksum_is_valid(ludev, ludev->rx_msg_size)) {
+            DBG_ERR(ludev->last_err = "Bad data message checksum");
+            pbdrv_legodev_pup_uart_discard_rx_bytes(ludev, 1);
             continue;
         }
 
+        // at this point, we have a full ludev->msg that can be parsed
+        pbdrv_legodev_pup_uart_parse_msg(ludev);
+        pbdrv_legodev_pup_uart_discard_rx_bytes(ludev, ludev->rx_msg_size);
+    }
+}
+
+/**
+ * The receive thread for the LEGO UART device.
+ *
+ * This consumes the data stream as it arrives instead of reading each message
+ * separately, so the device never has to wait for a read to be started.
+ *
+ * @param [in]  ludev       The LEGO UART device instance.
+ */
+static PT_THREAD(pbdrv_legodev_pup_uart_receive_data_thread(pbdrv_legodev_pup_uart_dev_t * ludev)) {
+
+    pbio_error_t err;
+    uint8_t length;
+
+    PT_BEGIN(&ludev->recv_pt);
+
+    ludev->rx_msg_len = 0;
+
+    while (true) {
+        // Append everything received so far to the partial message, if any.
         PBIO_PT_WAIT_READY(&ludev->recv_pt,
-            err = pbdrv_uart_read_begin(ludev->uart, ludev->rx_msg + 1, ludev->rx_msg_size - 1, EV3_UART_IO_TIMEOUT));
-        if (err != PBIO_SUCCESS) {
-            DBG_ERR(ludev->last_err = "UART Rx data begin error");
-            break;
-        }
-        PBIO_PT_WAIT_READY(&ludev->recv_pt, err = pbdrv_uart_read_end(ludev->uart));
+            err = pbdrv_uart_read_available(ludev->uart, ludev->rx_msg + ludev->rx_msg_len,
+                EV3_UART_MAX_MESSAGE_SIZE - ludev->rx_msg_len, &length));
         if (err != PBIO_SUCCESS) {
-            DBG_ERR(ludev->last_err = "UART Rx data end error");
+            DBG_ERR(ludev->last_err = "UART Rx data error");
             break;
         }
+        ludev->rx_msg_len += length;
 
-        // at this point, we have a full ludev->msg that can be parsed
-        pbdrv_legodev_pup_uart_parse_msg(ludev);
+        pbdrv_legodev_pup_uart_parse_rx_bytes(ludev);
     }
 
     PT_END(&ludev->recv_pt);
@@ -1070,6 +1503,9 @@ PT_THREAD(pbdrv_legodev_pup_uart_thread(struct pt *pt, pbdrv_legodev_pup_uart_de
     // Get in in sync with the sensor information dump and parse it.
     PT_SPAWN(pt, &ludev->pt, pbdrv_legodev_pup_uart_synchronize_thread(ludev));
     if (ludev->err != PBIO_SUCCESS) {
+        #if PBDRV_CONFIG_LEGODEV_INFO_CACHE
+        pbdrv_legodev_pup_uart_info_cache_check_failed(ludev);
+        #endif
         pbdrv_legodev_pup_uart_reset(ludev);
         PT_EXIT(pt);
     }
@@ -1082,29 +1518,14 @@ PT_THREAD(pbdrv_legodev_pup_uart_thread(struct pt *pt, pbdrv_legodev_pup_uart_de
         pbdrv_legodev_pup_uart_receive_data_thread(ludev);
         PT_YIELD(pt);
     }
+    #if PBDRV_CONFIG_LEGODEV_INFO_CACHE
+    pbdrv_legodev_pup_uart_info_cache_check_failed(ludev);
+    #endif
     pbdrv_legodev_pup_uart_reset(ludev);
 
     PT_END(pt);
 }
 
-/**
- * Gets the size of a data type.
- * @param [in]  type        The data type
- * @return                  The size of the type or 0 if the type was not valid
- */
-size_t pbdrv_legodev_size_of(pbdrv_legodev_data_type_t type) {
-    switch (type) {
-        case PBDRV_LEGODEV_DATA_TYPE_INT8:
-            return 1;
-        case PBDRV_LEGODEV_DATA_TYPE_INT16:
-            return 2;
-        case PBDRV_LEGODEV_DATA_TYPE_INT32:
-        case PBDRV_LEGODEV_DATA_TYPE_FLOAT:
-            return 4;
-    }
-    return 0;
-}
-
 /**
  * Checks if LEGO UART device has data available for reading or is ready to write.
  *
@@ -1131,6 +1552,13 @@ pbio_error_t pbdrv_legodev_is_ready(pbdrv_legodev_dev_t *legodev) {
         return PBIO_ERROR_AGAIN;
     }
 
+    #if PBDRV_CONFIG_LEGODEV_MODE_INFO
+    // Not ready if waiting for the first data of a mode combination.
+    if (ludev->combi.num_modes && ludev->combi.num_received < 2) {
+        return PBIO_ERROR_AGAIN;
+    }
+    #endif
+
     // Not ready if waiting for stale data to be discarded.
     if (time - ludev->mode_switch.time <= pbdrv_legodev_spec_stale_data_delay(ludev->device_info.type_id, ludev->device_info.mode)) {
         return PBIO_ERROR_AGAIN;
@@ -1162,6 +1590,11 @@ pbio_error_t pbdrv_legodev_set_mode(pbdrv_legodev_dev_t *legodev, uint8_t mode)
         return PBIO_ERROR_NO_DEV;
     }
 
+    // Mode is part of the mode combination, so data is already being received.
+    if (pbdrv_legodev_pup_uart_combi_get_index(ludev, mode) >= 0) {
+        return PBIO_SUCCESS;
+    }
+
     // Mode already set or being set, so return success.
     if (ludev->mode_switch.desired_mode == mode || ludev->device_info.mode == mode) {
         return PBIO_SUCCESS;
@@ -1180,7 +1613,8 @@ pbio_error_t pbdrv_legodev_set_mode(pbdrv_legodev_dev_t *legodev, uint8_t mode)
     }
     #endif
 
-    // Request mode switch.
+    // Request mode switch, which also ends the mode combination, if any.
+    pbdrv_legodev_pup_uart_combi_clear(ludev);
     pbdrv_legodev_request_mode(ludev, mode);
 
     return PBIO_SUCCESS;
@@ -1204,6 +1638,15 @@ pbio_error_t pbdrv_legodev_get_data(pbdrv_legodev_dev_t *legodev, uint8_t mode,
         return PBIO_ERROR_NO_DEV;
     }
 
+    #if PBDRV_CONFIG_LEGODEV_MODE_INFO
+    // Data for combined modes is stored one after the other.
+    int8_t index = pbdrv_legodev_pup_uart_combi_get_index(ludev, mode);
+    if (index >= 0) {
+        *data = ludev->bin_data + ludev->combi.offsets[index];
+        return pbdrv_legodev_is_ready(legodev);
+    }
+    #endif
+
     // Can only request data for mode that is set.
     if (mode != ludev->device_info.mode) {
         return PBIO_ERROR_INVALID_OP;
@@ -1238,6 +1681,21 @@ pbio_error_t pbdrv_legodev_set_mode_with_data(pbdrv_legodev_dev_t *legodev, uint
     }
     #endif
 
+    #if PBDRV_CONFIG_LEGODEV_MODE_INFO
+    // Data can only be set in a single mode, so suspend the mode combination
+    // until the data is sent.
+    if (ludev->combi.num_modes && !ludev->combi.suspended) {
+        pbio_error_t err = pbdrv_legodev_is_ready(legodev);
+        if (err != PBIO_SUCCESS) {
+            return err;
+        }
+        ludev->combi.suspended = true;
+        ludev->combi.requested = false;
+        ludev->combi.clear_requested = true;
+        pbdrv_legodev_request_mode(ludev, mode);
+    }
+    #endif
+
     // Start setting mode.
     pbio_error_t err = pbdrv_legodev_set_mode(legodev, mode);
     if (err != PBIO_SUCCESS) {
@@ -1249,6 +1707,82 @@ pbio_error_t pbdrv_legodev_set_mode_with_data(pbdrv_legodev_dev_t *legodev, uint
     return PBIO_SUCCESS;
 }
 
+pbio_error_t pbdrv_legodev_set_mode_combi(pbdrv_legodev_dev_t *legodev, const uint8_t *modes, uint8_t num_modes) {
+
+    pbdrv_legodev_pup_uart_dev_t *ludev = pbdrv_legodev_get_uart_dev(legodev);
+    if (!ludev) {
+        return PBIO_ERROR_NO_DEV;
+    }
+
+    #if PBDRV_CONFIG_LEGODEV_MODE_INFO
+
+    if (num_modes < 2 || num_modes > PBDRV_LEGODEV_MAX_COMBI_MODES) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+
+    // Combination already set or being set, so return success.
+    if (ludev->combi.num_modes == num_modes && !memcmp(ludev->combi.modes, modes, num_modes)) {
+        return PBIO_SUCCESS;
+    }
+
+    // We can only initiate a mode switch if currently idle (receiving data).
+    pbio_error_t err = pbdrv_legodev_is_ready(legodev);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    // Get the combined data layout. Each mode is stored at an aligned offset
+    // so it can be read just like the data of a single mode.
+    uint8_t offsets[PBDRV_LEGODEV_MAX_COMBI_MODES];
+    uint16_t flags = 0;
+    uint8_t size = 0;
+    uint8_t offset = 0;
+    uint8_t num_entries = 0;
+    for (uint8_t i = 0; i < num_modes; i++) {
+        if (modes[i] >= ludev->device_info.num_modes || flags & (1 << modes[i])) {
+            return PBIO_ERROR_INVALID_ARG;
+        }
+        flags |= 1 << modes[i];
+
+        const pbdrv_legodev_mode_info_t *mode_info = &ludev->device_info.mode_info[modes[i]];
+        uint8_t mode_size = mode_info->num_values * pbdrv_legodev_size_of(mode_info->data_type);
+        offsets[i] = offset;
+        offset += (mode_size + 3) & ~3;
+        size += mode_size;
+        num_entries += mode_info->num_values;
+    }
+    if (offset > PBDRV_LEGODEV_MAX_DATA_SIZE || num_entries + 2 > LUMP_MAX_MSG_SIZE) {
+        return PBIO_ERROR_NOT_SUPPORTED;
+    }
+
+    // The device must support combining these modes.
+    for (uint8_t i = 0; (flags & ludev->device_info.mode_combos[i]) != flags; i++) {
+        if (i + 1 == LUMP_MAX_MODE_COMBOS || !ludev->device_info.mode_combos[i]) {
+            return PBIO_ERROR_NOT_SUPPORTED;
+        }
+    }
+
+    // Request mode combination. The first mode is used as the mode of the
+    // device while the combination is set.
+    memcpy(ludev->combi.modes, modes, num_modes);
+    memcpy(ludev->combi.offsets, offsets, num_modes);
+    ludev->combi.num_modes = num_modes;
+    ludev->combi.size = size;
+    ludev->combi.num_received = 0;
+    ludev->combi.requested = true;
+    ludev->combi.clear_requested = true;
+    ludev->mode_switch.desired_mode = modes[0];
+    ludev->mode_switch.requested = false;
+    ludev->mode_switch.time = pbdrv_clock_get_ms();
+    pbdrv_legodev_pup_uart_process_poll();
+
+    return PBIO_SUCCESS;
+
+    #else // PBDRV_CONFIG_LEGODEV_MODE_INFO
+    return PBIO_ERROR_NOT_SUPPORTED;
+    #endif // PBDRV_CONFIG_LEGODEV_MODE_INFO
+}
+
 pbio_error_t pbdrv_legodev_get_info(pbdrv_legodev_dev_t *legodev, pbdrv_legodev_info_t **info) {
 
     pbdrv_legodev_pup_uart_dev_t *ludev = pbdrv_legodev_get_uart_dev(legodev);
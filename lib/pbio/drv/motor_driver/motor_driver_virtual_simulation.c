@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2022-2023 The Pybricks Authors
+// Copyright (c) 2022-2024 The Pybricks Authors
 
 #include <pbdrv/config.h>
 
@@ -39,13 +39,27 @@ typedef struct _pbio_simulation_model_t {
 } pbio_simulation_model_t;
 
 struct _pbdrv_motor_driver_dev_t {
-    double angle;
-    double current;
-    double speed;
-    double voltage;
-    double torque;
-    const pbio_simulation_model_t *model;
-    const pbdrv_motor_driver_virtual_simulation_platform_data_t *pdata;
+    /** Index of this motor in the simulation state arrays. */
+    uint32_t index;
+};
+
+// Models are discretized at 1 ms from the same motor data as the observer
+// models in doc/control/motor_data.py.
+
+static const pbio_simulation_model_t model_technic_s_angular = {
+    .d_angle_d_speed = 0.0009970293444820683,
+    .d_speed_d_speed = 0.9915834369366782,
+    .d_current_d_speed = -0.0019740215727610134,
+    .d_angle_d_current = 0.0030080026320155823,
+    .d_speed_d_current = 5.354415210720303,
+    .d_current_d_current = 0.47263977967875587,
+    .d_angle_d_voltage = 0.00044236879261772325,
+    .d_speed_d_voltage = 1.253334430006493,
+    .d_current_d_voltage = 0.29395718704930596,
+    .d_angle_d_torque = -0.00020632116607675432,
+    .d_speed_d_torque = -0.4120498970827091,
+    .d_current_d_torque = 0.00045831062970592176,
+    .torque_friction = 9182.16,
 };
 
 static const pbio_simulation_model_t model_technic_m_angular = {
@@ -64,28 +78,183 @@ static const pbio_simulation_model_t model_technic_m_angular = {
     .torque_friction = 21413.268,
 };
 
-static pbdrv_motor_driver_dev_t motor_driver_devs[PBDRV_CONFIG_MOTOR_DRIVER_NUM_DEV];
+static const pbio_simulation_model_t model_technic_l_angular = {
+    .d_angle_d_speed = 0.0009989905838264114,
+    .d_speed_d_speed = 0.9970472644002999,
+    .d_current_d_speed = -0.005135634057919129,
+    .d_angle_d_current = 0.0004936363097546972,
+    .d_speed_d_current = 0.9381983530548228,
+    .d_current_d_current = 0.7301692153525317,
+    .d_angle_d_voltage = 0.0001406279188998589,
+    .d_speed_d_voltage = 0.41136359146224794,
+    .d_current_d_voltage = 0.7154764790710811,
+    .d_angle_d_torque = -2.349871933909065e-05,
+    .d_speed_d_torque = -0.04697406840940621,
+    .d_current_d_torque = 0.00012705837079320112,
+    .torque_friction = 23239.205581395352,
+};
+
+// Ports without a motor keep all model coefficients at zero, so they can be
+// stepped along with the others without changing state.
+static const pbio_simulation_model_t model_none;
+
+#define NUM_DEV (PBDRV_CONFIG_MOTOR_DRIVER_NUM_DEV)
+
+/**
+ * State and model coefficients of all simulated motors.
+ *
+ * Each quantity is stored as an array indexed by motor, so that all motors
+ * are stepped together in simple loops that the compiler can vectorize.
+ */
+static struct {
+    double angle[NUM_DEV];
+    double speed[NUM_DEV];
+    double current[NUM_DEV];
+    double voltage[NUM_DEV];
+    double endstop_angle_negative[NUM_DEV];
+    double endstop_angle_positive[NUM_DEV];
+    double d_angle_d_speed[NUM_DEV];
+    double d_speed_d_speed[NUM_DEV];
+    double d_current_d_speed[NUM_DEV];
+    double d_angle_d_current[NUM_DEV];
+    double d_speed_d_current[NUM_DEV];
+    double d_current_d_current[NUM_DEV];
+    double d_angle_d_voltage[NUM_DEV];
+    double d_speed_d_voltage[NUM_DEV];
+    double d_current_d_voltage[NUM_DEV];
+    double d_angle_d_torque[NUM_DEV];
+    double d_speed_d_torque[NUM_DEV];
+    double d_current_d_torque[NUM_DEV];
+    double torque_friction[NUM_DEV];
+} sim;
+
+static pbdrv_motor_driver_dev_t motor_driver_devs[NUM_DEV];
 
 pbio_error_t pbdrv_motor_driver_get_dev(uint8_t id, pbdrv_motor_driver_dev_t **driver) {
-    if (id >= PBDRV_CONFIG_MOTOR_DRIVER_NUM_DEV) {
+    if (id >= NUM_DEV) {
         return PBIO_ERROR_INVALID_ARG;
     }
 
     *driver = &motor_driver_devs[id];
+    (*driver)->index = id;
 
     return PBIO_SUCCESS;
 }
 
 pbio_error_t pbdrv_motor_driver_coast(pbdrv_motor_driver_dev_t *driver) {
-    driver->voltage = 0.0;
+    sim.voltage[driver->index] = 0.0;
     return PBIO_SUCCESS;
 }
 
 pbio_error_t pbdrv_motor_driver_set_duty_cycle(pbdrv_motor_driver_dev_t *driver, int16_t duty_cycle) {
-    driver->voltage = pbio_battery_get_voltage_from_duty(duty_cycle);
+    sim.voltage[driver->index] = pbio_battery_get_voltage_from_duty(duty_cycle);
     return PBIO_SUCCESS;
 }
 
+/**
+ * Initializes the state and model of one motor from its platform data.
+ *
+ * @param [in]  index       Index of the motor.
+ * @return                  ::PBIO_SUCCESS on success or
+ *                          ::PBIO_ERROR_NOT_SUPPORTED for unknown motor types.
+ */
+static pbio_error_t pbdrv_motor_driver_virtual_simulation_init_dev(uint32_t index) {
+
+    const pbdrv_motor_driver_virtual_simulation_platform_data_t *pdata =
+        &pbdrv_motor_driver_virtual_simulation_platform_data[index];
+
+    // Select model corresponding to device ID.
+    const pbio_simulation_model_t *m;
+    switch (pdata->type_id) {
+        case PBDRV_LEGODEV_TYPE_ID_SPIKE_S_MOTOR:
+            m = &model_technic_s_angular;
+            break;
+        case PBDRV_LEGODEV_TYPE_ID_SPIKE_M_MOTOR:
+            m = &model_technic_m_angular;
+            break;
+        case PBDRV_LEGODEV_TYPE_ID_SPIKE_L_MOTOR:
+            m = &model_technic_l_angular;
+            break;
+        case PBDRV_LEGODEV_TYPE_ID_NONE:
+            m = &model_none;
+            break;
+        default:
+            return PBIO_ERROR_NOT_SUPPORTED;
+    }
+
+    sim.angle[index] = pdata->initial_angle;
+    sim.speed[index] = pdata->initial_speed;
+    sim.current[index] = 0;
+    sim.voltage[index] = 0;
+    sim.endstop_angle_negative[index] = pdata->endstop_angle_negative;
+    sim.endstop_angle_positive[index] = pdata->endstop_angle_positive;
+
+    sim.d_angle_d_speed[index] = m->d_angle_d_speed;
+    sim.d_speed_d_speed[index] = m->d_speed_d_speed;
+    sim.d_current_d_speed[index] = m->d_current_d_speed;
+    sim.d_angle_d_current[index] = m->d_angle_d_current;
+    sim.d_speed_d_current[index] = m->d_speed_d_current;
+    sim.d_current_d_current[index] = m->d_current_d_current;
+    sim.d_angle_d_voltage[index] = m->d_angle_d_voltage;
+    sim.d_speed_d_voltage[index] = m->d_speed_d_voltage;
+    sim.d_current_d_voltage[index] = m->d_current_d_voltage;
+    sim.d_angle_d_torque[index] = m->d_angle_d_torque;
+    sim.d_speed_d_torque[index] = m->d_speed_d_torque;
+    sim.d_current_d_torque[index] = m->d_current_d_torque;
+    sim.torque_friction[index] = m->torque_friction;
+
+    return PBIO_SUCCESS;
+}
+
+/**
+ * Advances all simulated motors by one 1 ms time step.
+ *
+ * The loop body only selects between computed values instead of branching,
+ * so it vectorizes across motors.
+ */
+static void pbdrv_motor_driver_virtual_simulation_step(void) {
+    for (uint32_t i = 0; i < NUM_DEV; i++) {
+
+        const double angle = sim.angle[i];
+        const double speed = sim.speed[i];
+        const double current = sim.current[i];
+        const double voltage = sim.voltage[i];
+
+        // Modified coulomb friction with transition linear in speed through origin.
+        const double limit = 2000;
+        const double friction_max = sim.torque_friction[i];
+        double friction = friction_max * speed / limit;
+        friction = friction > friction_max ? friction_max : friction;
+        friction = friction < -friction_max ? -friction_max : friction;
+
+        // Stall obstacle torque, with damping only while beyond the endstop.
+        double angle_free = angle > sim.endstop_angle_positive[i] ? sim.endstop_angle_positive[i] : angle;
+        angle_free = angle_free < sim.endstop_angle_negative[i] ? sim.endstop_angle_negative[i] : angle_free;
+        const double overshoot = angle - angle_free;
+        const double damping = overshoot != 0 ? 5 : 0;
+        const double external_torque = overshoot * 500 + speed * damping;
+
+        const double torque = friction + external_torque;
+
+        // Get next state based on current state and input: x(k+1) = Ax(k) + Bu(k)
+        sim.angle[i] = angle +
+            speed * sim.d_angle_d_speed[i] +
+            current * sim.d_angle_d_current[i] +
+            voltage * sim.d_angle_d_voltage[i] +
+            torque * sim.d_angle_d_torque[i];
+        sim.speed[i] = 0 +
+            speed * sim.d_speed_d_speed[i] +
+            current * sim.d_speed_d_current[i] +
+            voltage * sim.d_speed_d_voltage[i] +
+            torque * sim.d_speed_d_torque[i];
+        sim.current[i] = 0 +
+            speed * sim.d_current_d_speed[i] +
+            current * sim.d_current_d_current[i] +
+            voltage * sim.d_current_d_voltage[i] +
+            torque * sim.d_current_d_torque[i];
+    }
+}
+
 static pid_t data_parser_pid;
 static FILE *data_parser_in;
 
@@ -96,37 +265,13 @@ PROCESS_THREAD(pbdrv_motor_driver_virtual_simulation_process, ev, data) {
     static struct timer frame_timer;
 
     static uint32_t dev_index;
-    static pbdrv_motor_driver_dev_t *driver;
 
     PROCESS_BEGIN();
 
-    // Initialize driver from platform data.
-    for (dev_index = 0; dev_index < PBDRV_CONFIG_MOTOR_DRIVER_NUM_DEV; dev_index++) {
-        // Get driver and platform data.
-        driver = &motor_driver_devs[dev_index];
-        driver->pdata = &pbdrv_motor_driver_virtual_simulation_platform_data[dev_index];
-        driver->angle = driver->pdata->initial_angle;
-        driver->speed = driver->pdata->initial_speed;
-        driver->current = 0;
-        driver->torque = 0;
-        driver->voltage = 0;
-
-        // Select model corresponding to device ID.
-        switch (driver->pdata->type_id) {
-            case PBDRV_LEGODEV_TYPE_ID_SPIKE_S_MOTOR:
-                driver->model = &model_technic_m_angular; // TODO
-                break;
-            case PBDRV_LEGODEV_TYPE_ID_SPIKE_M_MOTOR:
-                driver->model = &model_technic_m_angular;
-                break;
-            case PBDRV_LEGODEV_TYPE_ID_SPIKE_L_MOTOR:
-                driver->model = &model_technic_m_angular; // TODO
-                break;
-            case PBDRV_LEGODEV_TYPE_ID_NONE:
-                driver->model = NULL;
-                break;
-            default:
-                PROCESS_EXIT();
+    // Initialize drivers from platform data.
+    for (dev_index = 0; dev_index < NUM_DEV; dev_index++) {
+        if (pbdrv_motor_driver_virtual_simulation_init_dev(dev_index) != PBIO_SUCCESS) {
+            PROCESS_EXIT();
         }
     }
 
@@ -143,9 +288,8 @@ PROCESS_THREAD(pbdrv_motor_driver_virtual_simulation_process, ev, data) {
             timer_reset(&frame_timer);
 
             // Output motor angles on one line.
-            for (dev_index = 0; dev_index < PBDRV_CONFIG_MOTOR_DRIVER_NUM_DEV; dev_index++) {
-                driver = &motor_driver_devs[dev_index];
-                fprintf(data_parser_in, "%d ", ((int32_t)(driver->angle / 1000)));
+            for (dev_index = 0; dev_index < NUM_DEV; dev_index++) {
+                fprintf(data_parser_in, "%d ", ((int32_t)(sim.angle[dev_index] / 1000)));
             }
             fprintf(data_parser_in, "\r\n");
 
@@ -163,61 +307,7 @@ PROCESS_THREAD(pbdrv_motor_driver_virtual_simulation_process, ev, data) {
             }
         }
 
-        for (dev_index = 0; dev_index < PBDRV_CONFIG_MOTOR_DRIVER_NUM_DEV; dev_index++) {
-            driver = &motor_driver_devs[dev_index];
-
-            // Skip simulating if there is no model.
-            if (!driver->model) {
-                continue;
-            }
-
-            // Shorthand notation for frequent local references to model.
-            const pbio_simulation_model_t *m = driver->model;
-
-            // Modified coulomb friction with transition linear in speed through origin.
-            const double limit = 2000;
-            double friction;
-            if (driver->speed > limit) {
-                friction = m->torque_friction;
-            } else if (driver->speed < -limit) {
-                friction = -m->torque_friction;
-            } else {
-                friction = m->torque_friction * driver->speed / limit;
-            }
-
-            // Stall obstacle torque
-            double external_torque = 0;
-            if (driver->angle > driver->pdata->endstop_angle_positive) {
-                external_torque = (driver->angle - driver->pdata->endstop_angle_positive) * 500 + driver->speed * 5;
-            } else if (driver->angle < driver->pdata->endstop_angle_negative) {
-                external_torque = (driver->angle - driver->pdata->endstop_angle_negative) * 500 + driver->speed * 5;
-            }
-
-            double voltage = driver->voltage;
-            double torque = friction + external_torque;
-
-            // Get next state based on current state and input: x(k+1) = Ax(k) + Bu(k)
-            double angle_next = driver->angle +
-                driver->speed * m->d_angle_d_speed +
-                driver->current * m->d_angle_d_current +
-                voltage * m->d_angle_d_voltage +
-                torque * m->d_angle_d_torque;
-            double speed_next = 0 +
-                driver->speed * m->d_speed_d_speed +
-                driver->current * m->d_speed_d_current +
-                voltage * m->d_speed_d_voltage +
-                torque * m->d_speed_d_torque;
-            double current_next = 0 +
-                driver->speed * m->d_current_d_speed +
-                driver->current * m->d_current_d_current +
-                voltage * m->d_current_d_voltage +
-                torque * m->d_current_d_torque;
-
-            // Save new state.
-            driver->angle = angle_next;
-            driver->speed = speed_next;
-            driver->current = current_next;
-        }
+        pbdrv_motor_driver_virtual_simulation_step();
 
         etimer_reset(&tick_timer);
     }
@@ -290,8 +380,9 @@ void pbdrv_motor_driver_init_manual(void) {
 #endif // !PBDRV_CONFIG_MOTOR_DRIVER_VIRTUAL_SIMULATION_AUTO_START
 
 void pbdrv_motor_driver_virtual_simulation_get_angle(pbdrv_motor_driver_dev_t *dev, int32_t *rotations, int32_t *millidegrees) {
-    *rotations = (int64_t)dev->angle / 360000;
-    *millidegrees = (int64_t)dev->angle - *rotations * 360000;
+    int64_t angle = (int64_t)sim.angle[dev->index];
+    *rotations = angle / 360000;
+    *millidegrees = angle - *rotations * 360000;
 }
 
 #endif // PBDRV_CONFIG_MOTOR_DRIVER_VIRTUAL_SIMULATION
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2020 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 // This driver is for UARTs on STM32F0 MCUs. It provides async read and write
 // functions for sending and receive data and allows changing the baud rate.
@@ -45,6 +45,8 @@ typedef struct {
     struct etimer tx_timer;
     volatile pbio_error_t rx_result;
     volatile pbio_error_t tx_result;
+    struct process *owner;  // notified when a read or write completes
+    bool rx_waiting;        // whether a streaming reader waits for new data
     uint8_t irq;
     bool initialized;
 } pbdrv_uart_t;
@@ -82,6 +84,7 @@ pbio_error_t pbdrv_uart_read_begin(pbdrv_uart_dev_t *uart_dev, uint8_t *msg, uin
     uart->rx_buf_size = length;
     uart->rx_buf_index = 0;
     uart->rx_result = PBIO_ERROR_AGAIN;
+    uart->owner = PROCESS_CURRENT();
 
     etimer_set(&uart->rx_timer, timeout);
 
@@ -116,6 +119,31 @@ void pbdrv_uart_read_cancel(pbdrv_uart_dev_t *uart_dev) {
     uart->rx_result = PBIO_ERROR_CANCELED;
 }
 
+pbio_error_t pbdrv_uart_read_available(pbdrv_uart_dev_t *uart_dev, uint8_t *msg, uint8_t size, uint8_t *length) {
+    pbdrv_uart_t *uart = PBIO_CONTAINER_OF(uart_dev, pbdrv_uart_t, uart_dev);
+
+    *length = 0;
+
+    if (uart->rx_buf) {
+        return PBIO_ERROR_AGAIN;
+    }
+
+    // copy as many bytes as are available from the ring buffer
+    while (*length < size && uart->rx_ring_buf_head != uart->rx_ring_buf_tail) {
+        msg[(*length)++] = uart->rx_ring_buf[uart->rx_ring_buf_tail];
+        uart->rx_ring_buf_tail = (uart->rx_ring_buf_tail + 1) & (UART_RING_BUF_SIZE - 1);
+    }
+
+    if (*length) {
+        return PBIO_SUCCESS;
+    }
+
+    // nothing received yet, so notify this process when there is
+    uart->owner = PROCESS_CURRENT();
+    uart->rx_waiting = true;
+    return PBIO_ERROR_AGAIN;
+}
+
 pbio_error_t pbdrv_uart_write_begin(pbdrv_uart_dev_t *uart_dev, uint8_t *msg, uint8_t length, uint32_t timeout) {
     pbdrv_uart_t *uart = PBIO_CONTAINER_OF(uart_dev, pbdrv_uart_t, uart_dev);
 
@@ -131,6 +159,7 @@ pbio_error_t pbdrv_uart_write_begin(pbdrv_uart_dev_t *uart_dev, uint8_t *msg, ui
     uart->tx_buf_size = length;
     uart->tx_buf_index = 0;
     uart->tx_result = PBIO_ERROR_AGAIN;
+    uart->owner = PROCESS_CURRENT();
 
     etimer_set(&uart->tx_timer, timeout);
 
@@ -222,18 +251,22 @@ static void handle_poll(void) {
             while (uart->rx_ring_buf_head != uart->rx_ring_buf_tail) {
                 uart->rx_buf[uart->rx_buf_index++] = uart->rx_ring_buf[uart->rx_ring_buf_tail];
                 uart->rx_ring_buf_tail = (uart->rx_ring_buf_tail + 1) & (UART_RING_BUF_SIZE - 1);
-                // when rx_buf is full, send out a notification
+                // when rx_buf is full, notify the reader
                 if (uart->rx_buf_index == uart->rx_buf_size) {
                     uart->rx_result = PBIO_SUCCESS;
-                    process_post(PROCESS_BROADCAST, PROCESS_EVENT_COM, NULL);
+                    process_poll(uart->owner);
                     break;
                 }
             }
+        } else if (!uart->rx_buf && uart->rx_waiting && uart->rx_ring_buf_head != uart->rx_ring_buf_tail) {
+            // notify the streaming reader once, when new data arrives
+            uart->rx_waiting = false;
+            process_poll(uart->owner);
         }
 
         if (uart->tx_buf && uart->tx_buf_index == uart->tx_buf_size) {
             // TODO: this should only be sent once per write_begin
-            process_post(PROCESS_BROADCAST, PROCESS_EVENT_COM, NULL);
+            process_poll(uart->owner);
         }
     }
 }
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2020 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 // UART driver for STM32F4x using IRQ.
 
@@ -50,6 +50,10 @@ typedef struct {
     uint8_t write_length;
     /** The current position in write_buf. */
     volatile uint8_t write_pos;
+    /** The process that is notified when a read or write completes. */
+    struct process *owner;
+    /** Whether a streaming reader is waiting for new data. */
+    bool rx_waiting;
 } pbdrv_uart_t;
 
 static pbdrv_uart_t pbdrv_uart[PBDRV_CONFIG_UART_STM32F4_LL_IRQ_NUM_UART];
@@ -83,6 +87,7 @@ pbio_error_t pbdrv_uart_read_begin(pbdrv_uart_dev_t *uart_dev, uint8_t *msg, uin
     uart->read_buf = msg;
     uart->read_length = length;
     uart->read_pos = 0;
+    uart->owner = PROCESS_CURRENT();
 
     etimer_set(&uart->read_timer, timeout);
 
@@ -110,6 +115,35 @@ void pbdrv_uart_read_cancel(pbdrv_uart_dev_t *uart_dev) {
     // TODO
 }
 
+pbio_error_t pbdrv_uart_read_available(pbdrv_uart_dev_t *uart_dev, uint8_t *msg, uint8_t size, uint8_t *length) {
+    pbdrv_uart_t *uart = PBIO_CONTAINER_OF(uart_dev, pbdrv_uart_t, uart_dev);
+
+    *length = 0;
+
+    if (uart->read_buf) {
+        // Another read operation is already in progress.
+        return PBIO_ERROR_AGAIN;
+    }
+
+    // Copy as many bytes as are available from the ring buffer.
+    while (*length < size) {
+        int c = ringbuf_get(&uart->rx_buf);
+        if (c == -1) {
+            break;
+        }
+        msg[(*length)++] = c;
+    }
+
+    if (*length) {
+        return PBIO_SUCCESS;
+    }
+
+    // Nothing received yet, so notify this process when there is.
+    uart->owner = PROCESS_CURRENT();
+    uart->rx_waiting = true;
+    return PBIO_ERROR_AGAIN;
+}
+
 pbio_error_t pbdrv_uart_write_begin(pbdrv_uart_dev_t *uart_dev, uint8_t *msg, uint8_t length, uint32_t timeout) {
     pbdrv_uart_t *uart = PBIO_CONTAINER_OF(uart_dev, pbdrv_uart_t, uart_dev);
 
@@ -121,6 +155,7 @@ pbio_error_t pbdrv_uart_write_begin(pbdrv_uart_dev_t *uart_dev, uint8_t *msg, ui
     uart->write_buf = msg;
     uart->write_length = length;
     uart->write_pos = 0;
+    uart->owner = PROCESS_CURRENT();
 
     etimer_set(&uart->write_timer, timeout);
 
@@ -224,18 +259,22 @@ static void handle_poll(void) {
             uart->read_buf[uart->read_pos++] = c;
         }
 
-        // broadcast when read_buf is full
+        // notify owner when read_buf is full
         if (uart->read_buf && uart->read_pos == uart->read_length) {
-            // clearing read_buf to prevent multiple broadcasts
+            // clearing read_buf to prevent multiple notifications
             uart->read_buf = NULL;
-            process_post(PROCESS_BROADCAST, PROCESS_EVENT_COM, NULL);
+            process_poll(uart->owner);
+        } else if (!uart->read_buf && uart->rx_waiting && ringbuf_elements(&uart->rx_buf)) {
+            // Notify the streaming reader once, when new data arrives.
+            uart->rx_waiting = false;
+            process_poll(uart->owner);
         }
 
-        // broadcast when write_buf is drained
+        // notify owner when write_buf is drained
         if (uart->write_buf && uart->write_pos == uart->write_length) {
-            // clearing write_buf to prevent multiple broadcasts
+            // clearing write_buf to prevent multiple notifications
             uart->write_buf = NULL;
-            process_post(PROCESS_BROADCAST, PROCESS_EVENT_COM, NULL);
+            process_poll(uart->owner);
         }
     }
 }
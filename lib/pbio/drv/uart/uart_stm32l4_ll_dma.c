@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2020 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 // Copyright (c) 2020 Tilen MAJERLE
 // https://github.com/MaJerle/stm32-usart-uart-dma-rx-tx/blob/master/projects/usart_rx_idle_line_irq_rtos_L4_multi_instance/Src/main.c
 
@@ -202,16 +202,34 @@ static bool dma_is_ht(DMA_TypeDef *DMAx, uint32_t channel) {
     }
 }
 
-pbio_error_t pbdrv_uart_read_end(pbdrv_uart_dev_t *uart_dev) {
-    pbdrv_uart_t *uart = PBIO_CONTAINER_OF(uart_dev, pbdrv_uart_t, uart_dev);
+// Gets the number of bytes that DMA has written to the ring buffer but have
+// not been read yet.
+static uint32_t pbdrv_uart_rx_available(pbdrv_uart_t *uart) {
     const pbdrv_uart_stm32l4_ll_dma_platform_data_t *pdata = uart->pdata;
-    uint32_t rx_head;
 
     // head is the last position that DMA wrote to
-    rx_head = RX_DATA_SIZE - LL_DMA_GetDataLength(pdata->rx_dma, pdata->rx_dma_ch);
+    uint32_t rx_head = RX_DATA_SIZE - LL_DMA_GetDataLength(pdata->rx_dma, pdata->rx_dma_ch);
 
-    uint32_t available = (rx_head - uart->rx_tail) & (RX_DATA_SIZE - 1);
-    if (available < uart->read_length) {
+    return (rx_head - uart->rx_tail) & (RX_DATA_SIZE - 1);
+}
+
+// Copies bytes from the ring buffer and advances the tail.
+static void pbdrv_uart_rx_copy(pbdrv_uart_t *uart, uint8_t *dst, uint32_t size) {
+    if (uart->rx_tail + size > RX_DATA_SIZE) {
+        uint32_t partial_size = RX_DATA_SIZE - uart->rx_tail;
+        volatile_copy(&uart->rx_data[uart->rx_tail], &dst[0], partial_size);
+        volatile_copy(&uart->rx_data[0], &dst[partial_size], size - partial_size);
+    } else {
+        volatile_copy(&uart->rx_data[uart->rx_tail], &dst[0], size);
+    }
+
+    uart->rx_tail = (uart->rx_tail + size) & (RX_DATA_SIZE - 1);
+}
+
+pbio_error_t pbdrv_uart_read_end(pbdrv_uart_dev_t *uart_dev) {
+    pbdrv_uart_t *uart = PBIO_CONTAINER_OF(uart_dev, pbdrv_uart_t, uart_dev);
+
+    if (pbdrv_uart_rx_available(uart) < uart->read_length) {
         if (etimer_expired(&uart->rx_timer)) {
             uart->read_buf = NULL;
             uart->read_length = 0;
@@ -220,15 +238,7 @@ pbio_error_t pbdrv_uart_read_end(pbdrv_uart_dev_t *uart_dev) {
         return PBIO_ERROR_AGAIN;
     }
 
-    if (uart->rx_tail + uart->read_length > RX_DATA_SIZE) {
-        uint32_t partial_size = RX_DATA_SIZE - uart->rx_tail;
-        volatile_copy(&uart->rx_data[uart->rx_tail], &uart->read_buf[0], partial_size);
-        volatile_copy(&uart->rx_data[0], &uart->read_buf[partial_size], uart->read_length - partial_size);
-    } else {
-        volatile_copy(&uart->rx_data[uart->rx_tail], &uart->read_buf[0], uart->read_length);
-    }
-
-    uart->rx_tail = (uart->rx_tail + uart->read_length) & (RX_DATA_SIZE - 1);
+    pbdrv_uart_rx_copy(uart, uart->read_buf, uart->read_length);
     uart->read_buf = NULL;
     uart->read_length = 0;
 
@@ -237,6 +247,30 @@ pbio_error_t pbdrv_uart_read_end(pbdrv_uart_dev_t *uart_dev) {
     return PBIO_SUCCESS;
 }
 
+pbio_error_t pbdrv_uart_read_available(pbdrv_uart_dev_t *uart_dev, uint8_t *msg, uint8_t size, uint8_t *length) {
+    pbdrv_uart_t *uart = PBIO_CONTAINER_OF(uart_dev, pbdrv_uart_t, uart_dev);
+
+    *length = 0;
+
+    if (uart->read_buf) {
+        return PBIO_ERROR_AGAIN;
+    }
+
+    uint32_t available = pbdrv_uart_rx_available(uart);
+    if (available == 0) {
+        return PBIO_ERROR_AGAIN;
+    }
+
+    if (available > size) {
+        available = size;
+    }
+
+    pbdrv_uart_rx_copy(uart, msg, available);
+    *length = available;
+
+    return PBIO_SUCCESS;
+}
+
 void pbdrv_uart_read_cancel(pbdrv_uart_dev_t *uart_dev) {
     // TODO
 }
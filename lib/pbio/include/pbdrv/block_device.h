@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2022 The Pybricks Authors
+// Copyright (c) 2022-2024 The Pybricks Authors
 
 /**
  * @addtogroup BlockDeviceDriver Driver: Block device.
@@ -42,7 +42,8 @@ PT_THREAD(pbdrv_block_device_read(struct pt *pt, uint32_t offset, uint8_t *buffe
 /**
  * Store data on storage device, starting from the base address.
  *
- * This erases as many sectors as needed for the given size prior to writing.
+ * This erases and writes only the sectors whose contents differ from the
+ * given data. Sectors that already hold the data are left untouched.
  *
  * On systems with data storage on an external chip, this is implemented with
  * non-blocking I/O operations.
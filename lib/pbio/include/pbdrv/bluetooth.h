@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2023 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 /**
  * @addtogroup BluetoothDriver Driver: Bluetooth
@@ -85,8 +85,8 @@ struct _pbdrv_bluetooth_send_context_t {
     pbdrv_bluetooth_send_done_t done;
     /** The data to be sent. This data must remain valid until @p done is called. */
     const uint8_t *data;
-    /** The size of @p data. */
-    uint8_t size;
+    /** The size of @p data. Must not exceed pbdrv_bluetooth_get_max_notification_size(). */
+    uint16_t size;
     /** The connection to use. Only characteristics with notify capability are allowed. */
     pbdrv_bluetooth_connection_t connection;
 };
@@ -207,6 +207,12 @@ typedef void (*pbdrv_bluetooth_start_observing_callback_t)(pbdrv_bluetooth_ad_ty
 #define PBDRV_BLUETOOTH_MAX_MTU_SIZE 23
 #endif
 
+/** The maximum size of a notification or write on any connection for this chip. */
+#define PBDRV_BLUETOOTH_MAX_CHAR_SIZE (PBDRV_BLUETOOTH_MAX_MTU_SIZE - 3)
+
+/** The size of a notification or write that is valid on every connection. */
+#define PBDRV_BLUETOOTH_MIN_CHAR_SIZE (20)
+
 #if PBDRV_CONFIG_BLUETOOTH
 
 /**
@@ -286,6 +292,17 @@ void pbdrv_bluetooth_set_on_event(pbdrv_bluetooth_on_event_t on_event);
  */
 void pbdrv_bluetooth_send(pbdrv_bluetooth_send_context_t *context);
 
+/**
+ * Gets the maximum size of a notification on the given connection.
+ *
+ * This is the negotiated ATT MTU minus the 3-byte header. It is
+ * ::PBDRV_BLUETOOTH_MIN_CHAR_SIZE until the MTU has been exchanged.
+ *
+ * @param [in]  connection  The connection.
+ * @return                  The size in bytes.
+ */
+uint16_t pbdrv_bluetooth_get_max_notification_size(pbdrv_bluetooth_connection_t connection);
+
 /**
  * Registers a callback that will be called when data is received via a
  * characteristic write.
@@ -415,6 +432,10 @@ static inline void pbdrv_bluetooth_send(pbdrv_bluetooth_send_context_t *context)
     context->done();
 }
 
+static inline uint16_t pbdrv_bluetooth_get_max_notification_size(pbdrv_bluetooth_connection_t connection) {
+    return PBDRV_BLUETOOTH_MIN_CHAR_SIZE;
+}
+
 static inline void pbdrv_bluetooth_peripheral_scan_and_connect(
     pbio_task_t *task,
     pbdrv_bluetooth_ad_match_t match_adv,
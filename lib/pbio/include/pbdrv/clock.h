@@ -9,8 +9,11 @@
 #ifndef _PBDRV_CLOCK_H_
 #define _PBDRV_CLOCK_H_
 
+#include <stdbool.h>
 #include <stdint.h>
 
+#include <pbdrv/config.h>
+
 /**
  * Gets the current clock time in milliseconds (1e-3 seconds).
  */
@@ -36,6 +39,24 @@ uint32_t pbdrv_clock_get_us(void);
  */
 void pbdrv_clock_delay_us(uint32_t us);
 
+#if PBDRV_CONFIG_CLOCK_LINUX_LOCKSTEP
+
+bool pbdrv_clock_linux_lockstep_is_enabled(void);
+void pbdrv_clock_linux_lockstep_tick_us(uint32_t us);
+void pbdrv_clock_linux_lockstep_tick_ms(void);
+
+#else // PBDRV_CONFIG_CLOCK_LINUX_LOCKSTEP
+
+static inline bool pbdrv_clock_linux_lockstep_is_enabled(void) {
+    return false;
+}
+static inline void pbdrv_clock_linux_lockstep_tick_us(uint32_t us) {
+}
+static inline void pbdrv_clock_linux_lockstep_tick_ms(void) {
+}
+
+#endif // PBDRV_CONFIG_CLOCK_LINUX_LOCKSTEP
+
 #endif /* _PBDRV_CLOCK_H_ */
 
 /** @} */
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2023 The Pybricks Authors
+// Copyright (c) 2023-2024 The Pybricks Authors
 
 /**
  * @addtogroup legodev Driver: Driver for pluggable LEGO devices
@@ -413,6 +413,12 @@ typedef enum {
  */
 #define PBDRV_LEGODEV_MAX_DATA_SIZE    LUMP_MAX_MSG_SIZE
 
+/**
+ * Max number of modes that can be read at the same time using a mode
+ * combination.
+ */
+#define PBDRV_LEGODEV_MAX_COMBI_MODES  (4)
+
 /**
  * I/O device capability flags.
  */
@@ -481,9 +487,40 @@ typedef struct {
     uint8_t num_modes;
     /**< Information about the current mode. */
     pbdrv_legodev_mode_info_t mode_info[PBDRV_LEGODEV_MAX_NUM_MODES];
+    /**< Bit flags of modes that can be combined, terminated by 0. */
+    uint16_t mode_combos[LUMP_MAX_MODE_COMBOS];
     #endif
 } pbdrv_legodev_info_t;
 
+#if PBDRV_CONFIG_LEGODEV_INFO_CACHE
+
+/**
+ * Information of a device type that was received before.
+ */
+typedef struct {
+    /**< The device information. The type is ::PBDRV_LEGODEV_TYPE_ID_NONE if unused. */
+    pbdrv_legodev_info_t info;
+    /**< The baud rate that the device uses for data. */
+    uint32_t baud_rate;
+    /**< Number of consecutive times the cached info could not be used. */
+    uint8_t num_failed;
+    /**< Number of connections that still receive all info before the cache is tried again. */
+    uint8_t num_skip;
+} pbdrv_legodev_info_cache_entry_t;
+
+/**
+ * Information of recently used device types, so that it does not have to be
+ * received again when the device is connected again. All zeros is empty.
+ */
+typedef struct {
+    /**< The cached information, one entry per device type. */
+    pbdrv_legodev_info_cache_entry_t entries[PBDRV_CONFIG_LEGODEV_INFO_CACHE_NUM_ENTRIES];
+    /**< Index of the entry that is replaced next if there is no free entry. */
+    uint8_t next_index;
+} pbdrv_legodev_info_cache_t;
+
+#endif // PBDRV_CONFIG_LEGODEV_INFO_CACHE
+
 #if PBDRV_CONFIG_LEGODEV
 
 /**
@@ -539,6 +576,27 @@ pbio_error_t pbdrv_legodev_set_mode(pbdrv_legodev_dev_t *legodev, uint8_t mode);
  */
 pbio_error_t pbdrv_legodev_set_mode_with_data(pbdrv_legodev_dev_t *legodev, uint8_t mode, const void *data, uint8_t size);
 
+/**
+ * Starts setting a mode combination, so that the legodev device sends the
+ * data of several modes at once.
+ *
+ * While the combination is set, ::pbdrv_legodev_set_mode and
+ * ::pbdrv_legodev_get_data can be used for each of its modes without switching
+ * modes. Setting any other mode clears the combination. Writing data with
+ * ::pbdrv_legodev_set_mode_with_data suspends the combination until the data
+ * has been sent, after which it is set again.
+ *
+ * @param [in]  legodev   The legodev device instance.
+ * @param [in]  modes     The modes to combine.
+ * @param [in]  num_modes The number of modes, up to ::PBDRV_LEGODEV_MAX_COMBI_MODES.
+ * @return                ::PBIO_SUCCESS on success.
+ *                        ::PBIO_ERROR_NO_DEV if no device is attached.
+ *                        ::PBIO_ERROR_INVALID_ARG if the modes are not valid.
+ *                        ::PBIO_ERROR_NOT_SUPPORTED if the device can't combine these modes.
+ *                        ::PBIO_ERROR_AGAIN if the device is not ready for this operation.
+ */
+pbio_error_t pbdrv_legodev_set_mode_combi(pbdrv_legodev_dev_t *legodev, const uint8_t *modes, uint8_t num_modes);
+
 /**
  * Gets data from the legodev device.
  *
@@ -592,6 +650,19 @@ pbio_error_t pbdrv_legodev_get_abs_angle(pbdrv_legodev_dev_t *legodev, pbio_angl
  */
 bool pbdrv_legodev_needs_permanent_power(pbdrv_legodev_dev_t *legodev);
 
+#if PBDRV_CONFIG_LEGODEV_INFO_CACHE
+
+/**
+ * Sets the cache of device information that was received before. The cache
+ * is used and updated when devices are connected from here on.
+ *
+ * @param [in]  cache     The cache, which may be the previously stored cache.
+ * @param [in]  changed   Called when the contents of the cache change, or NULL.
+ */
+void pbdrv_legodev_set_info_cache(pbdrv_legodev_info_cache_t *cache, void (*changed)(void));
+
+#endif // PBDRV_CONFIG_LEGODEV_INFO_CACHE
+
 #else // PBDRV_CONFIG_LEGODEV
 
 static inline pbio_error_t pbdrv_legodev_get_device(pbio_port_id_t port_id, pbdrv_legodev_type_id_t *type_id, pbdrv_legodev_dev_t **legodev) {
@@ -630,6 +701,10 @@ static inline pbio_error_t pbdrv_legodev_set_mode_with_data(pbdrv_legodev_dev_t
     return PBIO_ERROR_NOT_SUPPORTED;
 }
 
+static inline pbio_error_t pbdrv_legodev_set_mode_combi(pbdrv_legodev_dev_t *legodev, const uint8_t *modes, uint8_t num_modes) {
+    return PBIO_ERROR_NOT_SUPPORTED;
+}
+
 static inline pbio_error_t pbdrv_legodev_get_data(pbdrv_legodev_dev_t *legodev, uint8_t mode, void **data) {
     return PBIO_ERROR_NOT_SUPPORTED;
 }
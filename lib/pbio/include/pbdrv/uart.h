@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2020 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 /**
  * @addtogroup UARTDriver Driver: Universal Asynchronous Receiver/Transmitter (UART)
@@ -33,6 +33,22 @@ void pbdrv_uart_set_baud_rate(pbdrv_uart_dev_t *uart, uint32_t baud);
 pbio_error_t pbdrv_uart_read_begin(pbdrv_uart_dev_t *uart, uint8_t *msg, uint8_t length, uint32_t timeout);
 pbio_error_t pbdrv_uart_read_end(pbdrv_uart_dev_t *uart);
 void pbdrv_uart_read_cancel(pbdrv_uart_dev_t *uart);
+
+/**
+ * Reads bytes that have already been received, without waiting.
+ *
+ * This can be used instead of ::pbdrv_uart_read_begin and
+ * ::pbdrv_uart_read_end to consume a continuous data stream.
+ *
+ * @param [in]  uart    The UART device
+ * @param [out] msg     Buffer for the received bytes
+ * @param [in]  size    Size of @p msg
+ * @param [out] length  Number of bytes copied to @p msg
+ * @return              ::PBIO_SUCCESS if at least one byte was read,
+ *                      ::PBIO_ERROR_AGAIN if no bytes are available yet
+ *                      or another read is in progress.
+ */
+pbio_error_t pbdrv_uart_read_available(pbdrv_uart_dev_t *uart, uint8_t *msg, uint8_t size, uint8_t *length);
 pbio_error_t pbdrv_uart_write_begin(pbdrv_uart_dev_t *uart, uint8_t *msg, uint8_t length, uint32_t timeout);
 pbio_error_t pbdrv_uart_write_end(pbdrv_uart_dev_t *uart);
 void pbdrv_uart_write_cancel(pbdrv_uart_dev_t *uart);
@@ -54,6 +70,10 @@ static inline pbio_error_t pbdrv_uart_read_end(pbdrv_uart_dev_t *uart) {
 }
 static inline void pbdrv_uart_read_cancel(pbdrv_uart_dev_t *uart) {
 }
+static inline pbio_error_t pbdrv_uart_read_available(pbdrv_uart_dev_t *uart, uint8_t *msg, uint8_t size, uint8_t *length) {
+    *length = 0;
+    return PBIO_ERROR_NOT_SUPPORTED;
+}
 static inline pbio_error_t pbdrv_uart_write_begin(pbdrv_uart_dev_t *uart, uint8_t *msg, uint8_t length, uint32_t timeout) {
     return PBIO_ERROR_NOT_SUPPORTED;
 }
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2019-2020 The Pybricks Authors
+// Copyright (c) 2019-2024 The Pybricks Authors
 
 #ifndef _PBIO_CONFIG_H_
 #define _PBIO_CONFIG_H_
@@ -11,23 +11,55 @@
 #define PBIO_CONFIG_ENABLE_SYS (0)
 #endif
 
-// Control loop time
+// Default control loop time
 #ifndef PBIO_CONFIG_CONTROL_LOOP_TIME_MS
 #define PBIO_CONFIG_CONTROL_LOOP_TIME_MS (5)
 #endif
 
-// Angle differentiation time window, defined as a multiple of the loop time.
-// This is the time window used for calculating the average speed, so 100ms.
-#define PBIO_CONFIG_DIFFERENTIATOR_WINDOW_SIZE (100 / PBIO_CONFIG_CONTROL_LOOP_TIME_MS)
+// Whether the control loop time can be changed at runtime. If enabled, the
+// loop time can be 1, 2, 5, or 10 ms for motors that have models for it.
+#ifndef PBIO_CONFIG_CONTROL_LOOP_TIME_RUNTIME
+#define PBIO_CONFIG_CONTROL_LOOP_TIME_RUNTIME (0)
+#endif
+
+// Shortest control loop time
+#if PBIO_CONFIG_CONTROL_LOOP_TIME_RUNTIME
+#define PBIO_CONFIG_CONTROL_LOOP_TIME_MIN_MS (1)
+#else
+#define PBIO_CONFIG_CONTROL_LOOP_TIME_MIN_MS (PBIO_CONFIG_CONTROL_LOOP_TIME_MS)
+#endif
+
+// Whether controllers have a queue of position control segments that blend
+// into each other. This costs RAM for every servo and drive base controller.
+#ifndef PBIO_CONFIG_CONTROL_QUEUE
+#define PBIO_CONFIG_CONTROL_QUEUE (0)
+#endif
+
+// Angle differentiation time window. This is the time window used for
+// calculating the average speed.
+#define PBIO_CONFIG_DIFFERENTIATOR_WINDOW_MS (100)
 
 // Total number of position samples to store in the differentiator buffer.
-// Must be > PBIO_CONFIG_DIFFERENTIATOR_WINDOW_SIZE. This allows a user
-// program to get speed with additional control over the trade off between a
-// smooth but delayed value (long window) or noisy and fast value (short window).
+// Must be > PBIO_CONFIG_DIFFERENTIATOR_WINDOW_MS / shortest loop time. Longer
+// buffers allow a user program to get speed with additional control over the
+// trade off between a smooth but delayed value (long window) or noisy and fast
+// value (short window). Every servo has one, so platforms with a runtime loop
+// time only fit the default window at the shortest loop time, unless they set
+// a bigger buffer.
 #ifndef PBIO_CONFIG_DIFFERENTIATOR_BUFFER_SIZE
-#define PBIO_CONFIG_DIFFERENTIATOR_BUFFER_SIZE (PBIO_CONFIG_DIFFERENTIATOR_WINDOW_SIZE * 3 + 1)
+#if PBIO_CONFIG_CONTROL_LOOP_TIME_RUNTIME
+#define PBIO_CONFIG_DIFFERENTIATOR_BUFFER_SIZE (PBIO_CONFIG_DIFFERENTIATOR_WINDOW_MS / PBIO_CONFIG_CONTROL_LOOP_TIME_MIN_MS + 1)
+#else
+#define PBIO_CONFIG_DIFFERENTIATOR_BUFFER_SIZE (PBIO_CONFIG_DIFFERENTIATOR_WINDOW_MS / PBIO_CONFIG_CONTROL_LOOP_TIME_MS * 3 + 1)
+#endif
 #endif
 
 #define PBIO_CONFIG_NUM_DRIVEBASES (PBIO_CONFIG_SERVO_NUM_DEV / 2)
 
+// Whether drivebases continuously estimate their position and heading. This
+// uses floating point math, so it should only be enabled on hubs with an FPU.
+#ifndef PBIO_CONFIG_DRIVEBASE_ODOMETRY
+#define PBIO_CONFIG_DRIVEBASE_ODOMETRY (0)
+#endif
+
 #endif // _PBIO_CONFIG_H_
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2023 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 // SPDX-License-Identifier: BSD-3-Clause
 // Copyright (c) 2020-2023 LEGO System A/S
@@ -17,6 +17,7 @@
 #include <stdint.h>
 
 #include <pbio/angle.h>
+#include <pbio/config.h>
 #include <pbio/control_settings.h>
 #include <pbio/error.h>
 #include <pbio/port.h>
@@ -125,6 +126,34 @@ typedef enum {
     PBIO_CONTROL_STATUS_COMPLETE = 1 << 1,
 } pbio_control_status_flag_t;
 
+#if PBIO_CONFIG_CONTROL_QUEUE
+
+/**
+ * Maximum number of position control segments that can be queued to run after
+ * the ongoing one.
+ */
+#define PBIO_CONTROL_QUEUE_SIZE (8)
+
+/**
+ * Position control segment that waits in the queue.
+ */
+typedef struct _pbio_control_segment_t {
+    /**
+     * Target position (control units).
+     */
+    pbio_angle_t target;
+    /**
+     * Top speed on the way to the target (control units). The sign is ignored.
+     */
+    int32_t speed;
+    /**
+     * Action to be taken if this is the last segment.
+     */
+    pbio_control_on_completion_t on_completion;
+} pbio_control_segment_t;
+
+#endif // PBIO_CONFIG_CONTROL_QUEUE
+
 /**
  * Controller status and state.
  */
@@ -167,6 +196,21 @@ typedef struct _pbio_control_t {
      * Control state flags such as being on target and/or being stalled.
      */
     pbio_control_status_flag_t status;
+    #if PBIO_CONFIG_CONTROL_QUEUE
+    /**
+     * Position control segments to run after the ongoing one. Consecutive
+     * segments are blended so the system does not stop in between.
+     */
+    pbio_control_segment_t queue[PBIO_CONTROL_QUEUE_SIZE];
+    /**
+     * Index of the next segment in the queue.
+     */
+    uint8_t queue_start;
+    /**
+     * Number of segments in the queue.
+     */
+    uint8_t queue_size;
+    #endif
 } pbio_control_t;
 
 // Time and reference functions:
@@ -202,6 +246,9 @@ pbio_dcmotor_actuation_t pbio_control_passive_completion_to_actuation_type(pbio_
 pbio_error_t pbio_control_start_position_control(pbio_control_t *ctl, uint32_t time_now, const pbio_control_state_t *state, int32_t position, int32_t speed, pbio_control_on_completion_t on_completion);
 pbio_error_t pbio_control_start_position_control_relative(pbio_control_t *ctl, uint32_t time_now, const pbio_control_state_t *state, int32_t distance, int32_t speed, pbio_control_on_completion_t on_completion, bool allow_trajectory_shift);
 pbio_error_t pbio_control_start_position_control_hold(pbio_control_t *ctl, uint32_t time_now, int32_t position);
+#if PBIO_CONFIG_CONTROL_QUEUE
+pbio_error_t pbio_control_queue_position_control(pbio_control_t *ctl, uint32_t time_now, const pbio_control_state_t *state, int32_t position, int32_t speed, pbio_control_on_completion_t on_completion);
+#endif
 pbio_error_t pbio_control_start_timed_control(pbio_control_t *ctl, uint32_t time_now, const pbio_control_state_t *state, uint32_t duration, int32_t speed, pbio_control_on_completion_t on_completion);
 
 #endif // _PBIO_CONTROL_H_
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2023 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 // SPDX-License-Identifier: BSD-3-Clause
 // Copyright (c) 2020-2023 LEGO System A/S
@@ -77,6 +77,12 @@ typedef struct _pbio_control_settings_t {
      * Absolute rate of change of the speed during off-ramp of the maneuver.
      */
     int32_t deceleration;
+    /**
+     * Absolute rate of change of the acceleration, used to smooth the start
+     * and end of the on-ramp and off-ramp. If zero, the acceleration changes
+     * instantaneously, giving a trapezoidal speed profile.
+     */
+    int32_t jerk;
     /**
      * Maximum feedback actuation value. On a motor this is the maximum torque.
      */
@@ -122,6 +128,10 @@ typedef struct _pbio_control_settings_t {
      * brake and smart coast.
      */
     uint32_t smart_passive_hold_time;
+    /**
+     * Time between control updates (ms).
+     */
+    uint32_t loop_time;
 } pbio_control_settings_t;
 
 // Unit conversion functions:
@@ -135,17 +145,18 @@ void pbio_control_settings_app_to_ctl_long(const pbio_control_settings_t *s, int
 int32_t pbio_control_settings_actuation_ctl_to_app(int32_t input);
 int32_t pbio_control_settings_actuation_app_to_ctl(int32_t input);
 bool pbio_control_settings_time_is_later(uint32_t sample, uint32_t base);
+pbio_error_t pbio_control_settings_get_loop_time_index(uint32_t loop_time, uint8_t *index);
 
 // Scale values by given constants:
 
-int32_t pbio_control_settings_mul_by_loop_time(int32_t input);
+int32_t pbio_control_settings_mul_by_loop_time(const pbio_control_settings_t *s, int32_t input);
 int32_t pbio_control_settings_mul_by_gain(int32_t value, int32_t gain);
 int32_t pbio_control_settings_div_by_gain(int32_t value, int32_t gain);
 
 // Control settings getters and setters:
 
-void pbio_control_settings_get_trajectory_limits(const pbio_control_settings_t *s, int32_t *speed, int32_t *acceleration, int32_t *deceleration);
-pbio_error_t pbio_control_settings_set_trajectory_limits(pbio_control_settings_t *s, int32_t speed, int32_t acceleration, int32_t deceleration);
+void pbio_control_settings_get_trajectory_limits(const pbio_control_settings_t *s, int32_t *speed, int32_t *acceleration, int32_t *deceleration, int32_t *jerk);
+pbio_error_t pbio_control_settings_set_trajectory_limits(pbio_control_settings_t *s, int32_t speed, int32_t acceleration, int32_t deceleration, int32_t jerk);
 int32_t pbio_control_settings_get_actuation_limit(const pbio_control_settings_t *s);
 pbio_error_t pbio_control_settings_set_actuation_limit(pbio_control_settings_t *s, int32_t limit);
 void pbio_control_settings_get_pid(const pbio_control_settings_t *s, int32_t *pid_kp, int32_t *pid_ki, int32_t *pid_kd, int32_t *integral_deadzone, int32_t *integral_change_max);
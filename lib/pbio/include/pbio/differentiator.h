@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2022-2023 The Pybricks Authors
+// Copyright (c) 2022-2024 The Pybricks Authors
 
 // SPDX-License-Identifier: BSD-3-Clause
 // Copyright (c) 2022-2023 LEGO System A/S
@@ -39,7 +39,11 @@ typedef struct _pbio_differentiator_t {
     /**
      * Ring buffer index of the newest sampe.
      */
-    uint8_t index;
+    uint16_t index;
+    /**
+     * Time between samples (ms).
+     */
+    uint8_t loop_time;
 } pbio_differentiator_t;
 
 int32_t pbio_differentiator_update_and_get_speed(pbio_differentiator_t *dif, const pbio_angle_t *angle);
@@ -48,6 +52,8 @@ pbio_error_t pbio_differentiator_get_speed(pbio_differentiator_t *dif, uint32_t
 
 void pbio_differentiator_reset(pbio_differentiator_t *dif, const pbio_angle_t *angle);
 
+void pbio_differentiator_set_loop_time(pbio_differentiator_t *dif, uint32_t loop_time);
+
 #endif // _PBIO_DIFFERENTIATOR_H_
 
 /** @} */
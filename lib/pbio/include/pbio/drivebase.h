@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2023 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 // SPDX-License-Identifier: BSD-3-Clause
 // Copyright (c) 2020-2023 LEGO System A/S
@@ -14,10 +14,36 @@
 #ifndef _PBIO_DRIVEBASE_H_
 #define _PBIO_DRIVEBASE_H_
 
+#include <pbio/logger.h>
 #include <pbio/servo.h>
 
 #if PBIO_CONFIG_NUM_DRIVEBASES > 0
 
+#if PBIO_CONFIG_DRIVEBASE_ODOMETRY
+
+/** Number of values per row when the drivebase pose logger is active. */
+#define PBIO_DRIVEBASE_POSE_LOGGER_NUM_COLS (3)
+
+/**
+ * Position and heading of a drivebase, relative to where its pose was reset.
+ */
+typedef struct _pbio_drivebase_pose_t {
+    /**
+     * Distance traveled along the initial heading (mm).
+     */
+    float x;
+    /**
+     * Distance traveled to the right of the initial heading (mm).
+     */
+    float y;
+    /**
+     * Heading, positive when turning clockwise, like the drivebase angle (deg).
+     */
+    float heading;
+} pbio_drivebase_pose_t;
+
+#endif // PBIO_CONFIG_DRIVEBASE_ODOMETRY
+
 typedef struct _pbio_drivebase_t {
     /**
      * True if a gyro or compass is used for heading control, else false.
@@ -31,6 +57,32 @@ typedef struct _pbio_drivebase_t {
     pbio_servo_t *right;
     pbio_control_t control_heading;
     pbio_control_t control_distance;
+    #if PBIO_CONFIG_DRIVEBASE_ODOMETRY
+    /**
+     * Pose estimated by integrating the distance and heading increments.
+     */
+    pbio_drivebase_pose_t pose;
+    /**
+     * Distance at the previous pose update, in control units.
+     */
+    pbio_angle_t pose_distance;
+    /**
+     * Heading at the previous pose update, in control units.
+     */
+    pbio_angle_t pose_heading;
+    /**
+     * Sum of the angle reset counts of both motors at the previous pose update.
+     */
+    uint32_t pose_motor_resets;
+    /**
+     * Gyro heading reset count at the previous pose update.
+     */
+    uint32_t pose_gyro_resets;
+    /**
+     * Structure with pose log settings and pointer to data buffer if active.
+     */
+    pbio_log_t pose_log;
+    #endif
 } pbio_drivebase_t;
 
 pbio_error_t pbio_drivebase_get_drivebase(pbio_drivebase_t **db_address, pbio_servo_t *left, pbio_servo_t *right, int32_t wheel_diameter, int32_t axle_track);
@@ -38,6 +90,7 @@ pbio_error_t pbio_drivebase_get_drivebase(pbio_drivebase_t **db_address, pbio_se
 // Drive base status:
 
 void pbio_drivebase_update_all(void);
+void pbio_drivebase_set_loop_time_all(uint32_t loop_time);
 bool pbio_drivebase_update_loop_is_running(pbio_drivebase_t *db);
 bool pbio_drivebase_is_done(const pbio_drivebase_t *db);
 pbio_error_t pbio_drivebase_is_stalled(pbio_drivebase_t *db, bool *stalled, uint32_t *stall_duration);
@@ -60,6 +113,15 @@ pbio_error_t pbio_drivebase_get_drive_settings(const pbio_drivebase_t *db, int32
 pbio_error_t pbio_drivebase_set_drive_settings(pbio_drivebase_t *db, int32_t drive_speed, int32_t drive_acceleration, int32_t drive_deceleration, int32_t turn_rate, int32_t turn_acceleration, int32_t turn_deceleration);
 pbio_error_t pbio_drivebase_set_use_gyro(pbio_drivebase_t *db, bool use_gyro);
 
+#if PBIO_CONFIG_DRIVEBASE_ODOMETRY
+
+// Odometry:
+
+pbio_error_t pbio_drivebase_get_pose(pbio_drivebase_t *db, int32_t *x, int32_t *y, int32_t *heading);
+pbio_error_t pbio_drivebase_reset_pose(pbio_drivebase_t *db, int32_t x, int32_t y, int32_t heading);
+
+#endif // PBIO_CONFIG_DRIVEBASE_ODOMETRY
+
 #if PBIO_CONFIG_DRIVEBASE_SPIKE
 
 // SPIKE drive base wrappers:
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2023 The Pybricks Authors
+// Copyright (c) 2023-2024 The Pybricks Authors
 
 /**
  * @addtogroup Geometry pbio/geometry: Linear algebra and geometry utilities
@@ -62,6 +62,21 @@ typedef struct _pbio_geometry_matrix_3x3_t {
     };
 } pbio_geometry_matrix_3x3_t;
 
+/**
+ * Quaternion orientation or its time derivative.
+ */
+typedef struct _pbio_geometry_quaternion_t {
+    union {
+        struct {
+            float q1; /**< q1 coordinate.*/
+            float q2; /**< q2 coordinate.*/
+            float q3; /**< q3 coordinate.*/
+            float q4; /**< q4 coordinate.*/
+        };
+        float values[4];
+    };
+} pbio_geometry_quaternion_t;
+
 void pbio_geometry_side_get_axis(pbio_geometry_side_t side, uint8_t *index, int8_t *sign);
 
 void pbio_geometry_get_complementary_axis(uint8_t *index, int8_t *sign);
@@ -72,12 +87,26 @@ pbio_error_t pbio_geometry_vector_normalize(pbio_geometry_xyz_t *input, pbio_geo
 
 void pbio_geometry_vector_cross_product(pbio_geometry_xyz_t *a, pbio_geometry_xyz_t *b, pbio_geometry_xyz_t *output);
 
+float pbio_geometry_vector_dot_product(pbio_geometry_xyz_t *a, pbio_geometry_xyz_t *b);
+
 pbio_error_t pbio_geometry_vector_project(pbio_geometry_xyz_t *axis, pbio_geometry_xyz_t *input, float *projection);
 
 void pbio_geometry_vector_map(pbio_geometry_matrix_3x3_t *map, pbio_geometry_xyz_t *input, pbio_geometry_xyz_t *output);
 
 pbio_error_t pbio_geometry_map_from_base_axes(pbio_geometry_xyz_t *x_axis, pbio_geometry_xyz_t *z_axis, pbio_geometry_matrix_3x3_t *rotation);
 
+void pbio_geometry_quaternion_to_rotation_matrix(pbio_geometry_quaternion_t *q, pbio_geometry_matrix_3x3_t *R);
+
+void pbio_geometry_quaternion_from_gravity_unit_vector(pbio_geometry_xyz_t *g, pbio_geometry_quaternion_t *q);
+
+void pbio_geometry_quaternion_get_rate_of_change(pbio_geometry_quaternion_t *q, pbio_geometry_xyz_t *w, pbio_geometry_quaternion_t *dq);
+
+void pbio_geometry_quaternion_integrate(pbio_geometry_quaternion_t *q, pbio_geometry_xyz_t *w, float dt);
+
+void pbio_geometry_get_tilt_correction(pbio_geometry_xyz_t *gravity, pbio_geometry_xyz_t *up, float gain, pbio_geometry_xyz_t *correction);
+
+void pbio_geometry_quaternion_normalize(pbio_geometry_quaternion_t *q);
+
 #endif // _PBIO_GEOMETRY_H_
 
 /** @} */
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2023 The Pybricks Authors
+// Copyright (c) 2023-2024 The Pybricks Authors
 
 /**
  * @addtogroup Imu Imu functions
@@ -18,6 +18,22 @@
 #include <pbio/error.h>
 #include <pbio/geometry.h>
 
+/**
+ * Heading estimates.
+ */
+typedef enum {
+    /**
+     * Integrated rotation about the Z axis of the robot. This is the most
+     * accurate option for robots that drive on a flat surface.
+     */
+    PBIO_IMU_HEADING_TYPE_1D,
+    /**
+     * Rotation about the vertical axis, estimated from the 3D orientation.
+     * This stays correct when the robot is tilted.
+     */
+    PBIO_IMU_HEADING_TYPE_3D,
+} pbio_imu_heading_type_t;
+
 #if PBIO_CONFIG_IMU
 
 void pbio_imu_init(void);
@@ -36,14 +52,22 @@ void pbio_imu_get_angular_velocity(pbio_geometry_xyz_t *values);
 
 void pbio_imu_get_acceleration(pbio_geometry_xyz_t *values);
 
+void pbio_imu_get_linear_acceleration(pbio_geometry_xyz_t *values);
+
+void pbio_imu_get_up_vector(pbio_geometry_xyz_t *values);
+
+void pbio_imu_get_orientation(pbio_geometry_matrix_3x3_t *rotation);
+
 pbio_error_t pbio_imu_get_single_axis_rotation(pbio_geometry_xyz_t *axis, float *angle);
 
 pbio_geometry_side_t pbio_imu_get_up_side(void);
 
-float pbio_imu_get_heading(void);
+float pbio_imu_get_heading(pbio_imu_heading_type_t type);
 
 void pbio_imu_set_heading(float desired_heading);
 
+uint32_t pbio_imu_get_heading_reset_count(void);
+
 void pbio_imu_get_heading_scaled(pbio_angle_t *heading, int32_t *heading_rate, int32_t ctl_steps_per_degree);
 
 #else // PBIO_CONFIG_IMU
@@ -72,17 +96,30 @@ static inline void pbio_imu_get_angular_velocity(pbio_geometry_xyz_t *values) {
 static inline void pbio_imu_get_acceleration(pbio_geometry_xyz_t *values) {
 }
 
+static inline void pbio_imu_get_linear_acceleration(pbio_geometry_xyz_t *values) {
+}
+
+static inline void pbio_imu_get_up_vector(pbio_geometry_xyz_t *values) {
+}
+
+static inline void pbio_imu_get_orientation(pbio_geometry_matrix_3x3_t *rotation) {
+}
+
 static inline pbio_geometry_side_t pbio_imu_get_up_side(void) {
     return PBIO_GEOMETRY_SIDE_TOP;
 }
 
-static inline float pbio_imu_get_heading(void) {
+static inline float pbio_imu_get_heading(pbio_imu_heading_type_t type) {
     return 0.0f;
 }
 
 static inline void pbio_imu_set_heading(float desired_heading) {
 }
 
+static inline uint32_t pbio_imu_get_heading_reset_count(void) {
+    return 0;
+}
+
 static inline void pbio_imu_get_heading_scaled(pbio_angle_t *heading, int32_t *heading_rate, int32_t ctl_steps_per_degree) {
 }
 
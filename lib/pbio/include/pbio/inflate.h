@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2024 The Pybricks Authors
+
+/**
+ * @addtogroup Inflate pbio/inflate: Inflating compressed data
+ *
+ * Inflates data compressed with tools/mpy_compress.py one byte at a time.
+ *
+ * Compressed data is a sequence of tokens. A token byte t below 0x80 is
+ * followed by t + 1 literal bytes. A token byte t of 0x80 or more is followed
+ * by a 16-bit little-endian distance d. It repeats (t & 0x7F) + 3 bytes,
+ * starting d + 1 bytes back in the inflated data.
+ *
+ * @{
+ */
+
+#ifndef _PBIO_INFLATE_H_
+#define _PBIO_INFLATE_H_
+
+#include <stdint.h>
+
+#include <pbio/error.h>
+
+/**
+ * How far back matches may refer to. Must be a power of two.
+ */
+#define PBIO_INFLATE_WINDOW_SIZE (1024)
+
+/**
+ * State of inflating compressed data.
+ */
+typedef struct _pbio_inflate_t {
+    /** Next compressed byte. */
+    const uint8_t *cur;
+    /** End of the compressed data. */
+    const uint8_t *end;
+    /** Number of literal bytes left in the current token. */
+    uint16_t literals;
+    /** Number of repeated bytes left in the current token. */
+    uint16_t matches;
+    /** Distance of the current match, minus one. */
+    uint16_t distance;
+    /** Number of bytes inflated so far. */
+    uint32_t pos;
+    /** The most recently inflated bytes. */
+    uint8_t window[PBIO_INFLATE_WINDOW_SIZE];
+} pbio_inflate_t;
+
+void pbio_inflate_init(pbio_inflate_t *z, const uint8_t *data, uint32_t size);
+pbio_error_t pbio_inflate_byte(pbio_inflate_t *z, uint8_t *value);
+
+#endif // _PBIO_INFLATE_H_
+
+/** @} */
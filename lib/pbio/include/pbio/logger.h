@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2022 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 /**
  * @addtogroup Logger pbio/logger: Logging control loop data
@@ -55,6 +55,32 @@ typedef struct _pbio_log_t {
      * How many rows have been skipped so far, counts up to down_sample.
      */
     uint32_t skipped_samples;
+    /**
+     * Time between two calls to add a row (ms), set by the owner of the log.
+     */
+    uint32_t loop_time;
+    /**
+     * Whether the data buffer is used as a ring that is drained while logging.
+     */
+    bool streaming;
+    /**
+     * Index of the row that will be written next in streaming mode. Only
+     * modified by the producer (the background control loop).
+     */
+    volatile uint32_t head;
+    /**
+     * Index of the row that will be read next in streaming mode. Only
+     * modified by the consumer.
+     */
+    volatile uint32_t tail;
+    /**
+     * Index of the next value to read in the row at @p tail.
+     */
+    uint8_t tail_col;
+    /**
+     * Number of rows discarded in streaming mode because the ring was full.
+     */
+    uint32_t num_rows_dropped;
     #endif
 } pbio_log_t;
 
@@ -64,20 +90,42 @@ typedef struct _pbio_log_t {
 // Number of values logged by the logger itself, such as time of call to logger
 #define PBIO_LOGGER_NUM_DEFAULT_COLS (1)
 
+/** Version of the binary log format. */
+#define PBIO_LOGGER_BINARY_VERSION (1)
+
+/** Number of bytes in the header of a binary log. */
+#define PBIO_LOGGER_BINARY_HEADER_SIZE (12)
+
+/** Maximum number of bytes of one encoded value in a binary log. */
+#define PBIO_LOGGER_BINARY_MAX_VALUE_SIZE (5)
+
 void pbio_logger_start(pbio_log_t *log, int32_t *buf, uint32_t num_rows, uint8_t num_cols, int32_t down_sample);
+void pbio_logger_start_stream(pbio_log_t *log, int32_t *buf, uint32_t num_rows, uint8_t num_cols, int32_t down_sample);
 void pbio_logger_stop(pbio_log_t *log);
+void pbio_logger_set_loop_time(pbio_log_t *log, uint32_t loop_time);
 bool pbio_logger_is_active(const pbio_log_t *log);
 void pbio_logger_add_row(pbio_log_t *log, const int32_t *row_data);
 
 uint32_t pbio_logger_get_num_rows_used(const pbio_log_t *log);
 int32_t *pbio_logger_get_row_data(const pbio_log_t *log, uint32_t index);
 
+bool pbio_logger_is_streaming(const pbio_log_t *log);
+uint32_t pbio_logger_stream_get_num_rows_pending(const pbio_log_t *log);
+uint32_t pbio_logger_stream_read(pbio_log_t *log, uint8_t *buf, uint32_t size);
+
+uint32_t pbio_logger_binary_encode_header(const pbio_log_t *log, uint8_t *buf);
+uint32_t pbio_logger_binary_encode_row(const pbio_log_t *log, uint32_t index, int32_t *previous, uint8_t *buf);
+
 #else
 
 static inline void pbio_logger_start(pbio_log_t *log, int32_t *buf, uint32_t num_rows, uint8_t num_cols, int32_t down_sample) {
 }
+static inline void pbio_logger_start_stream(pbio_log_t *log, int32_t *buf, uint32_t num_rows, uint8_t num_cols, int32_t down_sample) {
+}
 static inline void pbio_logger_stop(pbio_log_t *log) {
 }
+static inline void pbio_logger_set_loop_time(pbio_log_t *log, uint32_t loop_time) {
+}
 static inline bool pbio_logger_is_active(const pbio_log_t *log) {
     return false;
 }
@@ -89,6 +137,21 @@ static inline uint32_t pbio_logger_get_num_rows_used(const pbio_log_t *log) {
 static inline int32_t *pbio_logger_get_row_data(pbio_log_t *log, uint32_t index) {
     return NULL;
 }
+static inline bool pbio_logger_is_streaming(const pbio_log_t *log) {
+    return false;
+}
+static inline uint32_t pbio_logger_stream_get_num_rows_pending(const pbio_log_t *log) {
+    return 0;
+}
+static inline uint32_t pbio_logger_stream_read(pbio_log_t *log, uint8_t *buf, uint32_t size) {
+    return 0;
+}
+static inline uint32_t pbio_logger_binary_encode_header(const pbio_log_t *log, uint8_t *buf) {
+    return 0;
+}
+static inline uint32_t pbio_logger_binary_encode_row(const pbio_log_t *log, uint32_t index, int32_t *previous, uint8_t *buf) {
+    return 0;
+}
 
 #endif // PBIO_CONFIG_LOGGER
 
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2023 The Pybricks Authors
+// Copyright (c) 2023-2024 The Pybricks Authors
 
 /**
  * @addtogroup MotorProcess pbio/motor_process: Motor control background process.
@@ -11,7 +11,56 @@
 #ifndef _PBIO_MOTOR_PROCESS_H_
 #define _PBIO_MOTOR_PROCESS_H_
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include <pbio/config.h>
+#include <pbio/error.h>
+
+#ifndef PBIO_CONFIG_MOTOR_PROCESS_STATS
+#define PBIO_CONFIG_MOTOR_PROCESS_STATS (0)
+#endif
+
+/** Stages of one update of the motor process. */
+typedef enum {
+    /** Battery voltage update. */
+    PBIO_MOTOR_PROCESS_STAGE_BATTERY,
+    /** Drivebase control update. */
+    PBIO_MOTOR_PROCESS_STAGE_DRIVEBASE,
+    /** Servo control update. */
+    PBIO_MOTOR_PROCESS_STAGE_SERVO,
+    /** Number of stages. */
+    PBIO_MOTOR_PROCESS_NUM_STAGES,
+} pbio_motor_process_stage_t;
+
+/** Number of bins in each timing histogram. */
+#define PBIO_MOTOR_PROCESS_STATS_NUM_BINS (8)
+
+/**
+ * Upper limit of the first histogram bin in microseconds. The limit doubles
+ * for each next bin. The last bin counts everything else.
+ */
+#define PBIO_MOTOR_PROCESS_STATS_BIN_US (32)
+
+/**
+ * Timing statistics of the motor process.
+ */
+typedef struct _pbio_motor_process_stats_t {
+    /** Number of updates since the statistics were reset. */
+    uint32_t num_updates;
+    /** Number of updates that ran more than one full period late. */
+    uint32_t num_overruns;
+    /** Largest deviation from the nominal update period (us). */
+    uint32_t jitter_max;
+    /** Histogram of the deviation from the nominal update period. */
+    uint32_t jitter_histogram[PBIO_MOTOR_PROCESS_STATS_NUM_BINS];
+    /** Total execution time of each stage (us). 64 bits so it does not wrap. */
+    uint64_t stage_time_total[PBIO_MOTOR_PROCESS_NUM_STAGES];
+    /** Longest execution time of each stage (us). */
+    uint32_t stage_time_max[PBIO_MOTOR_PROCESS_NUM_STAGES];
+    /** Histogram of the execution time of each stage. */
+    uint32_t stage_histogram[PBIO_MOTOR_PROCESS_NUM_STAGES][PBIO_MOTOR_PROCESS_STATS_NUM_BINS];
+} pbio_motor_process_stats_t;
 
 #if PBIO_CONFIG_MOTOR_PROCESS
 
@@ -21,14 +70,47 @@
 #endif
 
 void pbio_motor_process_start(void);
+uint32_t pbio_motor_process_get_loop_time(void);
 
 #else
 
 static inline void pbio_motor_process_start(void) {
 }
 
+static inline uint32_t pbio_motor_process_get_loop_time(void) {
+    return PBIO_CONFIG_CONTROL_LOOP_TIME_MS;
+}
+
 #endif // PBIO_CONFIG_MOTOR_PROCESS
 
+#if PBIO_CONFIG_MOTOR_PROCESS && PBIO_CONFIG_CONTROL_LOOP_TIME_RUNTIME
+
+pbio_error_t pbio_motor_process_set_loop_time(uint32_t loop_time);
+
+#else
+
+static inline pbio_error_t pbio_motor_process_set_loop_time(uint32_t loop_time) {
+    return PBIO_ERROR_NOT_SUPPORTED;
+}
+
+#endif // PBIO_CONFIG_MOTOR_PROCESS && PBIO_CONFIG_CONTROL_LOOP_TIME_RUNTIME
+
+#if PBIO_CONFIG_MOTOR_PROCESS && PBIO_CONFIG_MOTOR_PROCESS_STATS
+
+const pbio_motor_process_stats_t *pbio_motor_process_get_stats(void);
+void pbio_motor_process_reset_stats(void);
+
+#else
+
+static inline const pbio_motor_process_stats_t *pbio_motor_process_get_stats(void) {
+    return NULL;
+}
+
+static inline void pbio_motor_process_reset_stats(void) {
+}
+
+#endif // PBIO_CONFIG_MOTOR_PROCESS && PBIO_CONFIG_MOTOR_PROCESS_STATS
+
 #endif // _PBIO_MOTOR_PROCESS_H_
 
 /** @} */
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2019-2023 The Pybricks Authors
+// Copyright (c) 2019-2024 The Pybricks Authors
 
 // SPDX-License-Identifier: BSD-3-Clause
 // Copyright (c) 2020-2023 LEGO System A/S
@@ -14,13 +14,27 @@
 #ifndef _PBIO_OBSERVER_H_
 #define _PBIO_OBSERVER_H_
 
+#include <stdbool.h>
 #include <stdint.h>
 
+#include <pbio/config.h>
 #include <pbio/control_settings.h>
 #include <pbio/dcmotor.h>
 #include <pbio/differentiator.h>
 #include <pbio/angle.h>
 
+// Values generated by pbio/doc/control/model.py
+#define PBIO_OBSERVER_MAX_NUM_SPEED (2500000)
+#define PBIO_OBSERVER_MAX_NUM_ACCELERATION (25000000)
+#define PBIO_OBSERVER_MAX_NUM_CURRENT (30000)
+#define PBIO_OBSERVER_MAX_NUM_VOLTAGE (12000)
+#define PBIO_OBSERVER_MAX_NUM_TORQUE (1000000)
+#define PBIO_OBSERVER_PRESCALE_SPEED (858)
+#define PBIO_OBSERVER_PRESCALE_ACCELERATION (85)
+#define PBIO_OBSERVER_PRESCALE_CURRENT (71582)
+#define PBIO_OBSERVER_PRESCALE_VOLTAGE (178956)
+#define PBIO_OBSERVER_PRESCALE_TORQUE (2147)
+
 /**
  * Device-type specific constants that describe the motor model.
  */
@@ -44,6 +58,46 @@ typedef struct _pbio_observer_model_t {
     int32_t torque_friction;
 } pbio_observer_model_t;
 
+#ifndef PBIO_CONFIG_OBSERVER_RECIPROCAL
+/**
+ * Evaluates the observer model with multiplications and shifts instead of
+ * divisions. This is faster on platforms without a hardware divider.
+ */
+#define PBIO_CONFIG_OBSERVER_RECIPROCAL (0)
+#endif
+
+/**
+ * Scale factor in Q-format, so that a value can be scaled as
+ * (value * multiplier) >> shift.
+ */
+typedef struct _pbio_observer_reciprocal_t {
+    /** Magnitude of the scale factor multiplied by 2^shift, rounded up. */
+    uint32_t multiplier;
+    /** Number of fractional bits of the multiplier. */
+    uint8_t shift;
+    /** Whether the scale factor is negative. */
+    bool negative;
+} pbio_observer_reciprocal_t;
+
+/**
+ * The model terms used by the observer update, as reciprocals of the
+ * corresponding fields in ::pbio_observer_model_t including the prescaler.
+ */
+typedef struct _pbio_observer_model_reciprocal_t {
+    pbio_observer_reciprocal_t d_angle_d_speed;
+    pbio_observer_reciprocal_t d_speed_d_speed;
+    pbio_observer_reciprocal_t d_current_d_speed;
+    pbio_observer_reciprocal_t d_angle_d_current;
+    pbio_observer_reciprocal_t d_speed_d_current;
+    pbio_observer_reciprocal_t d_current_d_current;
+    pbio_observer_reciprocal_t d_angle_d_voltage;
+    pbio_observer_reciprocal_t d_speed_d_voltage;
+    pbio_observer_reciprocal_t d_current_d_voltage;
+    pbio_observer_reciprocal_t d_angle_d_torque;
+    pbio_observer_reciprocal_t d_speed_d_torque;
+    pbio_observer_reciprocal_t d_current_d_torque;
+} pbio_observer_model_reciprocal_t;
+
 /**
  * Configurable observer settings.
  */
@@ -123,6 +177,12 @@ typedef struct _pbio_observer_t {
      * Model parameters used by this model.
      */
     const pbio_observer_model_t *model;
+    #if PBIO_CONFIG_OBSERVER_RECIPROCAL
+    /**
+     * Model terms for the update step, generated from the model.
+     */
+    pbio_observer_model_reciprocal_t reciprocal;
+    #endif
     /**
      * Control settings, which includes stall settings.
      */
@@ -132,6 +192,7 @@ typedef struct _pbio_observer_t {
 // Observer state functions:
 
 void pbio_observer_reset(pbio_observer_t *obs, const pbio_angle_t *angle);
+void pbio_observer_set_model(pbio_observer_t *obs, const pbio_observer_model_t *model, uint32_t loop_time);
 void pbio_observer_get_estimated_state(const pbio_observer_t *obs, int32_t *speed_num, pbio_angle_t *angle_est, int32_t *speed_est);
 void pbio_observer_update(pbio_observer_t *obs, uint32_t time, const pbio_angle_t *angle, pbio_dcmotor_actuation_t actuation, int32_t voltage);
 bool pbio_observer_is_stalled(const pbio_observer_t *obs, uint32_t time, uint32_t *stall_duration);
@@ -139,6 +200,32 @@ int32_t pbio_observer_get_feedback_voltage(const pbio_observer_t *obs, const pbi
 
 // Model conversion functions:
 
+void pbio_observer_reciprocal_init(pbio_observer_reciprocal_t *reciprocal, int32_t numerator, int32_t denominator);
+void pbio_observer_model_get_reciprocal(const pbio_observer_model_t *model, pbio_observer_model_reciprocal_t *reciprocal);
+
+/**
+ * Scales a value by a reciprocal without dividing.
+ *
+ * This equals value * numerator / denominator, rounded toward zero, for
+ * values up to the PBIO_OBSERVER_MAX_NUM_* limit that goes with the PBIO_OBSERVER_PRESCALE_* numerator.
+ *
+ * @param [in]  reciprocal  The scale factor.
+ * @param [in]  value       The value to scale.
+ * @return                  The scaled value.
+ */
+static inline int32_t pbio_observer_reciprocal_scale(const pbio_observer_reciprocal_t *reciprocal, int32_t value) {
+    int64_t product = (int64_t)value * reciprocal->multiplier;
+    if (reciprocal->negative) {
+        product = -product;
+    }
+    // Shifting rounds down, so round negative values up to get the same
+    // result as dividing.
+    if (product < 0) {
+        product += (INT64_C(1) << reciprocal->shift) - 1;
+    }
+    return (int32_t)(product >> reciprocal->shift);
+}
+
 int32_t pbio_observer_get_max_torque(void);
 int32_t pbio_observer_get_feedforward_torque(const pbio_observer_model_t *model, int32_t rate_ref, int32_t acceleration_ref);
 int32_t pbio_observer_torque_to_voltage(const pbio_observer_model_t *model, int32_t desired_torque);
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2021-2023 The Pybricks Authors
+// Copyright (c) 2021-2024 The Pybricks Authors
 
 /**
  * @addtogroup ProtocolPybricks pbio/protocol: Pybricks Communication Profile
@@ -24,7 +24,7 @@
 #define PBIO_PROTOCOL_VERSION_MAJOR 1
 
 /** The minor version number for the protocol. */
-#define PBIO_PROTOCOL_VERSION_MINOR 3
+#define PBIO_PROTOCOL_VERSION_MINOR 5
 
 /** The patch version number for the protocol. */
 #define PBIO_PROTOCOL_VERSION_PATCH 0
@@ -122,6 +122,35 @@ typedef enum {
      * @since Pybricks Profile v1.3.0
      */
     PBIO_PYBRICKS_COMMAND_WRITE_STDIN = 6,
+
+    /**
+     * Requests to reuse modules of the user program that is currently loaded
+     * as part of a new user program, so that they do not have to be sent
+     * again.
+     *
+     * Each module in the user program is its size (32-bit little-endian
+     * unsigned integer), followed by its zero-terminated name and its .mpy
+     * data. Modules are identified by the CRC-32 of all of this.
+     *
+     * This must be sent before writing any other data of the new program or
+     * its size. All modules to reuse must be given in one command, in the
+     * order in which they appear in both programs. The remaining modules can
+     * then be written with ::PBIO_PYBRICKS_COMMAND_WRITE_USER_RAM as usual.
+     *
+     * Parameters:
+     * - modules: Up to 63 pairs of a module checksum and the offset of that
+     *   module in the new program (both 32-bit little-endian unsigned
+     *   integers).
+     *
+     * Errors:
+     * - ::PBIO_PYBRICKS_ERROR_BUSY if the user program is running.
+     * - ::PBIO_PYBRICKS_ERROR_VALUE_NOT_ALLOWED if any of the modules is not
+     *   found or the modules are not in order. Nothing is changed in that
+     *   case, so the whole program should be written instead.
+     *
+     * @since Pybricks Profile v1.5.0
+     */
+    PBIO_PYBRICKS_COMMAND_REUSE_USER_PROGRAM_MODULES = 7,
 } pbio_pybricks_command_t;
 
 /**
@@ -179,6 +208,18 @@ typedef enum {
      * @since Pybricks Profile v1.3.0
      */
     PBIO_PYBRICKS_EVENT_WRITE_STDOUT = 1,
+
+    /**
+     * Data from a streaming data log event.
+     *
+     * The first byte of the payload is the number of columns in one row of the
+     * log. It is followed by a variable number of 32-bit little-endian signed
+     * integers. Rows may be split across events, so the values of consecutive
+     * events must be concatenated and then regrouped into rows.
+     *
+     * @since Pybricks Profile v1.4.0
+     */
+    PBIO_PYBRICKS_EVENT_WRITE_LOG = 2,
 } pbio_pybricks_event_t;
 
 /**
@@ -283,6 +324,24 @@ typedef enum {
      * @since Pybricks Profile v1.3.0.
      */
     PBIO_PYBRICKS_FEATURE_USER_PROG_FORMAT_MULTI_MPY_V6_1_NATIVE = 1 << 2,
+    /**
+     * Hub supports ::PBIO_PYBRICKS_COMMAND_REUSE_USER_PROGRAM_MODULES.
+     *
+     * @since Pybricks Profile v1.5.0.
+     */
+    PBIO_PYBRICKS_FEATURE_USER_PROG_REUSE_MODULES = 1 << 3,
+    /**
+     * Hub supports compressed modules in user programs. The data of such a
+     * module starts with 'z' instead of the 'M' of an .mpy file, followed by
+     * the compressed .mpy file. See tools/mpy_compress.py for the format.
+     *
+     * This trades heap for storage. Uncompressed modules are used in place,
+     * but the code of compressed modules is inflated into the heap when they
+     * are imported.
+     *
+     * @since Pybricks Profile v1.5.0.
+     */
+    PBIO_PYBRICKS_FEATURE_USER_PROG_FORMAT_COMPRESSED = 1 << 4,
 } pbio_pybricks_feature_flags_t;
 
 void pbio_pybricks_hub_capabilities(uint8_t *buf,
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2023 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 // SPDX-License-Identifier: BSD-3-Clause
 // Copyright (c) 2020-2023 LEGO System A/S
@@ -85,6 +85,19 @@ typedef struct _pbio_servo_t {
      * occur.
      */
     bool run_update_loop;
+    /**
+     * Reduced settings of this type of motor, used to select a model when
+     * the loop time changes.
+     */
+    const struct _pbio_servo_settings_reduced_t *settings_reduced;
+    /**
+     * The servo is updated once every this many control loop iterations.
+     */
+    uint8_t decimation;
+    /**
+     * Number of control loop iterations since the last servo update.
+     */
+    uint8_t decimation_count;
 } pbio_servo_t;
 
 /**
@@ -112,6 +125,13 @@ typedef struct _pbio_servo_settings_reduced_t {
      * Physical model parameter for this type of motor
      */
     const pbio_observer_model_t *model;
+    #if PBIO_CONFIG_CONTROL_LOOP_TIME_RUNTIME
+    /**
+     * Models for the non-default loop times, or NULL if this motor can only
+     * run at the default loop time.
+     */
+    const pbio_observer_model_t *models_runtime;
+    #endif
     /**
      * The rated maximum speed (deg/s), approximately equivalent to "100%" speed in other apps.
      */
@@ -143,6 +163,8 @@ pbio_error_t pbio_servo_setup(pbio_servo_t *srv, pbdrv_legodev_type_id_t type, p
 /** @cond INTERNAL */
 pbio_error_t pbio_servo_actuate(pbio_servo_t *srv, pbio_dcmotor_actuation_t actuation_type, int32_t payload);
 const pbio_servo_settings_reduced_t *pbio_servo_get_reduced_settings(pbdrv_legodev_type_id_t id);
+pbio_error_t pbio_servo_get_model(const pbio_servo_settings_reduced_t *settings, uint32_t loop_time, const pbio_observer_model_t **model);
+pbio_error_t pbio_servo_set_loop_time_all(uint32_t loop_time);
 void pbio_servo_update_all(void);
 /** @endcond */
 
@@ -154,6 +176,14 @@ pbio_error_t pbio_servo_get_speed_user(pbio_servo_t *srv, uint32_t window, int32
 bool pbio_servo_update_loop_is_running(pbio_servo_t *srv);
 pbio_error_t pbio_servo_is_stalled(pbio_servo_t *srv, bool *stalled, uint32_t *stall_duration);
 pbio_error_t pbio_servo_get_load(pbio_servo_t *srv, int32_t *load);
+uint32_t pbio_servo_get_loop_time(pbio_servo_t *srv);
+/**@}*/
+
+/** @name Configuration Functions */
+/**@{*/
+pbio_error_t pbio_servo_set_decimation(pbio_servo_t *srv, uint8_t decimation);
+pbio_error_t pbio_servo_reset_decimation(pbio_servo_t *srv);
+pbio_error_t pbio_servo_reset_decimation_all(void);
 /**@}*/
 
 /** @name Operation Functions */
@@ -165,6 +195,9 @@ pbio_error_t pbio_servo_run_time(pbio_servo_t *srv, int32_t speed, uint32_t dura
 pbio_error_t pbio_servo_run_until_stalled(pbio_servo_t *srv, int32_t speed, int32_t torque_limit, pbio_control_on_completion_t on_completion);
 pbio_error_t pbio_servo_run_angle(pbio_servo_t *srv, int32_t speed, int32_t angle, pbio_control_on_completion_t on_completion);
 pbio_error_t pbio_servo_run_target(pbio_servo_t *srv, int32_t speed, int32_t target, pbio_control_on_completion_t on_completion);
+#if PBIO_CONFIG_CONTROL_QUEUE
+pbio_error_t pbio_servo_queue_target(pbio_servo_t *srv, int32_t speed, int32_t target, pbio_control_on_completion_t on_completion);
+#endif
 pbio_error_t pbio_servo_track_target(pbio_servo_t *srv, int32_t target);
 /**@}*/
 
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2023 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 // SPDX-License-Identifier: BSD-3-Clause
 // Copyright (c) 2020-2023 LEGO System A/S
@@ -40,6 +40,7 @@ pbio_error_t pbio_tacho_setup(pbio_tacho_t *tacho, pbio_direction_t direction, b
 /** @name Status Functions */
 /**@{*/
 pbio_error_t pbio_tacho_get_angle(pbio_tacho_t *tacho, pbio_angle_t *angle);
+uint32_t pbio_tacho_get_reset_count(pbio_tacho_t *tacho);
 /**@}*/
 
 /** @name Operation Functions */
@@ -61,6 +62,10 @@ static inline pbio_error_t pbio_tacho_get_angle(pbio_tacho_t *tacho, pbio_angle_
     return PBIO_ERROR_NOT_SUPPORTED;
 }
 
+static inline uint32_t pbio_tacho_get_reset_count(pbio_tacho_t *tacho) {
+    return 0;
+}
+
 static inline pbio_error_t pbio_tacho_reset_angle(pbio_tacho_t *tacho, pbio_angle_t *reset_angle, bool reset_to_abs) {
     return PBIO_ERROR_NOT_SUPPORTED;
 }
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2023 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 // SPDX-License-Identifier: BSD-3-Clause
 // Copyright (c) 2020-2023 LEGO System A/S
@@ -14,11 +14,21 @@
 #ifndef _PBIO_TRAJECTORY_H_
 #define _PBIO_TRAJECTORY_H_
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include <pbio/angle.h>
+#include <pbio/config.h>
 #include <pbio/error.h>
 
+// Whether trajectories are evaluated incrementally when the reference is
+// requested at a fixed time step, as is done by the control loop. This avoids
+// multiplications and divisions on every control loop update, but it adds
+// about 108 bytes of state to each trajectory.
+#ifndef PBIO_CONFIG_TRAJECTORY_INCREMENTAL
+#define PBIO_CONFIG_TRAJECTORY_INCREMENTAL (0)
+#endif
+
 // Trajectories use sub-millisecond steps for increased resolution.
 #define PBIO_TRAJECTORY_TICKS_PER_MS (10)
 
@@ -42,6 +52,8 @@ typedef struct _pbio_trajectory_command_t {
     int32_t speed_max;             /**<  Max target rate target */
     int32_t acceleration;          /**<  Encoder acceleration magnitude during in-phase */
     int32_t deceleration;          /**<  Encoder acceleration magnitude during out-phase */
+    int32_t speed_end;             /**<  Encoder rate magnitude at end of maneuver if it does not continue running. Only used for position commands. */
+    int32_t jerk;                  /**<  Encoder jerk magnitude used to smooth the profile, or 0 for a trapezoidal profile */
     bool continue_running;         /**<  Whether it movement continues after t3 (true) or not (false) */
 } pbio_trajectory_command_t;
 
@@ -55,6 +67,45 @@ typedef struct _pbio_trajectory_reference_t {
     int32_t acceleration;   /**<  Reference acceleration */
 } pbio_trajectory_reference_t;
 
+/**
+ * Whole part and nonnegative remainder of a fraction with a fixed denominator.
+ */
+typedef struct _pbio_trajectory_fraction_t {
+    int32_t quotient;                    /**<  Whole part */
+    uint32_t remainder;                  /**<  Remainder */
+} pbio_trajectory_fraction_t;
+
+/**
+ * State for evaluating a trajectory one fixed time step at a time.
+ *
+ * Within a phase, the full evaluation is made of products of the time since
+ * the start of the phase, each rounded toward zero. These products have the
+ * same sign throughout the phase, so their magnitudes are stored as fractions
+ * along with their change per time step. This way, each step is done with
+ * additions only, and gives the same result as the full evaluation. Any other
+ * time is evaluated in full, after which stepping resumes from there.
+ */
+typedef struct _pbio_trajectory_increment_t {
+    bool valid;                          /**<  Whether this state matches the trajectory */
+    bool final;                          /**<  Whether this is the phase after the maneuver completes */
+    int32_t time;                        /**<  Time of the last evaluation since start of maneuver */
+    int32_t time_end;                    /**<  Time at which the current phase ends */
+    int32_t dt;                          /**<  Time step of the increments, or 0 if not yet known */
+    int32_t th;                          /**<  Encoder count at the start of the phase */
+    int32_t w;                           /**<  Encoder rate at the start of the phase */
+    int32_t a;                           /**<  Encoder acceleration in the current phase */
+    pbio_trajectory_fraction_t wt;       /**<  Speed times time, over 100 */
+    pbio_trajectory_fraction_t at;       /**<  Acceleration times time, over 1000 */
+    pbio_trajectory_fraction_t vt;       /**<  Whole part of at times time, over 200 */
+    pbio_trajectory_fraction_t vdt;      /**<  Whole part of at times time step, over 200 */
+    pbio_trajectory_fraction_t ct;       /**<  Whole part of at step times time, over 200 */
+    pbio_trajectory_fraction_t t;        /**<  Time, over 200 */
+    pbio_trajectory_fraction_t wt_step;  /**<  Change of wt per step */
+    pbio_trajectory_fraction_t at_step;  /**<  Change of at per step */
+    pbio_trajectory_fraction_t ct_step;  /**<  Change of ct per step */
+    pbio_trajectory_fraction_t t_step;   /**<  Change of t per step */
+} pbio_trajectory_increment_t;
+
 /**
  * Complete set of motor trajectory parameters for an ideal maneuver without
  * disturbances. These values have custom units to keep them within safe
@@ -75,16 +126,23 @@ typedef struct _pbio_trajectory_t {
     int32_t w3;                          /**<  Encoder rate target after the maneuver ends */
     int32_t a0;                          /**<  Encoder acceleration during in-phase */
     int32_t a2;                          /**<  Encoder acceleration during out-phase */
+    int32_t tj;                          /**<  Duration of the smoothing window, or 0 if not smoothed */
+    int32_t thj;                         /**<  Encoder count offset of the smoothed trajectory */
+    #if PBIO_CONFIG_TRAJECTORY_INCREMENTAL
+    pbio_trajectory_increment_t increment; /**<  State of incremental evaluation */
+    #endif
 } pbio_trajectory_t;
 
 // Make or modify trajectories:
 
 pbio_error_t pbio_trajectory_validate_speed_limit(int32_t ctl_steps_per_app_step, int32_t speed);
 pbio_error_t pbio_trajectory_validate_acceleration_limit(int32_t ctl_steps_per_app_step, int32_t acceleration);
+pbio_error_t pbio_trajectory_validate_jerk_limit(int32_t ctl_steps_per_app_step, int32_t jerk);
 pbio_error_t pbio_trajectory_new_angle_command(pbio_trajectory_t *trj, const pbio_trajectory_command_t *command);
 pbio_error_t pbio_trajectory_new_time_command(pbio_trajectory_t *trj, const pbio_trajectory_command_t *command);
 void pbio_trajectory_make_constant(pbio_trajectory_t *trj, const pbio_trajectory_command_t *command);
 void pbio_trajectory_stretch(pbio_trajectory_t *trj, const pbio_trajectory_t *leader);
+int32_t pbio_trajectory_get_max_junction_speed(int32_t speed, int32_t angle, int32_t deceleration);
 
 // Reference getter functions:
 
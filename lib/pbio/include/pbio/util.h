@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2019-2022 The Pybricks Authors
+// Copyright (c) 2019-2024 The Pybricks Authors
 
 /**
  * @addtogroup Utility pbio/util: Utility Functions
@@ -129,6 +129,8 @@ void pbio_uuid128_reverse_copy(uint8_t *dst, const uint8_t *src);
 
 bool pbio_oneshot(bool value, bool *state);
 
+uint32_t pbio_crc32(const uint8_t *data, uint32_t size);
+
 #endif // _PBIO_UTIL_H_
 
 /** @} */
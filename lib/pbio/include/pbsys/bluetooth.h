@@ -13,6 +13,7 @@
 #include <stdint.h>
 
 #include <pbio/error.h>
+#include <pbio/logger.h>
 #include <pbsys/config.h>
 
 /**
@@ -32,6 +33,8 @@ uint32_t pbsys_bluetooth_rx_get_available(void);
 pbio_error_t pbsys_bluetooth_rx(uint8_t *data, uint32_t *size);
 pbio_error_t pbsys_bluetooth_tx(const uint8_t *data, uint32_t *size);
 bool pbsys_bluetooth_tx_is_idle(void);
+pbio_error_t pbsys_bluetooth_log_stream_start(pbio_log_t *log);
+void pbsys_bluetooth_log_stream_stop(void);
 
 #else // PBSYS_CONFIG_BLUETOOTH
 
@@ -49,6 +52,11 @@ static inline pbio_error_t pbsys_bluetooth_tx(const uint8_t *data, uint32_t *siz
 static inline bool pbsys_bluetooth_tx_is_idle(void) {
     return false;
 }
+static inline pbio_error_t pbsys_bluetooth_log_stream_start(pbio_log_t *log) {
+    return PBIO_ERROR_NOT_SUPPORTED;
+}
+static inline void pbsys_bluetooth_log_stream_stop(void) {
+}
 
 #endif // PBSYS_CONFIG_BLUETOOTH
 
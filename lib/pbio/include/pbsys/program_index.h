@@ -0,0 +1,27 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2024 The Pybricks Authors
+
+/**
+ * @addtogroup SysProgramIndex System: Index of program modules.
+ *
+ * This module finds the modules of a downloaded program by name. Each module
+ * in the program data has a 32-bit little-endian size, a zero-terminated
+ * name, and then the module data.
+ *
+ * @{
+ */
+
+#ifndef _PBSYS_PROGRAM_INDEX_H_
+#define _PBSYS_PROGRAM_INDEX_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <pbsys/main.h>
+
+void *pbsys_program_index_init(pbsys_main_program_t *program);
+uint8_t *pbsys_program_index_find(const char *name, size_t len);
+
+#endif // _PBSYS_PROGRAM_INDEX_H_
+
+/** @} */
@@ -14,6 +14,7 @@
 
 #include <stdint.h>
 
+#include <pbdrv/legodev.h>
 #include <pbsys/config.h>
 #include <pbsys/storage_settings.h>
 
@@ -58,6 +59,13 @@ typedef struct _pbsys_storage_data_map_t {
      * version changes due to an update.
      */
     pbsys_storage_settings_t settings;
+    #if PBDRV_CONFIG_LEGODEV_INFO_CACHE
+    /**
+     * Information of previously connected devices. This is reset along with
+     * the settings when the firmware version changes.
+     */
+    pbdrv_legodev_info_cache_t legodev_info_cache;
+    #endif
     /**
      * Size of the application program (size of code only).
      */
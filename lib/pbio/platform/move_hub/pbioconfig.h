@@ -1,15 +1,16 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2019-2023 The Pybricks Authors
+// Copyright (c) 2019-2024 The Pybricks Authors
 
 #define PBIO_CONFIG_BATTERY                 (1)
 #define PBIO_CONFIG_DCMOTOR                 (1)
 #define PBIO_CONFIG_DCMOTOR_NUM_DEV         (4)
-#define PBIO_CONFIG_DIFFERENTIATOR_BUFFER_SIZE (21) // Must be > PBIO_CONFIG_DIFFERENTIATOR_WINDOW_SIZE
+#define PBIO_CONFIG_DIFFERENTIATOR_BUFFER_SIZE (21) // Must be > PBIO_CONFIG_DIFFERENTIATOR_WINDOW_MS / PBIO_CONFIG_CONTROL_LOOP_TIME_MS
 #define PBIO_CONFIG_DRIVEBASE_SPIKE         (0)
 #define PBIO_CONFIG_IMU                     (0)
 #define PBIO_CONFIG_LIGHT                   (1)
 #define PBIO_CONFIG_LOGGER                  (0)
 #define PBIO_CONFIG_MOTOR_PROCESS           (1)
+#define PBIO_CONFIG_CONTROL_QUEUE           (0)
 #define PBIO_CONFIG_SERVO                   (1)
 #define PBIO_CONFIG_SERVO_NUM_DEV           (4)
 #define PBIO_CONFIG_SERVO_EV3_NXT           (0)
@@ -17,6 +18,8 @@
 #define PBIO_CONFIG_SERVO_PUP_MOVE_HUB      (1)
 #define PBIO_CONFIG_TACHO                   (1)
 #define PBIO_CONFIG_CONTROL_MINIMAL         (1)
+#define PBIO_CONFIG_TRAJECTORY_INCREMENTAL  (0)
+#define PBIO_CONFIG_OBSERVER_RECIPROCAL     (1)
 
 #define PBIO_CONFIG_UARTDEV                 (0)
 #define PBIO_CONFIG_UARTDEV_NUM_DEV         (2)
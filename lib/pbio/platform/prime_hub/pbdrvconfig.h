@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2022 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 #define PBDRV_CONFIG_ADC                            (1)
 #define PBDRV_CONFIG_ADC_STM32_HAL                  (1)
@@ -90,6 +90,8 @@
 #define PBDRV_CONFIG_LEGODEV_PUP_NUM_EXT_DEV        (6 - PBDRV_CONFIG_IOPORT_DEBUG_UART)
 #define PBDRV_CONFIG_LEGODEV_PUP_UART               (1)
 #define PBDRV_CONFIG_LEGODEV_MODE_INFO              (1)
+#define PBDRV_CONFIG_LEGODEV_INFO_CACHE             (1)
+#define PBDRV_CONFIG_LEGODEV_INFO_CACHE_NUM_ENTRIES (8)
 #define PBDRV_CONFIG_LEGODEV_PUP_UART_NUM_DEV       (PBDRV_CONFIG_LEGODEV_PUP_NUM_EXT_DEV)
 
 #define PBDRV_CONFIG_MOTOR_DRIVER                   (1)
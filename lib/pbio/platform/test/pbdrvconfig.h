@@ -1,9 +1,13 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2019-2022 The Pybricks Authors
+// Copyright (c) 2019-2024 The Pybricks Authors
 
 #define PBDRV_CONFIG_BATTERY                        (1)
 #define PBDRV_CONFIG_BATTERY_TEST                   (1)
 
+#define PBDRV_CONFIG_BLOCK_DEVICE                   (1)
+#define PBDRV_CONFIG_BLOCK_DEVICE_TEST              (1)
+#define PBDRV_CONFIG_BLOCK_DEVICE_TEST_SIZE         (8 * 1024)
+
 #define PBDRV_CONFIG_BUTTON                         (1)
 #define PBDRV_CONFIG_BUTTON_TEST                    (1)
 
@@ -25,6 +29,8 @@
 #define PBDRV_CONFIG_LEGODEV_TEST_NUM_DEV           (6)
 #define PBDRV_CONFIG_LEGODEV_PUP_UART               (1)
 #define PBDRV_CONFIG_LEGODEV_MODE_INFO              (1)
+#define PBDRV_CONFIG_LEGODEV_INFO_CACHE             (1)
+#define PBDRV_CONFIG_LEGODEV_INFO_CACHE_NUM_ENTRIES (2)
 #define PBDRV_CONFIG_LEGODEV_PUP_UART_NUM_DEV       (1)
 
 #define PBDRV_CONFIG_MOTOR_DRIVER                   (1)
@@ -3,6 +3,7 @@
 #define PBIO_CONFIG_DCMOTOR                 (1)
 #define PBIO_CONFIG_DCMOTOR_NUM_DEV         (6)
 #define PBIO_CONFIG_DRIVEBASE_SPIKE         (0)
+#define PBIO_CONFIG_DRIVEBASE_ODOMETRY      (1)
 #define PBIO_CONFIG_IMU                     (0)
 
 #define PBIO_CONFIG_LIGHT                   (1)
@@ -10,7 +11,12 @@
 #define PBIO_CONFIG_LIGHT_MATRIX            (1)
 
 #define PBIO_CONFIG_MOTOR_PROCESS           (1)
+#define PBIO_CONFIG_MOTOR_PROCESS_STATS     (1)
+#define PBIO_CONFIG_CONTROL_LOOP_TIME_RUNTIME (1)
+#define PBIO_CONFIG_TRAJECTORY_INCREMENTAL  (1)
+#define PBIO_CONFIG_OBSERVER_RECIPROCAL     (1)
 #define PBIO_CONFIG_MOTOR_PROCESS_AUTO_START (0)
+#define PBIO_CONFIG_CONTROL_QUEUE           (1)
 #define PBIO_CONFIG_SERVO                   (1)
 #define PBIO_CONFIG_SERVO_NUM_DEV           (6)
 #define PBIO_CONFIG_SERVO_EV3_NXT           (1)
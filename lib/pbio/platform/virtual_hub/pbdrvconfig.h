@@ -10,6 +10,7 @@
 #define PBDRV_CONFIG_CLOCK                                  (1)
 #define PBDRV_CONFIG_CLOCK_LINUX                            (1)
 #define PBDRV_CONFIG_CLOCK_LINUX_SIGNAL                     (1)
+#define PBDRV_CONFIG_CLOCK_LINUX_LOCKSTEP                   (1)
 
 #define PBDRV_CONFIG_LEGODEV                                (1)
 #define PBDRV_CONFIG_LEGODEV_MODE_INFO                      (1)
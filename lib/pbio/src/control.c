@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2023 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 // SPDX-License-Identifier: BSD-3-Clause
 // Copyright (c) 2020-2023 LEGO System A/S
@@ -223,6 +223,22 @@ static int32_t pbio_control_get_pid_kp(const pbio_control_settings_t *settings,
     return pbio_int_math_max(kp_pwa, kp_target);
 }
 
+#if PBIO_CONFIG_CONTROL_QUEUE
+static void pbio_control_queue_update(pbio_control_t *ctl, uint32_t time_now, const pbio_control_state_t *state);
+
+/**
+ * Discards all queued position control segments.
+ *
+ * @param [in]  ctl         The control instance.
+ */
+static void pbio_control_queue_clear(pbio_control_t *ctl) {
+    ctl->queue_size = 0;
+}
+#else
+static inline void pbio_control_queue_clear(pbio_control_t *ctl) {
+}
+#endif // PBIO_CONFIG_CONTROL_QUEUE
+
 /**
  * Updates the PID controller state to calculate the next actuation step.
  *
@@ -244,6 +260,13 @@ void pbio_control_update(
     int32_t *control,
     bool *external_pause) {
 
+    #if PBIO_CONFIG_CONTROL_QUEUE
+    // Move on to the next queued segment, if any.
+    if (ctl->queue_size > 0) {
+        pbio_control_queue_update(ctl, time_now, state);
+    }
+    #endif
+
     // Get reference signals at the reference time point in the trajectory.
     // This compensates for any time we may have spent pausing when the motor was stalled.
     pbio_trajectory_get_reference(&ctl->trajectory, pbio_control_get_ref_time(ctl, time_now), ref);
@@ -291,7 +314,7 @@ void pbio_control_update(
     // We want to stop building up further errors if we are at the proportional torque limit. So, we pause the trajectory
     // if we get at this limit. We wait a little longer though, to make sure it does not fall back to below the limit
     // within one sample, which we can predict using the current rate times the loop time, with a factor two tolerance.
-    int32_t windup_margin = pbio_control_settings_mul_by_loop_time(pbio_int_math_abs(state->speed)) * 2;
+    int32_t windup_margin = pbio_control_settings_mul_by_loop_time(&ctl->settings, pbio_int_math_abs(state->speed)) * 2;
     int32_t max_windup_torque = ctl->settings.actuation_max_temporary + pbio_control_settings_mul_by_gain(windup_margin, ctl->settings.pid_kp);
 
     // Speed value that is rounded to zero if small. This is used for a
@@ -337,12 +360,18 @@ void pbio_control_update(
         pbio_position_integrator_stalled(&ctl->position_integrator, time_now, state->speed, ref->speed) :
         pbio_speed_integrator_stalled(&ctl->speed_integrator, time_now, state->speed, ref->speed));
 
+    // Queued segments are discarded on stall, since they were planned from
+    // positions that can no longer be reached as intended.
+    if (pbio_control_status_test(ctl, PBIO_CONTROL_STATUS_STALLED)) {
+        pbio_control_queue_clear(ctl);
+    }
+
     // Check if we are on target, and set the status.
     pbio_control_status_set(ctl, PBIO_CONTROL_STATUS_COMPLETE,
         pbio_control_check_completion(ctl, ref->time, state, &ref_end));
 
     // Save (low-pass filtered) load for diagnostics
-    ctl->pid_average = (ctl->pid_average * (100 - PBIO_CONFIG_CONTROL_LOOP_TIME_MS) + torque * PBIO_CONFIG_CONTROL_LOOP_TIME_MS) / 100;
+    ctl->pid_average = (ctl->pid_average * (100 - (int32_t)ctl->settings.loop_time) + torque * (int32_t)ctl->settings.loop_time) / 100;
 
     // Decide actuation based on control status.
     if (// Not on target yet, so keep actuating.
@@ -422,6 +451,7 @@ void pbio_control_update(
  */
 void pbio_control_stop(pbio_control_t *ctl) {
     ctl->type = PBIO_CONTROL_TYPE_NONE;
+    pbio_control_queue_clear(ctl);
     pbio_control_status_set(ctl, PBIO_CONTROL_STATUS_COMPLETE, true);
     pbio_control_status_set(ctl, PBIO_CONTROL_STATUS_STALLED, false);
     ctl->pid_average = 0;
@@ -494,7 +524,34 @@ void pbio_control_reset(pbio_control_t *ctl) {
     // subsequent maneuvers, so nothing else needs to be reset explicitly.
 }
 
-static pbio_error_t _pbio_control_start_position_control(pbio_control_t *ctl, uint32_t time_now, const pbio_control_state_t *state, const pbio_angle_t *target, int32_t speed, pbio_control_on_completion_t on_completion, bool allow_trajectory_shift) {
+// Largest deviation from the ongoing reference for which a shifted smoothed
+// trajectory is still used, in control units.
+#define PBIO_CONTROL_SHIFT_POSITION_TOLERANCE (10)
+#define PBIO_CONTROL_SHIFT_SPEED_TOLERANCE (1000)
+
+/**
+ * Checks whether a trajectory that was shifted to start at the last vertex of
+ * the ongoing trajectory passes through the current reference.
+ *
+ * This is always the case for trapezoidal trajectories. A smoothed trajectory
+ * has only one vertex at its start, so the shifted trajectory matches only if
+ * the command is practically the same as the one that started it.
+ *
+ * @param [in]  ctl         The control instance with the shifted trajectory.
+ * @param [in]  ref         The reference of the ongoing trajectory.
+ * @return                  True if the shifted trajectory passes through the reference.
+ */
+static bool pbio_control_trajectory_shift_is_tangent(pbio_control_t *ctl, const pbio_trajectory_reference_t *ref) {
+    if (ctl->trajectory.tj == 0) {
+        return true;
+    }
+    pbio_trajectory_reference_t ref_shifted;
+    pbio_trajectory_get_reference(&ctl->trajectory, ref->time, &ref_shifted);
+    return pbio_int_math_abs(pbio_angle_diff_mdeg(&ref_shifted.position, &ref->position)) <= PBIO_CONTROL_SHIFT_POSITION_TOLERANCE &&
+           pbio_int_math_abs(ref_shifted.speed - ref->speed) <= PBIO_CONTROL_SHIFT_SPEED_TOLERANCE;
+}
+
+static pbio_error_t _pbio_control_start_position_control(pbio_control_t *ctl, uint32_t time_now, const pbio_control_state_t *state, const pbio_angle_t *target, int32_t speed, pbio_control_on_completion_t on_completion, int32_t speed_end, bool allow_trajectory_shift) {
 
     pbio_error_t err;
 
@@ -505,10 +562,11 @@ static pbio_error_t _pbio_control_start_position_control(pbio_control_t *ctl, ui
         .speed_max = ctl->settings.speed_max,
         .acceleration = ctl->settings.acceleration,
         .deceleration = ctl->settings.deceleration,
+        .jerk = ctl->settings.jerk,
+        .speed_end = speed_end,
         .continue_running = on_completion == PBIO_CONTROL_ON_COMPLETION_CONTINUE,
     };
 
-
     // Given the control status, fill in remaining commands and get trajectory.
     if (!pbio_control_is_active(ctl)) {
         // If no control is ongoing, we just start from the measured state.
@@ -561,7 +619,11 @@ static pbio_error_t _pbio_control_start_position_control(pbio_control_t *ctl, ui
         // better than just branching off. Instead, we can adjust the command
         // so it starts from the same point as the previous trajectory. This
         // avoids rounding errors when restarting commands in a tight loop.
-        if (ctl->trajectory.a0 == ref.acceleration && allow_trajectory_shift) {
+        // Smoothed trajectories can only be shifted to their start, so try
+        // that and keep the branched trajectory if it does not match.
+        if ((ctl->trajectory.a0 == ref.acceleration || ctl->trajectory.tj != 0) && allow_trajectory_shift) {
+
+            pbio_trajectory_t trajectory_branched = ctl->trajectory;
 
             // Update command with shifted starting point, equal to ongoing
             // maneuver.
@@ -571,9 +633,12 @@ static pbio_error_t _pbio_control_start_position_control(pbio_control_t *ctl, ui
 
             // Recalculate the trajectory from the shifted starting point.
             err = pbio_trajectory_new_angle_command(&ctl->trajectory, &command);
-            if (err != PBIO_SUCCESS) {
+            if (err != PBIO_SUCCESS && trajectory_branched.tj == 0) {
                 return err;
             }
+            if (err != PBIO_SUCCESS || !pbio_control_trajectory_shift_is_tangent(ctl, &ref)) {
+                ctl->trajectory = trajectory_branched;
+            }
         }
     }
 
@@ -602,8 +667,11 @@ pbio_error_t pbio_control_start_position_control(pbio_control_t *ctl, uint32_t t
     pbio_angle_t target;
     pbio_control_settings_app_to_ctl_long(&ctl->settings, position, &target);
 
+    // A new command replaces any queued segments.
+    pbio_control_queue_clear(ctl);
+
     // Start position control in control units.
-    return _pbio_control_start_position_control(ctl, time_now, state, &target, pbio_control_settings_app_to_ctl(&ctl->settings, speed), on_completion, true);
+    return _pbio_control_start_position_control(ctl, time_now, state, &target, pbio_control_settings_app_to_ctl(&ctl->settings, speed), on_completion, 0, true);
 }
 
 /**
@@ -658,40 +726,236 @@ pbio_error_t pbio_control_start_position_control_relative(pbio_control_t *ctl, u
         }
     }
 
-    return _pbio_control_start_position_control(ctl, time_now, state, &target, pbio_control_settings_app_to_ctl(&ctl->settings, speed), on_completion, allow_trajectory_shift);
+    // A new command replaces any queued segments.
+    pbio_control_queue_clear(ctl);
+
+    return _pbio_control_start_position_control(ctl, time_now, state, &target, pbio_control_settings_app_to_ctl(&ctl->settings, speed), on_completion, 0, allow_trajectory_shift);
 }
 
 /**
  * Starts the controller and holds at the given position.
  *
- * This is similar to starting position control, but it skips the trajectory
- * computation and just sets the reference to the target position right away.
- *
  * @param [in]  ctl             The control instance.
  * @param [in]  time_now        The wall time (ticks).
- * @param [in]  position        The target position to hold (application units).
- * @return                      Error code.
+ * @param [in]  target          The target position to hold (control units).
  */
-pbio_error_t pbio_control_start_position_control_hold(pbio_control_t *ctl, uint32_t time_now, int32_t position) {
+static void _pbio_control_start_position_control_hold(pbio_control_t *ctl, uint32_t time_now, const pbio_angle_t *target) {
 
     // Compute new maneuver based on user argument, starting from the initial state
     pbio_trajectory_command_t command = {
         .time_start = pbio_control_get_ref_time(ctl, time_now),
+        .position_start = *target,
+        .position_end = *target,
         .speed_target = 0,
         .continue_running = false,
     };
-    pbio_control_settings_app_to_ctl_long(&ctl->settings, position, &command.position_start);
-    pbio_control_settings_app_to_ctl_long(&ctl->settings, position, &command.position_end);
 
     // Holding means staying at a constant trajectory.
     pbio_trajectory_make_constant(&ctl->trajectory, &command);
 
     // Activate control type and reset integrators if needed.
     pbio_control_set_control_type(ctl, time_now, PBIO_CONTROL_TYPE_POSITION, PBIO_CONTROL_ON_COMPLETION_HOLD);
+}
+
+/**
+ * Starts the controller and holds at the given position.
+ *
+ * This is similar to starting position control, but it skips the trajectory
+ * computation and just sets the reference to the target position right away.
+ *
+ * @param [in]  ctl             The control instance.
+ * @param [in]  time_now        The wall time (ticks).
+ * @param [in]  position        The target position to hold (application units).
+ * @return                      Error code.
+ */
+pbio_error_t pbio_control_start_position_control_hold(pbio_control_t *ctl, uint32_t time_now, int32_t position) {
 
+    // Convert target position to control units.
+    pbio_angle_t target;
+    pbio_control_settings_app_to_ctl_long(&ctl->settings, position, &target);
+
+    // A new command replaces any queued segments.
+    pbio_control_queue_clear(ctl);
+
+    _pbio_control_start_position_control_hold(ctl, time_now, &target);
     return PBIO_SUCCESS;
 }
 
+#if PBIO_CONFIG_CONTROL_QUEUE
+
+/**
+ * Gets a segment from the queue.
+ *
+ * @param [in]  ctl         The control instance.
+ * @param [in]  index       Index relative to the next segment in the queue.
+ * @return                  The segment.
+ */
+static pbio_control_segment_t *pbio_control_queue_get(pbio_control_t *ctl, uint8_t index) {
+    return &ctl->queue[(ctl->queue_start + index) % PBIO_CONTROL_QUEUE_SIZE];
+}
+
+/**
+ * Gets the top speed of a position control segment.
+ *
+ * @param [in]  ctl         The control instance.
+ * @param [in]  speed       Requested speed (control units). Zero means default speed.
+ * @return                  The top speed (control units, positive).
+ */
+static int32_t pbio_control_get_segment_speed(const pbio_control_t *ctl, int32_t speed) {
+    if (speed == 0) {
+        return ctl->settings.speed_default;
+    }
+    return pbio_int_math_min(pbio_int_math_abs(speed), ctl->settings.speed_max);
+}
+
+/**
+ * Gets the speed at which a position control segment may end so that it
+ * blends into the next segment in the queue without stopping.
+ *
+ * @param [in]  ctl         The control instance.
+ * @param [in]  start       Position at the start of the segment (control units).
+ * @param [in]  target      Position at the end of the segment (control units).
+ * @param [in]  speed       Top speed of the segment (control units).
+ * @return                  Speed at the end of the segment (control units, positive).
+ */
+static int32_t pbio_control_queue_get_junction_speed(pbio_control_t *ctl, const pbio_angle_t *start, const pbio_angle_t *target, int32_t speed) {
+
+    // The last segment always comes to a stop.
+    if (ctl->queue_size == 0) {
+        return 0;
+    }
+    const pbio_control_segment_t *next = pbio_control_queue_get(ctl, 0);
+
+    if (!pbio_angle_diff_is_small(target, start) || !pbio_angle_diff_is_small(&next->target, target)) {
+        return 0;
+    }
+    int32_t distance = pbio_angle_diff_mdeg(target, start);
+    int32_t distance_next = pbio_angle_diff_mdeg(&next->target, target);
+
+    // If the next segment goes the other way, we have to stop in between.
+    if (distance == 0 || distance_next == 0 || pbio_int_math_sign(distance) != pbio_int_math_sign(distance_next)) {
+        return 0;
+    }
+
+    // Otherwise pass through at the lowest speed of both segments, but no
+    // faster than what the next segment can still stop from.
+    int32_t speed_junction = pbio_int_math_min(pbio_control_get_segment_speed(ctl, speed), pbio_control_get_segment_speed(ctl, next->speed));
+    return pbio_trajectory_get_max_junction_speed(speed_junction, distance_next, ctl->settings.deceleration);
+}
+
+/**
+ * Starts a position control segment, blending into the next one in the queue.
+ *
+ * @param [in]  ctl         The control instance.
+ * @param [in]  time_now    The wall time (ticks).
+ * @param [in]  state       The current state of the system being controlled (control units).
+ * @param [in]  segment     The segment to start.
+ * @return                  Error code.
+ */
+static pbio_error_t pbio_control_queue_start_segment(pbio_control_t *ctl, uint32_t time_now, const pbio_control_state_t *state, const pbio_control_segment_t *segment) {
+
+    // The segment starts from the current reference if control is active.
+    pbio_angle_t start = state->position;
+    if (pbio_control_is_active(ctl)) {
+        pbio_trajectory_reference_t ref;
+        pbio_control_get_reference(ctl, time_now, state, &ref);
+        start = ref.position;
+    }
+
+    int32_t speed_end = pbio_control_queue_get_junction_speed(ctl, &start, &segment->target, segment->speed);
+    return _pbio_control_start_position_control(ctl, time_now, state, &segment->target, segment->speed, segment->on_completion, speed_end, true);
+}
+
+/**
+ * Starts the next segment in the queue once the ongoing segment is over.
+ *
+ * @param [in]  ctl         The control instance.
+ * @param [in]  time_now    The wall time (ticks).
+ * @param [in]  state       The current state of the system being controlled (control units).
+ */
+static void pbio_control_queue_update(pbio_control_t *ctl, uint32_t time_now, const pbio_control_state_t *state) {
+
+    // Switch as soon as the reference reaches the end of the ongoing segment.
+    // At that point, the reference is at the junction speed, so the next
+    // segment carries on from there without stopping.
+    pbio_trajectory_reference_t end;
+    pbio_trajectory_get_endpoint(&ctl->trajectory, &end);
+    if (!pbio_control_settings_time_is_later(pbio_control_get_ref_time(ctl, time_now), end.time)) {
+        return;
+    }
+
+    // Take the next segment from the queue.
+    pbio_control_segment_t segment = *pbio_control_queue_get(ctl, 0);
+    ctl->queue_start = (ctl->queue_start + 1) % PBIO_CONTROL_QUEUE_SIZE;
+    ctl->queue_size--;
+
+    // If it can't be started, drop the remaining segments and hold at the
+    // end of the ongoing one, which may otherwise keep going.
+    if (pbio_control_queue_start_segment(ctl, time_now, state, &segment) != PBIO_SUCCESS) {
+        ctl->queue_size = 0;
+        _pbio_control_start_position_control_hold(ctl, time_now, &end.position);
+    }
+}
+
+/**
+ * Queues a target position to run to after the ongoing position control
+ * command completes.
+ *
+ * Consecutive segments in the same direction blend into each other without
+ * stopping in between. If no position control is ongoing, this starts right
+ * away just like pbio_control_start_position_control().
+ *
+ * @param [in]  ctl            The control instance.
+ * @param [in]  time_now       The wall time (ticks).
+ * @param [in]  state          The current state of the system being controlled (control units).
+ * @param [in]  position       The target position to run to (application units).
+ * @param [in]  speed          The top speed on the way to the target (application units). The sign is ignored. If zero, default speed is used.
+ * @param [in]  on_completion  What to do when reaching the target position, if no other segments follow.
+ * @return                     ::PBIO_ERROR_BUSY if the queue is full, otherwise error code of starting the segment.
+ */
+pbio_error_t pbio_control_queue_position_control(pbio_control_t *ctl, uint32_t time_now, const pbio_control_state_t *state, int32_t position, int32_t speed, pbio_control_on_completion_t on_completion) {
+
+    // Convert segment to control units.
+    pbio_control_segment_t segment = {
+        .speed = pbio_control_settings_app_to_ctl(&ctl->settings, speed),
+        .on_completion = on_completion,
+    };
+    pbio_control_settings_app_to_ctl_long(&ctl->settings, position, &segment.target);
+
+    // If no position control is ongoing, there is nothing to wait for.
+    if (ctl->type != PBIO_CONTROL_TYPE_POSITION || pbio_control_status_test(ctl, PBIO_CONTROL_STATUS_COMPLETE)) {
+        ctl->queue_size = 0;
+        return pbio_control_queue_start_segment(ctl, time_now, state, &segment);
+    }
+
+    if (ctl->queue_size == PBIO_CONTROL_QUEUE_SIZE) {
+        return PBIO_ERROR_BUSY;
+    }
+    *pbio_control_queue_get(ctl, ctl->queue_size++) = segment;
+
+    // Only the last segment before this one needs to know how fast it may
+    // end. If that segment is already ongoing, recompute it from the current
+    // reference to blend into the new one.
+    if (ctl->queue_size > 1) {
+        return PBIO_SUCCESS;
+    }
+    pbio_trajectory_reference_t ref, end;
+    pbio_control_get_reference(ctl, time_now, state, &ref);
+    pbio_trajectory_get_endpoint(&ctl->trajectory, &end);
+    int32_t speed_ongoing = pbio_trajectory_get_abs_command_speed(&ctl->trajectory);
+    int32_t speed_end = pbio_control_queue_get_junction_speed(ctl, &ref.position, &end.position, speed_ongoing);
+    if (speed_end == 0) {
+        return PBIO_SUCCESS;
+    }
+    pbio_error_t err = _pbio_control_start_position_control(ctl, time_now, state, &end.position, speed_ongoing, ctl->on_completion, speed_end, true);
+    if (err != PBIO_SUCCESS) {
+        ctl->queue_size = 0;
+    }
+    return err;
+}
+
+#endif // PBIO_CONFIG_CONTROL_QUEUE
+
 /**
  * Starts the controller to run for a given amount of time.
  *
@@ -711,6 +975,9 @@ pbio_error_t pbio_control_start_timed_control(pbio_control_t *ctl, uint32_t time
     // does nothing useful, so discard it to keep only the passive actuation type.
     on_completion = pbio_control_on_completion_discard_smart(on_completion);
 
+    // A new command replaces any queued segments.
+    pbio_control_queue_clear(ctl);
+
     // Common trajectory parameters for the cases covered here.
     pbio_trajectory_command_t command = {
         .time_start = time_now,
@@ -719,6 +986,7 @@ pbio_error_t pbio_control_start_timed_control(pbio_control_t *ctl, uint32_t time
         .speed_max = ctl->settings.speed_max,
         .acceleration = ctl->settings.acceleration,
         .deceleration = ctl->settings.deceleration,
+        .jerk = ctl->settings.jerk,
         .continue_running = on_completion == PBIO_CONTROL_ON_COMPLETION_CONTINUE,
     };
 
@@ -763,7 +1031,9 @@ pbio_error_t pbio_control_start_timed_control(pbio_control_t *ctl, uint32_t time
         // better than just branching off. Instead, we can adjust the command
         // so it starts from the same point as the previous trajectory. This
         // avoids rounding errors when restarting commands in a tight loop.
-        if (pbio_control_type_is_time(ctl) && ctl->trajectory.a0 == ref.acceleration) {
+        if (pbio_control_type_is_time(ctl) && (ctl->trajectory.a0 == ref.acceleration || ctl->trajectory.tj != 0)) {
+
+            pbio_trajectory_t trajectory_branched = ctl->trajectory;
 
             // Update command with shifted starting point, equal to ongoing
             // maneuver.
@@ -777,9 +1047,12 @@ pbio_error_t pbio_control_start_timed_control(pbio_control_t *ctl, uint32_t time
 
             // Recalculate the trajectory from the shifted starting point.
             err = pbio_trajectory_new_time_command(&ctl->trajectory, &command);
-            if (err != PBIO_SUCCESS) {
+            if (err != PBIO_SUCCESS && trajectory_branched.tj == 0) {
                 return err;
             }
+            if (err != PBIO_SUCCESS || !pbio_control_trajectory_shift_is_tangent(ctl, &ref)) {
+                ctl->trajectory = trajectory_branched;
+            }
         }
     }
 
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2023 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 // SPDX-License-Identifier: BSD-3-Clause
 // Copyright (c) 2020-2023 LEGO System A/S
@@ -10,6 +10,7 @@
 #include <pbio/control_settings.h>
 #include <pbio/int_math.h>
 #include <pbio/observer.h>
+#include <pbio/util.h>
 
 /**
  * Converts milliseconds to time ticks used by controller.
@@ -147,11 +148,12 @@ int32_t pbio_control_settings_div_by_gain(int32_t value, int32_t gain) {
 /**
  * Multiplies a value by the loop time in seconds.
  *
+ * @param [in] s              Control settings containing the loop time.
  * @param [in] input          Input value.
  * @return                    Input scaled by loop time in seconds.
  */
-int32_t pbio_control_settings_mul_by_loop_time(int32_t input) {
-    return input / (1000 / PBIO_CONFIG_CONTROL_LOOP_TIME_MS);
+int32_t pbio_control_settings_mul_by_loop_time(const pbio_control_settings_t *s, int32_t input) {
+    return input / (1000 / (int32_t)s->loop_time);
 }
 
 /**
@@ -165,6 +167,41 @@ bool pbio_control_settings_time_is_later(uint32_t sample, uint32_t base) {
     return sample - base < UINT32_MAX / 2;
 }
 
+/**
+ * Supported control loop times (ms). Motor models are available for each of
+ * these, in the same order, starting with the default.
+ */
+static const uint8_t loop_times[] = {
+    PBIO_CONFIG_CONTROL_LOOP_TIME_MS,
+    #if PBIO_CONFIG_CONTROL_LOOP_TIME_RUNTIME
+    1,
+    2,
+    10,
+    #endif
+};
+
+#if PBIO_CONFIG_CONTROL_LOOP_TIME_RUNTIME
+_Static_assert(PBIO_CONFIG_CONTROL_LOOP_TIME_MS == 5, "runtime loop times assume 5 ms default");
+#endif
+
+/**
+ * Gets the position of a loop time in the list of supported loop times.
+ *
+ * @param [in]  loop_time     Loop time (ms).
+ * @param [out] index         Index of the loop time. The default is 0.
+ * @return                    ::PBIO_SUCCESS on success or
+ *                            ::PBIO_ERROR_INVALID_ARG if the loop time is not supported.
+ */
+pbio_error_t pbio_control_settings_get_loop_time_index(uint32_t loop_time, uint8_t *index) {
+    for (uint8_t i = 0; i < PBIO_ARRAY_SIZE(loop_times); i++) {
+        if (loop_times[i] == loop_time) {
+            *index = i;
+            return PBIO_SUCCESS;
+        }
+    }
+    return PBIO_ERROR_INVALID_ARG;
+}
+
 /**
  * Gets the control limits for movement and actuation, in application units.
  *
@@ -172,11 +209,13 @@ bool pbio_control_settings_time_is_later(uint32_t sample, uint32_t base) {
  * @param [out] speed         Speed limit in application units.
  * @param [out] acceleration  Absolute rate of change of the speed during on-ramp of the maneuver.
  * @param [out] deceleration  Absolute rate of change of the speed during off-ramp of the maneuver.
+ * @param [out] jerk          Absolute rate of change of the acceleration, or 0 if not limited.
  */
-void pbio_control_settings_get_trajectory_limits(const pbio_control_settings_t *s, int32_t *speed, int32_t *acceleration, int32_t *deceleration) {
+void pbio_control_settings_get_trajectory_limits(const pbio_control_settings_t *s, int32_t *speed, int32_t *acceleration, int32_t *deceleration, int32_t *jerk) {
     *speed = pbio_control_settings_ctl_to_app(s, s->speed_max);
     *acceleration = pbio_control_settings_ctl_to_app(s, s->acceleration);
     *deceleration = pbio_control_settings_ctl_to_app(s, s->deceleration);
+    *jerk = pbio_control_settings_ctl_to_app(s, s->jerk);
 }
 
 /**
@@ -186,10 +225,11 @@ void pbio_control_settings_get_trajectory_limits(const pbio_control_settings_t *
  * @param [in] speed          Speed limit in application units.
  * @param [in] acceleration   Absolute rate of change of the speed during on-ramp of the maneuver.
  * @param [in] deceleration   Absolute rate of change of the speed during off-ramp of the maneuver.
+ * @param [in] jerk           Absolute rate of change of the acceleration, or 0 for a trapezoidal speed profile.
  * @return                    ::PBIO_SUCCESS on success
  *                            ::PBIO_ERROR_INVALID_ARG if any argument is negative.
  */
-pbio_error_t pbio_control_settings_set_trajectory_limits(pbio_control_settings_t *s, int32_t speed, int32_t acceleration, int32_t deceleration) {
+pbio_error_t pbio_control_settings_set_trajectory_limits(pbio_control_settings_t *s, int32_t speed, int32_t acceleration, int32_t deceleration, int32_t jerk) {
     // Validate that all inputs are within allowed bounds.
     pbio_error_t err = pbio_trajectory_validate_speed_limit(s->ctl_steps_per_app_step, speed);
     if (err != PBIO_SUCCESS) {
@@ -203,9 +243,14 @@ pbio_error_t pbio_control_settings_set_trajectory_limits(pbio_control_settings_t
     if (err != PBIO_SUCCESS) {
         return err;
     }
+    err = pbio_trajectory_validate_jerk_limit(s->ctl_steps_per_app_step, jerk);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
     s->speed_max = pbio_control_settings_app_to_ctl(s, speed);
     s->acceleration = pbio_control_settings_app_to_ctl(s, acceleration);
     s->deceleration = pbio_control_settings_app_to_ctl(s, deceleration);
+    s->jerk = pbio_control_settings_app_to_ctl(s, jerk);
     return PBIO_SUCCESS;
 }
 
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2022-2023 The Pybricks Authors
+// Copyright (c) 2022-2024 The Pybricks Authors
 
 // SPDX-License-Identifier: BSD-3-Clause
 // Copyright (c) 2022-2023 LEGO System A/S
@@ -14,6 +14,10 @@
 #include <pbio/int_math.h>
 #include <pbio/util.h>
 
+#if PBIO_CONFIG_DIFFERENTIATOR_BUFFER_SIZE <= PBIO_CONFIG_DIFFERENTIATOR_WINDOW_MS / PBIO_CONFIG_CONTROL_LOOP_TIME_MIN_MS
+#error "PBIO_CONFIG_DIFFERENTIATOR_BUFFER_SIZE must be larger than the speed window at the shortest loop time."
+#endif
+
 /**
  * Internal function to get the speed with a variable window size. Window
  * size must be validated externally for this function to be used safely.
@@ -22,17 +26,17 @@
  * @param [in]  window_size    Window size in number of samples (Must be > 0 and <= buffer size!).
  * @param [out] speed          Average speed across given time window in mdeg/s.
  */
-static int32_t pbio_differentiator_calc_speed(pbio_differentiator_t *dif, uint8_t window_size) {
+static int32_t pbio_differentiator_calc_speed(pbio_differentiator_t *dif, uint16_t window_size) {
 
     // Sum differences including start and endpoint.
-    uint8_t start_index = (dif->index - (window_size - 1) + PBIO_ARRAY_SIZE(dif->history)) % PBIO_ARRAY_SIZE(dif->history);
+    uint16_t start_index = (dif->index - (window_size - 1) + PBIO_ARRAY_SIZE(dif->history)) % PBIO_ARRAY_SIZE(dif->history);
     int32_t total = dif->history[dif->index];
-    for (uint8_t i = start_index; i != dif->index; i = (i + 1) % PBIO_ARRAY_SIZE(dif->history)) {
+    for (uint16_t i = start_index; i != dif->index; i = (i + 1) % PBIO_ARRAY_SIZE(dif->history)) {
         total += dif->history[i];
     }
 
     // Each sample has units of mdeg, so take average and convert to mdeg/s.
-    return total * (1000 / PBIO_CONFIG_CONTROL_LOOP_TIME_MS) / window_size;
+    return total * (1000 / dif->loop_time) / window_size;
 }
 
 /**
@@ -47,14 +51,15 @@ int32_t pbio_differentiator_update_and_get_speed(pbio_differentiator_t *dif, con
     // Increment index where latest difference will be stored.
     dif->index = (dif->index + 1) % PBIO_ARRAY_SIZE(dif->history);
 
-    // The difference is stored in millidegrees. Even at 6000 deg/s (well
+    // The difference is stored in millidegrees. Even at 3000 deg/s (well
     // above the physical limits of the motors we use), this at most
-    // 6000 * 1000 * 0.005 = 30000, which fits in a 16-bit signed integer.
+    // 3000 * 1000 * 0.01 = 30000 for the longest loop time, which fits in a
+    // 16-bit signed integer.
     dif->history[dif->index] = pbio_int_math_clamp(pbio_angle_diff_mdeg(angle, &dif->prev_angle), INT16_MAX);
     dif->prev_angle = *angle;
 
     // Calculate the speed.
-    return pbio_differentiator_calc_speed(dif, PBIO_CONFIG_DIFFERENTIATOR_WINDOW_SIZE);
+    return pbio_differentiator_calc_speed(dif, PBIO_CONFIG_DIFFERENTIATOR_WINDOW_MS / dif->loop_time);
 }
 
 /**
@@ -69,7 +74,7 @@ int32_t pbio_differentiator_update_and_get_speed(pbio_differentiator_t *dif, con
 pbio_error_t pbio_differentiator_get_speed(pbio_differentiator_t *dif, uint32_t window, int32_t *speed) {
 
     // Round window to nearest sample size.
-    uint8_t window_size = (window + PBIO_CONFIG_CONTROL_LOOP_TIME_MS / 2) / PBIO_CONFIG_CONTROL_LOOP_TIME_MS;
+    uint32_t window_size = (window + dif->loop_time / 2) / dif->loop_time;
     if (window_size == 0 || window_size > PBIO_ARRAY_SIZE(dif->history) - 1) {
         return PBIO_ERROR_INVALID_ARG;
     }
@@ -87,7 +92,19 @@ pbio_error_t pbio_differentiator_get_speed(pbio_differentiator_t *dif, uint32_t
  */
 void pbio_differentiator_reset(pbio_differentiator_t *dif, const pbio_angle_t *angle) {
     dif->prev_angle = *angle;
-    for (uint8_t i = 0; i < PBIO_ARRAY_SIZE(dif->history); i++) {
+    for (uint16_t i = 0; i < PBIO_ARRAY_SIZE(dif->history); i++) {
         dif->history[i] = 0;
     }
 }
+
+/**
+ * Sets the time between samples and resets the angle buffer, since the
+ * samples taken so far no longer apply.
+ *
+ * @param [in]  dif            The differentiator instance.
+ * @param [in]  loop_time      Time between samples (ms).
+ */
+void pbio_differentiator_set_loop_time(pbio_differentiator_t *dif, uint32_t loop_time) {
+    dif->loop_time = loop_time;
+    pbio_differentiator_reset(dif, &dif->prev_angle);
+}
@@ -1,9 +1,10 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2023 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 // SPDX-License-Identifier: BSD-3-Clause
 // Copyright (c) 2020-2023 LEGO System A/S
 
+#include <math.h>
 #include <stdlib.h>
 
 #include <pbdrv/clock.h>
@@ -97,6 +98,8 @@ static void drivebase_adopt_settings(pbio_control_settings_t *s_distance, pbio_c
         .integral_deadzone = pbio_int_math_max(s_left->integral_deadzone, s_right->integral_deadzone),
         .integral_change_max = pbio_int_math_min(s_left->integral_change_max, s_right->integral_change_max),
         .smart_passive_hold_time = pbio_int_math_max(s_left->smart_passive_hold_time, s_right->smart_passive_hold_time),
+        // Both servos are updated on every control loop, just like the drivebase.
+        .loop_time = s_left->loop_time,
     };
 
     // By default, heading control is the nearly same as distance control.
@@ -158,6 +161,109 @@ static pbio_error_t pbio_drivebase_get_state_control(pbio_drivebase_t *db, pbio_
     return PBIO_SUCCESS;
 }
 
+#if PBIO_CONFIG_DRIVEBASE_ODOMETRY
+
+/**
+ * Gets the sum of the angle reset counts of both motors.
+ *
+ * @param [in]  db              The drivebase instance
+ * @return                      The number of resets.
+ */
+static uint32_t pbio_drivebase_pose_get_motor_resets(pbio_drivebase_t *db) {
+    return pbio_tacho_get_reset_count(db->left->tacho) + pbio_tacho_get_reset_count(db->right->tacho);
+}
+
+/**
+ * Makes the pose estimate continue from the current distance and heading.
+ *
+ * This is used when the pose is reset or when the heading source changes, so
+ * that the resulting jump is not counted as motion.
+ *
+ * @param [in]  db              The drivebase instance
+ * @return                      Error code.
+ */
+static pbio_error_t pbio_drivebase_pose_sync(pbio_drivebase_t *db) {
+    pbio_control_state_t state_distance;
+    pbio_control_state_t state_heading;
+    pbio_error_t err = pbio_drivebase_get_state_control(db, &state_distance, &state_heading);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    db->pose_distance = state_distance.position;
+    db->pose_heading = state_heading.position;
+    db->pose_motor_resets = pbio_drivebase_pose_get_motor_resets(db);
+    db->pose_gyro_resets = pbio_imu_get_heading_reset_count();
+    return PBIO_SUCCESS;
+}
+
+/**
+ * Gets the increment of a drivebase position since the previous control loop.
+ *
+ * @param [in]  settings        Settings of the distance or heading controller.
+ * @param [in]  now             Current position in control units.
+ * @param [in]  previous        Position in the previous loop in control units.
+ * @param [in]  reset           Whether the position was reset since then.
+ * @return                      Increment in application units, or zero if the
+ *                              position was reset.
+ */
+static float pbio_drivebase_pose_get_increment(const pbio_control_settings_t *settings, const pbio_angle_t *now, const pbio_angle_t *previous, bool reset) {
+    if (reset || !pbio_angle_diff_is_small(now, previous)) {
+        return 0.0f;
+    }
+    return (float)pbio_angle_diff_mdeg(now, previous) / settings->ctl_steps_per_app_step;
+}
+
+/**
+ * Advances the pose estimate by the distance and heading increments since the
+ * previous control loop.
+ *
+ * Resetting the motor angles makes the distance jump, and also the heading if
+ * it is measured by the motors. Resetting the gyro heading makes only the
+ * heading jump. Such jumps are not counted as motion.
+ *
+ * @param [in]  db              The drivebase instance
+ * @param [in]  state_distance  Physical and estimated state of the distance.
+ * @param [in]  state_heading   Physical and estimated state of the heading.
+ */
+static void pbio_drivebase_pose_update(pbio_drivebase_t *db, const pbio_control_state_t *state_distance, const pbio_control_state_t *state_heading) {
+
+    uint32_t motor_resets = pbio_drivebase_pose_get_motor_resets(db);
+    uint32_t gyro_resets = pbio_imu_get_heading_reset_count();
+    bool distance_reset = motor_resets != db->pose_motor_resets;
+    bool heading_reset = db->use_gyro ? gyro_resets != db->pose_gyro_resets : distance_reset;
+
+    float distance = pbio_drivebase_pose_get_increment(&db->control_distance.settings, &state_distance->position, &db->pose_distance, distance_reset);
+    float heading = pbio_drivebase_pose_get_increment(&db->control_heading.settings, &state_heading->position, &db->pose_heading, heading_reset);
+
+    db->pose_distance = state_distance->position;
+    db->pose_heading = state_heading->position;
+    db->pose_motor_resets = motor_resets;
+    db->pose_gyro_resets = gyro_resets;
+
+    // Move along the average heading during this loop. Positive headings turn
+    // clockwise, so they move towards positive y.
+    float direction = (db->pose.heading + heading / 2) * (float)M_PI / 180.0f;
+    db->pose.x += distance * cosf(direction);
+    db->pose.y += distance * sinf(direction);
+    db->pose.heading += heading;
+
+    // Optionally log the pose.
+    if (pbio_logger_is_active(&db->pose_log)) {
+        int32_t log_data[] = {
+            // Column 0: Log time (added by logger).
+            // Column 1: X (mm).
+            (int32_t)db->pose.x,
+            // Column 2: Y (mm).
+            (int32_t)db->pose.y,
+            // Column 3: Heading (deg).
+            (int32_t)db->pose.heading,
+        };
+        pbio_logger_add_row(&db->pose_log, log_data);
+    }
+}
+
+#endif // PBIO_CONFIG_DRIVEBASE_ODOMETRY
+
 /**
  * Stop the drivebase from updating its controllers.
  *
@@ -242,7 +348,10 @@ static pbio_error_t pbio_drivebase_stop_from_servo(void *drivebase, bool clear_p
  * @param [in]  right            Right servo instance.
  * @param [in]  wheel_diameter   Wheel diameter in um.
  * @param [in]  axle_track       Distance between wheel-ground contact points in um.
- * @return                       Error code.
+ * @return                       Error code. Servos that were decimated are
+ *                               reset to update on every loop, which fails
+ *                               with ::PBIO_ERROR_NOT_SUPPORTED only if a
+ *                               servo has no model for the current loop time.
  */
 pbio_error_t pbio_drivebase_get_drivebase(pbio_drivebase_t **db_address, pbio_servo_t *left, pbio_servo_t *right, int32_t wheel_diameter, int32_t axle_track) {
 
@@ -286,6 +395,17 @@ pbio_error_t pbio_drivebase_get_drivebase(pbio_drivebase_t **db_address, pbio_se
     db->left = left;
     db->right = right;
 
+    // Drivebase control needs both servos to be updated on every control
+    // loop, so undo any decimation that was set for the individual motors.
+    pbio_error_t err = pbio_servo_reset_decimation(left);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    err = pbio_servo_reset_decimation(right);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
     // Set parents of both servos, so they can stop this drivebase.
     pbio_parent_set(&left->parent, db, pbio_drivebase_stop_from_servo);
     pbio_parent_set(&right->parent, db, pbio_drivebase_stop_from_servo);
@@ -297,13 +417,18 @@ pbio_error_t pbio_drivebase_get_drivebase(pbio_drivebase_t **db_address, pbio_se
 
     // Reset both motors to a passive state
     pbio_drivebase_stop_servo_control(db);
-    pbio_error_t err = pbio_drivebase_stop(db, PBIO_CONTROL_ON_COMPLETION_COAST);
+    err = pbio_drivebase_stop(db, PBIO_CONTROL_ON_COMPLETION_COAST);
     if (err != PBIO_SUCCESS) {
         return err;
     }
 
     // Adopt settings as the average or sum of both servos, except scaling
     drivebase_adopt_settings(&db->control_distance.settings, &db->control_heading.settings, &left->control.settings, &right->control.settings);
+    pbio_logger_set_loop_time(&db->control_distance.log, db->control_distance.settings.loop_time);
+    pbio_logger_set_loop_time(&db->control_heading.log, db->control_heading.settings.loop_time);
+    #if PBIO_CONFIG_DRIVEBASE_ODOMETRY
+    pbio_logger_set_loop_time(&db->pose_log, db->control_distance.settings.loop_time);
+    #endif
 
     // Verify that the given dimensions are not too small or large to compute
     // a correct result for heading and distance control scale below.
@@ -329,6 +454,11 @@ pbio_error_t pbio_drivebase_get_drivebase(pbio_drivebase_t **db_address, pbio_se
         return PBIO_ERROR_INVALID_ARG;
     }
 
+    #if PBIO_CONFIG_DRIVEBASE_ODOMETRY
+    // Start estimating the pose from the origin.
+    db->pose = (pbio_drivebase_pose_t) { 0 };
+    #endif
+
     // Finish setup. By default, don't use gyro.
     return pbio_drivebase_set_use_gyro(db, false);
 }
@@ -352,7 +482,13 @@ pbio_error_t pbio_drivebase_set_use_gyro(pbio_drivebase_t *db, bool use_gyro) {
     }
 
     db->use_gyro = use_gyro;
+
+    #if PBIO_CONFIG_DRIVEBASE_ODOMETRY
+    // Continue the pose estimate from the newly selected heading.
+    return pbio_drivebase_pose_sync(db);
+    #else
     return PBIO_SUCCESS;
+    #endif
 }
 
 /**
@@ -411,6 +547,21 @@ bool pbio_drivebase_is_done(const pbio_drivebase_t *db) {
  */
 static pbio_error_t pbio_drivebase_update(pbio_drivebase_t *db) {
 
+    // Get drive base state
+    pbio_control_state_t state_distance;
+    pbio_control_state_t state_heading;
+    pbio_error_t err;
+
+    #if PBIO_CONFIG_DRIVEBASE_ODOMETRY
+    // The pose is updated even if the drivebase is passive, so that it also
+    // follows the robot when it is pushed or when its motors are used directly.
+    err = pbio_drivebase_get_state_control(db, &state_distance, &state_heading);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    pbio_drivebase_pose_update(db, &state_distance, &state_heading);
+    #endif
+
     // If passive, no need to update.
     if (!pbio_drivebase_control_is_active(db)) {
         return PBIO_SUCCESS;
@@ -419,13 +570,12 @@ static pbio_error_t pbio_drivebase_update(pbio_drivebase_t *db) {
     // Get current time
     uint32_t time_now = pbio_control_get_time_ticks();
 
-    // Get drive base state
-    pbio_control_state_t state_distance;
-    pbio_control_state_t state_heading;
-    pbio_error_t err = pbio_drivebase_get_state_control(db, &state_distance, &state_heading);
+    #if !PBIO_CONFIG_DRIVEBASE_ODOMETRY
+    err = pbio_drivebase_get_state_control(db, &state_distance, &state_heading);
     if (err != PBIO_SUCCESS) {
         return err;
     }
+    #endif
 
     // Get reference and torque signals for distance control.
     pbio_trajectory_reference_t ref_distance;
@@ -497,6 +647,24 @@ void pbio_drivebase_update_all(void) {
     }
 }
 
+/**
+ * Sets the time between control loops for all drivebases.
+ *
+ * @param [in]  loop_time   Time between control loops (ms).
+ */
+void pbio_drivebase_set_loop_time_all(uint32_t loop_time) {
+    for (uint8_t i = 0; i < PBIO_CONFIG_NUM_DRIVEBASES; i++) {
+        pbio_drivebase_t *db = &drivebases[i];
+        db->control_distance.settings.loop_time = loop_time;
+        db->control_heading.settings.loop_time = loop_time;
+        pbio_logger_set_loop_time(&db->control_distance.log, loop_time);
+        pbio_logger_set_loop_time(&db->control_heading.log, loop_time);
+        #if PBIO_CONFIG_DRIVEBASE_ODOMETRY
+        pbio_logger_set_loop_time(&db->pose_log, loop_time);
+        #endif
+    }
+}
+
 /**
  * Starts the drivebase controllers to run by a given distance and angle.
  *
@@ -687,6 +855,60 @@ pbio_error_t pbio_drivebase_get_state_user(pbio_drivebase_t *db, int32_t *distan
     return PBIO_SUCCESS;
 }
 
+#if PBIO_CONFIG_DRIVEBASE_ODOMETRY
+
+/**
+ * Gets the pose of the drivebase, estimated by odometry.
+ *
+ * The pose is updated in every control loop by combining the distance driven
+ * with the heading, which comes from the gyro if the drivebase uses it.
+ *
+ * @param [in]  db          The drivebase instance.
+ * @param [out] x           Distance along the initial heading in mm.
+ * @param [out] y           Distance to the right of the initial heading in mm.
+ * @param [out] heading     Heading in degrees, positive when turning clockwise.
+ * @return                  Error code.
+ */
+pbio_error_t pbio_drivebase_get_pose(pbio_drivebase_t *db, int32_t *x, int32_t *y, int32_t *heading) {
+
+    // The pose is only valid while the update loop is running.
+    if (!pbio_drivebase_update_loop_is_running(db)) {
+        return PBIO_ERROR_INVALID_OP;
+    }
+
+    *x = (int32_t)db->pose.x;
+    *y = (int32_t)db->pose.y;
+    *heading = (int32_t)db->pose.heading;
+    return PBIO_SUCCESS;
+}
+
+/**
+ * Resets the pose of the drivebase to the given values.
+ *
+ * This does not change the distance and angle of the drivebase or the heading
+ * of the gyro, so it can be used at any time, including while driving.
+ *
+ * @param [in]  db          The drivebase instance.
+ * @param [in]  x           Distance along the initial heading in mm.
+ * @param [in]  y           Distance to the right of the initial heading in mm.
+ * @param [in]  heading     Heading in degrees, positive when turning clockwise.
+ * @return                  Error code.
+ */
+pbio_error_t pbio_drivebase_reset_pose(pbio_drivebase_t *db, int32_t x, int32_t y, int32_t heading) {
+
+    // Can't reset the pose if update loop not registered.
+    if (!pbio_drivebase_update_loop_is_running(db)) {
+        return PBIO_ERROR_INVALID_OP;
+    }
+
+    db->pose.x = x;
+    db->pose.y = y;
+    db->pose.heading = heading;
+    return pbio_drivebase_pose_sync(db);
+}
+
+#endif // PBIO_CONFIG_DRIVEBASE_ODOMETRY
+
 
 /**
  * Gets the drivebase settings in user units.
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2023 The Pybricks Authors
+// Copyright (c) 2023-2024 The Pybricks Authors
 
 #include <assert.h>
 
@@ -141,6 +141,17 @@ void pbio_geometry_vector_cross_product(pbio_geometry_xyz_t *a, pbio_geometry_xy
     output->z = a->x * b->y - a->y * b->x;
 }
 
+/**
+ * Gets the dot product of two vectors.
+ *
+ * @param [in]  a       The first vector.
+ * @param [in]  b       The second vector.
+ * @return              The dot product.
+ */
+float pbio_geometry_vector_dot_product(pbio_geometry_xyz_t *a, pbio_geometry_xyz_t *b) {
+    return a->x * b->x + a->y * b->y + a->z * b->z;
+}
+
 /**
  * Gets the scalar projection of one vector onto the line spanned by another.
  *
@@ -159,7 +170,7 @@ pbio_error_t pbio_geometry_vector_project(pbio_geometry_xyz_t *axis, pbio_geomet
     }
 
     // Compute the projection.
-    *projection = unit_axis.x * input->x + unit_axis.y * input->y + unit_axis.z * input->z;
+    *projection = pbio_geometry_vector_dot_product(&unit_axis, input);
     return PBIO_SUCCESS;
 }
 
@@ -216,3 +227,138 @@ pbio_error_t pbio_geometry_map_from_base_axes(pbio_geometry_xyz_t *x_axis, pbio_
 
     return PBIO_SUCCESS;
 }
+
+/**
+ * Gets the rotation matrix that corresponds to a unit quaternion.
+ *
+ * The quaternion and matrix both map vectors from the body frame to the
+ * inertial frame. The scalar part of the quaternion is q4.
+ *
+ * @param [in]  q       The unit quaternion.
+ * @param [out] R       The rotation matrix.
+ */
+void pbio_geometry_quaternion_to_rotation_matrix(pbio_geometry_quaternion_t *q, pbio_geometry_matrix_3x3_t *R) {
+    R->m11 = 1 - 2 * (q->q2 * q->q2 + q->q3 * q->q3);
+    R->m21 = 2 * (q->q1 * q->q2 + q->q3 * q->q4);
+    R->m31 = 2 * (q->q1 * q->q3 - q->q2 * q->q4);
+    R->m12 = 2 * (q->q1 * q->q2 - q->q3 * q->q4);
+    R->m22 = 1 - 2 * (q->q1 * q->q1 + q->q3 * q->q3);
+    R->m32 = 2 * (q->q2 * q->q3 + q->q1 * q->q4);
+    R->m13 = 2 * (q->q1 * q->q3 + q->q2 * q->q4);
+    R->m23 = 2 * (q->q2 * q->q3 - q->q1 * q->q4);
+    R->m33 = 1 - 2 * (q->q1 * q->q1 + q->q2 * q->q2);
+}
+
+/**
+ * Gets the quaternion that rotates the gravity vector measured in the body
+ * frame onto the inertial Z axis, with the smallest possible rotation. This
+ * is used to get an initial orientation with zero heading.
+ *
+ * @param [in]  g       The upward unit vector measured in the body frame.
+ * @param [out] q       The resulting unit quaternion.
+ */
+void pbio_geometry_quaternion_from_gravity_unit_vector(pbio_geometry_xyz_t *g, pbio_geometry_quaternion_t *q) {
+
+    // Upside down, so any half rotation about a horizontal axis will do.
+    if (g->z < -0.9999f) {
+        *q = (pbio_geometry_quaternion_t) {
+            .q1 = 1.0f, .q2 = 0.0f, .q3 = 0.0f, .q4 = 0.0f,
+        };
+        return;
+    }
+
+    // Rotate about g x Z, the half angle of which follows from cos = g.z.
+    *q = (pbio_geometry_quaternion_t) {
+        .q1 = g->y,
+        .q2 = -g->x,
+        .q3 = 0.0f,
+        .q4 = 1.0f + g->z,
+    };
+    pbio_geometry_quaternion_normalize(q);
+}
+
+/**
+ * Gets the time derivative of the orientation quaternion for a given angular
+ * velocity in the body frame.
+ *
+ * @param [in]  q       The orientation quaternion.
+ * @param [in]  w       The angular velocity in deg/s, in the body frame.
+ * @param [out] dq      The rate of change of the quaternion, in 1/s.
+ */
+void pbio_geometry_quaternion_get_rate_of_change(pbio_geometry_quaternion_t *q, pbio_geometry_xyz_t *w, pbio_geometry_quaternion_t *dq) {
+
+    // Half of the angular velocity in rad/s.
+    float wx = w->x * (float)M_PI / 360.0f;
+    float wy = w->y * (float)M_PI / 360.0f;
+    float wz = w->z * (float)M_PI / 360.0f;
+
+    // dq = q * (w, 0) / 2
+    dq->q1 = q->q4 * wx - q->q3 * wy + q->q2 * wz;
+    dq->q2 = q->q3 * wx + q->q4 * wy - q->q1 * wz;
+    dq->q3 = -q->q2 * wx + q->q1 * wy + q->q4 * wz;
+    dq->q4 = -q->q1 * wx - q->q2 * wy - q->q3 * wz;
+}
+
+/**
+ * Integrates a unit quaternion over one time step at a constant angular
+ * velocity, and normalizes it again to avoid drift.
+ *
+ * @param [in, out] q   The orientation quaternion.
+ * @param [in]  w       The angular velocity in deg/s, in the body frame.
+ * @param [in]  dt      The time step in s.
+ */
+void pbio_geometry_quaternion_integrate(pbio_geometry_quaternion_t *q, pbio_geometry_xyz_t *w, float dt) {
+    pbio_geometry_quaternion_t dq;
+    pbio_geometry_quaternion_get_rate_of_change(q, w, &dq);
+    for (uint8_t i = 0; i < 4; i++) {
+        q->values[i] += dq.values[i] * dt;
+    }
+    pbio_geometry_quaternion_normalize(q);
+}
+
+/**
+ * Gets the angular velocity that rotates an estimated up direction towards
+ * a measured gravity vector, both in the body frame.
+ *
+ * The result is perpendicular to both vectors. Its magnitude is @p gain times
+ * the sine of the angle between them, so it vanishes once they are aligned.
+ *
+ * @param [in]  gravity     The measured gravity vector, pointing up.
+ * @param [in]  up          The estimated up direction, as a unit vector.
+ * @param [in]  gain        The correction rate in deg/s per unit of error.
+ * @param [out] correction  The angular velocity in deg/s.
+ */
+void pbio_geometry_get_tilt_correction(pbio_geometry_xyz_t *gravity, pbio_geometry_xyz_t *up, float gain, pbio_geometry_xyz_t *correction) {
+    float norm = sqrtf(pbio_geometry_vector_dot_product(gravity, gravity));
+
+    // Nothing to correct towards.
+    if (norm == 0.0f) {
+        *correction = (pbio_geometry_xyz_t) { .x = 0.0f, .y = 0.0f, .z = 0.0f };
+        return;
+    }
+
+    pbio_geometry_vector_cross_product(gravity, up, correction);
+    for (uint8_t i = 0; i < 3; i++) {
+        correction->values[i] *= gain / norm;
+    }
+}
+
+/**
+ * Normalizes a quaternion so it has unit length.
+ *
+ * @param [in, out] q   The quaternion to normalize.
+ */
+void pbio_geometry_quaternion_normalize(pbio_geometry_quaternion_t *q) {
+    float norm = sqrtf(q->q1 * q->q1 + q->q2 * q->q2 + q->q3 * q->q3 + q->q4 * q->q4);
+
+    // Degenerate quaternions are not used, but avoid division by zero.
+    if (norm == 0.0f) {
+        q->q4 = 1.0f;
+        return;
+    }
+
+    q->q1 /= norm;
+    q->q2 /= norm;
+    q->q3 /= norm;
+    q->q4 /= norm;
+}
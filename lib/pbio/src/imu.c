@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2022-2023 The Pybricks Authors
+// Copyright (c) 2022-2024 The Pybricks Authors
 
 #include <stdbool.h>
 #include <string.h>
@@ -27,6 +27,91 @@ static pbio_geometry_xyz_t acceleration; // mm/s^2, in hub frame
 static pbio_geometry_xyz_t gyro_bias;
 static pbio_geometry_xyz_t single_axis_rotation; // deg, in hub frame
 
+// Estimated orientation, mapping vectors from the hub frame to the inertial
+// frame. The inertial Z axis points up, and its heading starts at zero.
+static pbio_geometry_quaternion_t orientation_quaternion = {
+    .q1 = 0.0f, .q2 = 0.0f, .q3 = 0.0f, .q4 = 1.0f,
+};
+static pbio_geometry_matrix_3x3_t orientation = {
+    .m11 = 1.0f, .m12 = 0.0f, .m13 = 0.0f,
+    .m21 = 0.0f, .m22 = 1.0f, .m23 = 0.0f,
+    .m31 = 0.0f, .m32 = 0.0f, .m33 = 1.0f,
+};
+static bool orientation_initialized;
+
+// Gravity in mm/s^2 as measured by this accelerometer while stationary.
+static float gravity_magnitude = 9806.65f;
+
+static pbio_geometry_xyz_t linear_acceleration; // mm/s^2, in hub frame, without gravity.
+static float heading_3d; // deg, rotation about the inertial Z axis.
+
+/**
+ * How fast the estimated orientation is pulled towards the measured gravity
+ * vector, in deg/s per unit of error. The error is the sine of the angle
+ * between the measured and estimated gravity vectors, so this settles small
+ * tilt errors with a time constant of about 2 seconds. This is slow enough
+ * to average out vibrations and fast enough to cancel gyro drift.
+ */
+#define PBIO_IMU_GRAVITY_CORRECTION_GAIN (30.0f)
+
+/**
+ * The acceleration is only used as a measure of gravity if its magnitude
+ * is within this fraction of gravity. Otherwise the hub is accelerating too
+ * much to tell which way is up, so the orientation relies on the gyro alone.
+ */
+#define PBIO_IMU_GRAVITY_TOLERANCE (0.1f)
+
+// Updates the estimated orientation using the latest gyro and accelerometer
+// data. This is a complementary filter on quaternions, similar to the Mahony
+// filter without integral term since the gyro bias is estimated separately.
+static void pbio_imu_update_orientation(void) {
+
+    float acceleration_norm = sqrtf(pbio_geometry_vector_dot_product(&acceleration, &acceleration));
+    if (acceleration_norm == 0.0f) {
+        // Invalid data, nothing we can do.
+        return;
+    }
+
+    // Start with the orientation given by gravity, with zero heading.
+    if (!orientation_initialized) {
+        pbio_geometry_xyz_t up;
+        pbio_geometry_vector_normalize(&acceleration, &up);
+        pbio_geometry_quaternion_from_gravity_unit_vector(&up, &orientation_quaternion);
+        pbio_geometry_quaternion_to_rotation_matrix(&orientation_quaternion, &orientation);
+        orientation_initialized = true;
+    }
+
+    // Estimated up direction in the hub frame, which is the last row of the
+    // rotation matrix (inertial Z axis mapped back to the hub frame).
+    pbio_geometry_xyz_t up_estimate = {
+        .x = orientation.m31, .y = orientation.m32, .z = orientation.m33,
+    };
+
+    // Rotate the estimate towards the measured gravity vector, if reliable.
+    pbio_geometry_xyz_t angular_velocity_corrected = angular_velocity;
+    if (fabsf(acceleration_norm - gravity_magnitude) < gravity_magnitude * PBIO_IMU_GRAVITY_TOLERANCE) {
+        pbio_geometry_xyz_t correction;
+        pbio_geometry_get_tilt_correction(&acceleration, &up_estimate, PBIO_IMU_GRAVITY_CORRECTION_GAIN, &correction);
+        for (uint8_t i = 0; i < PBIO_ARRAY_SIZE(correction.values); i++) {
+            angular_velocity_corrected.values[i] += correction.values[i];
+        }
+    }
+
+    // Integrate the quaternion.
+    pbio_geometry_quaternion_integrate(&orientation_quaternion, &angular_velocity_corrected, imu_config->sample_time);
+    pbio_geometry_quaternion_to_rotation_matrix(&orientation_quaternion, &orientation);
+
+    // The heading is the rotation about the vertical axis, which is the
+    // uncorrected angular velocity projected onto the up direction. Unlike
+    // the single axis rotation, this stays valid when the hub is tilted.
+    heading_3d += pbio_geometry_vector_dot_product(&angular_velocity, &up_estimate) * imu_config->sample_time;
+
+    // Get acceleration without gravity using the updated up direction.
+    linear_acceleration.x = acceleration.x - gravity_magnitude * orientation.m31;
+    linear_acceleration.y = acceleration.y - gravity_magnitude * orientation.m32;
+    linear_acceleration.z = acceleration.z - gravity_magnitude * orientation.m33;
+}
+
 // Called by driver to process one frame of unfiltered gyro and accelerometer data.
 static void pbio_imu_handle_frame_data_func(int16_t *data) {
     for (uint8_t i = 0; i < PBIO_ARRAY_SIZE(angular_velocity.values); i++) {
@@ -41,6 +126,9 @@ static void pbio_imu_handle_frame_data_func(int16_t *data) {
         // applications so long as the vehicle drives on a flat surface.
         single_axis_rotation.values[i] += angular_velocity.values[i] * imu_config->sample_time;
     }
+
+    // Update the 3D orientation estimate.
+    pbio_imu_update_orientation();
 }
 
 // This counter is a measure for calibration accuracy, roughly equivalent
@@ -80,6 +168,15 @@ static void pbio_imu_handle_stationary_data_func(const int32_t *gyro_data_sum, c
         // Update bias at decreasing rate.
         gyro_bias.values[i] = gyro_bias.values[i] * (1.0f - weight) + weight * average_now;
     }
+
+    // Average acceleration while stationary is gravity. Its magnitude is
+    // slightly different for each hub, so update it in the same way.
+    pbio_geometry_xyz_t gravity;
+    for (uint8_t i = 0; i < PBIO_ARRAY_SIZE(gravity.values); i++) {
+        gravity.values[i] = accel_data_sum[i] * imu_config->accel_scale / num_samples;
+    }
+    float gravity_now = sqrtf(pbio_geometry_vector_dot_product(&gravity, &gravity));
+    gravity_magnitude = gravity_magnitude * (1.0f - weight) + weight * gravity_now;
 }
 
 /**
@@ -200,6 +297,52 @@ void pbio_imu_get_acceleration(pbio_geometry_xyz_t *values) {
     pbio_geometry_vector_map(&pbio_orientation_base_orientation, &acceleration, values);
 }
 
+/**
+ * Gets the cached IMU acceleration in mm/s^2, without gravity.
+ *
+ * @param [out] values      The acceleration vector.
+ */
+void pbio_imu_get_linear_acceleration(pbio_geometry_xyz_t *values) {
+    pbio_geometry_vector_map(&pbio_orientation_base_orientation, &linear_acceleration, values);
+}
+
+/**
+ * Gets the estimated unit vector that points up, in the robot frame.
+ *
+ * Unlike the acceleration, this is not affected by the motion of the hub.
+ *
+ * @param [out] values      The up vector.
+ */
+void pbio_imu_get_up_vector(pbio_geometry_xyz_t *values) {
+    pbio_geometry_xyz_t up = {
+        .x = orientation.m31, .y = orientation.m32, .z = orientation.m33,
+    };
+    pbio_geometry_vector_map(&pbio_orientation_base_orientation, &up, values);
+}
+
+/**
+ * Gets the estimated orientation of the robot frame.
+ *
+ * This is a rotation matrix that maps vectors from the robot frame to the
+ * inertial frame, in which the Z axis points up. The initial heading is zero.
+ *
+ * @param [out] rotation    The rotation matrix.
+ */
+void pbio_imu_get_orientation(pbio_geometry_matrix_3x3_t *rotation) {
+
+    // The base orientation maps the hub frame to the robot frame, so the
+    // robot orientation is the hub orientation times the inverse (transpose)
+    // of the base orientation.
+    for (uint8_t r = 0; r < 3; r++) {
+        for (uint8_t c = 0; c < 3; c++) {
+            rotation->values[r * 3 + c] =
+                orientation.values[r * 3 + 0] * pbio_orientation_base_orientation.values[c * 3 + 0] +
+                orientation.values[r * 3 + 1] * pbio_orientation_base_orientation.values[c * 3 + 1] +
+                orientation.values[r * 3 + 2] * pbio_orientation_base_orientation.values[c * 3 + 2];
+        }
+    }
+}
+
 /**
  * Gets the rotation along a particular axis of the robot frame.
  *
@@ -227,12 +370,15 @@ pbio_error_t pbio_imu_get_single_axis_rotation(pbio_geometry_xyz_t *axis, float
 pbio_geometry_side_t pbio_imu_get_up_side(void) {
     // Up is which side of a unit box intersects the +Z vector first.
     // So read +Z vector of the inertial frame, in the body frame.
-    // For now, this is the gravity vector. In the future, we can make this
-    // slightly more accurate by using the full IMU orientation.
-    return pbio_geometry_side_from_vector(&acceleration);
+    pbio_geometry_xyz_t up = {
+        .x = orientation.m31, .y = orientation.m32, .z = orientation.m33,
+    };
+    return pbio_geometry_side_from_vector(&up);
 }
 
-static float heading_offset = 0;
+static float heading_offset_1d = 0;
+static float heading_offset_3d = 0;
+static uint32_t heading_reset_count = 0;
 
 /**
  * Reads the estimated IMU heading in degrees, accounting for user offset and
@@ -240,19 +386,24 @@ static float heading_offset = 0;
  *
  * Heading is defined as clockwise positive.
  *
+ * @param [in]  type        The heading estimate to use.
  * @return                  Heading angle in the base frame.
  */
-float pbio_imu_get_heading(void) {
+float pbio_imu_get_heading(pbio_imu_heading_type_t type) {
+
+    if (type == PBIO_IMU_HEADING_TYPE_3D) {
+        return -heading_3d * 360.0f / heading_degrees_per_rotation - heading_offset_3d;
+    }
 
     pbio_geometry_xyz_t heading_mapped;
 
     pbio_geometry_vector_map(&pbio_orientation_base_orientation, &single_axis_rotation, &heading_mapped);
 
-    return -heading_mapped.z * 360.0f / heading_degrees_per_rotation - heading_offset;
+    return -heading_mapped.z * 360.0f / heading_degrees_per_rotation - heading_offset_1d;
 }
 
 /**
- * Sets the IMU heading.
+ * Sets the IMU heading of both heading estimates.
  *
  * This only adjusts the user offset without resetting anything in the
  * algorithm, so this can be called at any time.
@@ -260,7 +411,20 @@ float pbio_imu_get_heading(void) {
  * @param [in] desired_heading  The desired heading value.
  */
 void pbio_imu_set_heading(float desired_heading) {
-    heading_offset = pbio_imu_get_heading() + heading_offset - desired_heading;
+    heading_offset_1d = pbio_imu_get_heading(PBIO_IMU_HEADING_TYPE_1D) + heading_offset_1d - desired_heading;
+    heading_offset_3d = pbio_imu_get_heading(PBIO_IMU_HEADING_TYPE_3D) + heading_offset_3d - desired_heading;
+    heading_reset_count++;
+}
+
+/**
+ * Gets how many times the heading was set with pbio_imu_set_heading().
+ *
+ * This lets users of the heading tell a reset apart from actual rotation.
+ *
+ * @return                  The number of resets.
+ */
+uint32_t pbio_imu_get_heading_reset_count(void) {
+    return heading_reset_count;
 }
 
 /**
@@ -279,7 +443,7 @@ void pbio_imu_set_heading(float desired_heading) {
 void pbio_imu_get_heading_scaled(pbio_angle_t *heading, int32_t *heading_rate, int32_t ctl_steps_per_degree) {
 
     // Heading in degrees of the robot.
-    float heading_degrees = pbio_imu_get_heading();
+    float heading_degrees = pbio_imu_get_heading(PBIO_IMU_HEADING_TYPE_1D);
 
     // Number of whole rotations in control units (in terms of wheels, not robot).
     heading->rotations = heading_degrees / (360000 / ctl_steps_per_degree);
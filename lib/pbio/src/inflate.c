@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2024 The Pybricks Authors
+
+#include <stdint.h>
+
+#include <pbio/error.h>
+#include <pbio/inflate.h>
+#include <pbio/util.h>
+
+/**
+ * Starts inflating compressed data.
+ *
+ * @param [out] z       The inflate state.
+ * @param [in]  data    The compressed data, without any header.
+ * @param [in]  size    The size of @p data.
+ */
+void pbio_inflate_init(pbio_inflate_t *z, const uint8_t *data, uint32_t size) {
+    z->cur = data;
+    z->end = data + size;
+    z->literals = 0;
+    z->matches = 0;
+    z->distance = 0;
+    z->pos = 0;
+}
+
+/**
+ * Inflates the next byte.
+ *
+ * @param [in]  z       The inflate state.
+ * @param [out] value   The inflated byte.
+ * @return              ::PBIO_ERROR_INVALID_ARG if the data ends early or a
+ *                      match refers to data before the start or outside of
+ *                      the window, otherwise ::PBIO_SUCCESS.
+ */
+pbio_error_t pbio_inflate_byte(pbio_inflate_t *z, uint8_t *value) {
+
+    // Start the next token if the previous one is done.
+    if (!z->literals && !z->matches) {
+        if (z->cur >= z->end) {
+            return PBIO_ERROR_INVALID_ARG;
+        }
+        uint8_t token = *z->cur++;
+        if (token < 0x80) {
+            z->literals = token + 1;
+        } else {
+            if (z->end - z->cur < 2) {
+                return PBIO_ERROR_INVALID_ARG;
+            }
+            z->distance = pbio_get_uint16_le(z->cur);
+            z->cur += 2;
+            if (z->distance >= PBIO_INFLATE_WINDOW_SIZE || z->distance >= z->pos) {
+                return PBIO_ERROR_INVALID_ARG;
+            }
+            z->matches = (token & 0x7F) + 3;
+        }
+    }
+
+    if (z->literals) {
+        if (z->cur >= z->end) {
+            return PBIO_ERROR_INVALID_ARG;
+        }
+        *value = *z->cur++;
+        z->literals--;
+    } else {
+        *value = z->window[(z->pos - z->distance - 1) & (PBIO_INFLATE_WINDOW_SIZE - 1)];
+        z->matches--;
+    }
+
+    // Keep inflated data for use by later matches.
+    z->window[z->pos++ & (PBIO_INFLATE_WINDOW_SIZE - 1)] = *value;
+    return PBIO_SUCCESS;
+}
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2023 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 #include <pbio/config.h>
 
@@ -13,6 +13,7 @@
 #include <pbio/config.h>
 #include <pbio/error.h>
 #include <pbio/logger.h>
+#include <pbio/util.h>
 
 /**
  * Starts logging in the background.
@@ -32,11 +33,39 @@ void pbio_logger_start(pbio_log_t *log, int32_t *buf, uint32_t num_rows, uint8_t
     log->num_cols = num_cols;
     log->down_sample = down_sample;
     log->start_time = pbdrv_clock_get_ms();
+    log->streaming = false;
 
     // Data may now be logged.
     log->active = true;
 }
 
+/**
+ * Starts logging in the background, using the buffer as a ring that is
+ * drained with pbio_logger_stream_read() while logging is still active.
+ *
+ * The ring has one producer (the background control loop that adds rows) and
+ * one consumer (the reader), so no locking is needed. One row is kept free
+ * to tell a full ring from an empty one, so at most @p num_rows - 1 rows are
+ * pending at any time. When the ring is full, new rows are dropped instead of
+ * stopping the log.
+ *
+ * @param [in]  log         Pointer to log.
+ * @param [in]  buf         Array large enough to hold @p num_rows rows of data.
+ * @param [in]  num_rows    Number of rows in the ring, at least 2.
+ * @param [in]  num_cols    Number of entries in one row.
+ * @param [in]  down_sample For every @p down_sample of update calls, only one row is logged.
+ */
+void pbio_logger_start_stream(pbio_log_t *log, int32_t *buf, uint32_t num_rows, uint8_t num_cols, int32_t down_sample) {
+    // Reset the ring before the producer may add new rows.
+    log->head = 0;
+    log->tail = 0;
+    log->tail_col = 0;
+    log->num_rows_dropped = 0;
+
+    pbio_logger_start(log, buf, num_rows, num_cols, down_sample);
+    log->streaming = true;
+}
+
 /**
  * Stops accepting new data from background loops.
  *
@@ -46,6 +75,16 @@ void pbio_logger_stop(pbio_log_t *log) {
     log->active = false;
 }
 
+/**
+ * Sets the time between two calls to add a row.
+ *
+ * @param [in]  log         Pointer to log.
+ * @param [in]  loop_time   Time between two calls to add a row (ms).
+ */
+void pbio_logger_set_loop_time(pbio_log_t *log, uint32_t loop_time) {
+    log->loop_time = loop_time;
+}
+
 /**
  * Checks if log is active (data can be added).
  *
@@ -70,6 +109,26 @@ void pbio_logger_add_row(pbio_log_t *log, const int32_t *row_data) {
     }
     log->skipped_samples = 0;
 
+    if (log->streaming) {
+        // In streaming mode, drop the row if the consumer has fallen behind.
+        uint32_t next = log->head + 1 == log->num_rows ? 0 : log->head + 1;
+        if (next == log->tail) {
+            log->num_rows_dropped++;
+            return;
+        }
+
+        int32_t *row = log->data + log->head * log->num_cols;
+        row[0] = pbdrv_clock_get_ms() - log->start_time;
+        for (uint8_t i = PBIO_LOGGER_NUM_DEFAULT_COLS; i < log->num_cols; i++) {
+            row[i] = row_data[i - PBIO_LOGGER_NUM_DEFAULT_COLS];
+        }
+
+        // Publish the row only after it has been completely written.
+        log->head = next;
+        log->num_rows_used++;
+        return;
+    }
+
     // Exit if log is full.
     if (log->num_rows_used >= log->num_rows) {
         log->active = false;
@@ -110,4 +169,121 @@ int32_t *pbio_logger_get_row_data(const pbio_log_t *log, uint32_t index) {
     return log->data + index * log->num_cols;
 }
 
+/**
+ * Checks if the log was started in streaming mode.
+ *
+ * @param [in]  log         Pointer to log.
+ * @return                  True if the log buffer is used as a ring, else false.
+ */
+bool pbio_logger_is_streaming(const pbio_log_t *log) {
+    return log->streaming;
+}
+
+/**
+ * Gets the number of rows in the ring that have not been fully read yet.
+ *
+ * @param [in]  log         Pointer to log.
+ * @return                  Number of pending rows.
+ */
+uint32_t pbio_logger_stream_get_num_rows_pending(const pbio_log_t *log) {
+    if (!log->streaming) {
+        return 0;
+    }
+    uint32_t head = log->head;
+    uint32_t tail = log->tail;
+    return head >= tail ? head - tail : log->num_rows - tail + head;
+}
+
+/**
+ * Reads pending values from the ring as 32-bit little endian integers.
+ *
+ * Only whole values are copied, but rows may be split across reads. The
+ * reader is responsible for regrouping the values into rows of num_cols
+ * values each.
+ *
+ * @param [in]  log         Pointer to log.
+ * @param [out] buf         Buffer to copy the values into.
+ * @param [in]  size        Size of @p buf in bytes.
+ * @return                  Number of bytes written to @p buf.
+ */
+uint32_t pbio_logger_stream_read(pbio_log_t *log, uint8_t *buf, uint32_t size) {
+    uint32_t written = 0;
+
+    while (pbio_logger_stream_get_num_rows_pending(log) && written + sizeof(int32_t) <= size) {
+        int32_t *row = log->data + log->tail * log->num_cols;
+        pbio_set_uint32_le(&buf[written], row[log->tail_col]);
+        written += sizeof(int32_t);
+
+        // Release the row to the producer once all of its values are read.
+        if (++log->tail_col == log->num_cols) {
+            log->tail_col = 0;
+            log->tail = log->tail + 1 == log->num_rows ? 0 : log->tail + 1;
+        }
+    }
+    return written;
+}
+
+/**
+ * Encodes the header of a binary log.
+ *
+ * The header consists of:
+ * - magic: The ASCII characters "PBLG".
+ * - version: ::PBIO_LOGGER_BINARY_VERSION (8-bit unsigned integer).
+ * - num_cols: Number of values in one row (8-bit unsigned integer).
+ * - sample_time: Expected time between two rows in milliseconds (16-bit little-endian unsigned integer).
+ * - num_rows: Number of rows that follow (32-bit little-endian unsigned integer).
+ *
+ * @param [in]  log         Pointer to log.
+ * @param [out] buf         Buffer of at least ::PBIO_LOGGER_BINARY_HEADER_SIZE bytes.
+ * @return                  Number of bytes written to @p buf.
+ */
+uint32_t pbio_logger_binary_encode_header(const pbio_log_t *log, uint8_t *buf) {
+    buf[0] = 'P';
+    buf[1] = 'B';
+    buf[2] = 'L';
+    buf[3] = 'G';
+    buf[4] = PBIO_LOGGER_BINARY_VERSION;
+    buf[5] = log->num_cols;
+    pbio_set_uint16_le(&buf[6], log->down_sample * log->loop_time);
+    pbio_set_uint32_le(&buf[8], log->num_rows_used);
+    return PBIO_LOGGER_BINARY_HEADER_SIZE;
+}
+
+/**
+ * Encodes one row of a binary log.
+ *
+ * Each value is stored as the difference from the value in the same column
+ * of the previous row. Logged signals such as time and angles change slowly,
+ * so the difference is usually small. It is zig-zag encoded so that small
+ * negative values become small unsigned values, and then written as a
+ * variable length integer of 7 bits per byte, least significant group first,
+ * with the most significant bit set on all but the last byte.
+ *
+ * @param [in]  log         Pointer to log.
+ * @param [in]  index       Index of the row to encode.
+ * @param [in, out] previous Values of the previously encoded row. Must be
+ *                          zero-initialized before encoding the first row.
+ * @param [out] buf         Buffer of at least num_cols times
+ *                          ::PBIO_LOGGER_BINARY_MAX_VALUE_SIZE bytes.
+ * @return                  Number of bytes written to @p buf.
+ */
+uint32_t pbio_logger_binary_encode_row(const pbio_log_t *log, uint32_t index, int32_t *previous, uint8_t *buf) {
+    const int32_t *row = pbio_logger_get_row_data(log, index);
+    uint32_t size = 0;
+
+    for (uint8_t col = 0; col < log->num_cols; col++) {
+        // Wrapping difference, so that decoding restores any 32-bit value.
+        int32_t delta = (int32_t)((uint32_t)row[col] - (uint32_t)previous[col]);
+        uint32_t zigzag = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+        previous[col] = row[col];
+
+        while (zigzag >= 0x80) {
+            buf[size++] = (zigzag & 0x7f) | 0x80;
+            zigzag >>= 7;
+        }
+        buf[size++] = zigzag;
+    }
+    return size;
+}
+
 #endif // PBIO_CONFIG_LOGGER
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2023 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 // SPDX-License-Identifier: BSD-3-Clause
 // Copyright (c) 2020-2023 LEGO System A/S
@@ -138,6 +138,389 @@ static const pbio_observer_model_t model_technic_xl = {
     .torque_friction = 12893,
 };
 
+#if PBIO_CONFIG_CONTROL_LOOP_TIME_RUNTIME
+
+// Models for the non-default loop times of 1, 2, and 10 ms, in that order.
+static const pbio_observer_model_t model_technic_s_angular_runtime[] = {
+    // 1 ms
+    {
+        .d_angle_d_speed = 860556,
+        .d_speed_d_speed = 865,
+        .d_current_d_speed = -434646,
+        .d_angle_d_current = 23797187,
+        .d_speed_d_current = 13369,
+        .d_current_d_current = 151451,
+        .d_angle_d_voltage = 404540291,
+        .d_speed_d_voltage = 142784,
+        .d_current_d_voltage = 608783,
+        .d_angle_d_torque = -10406106,
+        .d_speed_d_torque = -5211,
+        .d_current_d_torque = 4684596,
+        .d_voltage_d_torque = 22334,
+        .d_torque_d_voltage = 17203,
+        .d_torque_d_speed = 12282,
+        .d_torque_d_acceleration = 35129,
+        .torque_friction = 9182,
+    },
+    // 2 ms
+    {
+        .d_angle_d_speed = 433393,
+        .d_speed_d_speed = 882,
+        .d_current_d_speed = -296844,
+        .d_angle_d_current = 7328054,
+        .d_speed_d_current = 9130,
+        .d_current_d_current = 336352,
+        .d_angle_d_voltage = 59284971,
+        .d_speed_d_voltage = 43969,
+        .d_current_d_voltage = 415772,
+        .d_angle_d_torque = -2611638,
+        .d_speed_d_torque = -2624,
+        .d_current_d_torque = 1442564,
+        .d_voltage_d_torque = 22334,
+        .d_torque_d_voltage = 17203,
+        .d_torque_d_speed = 12282,
+        .d_torque_d_acceleration = 35129,
+        .torque_friction = 9182,
+    },
+    // 10 ms
+    {
+        .d_angle_d_speed = 95791,
+        .d_speed_d_speed = 1110,
+        .d_current_d_speed = -280162,
+        .d_angle_d_current = 882377,
+        .d_speed_d_current = 8617,
+        .d_current_d_current = -2231101,
+        .d_angle_d_voltage = 1152167,
+        .d_speed_d_voltage = 5294,
+        .d_current_d_voltage = 392406,
+        .d_angle_d_torque = -110964,
+        .d_speed_d_torque = -580,
+        .d_current_d_torque = 173700,
+        .d_voltage_d_torque = 22334,
+        .d_torque_d_voltage = 17203,
+        .d_torque_d_speed = 12282,
+        .d_torque_d_acceleration = 35129,
+        .torque_friction = 9182,
+    },
+};
+
+static const pbio_observer_model_t model_technic_m_angular_runtime[] = {
+    // 1 ms
+    {
+        .d_angle_d_speed = 859588,
+        .d_speed_d_speed = 863,
+        .d_current_d_speed = -390399,
+        .d_angle_d_current = 36566617,
+        .d_speed_d_current = 19662,
+        .d_current_d_current = 112749,
+        .d_angle_d_voltage = 635007179,
+        .d_speed_d_voltage = 219401,
+        .d_current_d_voltage = 533732,
+        .d_angle_d_torque = -22603145,
+        .d_speed_d_torque = -11312,
+        .d_current_d_torque = 9554529,
+        .d_voltage_d_torque = 47606,
+        .d_torque_d_voltage = 8071,
+        .d_torque_d_speed = 5903,
+        .d_torque_d_acceleration = 16163,
+        .torque_friction = 21413,
+    },
+    // 2 ms
+    {
+        .d_angle_d_speed = 431879,
+        .d_speed_d_speed = 874,
+        .d_current_d_speed = -239578,
+        .d_angle_d_current = 10473910,
+        .d_speed_d_current = 12066,
+        .d_current_d_current = 181189,
+        .d_angle_d_voltage = 87976024,
+        .d_speed_d_voltage = 62844,
+        .d_current_d_voltage = 327537,
+        .d_angle_d_torque = -5665135,
+        .d_speed_d_torque = -5683,
+        .d_current_d_torque = 2736739,
+        .d_voltage_d_torque = 47606,
+        .d_torque_d_voltage = 8071,
+        .d_torque_d_speed = 5903,
+        .d_torque_d_acceleration = 16163,
+        .torque_friction = 21413,
+    },
+    // 10 ms
+    {
+        .d_angle_d_speed = 93909,
+        .d_speed_d_speed = 1073,
+        .d_current_d_speed = -167290,
+        .d_angle_d_current = 974556,
+        .d_speed_d_current = 8425,
+        .d_current_d_current = -1780518,
+        .d_angle_d_voltage = 1358414,
+        .d_speed_d_voltage = 5847,
+        .d_current_d_voltage = 228710,
+        .d_angle_d_torque = -237803,
+        .d_speed_d_torque = -1236,
+        .d_current_d_torque = 254643,
+        .d_voltage_d_torque = 47606,
+        .d_torque_d_voltage = 8071,
+        .d_torque_d_speed = 5903,
+        .d_torque_d_acceleration = 16163,
+        .torque_friction = 21413,
+    },
+};
+
+static const pbio_observer_model_t model_technic_l_angular_runtime[] = {
+    // 1 ms
+    {
+        .d_angle_d_speed = 858867,
+        .d_speed_d_speed = 861,
+        .d_current_d_speed = -167068,
+        .d_angle_d_current = 145009592,
+        .d_speed_d_current = 76297,
+        .d_current_d_current = 98035,
+        .d_angle_d_voltage = 1272549586,
+        .d_speed_d_voltage = 435031,
+        .d_current_d_voltage = 250121,
+        .d_angle_d_torque = -91366681,
+        .d_speed_d_torque = -45706,
+        .d_current_d_torque = 16897745,
+        .d_voltage_d_torque = 133763,
+        .d_torque_d_voltage = 2872,
+        .d_torque_d_speed = 1919,
+        .d_torque_d_acceleration = 3997,
+        .torque_friction = 23239,
+    },
+    // 2 ms
+    {
+        .d_angle_d_speed = 430616,
+        .d_speed_d_speed = 867,
+        .d_current_d_speed = -96727,
+        .d_angle_d_current = 39960350,
+        .d_speed_d_current = 44174,
+        .d_current_d_current = 135488,
+        .d_angle_d_voltage = 171185978,
+        .d_speed_d_voltage = 119882,
+        .d_current_d_voltage = 144812,
+        .d_angle_d_torque = -22874160,
+        .d_speed_d_torque = -22916,
+        .d_current_d_torque = 4656518,
+        .d_voltage_d_torque = 133763,
+        .d_torque_d_voltage = 2872,
+        .d_torque_d_speed = 1919,
+        .d_torque_d_acceleration = 3997,
+        .torque_friction = 23239,
+    },
+    // 10 ms
+    {
+        .d_angle_d_speed = 90972,
+        .d_speed_d_speed = 997,
+        .d_current_d_speed = -51389,
+        .d_angle_d_current = 3066469,
+        .d_speed_d_current = 23468,
+        .d_current_d_current = -9848606,
+        .d_angle_d_voltage = 2259531,
+        .d_speed_d_voltage = 9199,
+        .d_current_d_voltage = 76935,
+        .d_angle_d_torque = -943439,
+        .d_speed_d_torque = -4841,
+        .d_current_d_torque = 357331,
+        .d_voltage_d_torque = 133763,
+        .d_torque_d_voltage = 2872,
+        .d_torque_d_speed = 1919,
+        .d_torque_d_acceleration = 3997,
+        .torque_friction = 23239,
+    },
+};
+
+static const pbio_observer_model_t model_interactive_runtime[] = {
+    // 1 ms
+    {
+        .d_angle_d_speed = 862626,
+        .d_speed_d_speed = 870,
+        .d_current_d_speed = -307455,
+        .d_angle_d_current = 47963924,
+        .d_speed_d_current = 34765,
+        .d_current_d_current = 1679091,
+        .d_angle_d_voltage = 179991081,
+        .d_speed_d_voltage = 71946,
+        .d_current_d_voltage = 345866,
+        .d_angle_d_torque = -17781360,
+        .d_speed_d_torque = -8912,
+        .d_current_d_torque = 4382277,
+        .d_voltage_d_torque = 32225,
+        .d_torque_d_voltage = 11923,
+        .d_torque_d_speed = 10599,
+        .d_torque_d_acceleration = 20588,
+        .torque_friction = 11227,
+    },
+    // 2 ms
+    {
+        .d_angle_d_speed = 435143,
+        .d_speed_d_speed = 887,
+        .d_current_d_speed = -298727,
+        .d_angle_d_current = 19861665,
+        .d_speed_d_current = 33778,
+        .d_current_d_current = -18220678,
+        .d_angle_d_voltage = 34186416,
+        .d_speed_d_voltage = 29793,
+        .d_current_d_voltage = 336048,
+        .d_angle_d_torque = -4469365,
+        .d_speed_d_torque = -4495,
+        .d_current_d_torque = 1814683,
+        .d_voltage_d_torque = 32225,
+        .d_torque_d_voltage = 11923,
+        .d_torque_d_speed = 10599,
+        .d_torque_d_acceleration = 20588,
+        .torque_friction = 11227,
+    },
+    // 10 ms
+    {
+        .d_angle_d_speed = 93950,
+        .d_speed_d_speed = 1038,
+        .d_current_d_speed = -348955,
+        .d_angle_d_current = 3704295,
+        .d_speed_d_current = 39457,
+        .d_current_d_current = -13260032,
+        .d_angle_d_voltage = 1112669,
+        .d_speed_d_voltage = 5556,
+        .d_current_d_voltage = 392551,
+        .d_angle_d_torque = -187981,
+        .d_speed_d_torque = -971,
+        .d_current_d_torque = 338447,
+        .d_voltage_d_torque = 32225,
+        .d_torque_d_voltage = 11923,
+        .d_torque_d_speed = 10599,
+        .d_torque_d_acceleration = 20588,
+        .torque_friction = 11227,
+    },
+};
+
+static const pbio_observer_model_t model_technic_l_runtime[] = {
+    // 1 ms
+    {
+        .d_angle_d_speed = 859560,
+        .d_speed_d_speed = 862,
+        .d_current_d_speed = -266467,
+        .d_angle_d_current = 66711731,
+        .d_speed_d_current = 37991,
+        .d_current_d_current = 166549,
+        .d_angle_d_voltage = 422435061,
+        .d_speed_d_voltage = 150102,
+        .d_current_d_voltage = 238123,
+        .d_angle_d_torque = -33982171,
+        .d_speed_d_torque = -17006,
+        .d_current_d_torque = 9257414,
+        .d_voltage_d_torque = 62889,
+        .d_torque_d_voltage = 6110,
+        .d_torque_d_speed = 6837,
+        .d_torque_d_acceleration = 10751,
+        .torque_friction = 26430,
+    },
+    // 2 ms
+    {
+        .d_angle_d_speed = 431629,
+        .d_speed_d_speed = 872,
+        .d_current_d_speed = -187035,
+        .d_angle_d_current = 20961376,
+        .d_speed_d_current = 26666,
+        .d_current_d_current = 400664,
+        .d_angle_d_voltage = 62930332,
+        .d_speed_d_voltage = 47163,
+        .d_current_d_voltage = 167140,
+        .d_angle_d_torque = -8515365,
+        .d_speed_d_torque = -8540,
+        .d_current_d_torque = 2908756,
+        .d_voltage_d_torque = 62889,
+        .d_torque_d_voltage = 6110,
+        .d_torque_d_speed = 6837,
+        .d_torque_d_acceleration = 10751,
+        .torque_friction = 26430,
+    },
+    // 10 ms
+    {
+        .d_angle_d_speed = 91334,
+        .d_speed_d_speed = 989,
+        .d_current_d_speed = -170232,
+        .d_angle_d_current = 2575585,
+        .d_speed_d_current = 24270,
+        .d_current_d_current = -4245458,
+        .d_angle_d_voltage = 1265482,
+        .d_speed_d_voltage = 5795,
+        .d_current_d_voltage = 152124,
+        .d_angle_d_torque = -352564,
+        .d_speed_d_torque = -1807,
+        .d_current_d_torque = 357407,
+        .d_voltage_d_torque = 62889,
+        .d_torque_d_voltage = 6110,
+        .d_torque_d_speed = 6837,
+        .d_torque_d_acceleration = 10751,
+        .torque_friction = 26430,
+    },
+};
+
+static const pbio_observer_model_t model_technic_xl_runtime[] = {
+    // 1 ms
+    {
+        .d_angle_d_speed = 860195,
+        .d_speed_d_speed = 864,
+        .d_current_d_speed = -222019,
+        .d_angle_d_current = 73910407,
+        .d_speed_d_current = 45293,
+        .d_current_d_current = 290329,
+        .d_angle_d_voltage = 301140412,
+        .d_speed_d_voltage = 110866,
+        .d_current_d_voltage = 198848,
+        .d_angle_d_torque = -31567879,
+        .d_speed_d_torque = -15803,
+        .d_current_d_torque = 6655883,
+        .d_voltage_d_torque = 55617,
+        .d_torque_d_voltage = 6908,
+        .d_torque_d_speed = 7713,
+        .d_torque_d_acceleration = 11578,
+        .torque_friction = 12893,
+    },
+    // 2 ms
+    {
+        .d_angle_d_speed = 432407,
+        .d_speed_d_speed = 875,
+        .d_current_d_speed = -179102,
+        .d_angle_d_current = 25714917,
+        .d_speed_d_current = 36538,
+        .d_current_d_current = 1309069,
+        .d_angle_d_voltage = 48759503,
+        .d_speed_d_voltage = 38573,
+        .d_current_d_voltage = 160410,
+        .d_angle_d_torque = -7915893,
+        .d_speed_d_torque = -7944,
+        .d_current_d_torque = 2315715,
+        .d_voltage_d_torque = 55617,
+        .d_torque_d_voltage = 6908,
+        .d_torque_d_speed = 7713,
+        .d_torque_d_acceleration = 11578,
+        .torque_friction = 12893,
+    },
+    // 10 ms
+    {
+        .d_angle_d_speed = 91585,
+        .d_speed_d_speed = 989,
+        .d_current_d_speed = -188901,
+        .d_angle_d_current = 3871393,
+        .d_speed_d_current = 38537,
+        .d_current_d_current = -7362525,
+        .d_angle_d_voltage = 1216669,
+        .d_speed_d_voltage = 5807,
+        .d_current_d_voltage = 169186,
+        .d_angle_d_torque = -328364,
+        .d_speed_d_torque = -1683,
+        .d_current_d_torque = 348632,
+        .d_voltage_d_torque = 55617,
+        .d_torque_d_voltage = 6908,
+        .d_torque_d_speed = 7713,
+        .d_torque_d_acceleration = 11578,
+        .torque_friction = 12893,
+    },
+};
+
+#endif // PBIO_CONFIG_CONTROL_LOOP_TIME_RUNTIME
+
 #if PBIO_CONFIG_SERVO_PUP_MOVE_HUB
 
 static const pbio_observer_model_t model_movehub = {
@@ -241,6 +624,9 @@ static const pbio_servo_settings_reduced_t servo_settings_reduced[] = {
     {
         .id = PBDRV_LEGODEV_TYPE_ID_INTERACTIVE_MOTOR,
         .model = &model_interactive,
+        #if PBIO_CONFIG_CONTROL_LOOP_TIME_RUNTIME
+        .models_runtime = model_interactive_runtime,
+        #endif
         .rated_max_speed = 1000,
         .feedback_gain_low = 45,
         .precision_profile = 12,
@@ -249,6 +635,9 @@ static const pbio_servo_settings_reduced_t servo_settings_reduced[] = {
     {
         .id = PBDRV_LEGODEV_TYPE_ID_TECHNIC_L_MOTOR,
         .model = &model_technic_l,
+        #if PBIO_CONFIG_CONTROL_LOOP_TIME_RUNTIME
+        .models_runtime = model_technic_l_runtime,
+        #endif
         .rated_max_speed = 1500,
         .feedback_gain_low = 45,
         .precision_profile = 20,
@@ -257,6 +646,9 @@ static const pbio_servo_settings_reduced_t servo_settings_reduced[] = {
     {
         .id = PBDRV_LEGODEV_TYPE_ID_TECHNIC_XL_MOTOR,
         .model = &model_technic_xl,
+        #if PBIO_CONFIG_CONTROL_LOOP_TIME_RUNTIME
+        .models_runtime = model_technic_xl_runtime,
+        #endif
         .rated_max_speed = 1500,
         .feedback_gain_low = 45,
         .precision_profile = 20,
@@ -265,6 +657,9 @@ static const pbio_servo_settings_reduced_t servo_settings_reduced[] = {
     {
         .id = PBDRV_LEGODEV_TYPE_ID_SPIKE_S_MOTOR,
         .model = &model_technic_s_angular,
+        #if PBIO_CONFIG_CONTROL_LOOP_TIME_RUNTIME
+        .models_runtime = model_technic_s_angular_runtime,
+        #endif
         .rated_max_speed = 620,
         .feedback_gain_low = 30,
         .precision_profile = 11,
@@ -273,6 +668,9 @@ static const pbio_servo_settings_reduced_t servo_settings_reduced[] = {
     {
         .id = PBDRV_LEGODEV_TYPE_ID_TECHNIC_L_ANGULAR_MOTOR,
         .model = &model_technic_l_angular,
+        #if PBIO_CONFIG_CONTROL_LOOP_TIME_RUNTIME
+        .models_runtime = model_technic_l_angular_runtime,
+        #endif
         .rated_max_speed = 1000,
         .feedback_gain_low = 45,
         .precision_profile = 11,
@@ -281,6 +679,9 @@ static const pbio_servo_settings_reduced_t servo_settings_reduced[] = {
     {
         .id = PBDRV_LEGODEV_TYPE_ID_TECHNIC_M_ANGULAR_MOTOR,
         .model = &model_technic_m_angular,
+        #if PBIO_CONFIG_CONTROL_LOOP_TIME_RUNTIME
+        .models_runtime = model_technic_m_angular_runtime,
+        #endif
         .rated_max_speed = 1000,
         .feedback_gain_low = 45,
         .precision_profile = 11,
@@ -329,4 +730,36 @@ const pbio_servo_settings_reduced_t *pbio_servo_get_reduced_settings(pbdrv_legod
     return NULL;
 }
 
+/**
+ * Gets the model for a motor type, discretized for the given loop time.
+ *
+ * @param [in]   settings      Reduced settings of the motor type.
+ * @param [in]   loop_time     Time between control updates (ms).
+ * @param [out]  model         The model for this loop time.
+ * @return                     ::PBIO_ERROR_NOT_SUPPORTED if there is no model
+ *                             for this loop time, otherwise ::PBIO_SUCCESS.
+ */
+pbio_error_t pbio_servo_get_model(const pbio_servo_settings_reduced_t *settings, uint32_t loop_time, const pbio_observer_model_t **model) {
+
+    uint8_t index;
+    if (pbio_control_settings_get_loop_time_index(loop_time, &index) != PBIO_SUCCESS) {
+        return PBIO_ERROR_NOT_SUPPORTED;
+    }
+
+    // The default loop time is always available.
+    if (index == 0) {
+        *model = settings->model;
+        return PBIO_SUCCESS;
+    }
+
+    #if PBIO_CONFIG_CONTROL_LOOP_TIME_RUNTIME
+    if (settings->models_runtime) {
+        *model = &settings->models_runtime[index - 1];
+        return PBIO_SUCCESS;
+    }
+    #endif
+
+    return PBIO_ERROR_NOT_SUPPORTED;
+}
+
 #endif // PBIO_CONFIG_SERVO
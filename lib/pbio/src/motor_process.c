@@ -1,15 +1,157 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2023 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
+
+#include <stdint.h>
+#include <string.h>
+
+#include <pbdrv/clock.h>
 
 #include <pbio/battery.h>
 #include <pbio/control.h>
 #include <pbio/drivebase.h>
+#include <pbio/motor_process.h>
 #include <pbio/servo.h>
 
 #include <contiki.h>
 
 #if PBIO_CONFIG_MOTOR_PROCESS != 0
 
+// Time between control loop updates (ms).
+static uint32_t loop_time = PBIO_CONFIG_CONTROL_LOOP_TIME_MS;
+
+/**
+ * Gets the time between two control loop updates.
+ *
+ * @return              Time between updates (ms).
+ */
+uint32_t pbio_motor_process_get_loop_time(void) {
+    return loop_time;
+}
+
+#if PBIO_CONFIG_CONTROL_LOOP_TIME_RUNTIME
+
+/**
+ * Sets the time between two control loop updates.
+ *
+ * Servos and drive bases that are running are updated to use the new loop
+ * time. Nothing is changed if any servo does not support it.
+ *
+ * @param [in]  time    Time between updates (ms).
+ * @return              ::PBIO_ERROR_INVALID_ARG if this loop time is not
+ *                      supported at all, ::PBIO_ERROR_NOT_SUPPORTED if not
+ *                      supported by one of the servos, else ::PBIO_SUCCESS.
+ */
+pbio_error_t pbio_motor_process_set_loop_time(uint32_t time) {
+
+    uint8_t index;
+    pbio_error_t err = pbio_control_settings_get_loop_time_index(time, &index);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    err = pbio_servo_set_loop_time_all(time);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+    pbio_drivebase_set_loop_time_all(time);
+
+    // The motor process picks this up after the next update.
+    loop_time = time;
+    return PBIO_SUCCESS;
+}
+
+#endif // PBIO_CONFIG_CONTROL_LOOP_TIME_RUNTIME
+
+#if PBIO_CONFIG_MOTOR_PROCESS_STATS
+
+static pbio_motor_process_stats_t stats;
+
+// Start time of the previous update, used to get the update period.
+static uint32_t stats_update_start;
+
+/**
+ * Gets the timing statistics of the motor process.
+ *
+ * @return              The statistics.
+ */
+const pbio_motor_process_stats_t *pbio_motor_process_get_stats(void) {
+    return &stats;
+}
+
+/**
+ * Resets the timing statistics of the motor process.
+ */
+void pbio_motor_process_reset_stats(void) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+static void pbio_motor_process_stats_add_to_histogram(uint32_t *histogram, uint32_t time) {
+    uint32_t bin = 0;
+    for (time /= PBIO_MOTOR_PROCESS_STATS_BIN_US; time && bin < PBIO_MOTOR_PROCESS_STATS_NUM_BINS - 1; time >>= 1) {
+        bin++;
+    }
+    histogram[bin]++;
+}
+
+/**
+ * Records the start of an update.
+ *
+ * @return              The current time (us).
+ */
+static uint32_t pbio_motor_process_stats_start(void) {
+    uint32_t now = pbdrv_clock_get_us();
+
+    // The first update has no previous update to get the period from.
+    if (stats.num_updates++ > 0) {
+        uint32_t period = now - stats_update_start;
+        uint32_t nominal = loop_time * 1000;
+        uint32_t jitter = period > nominal ? period - nominal : nominal - period;
+        if (jitter > stats.jitter_max) {
+            stats.jitter_max = jitter;
+        }
+        pbio_motor_process_stats_add_to_histogram(stats.jitter_histogram, jitter);
+    }
+    stats_update_start = now;
+    return now;
+}
+
+/**
+ * Records the end of one update stage.
+ *
+ * @param [in]  stage   The stage that just completed.
+ * @param [in]  start   The time at which the stage started (us).
+ * @return              The current time (us), which is the start of the next stage.
+ */
+static uint32_t pbio_motor_process_stats_stage_done(pbio_motor_process_stage_t stage, uint32_t start) {
+    uint32_t now = pbdrv_clock_get_us();
+    uint32_t time = now - start;
+    stats.stage_time_total[stage] += time;
+    if (time > stats.stage_time_max[stage]) {
+        stats.stage_time_max[stage] = time;
+    }
+    pbio_motor_process_stats_add_to_histogram(stats.stage_histogram[stage], time);
+    return now;
+}
+
+static void pbio_motor_process_stats_overrun(void) {
+    stats.num_overruns++;
+}
+
+#else // PBIO_CONFIG_MOTOR_PROCESS_STATS
+
+static inline uint32_t pbio_motor_process_stats_start(void) {
+    return 0;
+}
+
+static inline uint32_t pbio_motor_process_stats_stage_done(pbio_motor_process_stage_t stage, uint32_t start) {
+    return 0;
+}
+
+static inline void pbio_motor_process_stats_overrun(void) {
+}
+
+#endif // PBIO_CONFIG_MOTOR_PROCESS_STATS
+
 PROCESS(pbio_motor_process, "servo");
 
 PROCESS_THREAD(pbio_motor_process, ev, data) {
@@ -23,19 +165,24 @@ PROCESS_THREAD(pbio_motor_process, ev, data) {
     // Initialize motors in stopped state.
     pbio_dcmotor_stop_all(true);
 
-    etimer_set(&timer, PBIO_CONFIG_CONTROL_LOOP_TIME_MS);
+    etimer_set(&timer, loop_time);
 
     for (;;) {
         PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER && etimer_expired(&timer));
 
+        uint32_t stage_start = pbio_motor_process_stats_start();
+
         // Update battery voltage.
         pbio_battery_update();
+        stage_start = pbio_motor_process_stats_stage_done(PBIO_MOTOR_PROCESS_STAGE_BATTERY, stage_start);
 
         // Update drivebase
         pbio_drivebase_update_all();
+        stage_start = pbio_motor_process_stats_stage_done(PBIO_MOTOR_PROCESS_STAGE_DRIVEBASE, stage_start);
 
         // Update servos
         pbio_servo_update_all();
+        pbio_motor_process_stats_stage_done(PBIO_MOTOR_PROCESS_STAGE_SERVO, stage_start);
 
         clock_time_t now = clock_time();
 
@@ -43,13 +190,16 @@ PROCESS_THREAD(pbio_motor_process, ev, data) {
         // poll is a minimum of 1ms in the future. If we don't, the poll loop
         // will not yield until and the next update will be called with a 0 time
         // diff which causes issues.
-        if (now - etimer_start_time(&timer) >= 2 * PBIO_CONFIG_CONTROL_LOOP_TIME_MS) {
-            timer.timer.start = now - (PBIO_CONFIG_CONTROL_LOOP_TIME_MS - 1);
+        if (now - etimer_start_time(&timer) >= 2 * loop_time) {
+            timer.timer.start = now - (loop_time - 1);
+            pbio_motor_process_stats_overrun();
         }
 
         // Reset timer to wait for next update. Using etimer_reset() instead
         // of etimer_restart() makes average update period closer to the expected
-        // PBIO_CONFIG_CONTROL_LOOP_TIME_MS when occasional delays occur.
+        // loop time when occasional delays occur. The interval is updated
+        // here in case the loop time was changed.
+        timer.timer.interval = loop_time;
         etimer_reset(&timer);
     }
 
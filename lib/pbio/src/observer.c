@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2019-2023 The Pybricks Authors
+// Copyright (c) 2019-2024 The Pybricks Authors
 
 // SPDX-License-Identifier: BSD-3-Clause
 // Copyright (c) 2020-2023 LEGO System A/S
@@ -15,18 +15,6 @@
 #include <pbio/observer.h>
 #include <pbio/trajectory.h>
 
-// Values generated by pbio/doc/control/model.py
-#define MAX_NUM_SPEED (2500000)
-#define MAX_NUM_ACCELERATION (25000000)
-#define MAX_NUM_CURRENT (30000)
-#define MAX_NUM_VOLTAGE (12000)
-#define MAX_NUM_TORQUE (1000000)
-#define PRESCALE_SPEED (858)
-#define PRESCALE_ACCELERATION (85)
-#define PRESCALE_CURRENT (71582)
-#define PRESCALE_VOLTAGE (178956)
-#define PRESCALE_TORQUE (2147)
-
 /**
  * Resets the observer to a new angle. Speed and current are reset to zero.
  *
@@ -47,6 +35,21 @@ void pbio_observer_reset(pbio_observer_t *obs, const pbio_angle_t *angle) {
     pbio_differentiator_reset(&obs->differentiator, angle);
 }
 
+/**
+ * Sets the model and the time between observer updates.
+ *
+ * @param [in]  obs            The observer instance.
+ * @param [in]  model          Model discretized for the given loop time.
+ * @param [in]  loop_time      Time between observer updates (ms).
+ */
+void pbio_observer_set_model(pbio_observer_t *obs, const pbio_observer_model_t *model, uint32_t loop_time) {
+    obs->model = model;
+    #if PBIO_CONFIG_OBSERVER_RECIPROCAL
+    pbio_observer_model_get_reciprocal(model, &obs->reciprocal);
+    #endif
+    pbio_differentiator_set_loop_time(&obs->differentiator, loop_time);
+}
+
 /**
  * Gets the observer state, which is the estimated state of the real system.
  *
@@ -138,7 +141,7 @@ int32_t pbio_observer_get_feedback_voltage(const pbio_observer_t *obs, const pbi
     int32_t feedback_voltage_abs = pbio_observer_get_feedback_voltage_abs(pbio_int_math_abs(error), &obs->settings);
 
     // Sign and clamp the feedback voltage.
-    return pbio_int_math_clamp(feedback_voltage_abs * pbio_int_math_sign(error), MAX_NUM_VOLTAGE);
+    return pbio_int_math_clamp(feedback_voltage_abs * pbio_int_math_sign(error), PBIO_OBSERVER_MAX_NUM_VOLTAGE);
 }
 
 /**
@@ -165,7 +168,7 @@ void pbio_observer_update(pbio_observer_t *obs, uint32_t time, const pbio_angle_
 
     // The observer will get the applied voltage plus the feedback voltage to
     // keep it in sync with the real system.
-    int32_t model_voltage = pbio_int_math_clamp(voltage + feedback_voltage, MAX_NUM_VOLTAGE);
+    int32_t model_voltage = pbio_int_math_clamp(voltage + feedback_voltage, PBIO_OBSERVER_MAX_NUM_VOLTAGE);
 
     // Modified coulomb friction with transition linear in speed through origin.
     int32_t coulomb_friction = pbio_int_math_sign(obs->speed) * (
@@ -181,27 +184,52 @@ void pbio_observer_update(pbio_observer_t *obs, uint32_t time, const pbio_angle_
     // This model assumes that the actuation mode is a voltage. If the real
     // mode is coast, back EMF is slightly overestimated, but an accurate
     // speed value is typically not needed in that use case.
+    #if PBIO_CONFIG_OBSERVER_RECIPROCAL
+    const pbio_observer_model_reciprocal_t *q = &obs->reciprocal;
+    pbio_angle_add_mdeg(&obs->angle,
+        pbio_observer_reciprocal_scale(&q->d_angle_d_speed, obs->speed) +
+        pbio_observer_reciprocal_scale(&q->d_angle_d_current, obs->current) +
+        pbio_observer_reciprocal_scale(&q->d_angle_d_voltage, model_voltage) +
+        pbio_observer_reciprocal_scale(&q->d_angle_d_torque, torque));
+    int32_t speed_next = pbio_int_math_clamp(0 +
+        pbio_observer_reciprocal_scale(&q->d_speed_d_speed, obs->speed) +
+        pbio_observer_reciprocal_scale(&q->d_speed_d_current, obs->current) +
+        pbio_observer_reciprocal_scale(&q->d_speed_d_voltage, model_voltage) +
+        pbio_observer_reciprocal_scale(&q->d_speed_d_torque, torque), PBIO_OBSERVER_MAX_NUM_SPEED);
+    int32_t current_next = pbio_int_math_clamp(0 +
+        pbio_observer_reciprocal_scale(&q->d_current_d_speed, obs->speed) +
+        pbio_observer_reciprocal_scale(&q->d_current_d_current, obs->current) +
+        pbio_observer_reciprocal_scale(&q->d_current_d_voltage, model_voltage) +
+        pbio_observer_reciprocal_scale(&q->d_current_d_torque, torque), PBIO_OBSERVER_MAX_NUM_CURRENT);
+
+    // In case of a speed transition through zero, undo (subtract) the effect
+    // of friction, to avoid inducing chatter in the speed signal.
+    if ((obs->speed < 0) != (speed_next < 0)) {
+        speed_next -= pbio_observer_reciprocal_scale(&q->d_speed_d_torque, coulomb_friction);
+    }
+    #else
     pbio_angle_add_mdeg(&obs->angle,
-        PRESCALE_SPEED * obs->speed / m->d_angle_d_speed +
-        PRESCALE_CURRENT * obs->current / m->d_angle_d_current +
-        PRESCALE_VOLTAGE * model_voltage / m->d_angle_d_voltage +
-        PRESCALE_TORQUE * torque / m->d_angle_d_torque);
+        PBIO_OBSERVER_PRESCALE_SPEED * obs->speed / m->d_angle_d_speed +
+        PBIO_OBSERVER_PRESCALE_CURRENT * obs->current / m->d_angle_d_current +
+        PBIO_OBSERVER_PRESCALE_VOLTAGE * model_voltage / m->d_angle_d_voltage +
+        PBIO_OBSERVER_PRESCALE_TORQUE * torque / m->d_angle_d_torque);
     int32_t speed_next = pbio_int_math_clamp(0 +
-        PRESCALE_SPEED * obs->speed / m->d_speed_d_speed +
-        PRESCALE_CURRENT * obs->current / m->d_speed_d_current +
-        PRESCALE_VOLTAGE * model_voltage / m->d_speed_d_voltage +
-        PRESCALE_TORQUE * torque / m->d_speed_d_torque, MAX_NUM_SPEED);
+        PBIO_OBSERVER_PRESCALE_SPEED * obs->speed / m->d_speed_d_speed +
+        PBIO_OBSERVER_PRESCALE_CURRENT * obs->current / m->d_speed_d_current +
+        PBIO_OBSERVER_PRESCALE_VOLTAGE * model_voltage / m->d_speed_d_voltage +
+        PBIO_OBSERVER_PRESCALE_TORQUE * torque / m->d_speed_d_torque, PBIO_OBSERVER_MAX_NUM_SPEED);
     int32_t current_next = pbio_int_math_clamp(0 +
-        PRESCALE_SPEED * obs->speed / m->d_current_d_speed +
-        PRESCALE_CURRENT * obs->current / m->d_current_d_current +
-        PRESCALE_VOLTAGE * model_voltage / m->d_current_d_voltage +
-        PRESCALE_TORQUE * torque / m->d_current_d_torque, MAX_NUM_CURRENT);
+        PBIO_OBSERVER_PRESCALE_SPEED * obs->speed / m->d_current_d_speed +
+        PBIO_OBSERVER_PRESCALE_CURRENT * obs->current / m->d_current_d_current +
+        PBIO_OBSERVER_PRESCALE_VOLTAGE * model_voltage / m->d_current_d_voltage +
+        PBIO_OBSERVER_PRESCALE_TORQUE * torque / m->d_current_d_torque, PBIO_OBSERVER_MAX_NUM_CURRENT);
 
     // In case of a speed transition through zero, undo (subtract) the effect
     // of friction, to avoid inducing chatter in the speed signal.
     if ((obs->speed < 0) != (speed_next < 0)) {
-        speed_next -= PRESCALE_TORQUE * coulomb_friction / m->d_speed_d_torque;
+        speed_next -= PBIO_OBSERVER_PRESCALE_TORQUE * coulomb_friction / m->d_speed_d_torque;
     }
+    #endif // PBIO_CONFIG_OBSERVER_RECIPROCAL
 
     // Save new state.
     obs->speed = speed_next;
@@ -227,6 +255,58 @@ bool pbio_observer_is_stalled(const pbio_observer_t *obs, uint32_t time, uint32_
     return false;
 }
 
+/**
+ * Computes the Q-format multiplier and shift for scaling by a fraction.
+ *
+ * The multiplier is rounded up and gets 32 significant bits. Each PBIO_OBSERVER_PRESCALE_*
+ * value times its PBIO_OBSERVER_MAX_NUM_* limit is less than 2^31, so scaling rounds the
+ * same way as dividing for all values the observer model uses. This uses
+ * 64-bit divisions, so it should be done only once per model, not for each
+ * update.
+ *
+ * @param [out] reciprocal      The scale factor.
+ * @param [in]  numerator       Numerator of the scale factor.
+ * @param [in]  denominator     Nonzero denominator of the scale factor.
+ */
+void pbio_observer_reciprocal_init(pbio_observer_reciprocal_t *reciprocal, int32_t numerator, int32_t denominator) {
+
+    uint64_t n = pbio_int_math_abs(numerator);
+    uint64_t d = pbio_int_math_abs(denominator);
+    uint32_t shift = 0;
+
+    // Use as many fractional bits as fit in the multiplier.
+    while (n != 0 && (n << (shift + 1)) < (UINT64_C(1) << 62) &&
+           ((n << (shift + 1)) + d - 1) / d <= UINT32_MAX) {
+        shift++;
+    }
+
+    reciprocal->multiplier = (uint32_t)(((n << shift) + d - 1) / d);
+    reciprocal->shift = shift;
+    reciprocal->negative = (numerator < 0) != (denominator < 0);
+}
+
+/**
+ * Gets the observer update terms of a model as reciprocals, so that the
+ * update can be done without dividing.
+ *
+ * @param [in]  model           The observer model.
+ * @param [out] reciprocal      The model terms.
+ */
+void pbio_observer_model_get_reciprocal(const pbio_observer_model_t *model, pbio_observer_model_reciprocal_t *reciprocal) {
+    pbio_observer_reciprocal_init(&reciprocal->d_angle_d_speed, PBIO_OBSERVER_PRESCALE_SPEED, model->d_angle_d_speed);
+    pbio_observer_reciprocal_init(&reciprocal->d_speed_d_speed, PBIO_OBSERVER_PRESCALE_SPEED, model->d_speed_d_speed);
+    pbio_observer_reciprocal_init(&reciprocal->d_current_d_speed, PBIO_OBSERVER_PRESCALE_SPEED, model->d_current_d_speed);
+    pbio_observer_reciprocal_init(&reciprocal->d_angle_d_current, PBIO_OBSERVER_PRESCALE_CURRENT, model->d_angle_d_current);
+    pbio_observer_reciprocal_init(&reciprocal->d_speed_d_current, PBIO_OBSERVER_PRESCALE_CURRENT, model->d_speed_d_current);
+    pbio_observer_reciprocal_init(&reciprocal->d_current_d_current, PBIO_OBSERVER_PRESCALE_CURRENT, model->d_current_d_current);
+    pbio_observer_reciprocal_init(&reciprocal->d_angle_d_voltage, PBIO_OBSERVER_PRESCALE_VOLTAGE, model->d_angle_d_voltage);
+    pbio_observer_reciprocal_init(&reciprocal->d_speed_d_voltage, PBIO_OBSERVER_PRESCALE_VOLTAGE, model->d_speed_d_voltage);
+    pbio_observer_reciprocal_init(&reciprocal->d_current_d_voltage, PBIO_OBSERVER_PRESCALE_VOLTAGE, model->d_current_d_voltage);
+    pbio_observer_reciprocal_init(&reciprocal->d_angle_d_torque, PBIO_OBSERVER_PRESCALE_TORQUE, model->d_angle_d_torque);
+    pbio_observer_reciprocal_init(&reciprocal->d_speed_d_torque, PBIO_OBSERVER_PRESCALE_TORQUE, model->d_speed_d_torque);
+    pbio_observer_reciprocal_init(&reciprocal->d_current_d_torque, PBIO_OBSERVER_PRESCALE_TORQUE, model->d_current_d_torque);
+}
+
 /**
  * Gets the maximum torque for use by user input validators.
  *
@@ -234,7 +314,7 @@ bool pbio_observer_is_stalled(const pbio_observer_t *obs, uint32_t time, uint32_
  *
 */
 int32_t pbio_observer_get_max_torque(void) {
-    return MAX_NUM_TORQUE;
+    return PBIO_OBSERVER_MAX_NUM_TORQUE;
 }
 
 /**
@@ -250,11 +330,11 @@ int32_t pbio_observer_get_max_torque(void) {
 int32_t pbio_observer_get_feedforward_torque(const pbio_observer_model_t *model, int32_t rate_ref, int32_t acceleration_ref) {
 
     int32_t friction_compensation_torque = model->torque_friction / 2 * pbio_int_math_sign(rate_ref);
-    int32_t back_emf_compensation_torque = PRESCALE_SPEED * pbio_int_math_clamp(rate_ref, MAX_NUM_SPEED) / model->d_torque_d_speed;
-    int32_t acceleration_torque = PRESCALE_ACCELERATION * pbio_int_math_clamp(acceleration_ref, MAX_NUM_ACCELERATION) / model->d_torque_d_acceleration;
+    int32_t back_emf_compensation_torque = PBIO_OBSERVER_PRESCALE_SPEED * pbio_int_math_clamp(rate_ref, PBIO_OBSERVER_MAX_NUM_SPEED) / model->d_torque_d_speed;
+    int32_t acceleration_torque = PBIO_OBSERVER_PRESCALE_ACCELERATION * pbio_int_math_clamp(acceleration_ref, PBIO_OBSERVER_MAX_NUM_ACCELERATION) / model->d_torque_d_acceleration;
 
     // Total feedforward torque
-    return pbio_int_math_clamp(friction_compensation_torque + back_emf_compensation_torque + acceleration_torque, MAX_NUM_TORQUE);
+    return pbio_int_math_clamp(friction_compensation_torque + back_emf_compensation_torque + acceleration_torque, PBIO_OBSERVER_MAX_NUM_TORQUE);
 }
 
 /**
@@ -265,7 +345,7 @@ int32_t pbio_observer_get_feedforward_torque(const pbio_observer_model_t *model,
  * @returns                         The voltage in mV.
 */
 int32_t pbio_observer_torque_to_voltage(const pbio_observer_model_t *model, int32_t desired_torque) {
-    return PRESCALE_TORQUE * pbio_int_math_clamp(desired_torque, MAX_NUM_TORQUE) / model->d_voltage_d_torque;
+    return PBIO_OBSERVER_PRESCALE_TORQUE * pbio_int_math_clamp(desired_torque, PBIO_OBSERVER_MAX_NUM_TORQUE) / model->d_voltage_d_torque;
 }
 
 /**
@@ -276,5 +356,5 @@ int32_t pbio_observer_torque_to_voltage(const pbio_observer_model_t *model, int3
  * @returns                         The torque in uNm.
 */
 int32_t pbio_observer_voltage_to_torque(const pbio_observer_model_t *model, int32_t voltage) {
-    return PRESCALE_VOLTAGE * pbio_int_math_clamp(voltage, MAX_NUM_VOLTAGE) / model->d_torque_d_voltage;
+    return PBIO_OBSERVER_PRESCALE_VOLTAGE * pbio_int_math_clamp(voltage, PBIO_OBSERVER_MAX_NUM_VOLTAGE) / model->d_torque_d_voltage;
 }
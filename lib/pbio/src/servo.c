@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2023 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 // SPDX-License-Identifier: BSD-3-Clause
 // Copyright (c) 2020-2023 LEGO System A/S
@@ -14,6 +14,7 @@
 
 #include <pbio/angle.h>
 #include <pbio/int_math.h>
+#include <pbio/motor_process.h>
 #include <pbio/observer.h>
 #include <pbio/parent.h>
 #include <pbio/servo.h>
@@ -174,6 +175,12 @@ void pbio_servo_update_all(void) {
     for (uint8_t i = 0; i < PBIO_CONFIG_SERVO_NUM_DEV; i++) {
         pbio_servo_t *srv = &servos[i];
 
+        // Skip this servo if it is not yet due for an update.
+        if (++srv->decimation_count < srv->decimation) {
+            continue;
+        }
+        srv->decimation_count = 0;
+
         // Run update loop only if registered.
         if (srv->run_update_loop) {
             err = pbio_servo_update(srv);
@@ -222,6 +229,20 @@ static pbio_error_t pbio_servo_stop_from_dcmotor(void *servo, bool clear_parent)
 
 #define DEG_TO_MDEG(deg) ((deg) * 1000)
 
+/**
+ * Applies a new time between servo updates.
+ *
+ * @param [in]  srv         The servo instance.
+ * @param [in]  model       Model discretized for the given loop time.
+ * @param [in]  loop_time   Time between servo updates (ms).
+ */
+static void pbio_servo_apply_loop_time(pbio_servo_t *srv, const pbio_observer_model_t *model, uint32_t loop_time) {
+    srv->control.settings.loop_time = loop_time;
+    pbio_observer_set_model(&srv->observer, model, loop_time);
+    pbio_logger_set_loop_time(&srv->log, loop_time);
+    pbio_logger_set_loop_time(&srv->control.log, loop_time);
+}
+
 /**
  * Loads all parameters of a servo to make it ready for use.
  *
@@ -255,8 +276,17 @@ static pbio_error_t pbio_servo_initialize_settings(pbio_servo_t *srv, pbdrv_lego
         return PBIO_ERROR_INVALID_ARG;
     }
 
+    // Get the model for the current loop time of this servo.
+    const pbio_observer_model_t *model;
+    uint32_t loop_time = pbio_motor_process_get_loop_time() * srv->decimation;
+    pbio_error_t err = pbio_servo_get_model(settings_reduced, loop_time, &model);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
     // Save reference to motor model.
-    srv->observer.model = settings_reduced->model;
+    srv->settings_reduced = settings_reduced;
+    srv->observer.model = model;
 
     // Initialize maximum torque as the stall torque for maximum voltage.
     // In practice, the nominal voltage is a bit lower than the 9V values.
@@ -300,6 +330,7 @@ static pbio_error_t pbio_servo_initialize_settings(pbio_servo_t *srv, pbdrv_lego
         .integral_deadzone = DEG_TO_MDEG(8),
         .integral_change_max = DEG_TO_MDEG(15),
         .smart_passive_hold_time = pbio_control_time_ms_to_ticks(100),
+        .loop_time = loop_time,
     };
 
     // Initialize all observer settings.
@@ -314,6 +345,8 @@ static pbio_error_t pbio_servo_initialize_settings(pbio_servo_t *srv, pbdrv_lego
         .coulomb_friction_speed_cutoff = 500,
     };
 
+    pbio_servo_apply_loop_time(srv, model, loop_time);
+
     return PBIO_SUCCESS;
 }
 
@@ -334,6 +367,10 @@ pbio_error_t pbio_servo_setup(pbio_servo_t *srv, pbdrv_legodev_type_id_t type, p
     // Unregister this servo from control loop updates.
     pbio_servo_update_loop_set_state(srv, false);
 
+    // Update on every control loop unless configured otherwise later.
+    srv->decimation = 1;
+    srv->decimation_count = 0;
+
     // Configure tacho.
     err = pbio_tacho_setup(srv->tacho, direction, reset_angle);
     if (err != PBIO_SUCCESS) {
@@ -728,6 +765,54 @@ pbio_error_t pbio_servo_run_target(pbio_servo_t *srv, int32_t speed, int32_t tar
     return pbio_control_start_position_control(&srv->control, time_now, &state, target, speed, on_completion);
 }
 
+#if PBIO_CONFIG_CONTROL_QUEUE
+/**
+ * Queues a target angle to run to after the ongoing run to a target angle.
+ *
+ * Consecutive targets in the same direction are blended so the servo does not
+ * stop in between. If the servo is not running to a target, this starts right
+ * away like pbio_servo_run_target().
+ *
+ * @param [in]  srv            The control instance.
+ * @param [in]  speed          Top angular velocity in degrees per second. The sign is ignored.
+ * @param [in]  target         Angle to run to.
+ * @param [in]  on_completion  What to do after reaching the target angle, if no other targets follow.
+ * @return                     ::PBIO_ERROR_INVALID_ARG if the speed is zero,
+ *                             ::PBIO_ERROR_BUSY if the queue is full,
+ *                             otherwise error code.
+ */
+pbio_error_t pbio_servo_queue_target(pbio_servo_t *srv, int32_t speed, int32_t target, pbio_control_on_completion_t on_completion) {
+
+    // Don't allow new user command if update loop not registered.
+    if (!pbio_servo_update_loop_is_running(srv)) {
+        return PBIO_ERROR_INVALID_OP;
+    }
+
+    // A queued move at zero speed would never start the next one.
+    if (speed == 0) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+
+    // Stop parent object that uses this motor, if any.
+    pbio_error_t err = pbio_parent_stop(&srv->parent, false);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    // Get current time
+    uint32_t time_now = pbio_control_get_time_ticks();
+
+    // Read the physical and estimated state
+    pbio_control_state_t state;
+    err = pbio_servo_get_state_control(srv, &state);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    return pbio_control_queue_position_control(&srv->control, time_now, &state, target, speed, on_completion);
+}
+#endif // PBIO_CONFIG_CONTROL_QUEUE
+
 /**
  * Runs the servo at a given speed by a given angle and stops there.
  *
@@ -897,4 +982,151 @@ pbio_error_t pbio_servo_get_load(pbio_servo_t *srv, int32_t *load) {
     return PBIO_SUCCESS;
 }
 
+/**
+ * Gets the time between two updates of this servo.
+ *
+ * @param [in]  srv         The servo instance.
+ * @return                  Time between updates (ms).
+ */
+uint32_t pbio_servo_get_loop_time(pbio_servo_t *srv) {
+    return srv->control.settings.loop_time;
+}
+
+/**
+ * Makes the servo update only once every given number of control loops.
+ *
+ * This saves processing time for motors that do not need the fastest
+ * control loop. Servos that are used by a drive base can not be decimated.
+ *
+ * @param [in]  srv         The servo instance.
+ * @param [in]  decimation  Number of control loops between two updates.
+ * @return                  ::PBIO_ERROR_BUSY if the servo is used by a drive
+ *                          base, ::PBIO_ERROR_NOT_SUPPORTED if there is no
+ *                          model for the resulting loop time, otherwise
+ *                          ::PBIO_SUCCESS.
+ */
+pbio_error_t pbio_servo_set_decimation(pbio_servo_t *srv, uint8_t decimation) {
+
+    if (decimation < 1) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+
+    if (pbio_parent_exists(&srv->parent)) {
+        return PBIO_ERROR_BUSY;
+    }
+
+    if (!pbio_servo_update_loop_is_running(srv)) {
+        return PBIO_ERROR_INVALID_OP;
+    }
+
+    const pbio_observer_model_t *model;
+    uint32_t loop_time = pbio_motor_process_get_loop_time() * decimation;
+    pbio_error_t err = pbio_servo_get_model(srv->settings_reduced, loop_time, &model);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    srv->decimation = decimation;
+
+    // Spread the updates of decimated servos over the control loops.
+    srv->decimation_count = (srv - servos) % decimation;
+
+    pbio_servo_apply_loop_time(srv, model, loop_time);
+
+    return PBIO_SUCCESS;
+}
+
+/**
+ * Makes the servo update on every control loop again.
+ *
+ * This is used by parent objects such as a drive base, which need their
+ * servos to be updated on every control loop. Unlike
+ * pbio_servo_set_decimation, this may be used while the servo has a parent.
+ *
+ * @param [in]  srv         The servo instance.
+ * @return                  ::PBIO_ERROR_NOT_SUPPORTED if there is no model
+ *                          for the current loop time, otherwise
+ *                          ::PBIO_SUCCESS.
+ */
+pbio_error_t pbio_servo_reset_decimation(pbio_servo_t *srv) {
+
+    // Nothing to do if the servo is already updated on every loop.
+    if (srv->decimation == 1) {
+        return PBIO_SUCCESS;
+    }
+
+    const pbio_observer_model_t *model;
+    uint32_t loop_time = pbio_motor_process_get_loop_time();
+    pbio_error_t err = pbio_servo_get_model(srv->settings_reduced, loop_time, &model);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    srv->decimation = 1;
+    srv->decimation_count = 0;
+    pbio_servo_apply_loop_time(srv, model, loop_time);
+
+    return PBIO_SUCCESS;
+}
+
+/**
+ * Makes all servos that are running update on every control loop again.
+ *
+ * This undoes pbio_servo_set_decimation, so that a new loop time can be
+ * applied even if it is not supported at the decimated loop time.
+ *
+ * @return                  ::PBIO_ERROR_NOT_SUPPORTED if a servo has no
+ *                          model for the current loop time, otherwise
+ *                          ::PBIO_SUCCESS.
+ */
+pbio_error_t pbio_servo_reset_decimation_all(void) {
+    for (uint8_t i = 0; i < PBIO_CONFIG_SERVO_NUM_DEV; i++) {
+        pbio_servo_t *srv = &servos[i];
+        if (!srv->run_update_loop) {
+            continue;
+        }
+        pbio_error_t err = pbio_servo_reset_decimation(srv);
+        if (err != PBIO_SUCCESS) {
+            return err;
+        }
+    }
+    return PBIO_SUCCESS;
+}
+
+/**
+ * Sets the time between control loops for all servos that are running.
+ *
+ * Nothing is changed if any servo does not have a model for the resulting
+ * loop time.
+ *
+ * @param [in]  loop_time   Time between control loops (ms).
+ * @return                  Error code.
+ */
+pbio_error_t pbio_servo_set_loop_time_all(uint32_t loop_time) {
+
+    const pbio_observer_model_t *models[PBIO_CONFIG_SERVO_NUM_DEV];
+
+    // Verify that all servos can run at the new loop time.
+    for (uint8_t i = 0; i < PBIO_CONFIG_SERVO_NUM_DEV; i++) {
+        pbio_servo_t *srv = &servos[i];
+        if (!srv->run_update_loop) {
+            continue;
+        }
+        pbio_error_t err = pbio_servo_get_model(srv->settings_reduced, loop_time * srv->decimation, &models[i]);
+        if (err != PBIO_SUCCESS) {
+            return err;
+        }
+    }
+
+    // Now apply it to all of them.
+    for (uint8_t i = 0; i < PBIO_CONFIG_SERVO_NUM_DEV; i++) {
+        pbio_servo_t *srv = &servos[i];
+        if (srv->run_update_loop) {
+            pbio_servo_apply_loop_time(srv, models[i], loop_time * srv->decimation);
+        }
+    }
+
+    return PBIO_SUCCESS;
+}
+
 #endif // PBIO_CONFIG_SERVO
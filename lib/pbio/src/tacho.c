@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2023 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 // SPDX-License-Identifier: BSD-3-Clause
 // Copyright (c) 2020-2023 LEGO System A/S
@@ -30,6 +30,7 @@
 struct _pbio_tacho_t {
     pbio_direction_t direction;  /**< Direction of tacho for increasing raw driver counts. */
     pbio_angle_t zero_angle;     /**< Raw angle where tacho output angle reads zero. */
+    uint32_t reset_count;        /**< Number of times the angle was reset. */
     pbdrv_legodev_dev_t *legodev;
 };
 
@@ -132,9 +133,22 @@ pbio_error_t pbio_tacho_reset_angle(pbio_tacho_t *tacho, pbio_angle_t *angle, bo
         // direction = +1, so as per above we should subtract.
         pbio_angle_diff(&raw, angle, &tacho->zero_angle);
     }
+    tacho->reset_count++;
     return PBIO_SUCCESS;
 }
 
+/**
+ * Gets how many times the angle was reset.
+ *
+ * This lets users of the angle tell a reset apart from actual motion.
+ *
+ * @param [in]  tacho   The tacho instance.
+ * @return              The number of resets.
+ */
+uint32_t pbio_tacho_get_reset_count(pbio_tacho_t *tacho) {
+    return tacho->reset_count;
+}
+
 /**
  * Sets up the tacho instance to be used in an application.
  *
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2023 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 // SPDX-License-Identifier: BSD-3-Clause
 // Copyright (c) 2020-2023 LEGO System A/S
@@ -12,6 +12,7 @@
 #include <pbio/angle.h>
 #include <pbio/int_math.h>
 #include <pbio/trajectory.h>
+#include <pbio/util.h>
 
 /**
  * For a single maneuver, the relative angle in millidegrees is capped at
@@ -41,6 +42,16 @@
 #define assert_accel_numerator(a) (assert(pbio_int_math_abs((a)) <= ACCELERATION_MAX && pbio_int_math_abs((a)) >= ACCELERATION_MIN))
 #define assert_accel_angle(th) (assert(pbio_int_math_abs((th)) <= ANGLE_ACCEL_MAX))
 
+/**
+ * Jerk is used only to get the duration of the window over which a trajectory
+ * is smoothed. This window is capped at half a second. Windows shorter than
+ * a millisecond have no practical effect, so they are not used.
+ */
+#define JERK_MAX (1000000)
+#define JERK_MIN (100)
+#define TIME_JERK_MAX (5000)
+#define TIME_JERK_MIN (10)
+
 /*
  * Time segment length is capped at the maximum angle divided by maximum speed,
  * and scaled to time ticks. This is about 536 seconds.
@@ -105,6 +116,32 @@ static int32_t to_trajectory_accel(int32_t control_accel) {
     return pbio_int_math_bind(control_accel / 1000, ACCELERATION_MIN, ACCELERATION_MAX);
 }
 
+/*
+ * Jerk is in millidegrees/second^3 in control units, but this module uses
+ * deg/s^3 to keep the math numerically bounded.
+ */
+
+/**
+ * Converts a jerk from deg/s^3 to mdeg/s^3.
+ *
+ * @param [in]  trajectory_jerk     The jerk in deg/s^3.
+ * @returns                         The jerk in mdeg/s^3.
+ */
+static int32_t to_control_jerk(int32_t trajectory_jerk) {
+    return trajectory_jerk * 1000;
+}
+
+/**
+ * Converts a jerk from mdeg/s^3 to deg/s^3 and limits it to the range
+ * ::JERK_MIN to ::JERK_MAX.
+ *
+ * @param [in]  control_jerk        The jerk in mdeg/s^3.
+ * @returns                         The jerk in deg/s^3.
+ */
+static int32_t to_trajectory_jerk(int32_t control_jerk) {
+    return pbio_int_math_bind(control_jerk / 1000, JERK_MIN, JERK_MAX);
+}
+
 /**
  * Converts time from unsigned (for use outside this file) to signed (used here).
  * @param [in]  time    Unsigned time value.
@@ -119,6 +156,25 @@ static int32_t to_trajectory_accel(int32_t control_accel) {
  */
 #define TO_CONTROL_TIME(time) ((uint32_t)(time))
 
+#if PBIO_CONFIG_TRAJECTORY_INCREMENTAL
+
+/**
+ * Discards the incremental evaluation state, so that the next reference is
+ * evaluated in full.
+ *
+ * @param [in]  trj     The trajectory that was modified.
+ */
+static void pbio_trajectory_reset_increment(pbio_trajectory_t *trj) {
+    trj->increment.valid = false;
+}
+
+#else // PBIO_CONFIG_TRAJECTORY_INCREMENTAL
+
+static inline void pbio_trajectory_reset_increment(pbio_trajectory_t *trj) {
+}
+
+#endif // PBIO_CONFIG_TRAJECTORY_INCREMENTAL
+
 /**
  * Validates that the given speed limit is within the numerically allowed range.
  *
@@ -156,6 +212,23 @@ pbio_error_t pbio_trajectory_validate_acceleration_limit(int32_t ctl_steps_per_a
     return PBIO_SUCCESS;
 }
 
+/**
+ * Validates that the given jerk is within the numerically allowed range.
+ *
+ * @param [in] ctl_steps_per_app_step   Control units per application unit.
+ * @param [in] jerk                     Jerk (application units, positive), or 0 to disable smoothing.
+ * @return                              ::PBIO_SUCCESS on valid values.
+ *                                      ::PBIO_ERROR_INVALID_ARG if any argument is outside the allowed range.
+ */
+pbio_error_t pbio_trajectory_validate_jerk_limit(int32_t ctl_steps_per_app_step, int32_t jerk) {
+    const int32_t jerk_min = to_control_jerk(JERK_MIN) / ctl_steps_per_app_step;
+    const int32_t jerk_max = to_control_jerk(JERK_MAX) / ctl_steps_per_app_step;
+    if (jerk != 0 && (jerk < jerk_min || jerk > jerk_max)) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+    return PBIO_SUCCESS;
+}
+
 /**
  * Reverses a trajectory.
  *
@@ -168,6 +241,7 @@ static void reverse_trajectory(pbio_trajectory_t *trj) {
     trj->th1 = -trj->th1;
     trj->th2 = -trj->th2;
     trj->th3 = -trj->th3;
+    trj->thj = -trj->thj;
 
     // Negate speeds and accelerations
     trj->wu *= -1;
@@ -397,6 +471,26 @@ static int32_t intersect_ramp(int32_t th3, int32_t th0, int32_t a0, int32_t a2)
     return th0 + pbio_int_math_mult_then_div(th3 - th0, a2, a2 - a0);
 }
 
+/**
+ * Gets the duration of the window over which the trajectory is smoothed.
+ *
+ * Averaging the trapezoidal profile over this window makes the acceleration
+ * ramp up and down linearly instead of changing in a single step. The
+ * acceleration reaches its nominal value within this time, so the jerk is
+ * the acceleration divided by this time.
+ *
+ * @param [in]  c       The command to use.
+ * @returns             The time in s*10^-4, or 0 if the profile is not smoothed.
+ */
+static int32_t get_jerk_time(const pbio_trajectory_command_t *c) {
+    if (c->jerk <= 0) {
+        return 0;
+    }
+    int32_t a_max = pbio_int_math_max(to_trajectory_accel(c->acceleration), to_trajectory_accel(c->deceleration));
+    int32_t tj = pbio_int_math_mult_then_div(a_max, 10000, to_trajectory_jerk(c->jerk));
+    return tj < TIME_JERK_MIN ? 0 : pbio_int_math_min(tj, TIME_JERK_MAX);
+}
+
 /**
  * Computes a trajectory for a timed command assuming *positive* speed.
  *
@@ -419,10 +513,11 @@ static pbio_error_t pbio_trajectory_new_forward_time_command(pbio_trajectory_t *
     // Save duration.
     trj->t3 = TO_TRAJECTORY_TIME(c->duration);
 
-    // Speed continues at target speed or goes to zero. And scale to ddeg/s.
-    trj->w3 = c->continue_running ? to_trajectory_speed(c->speed_target) : 0;
+    // Speed continues at target speed or goes to the given end speed, which
+    // is usually zero. And scale to ddeg/s.
     trj->w0 = to_trajectory_speed(c->speed_start);
     int32_t wt = (trj->wu = to_trajectory_speed(c->speed_target));
+    trj->w3 = c->continue_running ? wt : pbio_int_math_min(to_trajectory_speed(pbio_int_math_abs(c->speed_end)), wt);
     int32_t accel = to_trajectory_accel(c->acceleration);
     int32_t decel = to_trajectory_accel(c->deceleration);
 
@@ -534,10 +629,11 @@ static pbio_error_t pbio_trajectory_new_forward_angle_command(pbio_trajectory_t
     // Get angle to travel.
     trj->th3 = pbio_angle_diff_mdeg(&c->position_end, &c->position_start);
 
-    // Speed continues at target speed or goes to zero. And scale to ddeg/s.
-    trj->w3 = c->continue_running ? to_trajectory_speed(c->speed_target) : 0;
+    // Speed continues at target speed or goes to the given end speed, which
+    // is usually zero. And scale to ddeg/s.
     trj->w0 = to_trajectory_speed(c->speed_start);
     int32_t wt = (trj->wu = to_trajectory_speed(c->speed_target));
+    trj->w3 = c->continue_running ? wt : pbio_int_math_min(to_trajectory_speed(pbio_int_math_abs(c->speed_end)), wt);
     int32_t accel = to_trajectory_accel(c->acceleration);
     int32_t decel = to_trajectory_accel(c->deceleration);
 
@@ -624,12 +720,27 @@ static pbio_error_t pbio_trajectory_new_forward_angle_command(pbio_trajectory_t
             trj->th1 = trj->th3;
             trj->th2 = trj->th3;
         } else {
-            // Otherwise we have a zero final speed. We can just take the
-            // intersection of the accelerating and decelerating ramps to find
-            // the speed at t1 = t2.
-            trj->th1 = intersect_ramp(trj->th3, thf, trj->a0, trj->a2);
+            // Otherwise we have a given final speed, usually zero. We can just
+            // take the intersection of the accelerating and decelerating ramps
+            // to find the speed at t1 = t2. Like thf, the decelerating ramp is
+            // extended to its fictitious zero-speed angle to do so.
+            int32_t thf3 = trj->th3 + div_w2_by_a(0, trj->w3, trj->a2);
+            trj->th1 = intersect_ramp(thf3, thf, trj->a0, trj->a2);
+
+            if (trj->th1 > trj->th3) {
+                // If the ramps intersect beyond the target, there is not
+                // enough room to reach the final speed, so accelerate the
+                // best we can, just like the continue running case above.
+                trj->th1 = trj->th3;
+                trj->w1 = bind_w0(0, trj->a0, trj->th3 - thf);
+                trj->w3 = trj->w1;
+            } else {
+                trj->w1 = bind_w0(0, trj->a0, trj->th1 - thf);
+
+                // Rounding errors may put the peak just below the final speed.
+                trj->w3 = pbio_int_math_min(trj->w3, trj->w1);
+            }
             trj->th2 = trj->th1;
-            trj->w1 = bind_w0(0, trj->a0, trj->th1 - thf);
 
             // If w0 and w1 are very close, the previously determined
             // acceleration sign may be wrong after rounding errors, so update.
@@ -671,6 +782,58 @@ static pbio_error_t pbio_trajectory_new_forward_angle_command(pbio_trajectory_t
     return PBIO_SUCCESS;
 }
 
+/**
+ * Smooths a trajectory for an angle command assuming *positive* speed.
+ *
+ * The smoothed trajectory lags behind the trapezoidal one by half the
+ * smoothing window, so it travels further than the trapezoid after the
+ * trapezoid ends. This recomputes the trapezoid for a shorter angle such that
+ * the smoothed trajectory ends at the originally commanded position.
+ *
+ * @param [in]  trj     The trajectory computed for the unmodified command.
+ * @param [in]  c       The command used to compute it.
+ * @returns             ::PBIO_ERROR_INVALID_ARG if the command duration is out of range,
+ *                      ::PBIO_ERROR_FAILED if any of the calculated intervals are non-positive,
+ *                      otherwise ::PBIO_SUCCESS.
+ */
+static pbio_error_t pbio_trajectory_smooth_forward_angle_command(pbio_trajectory_t *trj, const pbio_trajectory_command_t *c) {
+
+    int32_t tj = get_jerk_time(c);
+    trj->tj = 0;
+    trj->thj = 0;
+
+    // Limit the smoothing window so that at most half of the angle is used to
+    // make up for the lag at the start and end.
+    int32_t distance = trj->th3;
+    int32_t w_sum = trj->w0 + trj->w3;
+    if (tj > 0 && w_sum > 0) {
+        tj = pbio_int_math_min(tj, div_th_by_w(distance, w_sum));
+    }
+    if (tj < TIME_JERK_MIN) {
+        return PBIO_SUCCESS;
+    }
+
+    // Shorten the trapezoid by the angle traveled due to the lag.
+    int32_t lag = mul_w_by_t(trj->w0, tj) / 2 + mul_w_by_t(trj->w3, tj) / 2;
+    if (distance - lag <= 0) {
+        return PBIO_SUCCESS;
+    }
+    pbio_trajectory_command_t shortened = *c;
+    shortened.position_end = c->position_start;
+    pbio_angle_add_mdeg(&shortened.position_end, distance - lag);
+
+    pbio_error_t err = pbio_trajectory_new_forward_angle_command(trj, &shortened);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
+    // The bounded speeds of the shortened trapezoid may differ slightly, so
+    // choose the offset such that the final position is exact.
+    trj->tj = tj;
+    trj->thj = distance - trj->th3 - mul_w_by_t(trj->w3, tj) / 2;
+    return PBIO_SUCCESS;
+}
+
 /**
  * Stretches a trajectory to end at the same time as @p leader.
  *
@@ -679,6 +842,8 @@ static pbio_error_t pbio_trajectory_new_forward_angle_command(pbio_trajectory_t
  */
 void pbio_trajectory_stretch(pbio_trajectory_t *trj, const pbio_trajectory_t *leader) {
 
+    pbio_trajectory_reset_increment(trj);
+
     // Synchronize timestamps with leading trajectory.
     trj->t1 = leader->t1;
     trj->t2 = leader->t2;
@@ -689,6 +854,13 @@ void pbio_trajectory_stretch(pbio_trajectory_t *trj, const pbio_trajectory_t *le
         return;
     }
 
+    // Use the same smoothing window as the leader, keeping the final
+    // position of the smoothed trajectory the same.
+    int32_t distance = trj->thj + trj->th3 + mul_w_by_t(trj->w3, trj->tj) / 2;
+    trj->tj = leader->tj;
+    trj->thj = mul_w_by_t(trj->w0, trj->tj) / 2;
+    trj->th3 = distance - trj->thj - mul_w_by_t(trj->w3, trj->tj) / 2;
+
     // This recomputes several components of a trajectory such that it travels
     // the same distance as before, but with new time stamps t1, t2, and t3.
     // Setting the speed integral equal to (th3 - th0) gives three constraint
@@ -712,6 +884,30 @@ void pbio_trajectory_stretch(pbio_trajectory_t *trj, const pbio_trajectory_t *le
     trj->th2 = trj->th1 + mul_w_by_t(trj->w1, trj->t2 - trj->t1);
 }
 
+/**
+ * Gets the highest speed at which a maneuver can start such that it can
+ * still come to a standstill within the given angle.
+ *
+ * This is used to find how fast one maneuver may end if another one follows.
+ *
+ * @param [in]  speed           Desired speed (mdeg/s). The sign is ignored.
+ * @param [in]  angle           Angle of the maneuver that follows (mdeg). The sign is ignored.
+ * @param [in]  deceleration    Deceleration magnitude (mdeg/s^2).
+ * @return                      The speed, bound by what is possible (mdeg/s, positive).
+ */
+int32_t pbio_trajectory_get_max_junction_speed(int32_t speed, int32_t angle, int32_t deceleration) {
+    int32_t w = to_trajectory_speed(pbio_int_math_abs(speed));
+    int32_t th = pbio_int_math_min(pbio_int_math_abs(angle), ANGLE_MAX - 1);
+    int32_t a = to_trajectory_accel(deceleration);
+
+    // Do the check using quadratic terms to avoid square root evaluations in
+    // most cases, as in the forward angle command.
+    if (div_w2_by_a(w, 0, a) > th) {
+        w = bind_w0(0, a, th);
+    }
+    return to_control_speed(w);
+}
+
 /**
  * Computes a trajectory for a timed command.
  *
@@ -723,6 +919,8 @@ void pbio_trajectory_stretch(pbio_trajectory_t *trj, const pbio_trajectory_t *le
  */
 pbio_error_t pbio_trajectory_new_time_command(pbio_trajectory_t *trj, const pbio_trajectory_command_t *command) {
 
+    pbio_trajectory_reset_increment(trj);
+
     // Copy the command so we can modify it.
     pbio_trajectory_command_t c = *command;
 
@@ -746,12 +944,26 @@ pbio_error_t pbio_trajectory_new_time_command(pbio_trajectory_t *trj, const pbio
     // Bind target speed by maximum speed.
     c.speed_target = pbio_int_math_min(c.speed_target, c.speed_max);
 
+    // The smoothed trajectory ends later than the trapezoid it is based on,
+    // so make the trapezoid shorter. This is not needed for infinite
+    // maneuvers, which never reach their end.
+    int32_t tj = get_jerk_time(&c);
+    if (c.duration < PBIO_TRAJECTORY_DURATION_FOREVER_MS * PBIO_TRAJECTORY_TICKS_PER_MS) {
+        tj = pbio_int_math_min(tj, TO_TRAJECTORY_TIME(c.duration) / 2);
+        tj = tj < TIME_JERK_MIN ? 0 : tj;
+        c.duration -= tj;
+    }
+
     // Calculate the trajectory, assumed to be forward.
     pbio_error_t err = pbio_trajectory_new_forward_time_command(trj, &c);
     if (err != PBIO_SUCCESS) {
         return err;
     }
 
+    // The offset makes the smoothed trajectory start at the initial position.
+    trj->tj = tj;
+    trj->thj = mul_w_by_t(trj->w0, tj) / 2;
+
     // Reverse the maneuver if the original arguments imposed backward motion.
     if (backward) {
         reverse_trajectory(trj);
@@ -770,6 +982,8 @@ pbio_error_t pbio_trajectory_new_time_command(pbio_trajectory_t *trj, const pbio
  */
 pbio_error_t pbio_trajectory_new_angle_command(pbio_trajectory_t *trj, const pbio_trajectory_command_t *command) {
 
+    pbio_trajectory_reset_increment(trj);
+
     // Copy the command so we can modify it.
     pbio_trajectory_command_t c = *command;
 
@@ -815,6 +1029,12 @@ pbio_error_t pbio_trajectory_new_angle_command(pbio_trajectory_t *trj, const pbi
         return err;
     }
 
+    // Smooth the trajectory if a jerk limit is given.
+    err = pbio_trajectory_smooth_forward_angle_command(trj, &c);
+    if (err != PBIO_SUCCESS) {
+        return err;
+    }
+
     // Reverse the maneuver if the original arguments imposed backward motion.
     if (backward) {
         reverse_trajectory(trj);
@@ -858,6 +1078,12 @@ void pbio_trajectory_get_last_vertex(const pbio_trajectory_t *trj, uint32_t time
     int32_t time = TO_TRAJECTORY_TIME(time_ref - trj->start.time);
     assert_time(time);
 
+    // A smoothed trajectory has no vertices other than its starting point.
+    if (trj->tj != 0) {
+        pbio_trajectory_offset_start(vertex, &trj->start, 0, 0, trj->w0, 0);
+        return;
+    }
+
     // Find which section of the ongoing maneuver we were in, and take
     // corresponding segment starting point. Acceleration is undefined but not
     // used when synchronizing trajectories, so set to zero.
@@ -883,7 +1109,10 @@ void pbio_trajectory_get_last_vertex(const pbio_trajectory_t *trj, uint32_t time
  * @param [out] end         An uninitialized trajectory reference point to hold the result.
  */
 void pbio_trajectory_get_endpoint(const pbio_trajectory_t *trj, pbio_trajectory_reference_t *end) {
-    pbio_trajectory_offset_start(end, &trj->start, trj->t3, trj->th3, trj->w3, 0);
+    // If smoothed, the endpoint is reached when the smoothing window has
+    // passed the end of the trapezoid.
+    int32_t th = trj->thj + trj->th3 + mul_w_by_t(trj->w3, trj->tj) / 2;
+    pbio_trajectory_offset_start(end, &trj->start, trj->t3 + trj->tj, th, trj->w3, 0);
 }
 
 /**
@@ -909,8 +1138,312 @@ int32_t pbio_trajectory_get_abs_command_speed(const pbio_trajectory_t *trj) {
  * @return                  The duration of time after the start of the trajectory in s*10^-4.
  */
 uint32_t pbio_trajectory_get_duration(const pbio_trajectory_t *trj) {
-    assert_time(trj->t3);
-    return TO_CONTROL_TIME(trj->t3);
+    assert_time(trj->t3 + trj->tj);
+    return TO_CONTROL_TIME(trj->t3 + trj->tj);
+}
+
+/**
+ * Gets the reference of the trapezoidal trajectory, before smoothing.
+ *
+ * Before its start, the trajectory is extended backwards at the initial speed.
+ * This is used to evaluate the smoothing window near the start.
+ *
+ * @param [in]  trj     The trajectory instance.
+ * @param [in]  time    The time since the start of the trajectory in s*10^-4. May be negative.
+ * @param [out] th      The angle in mdeg.
+ * @param [out] w       The speed in ddeg/s.
+ * @param [out] a       The acceleration in deg/s^2.
+ */
+static void pbio_trajectory_get_trapezoid_reference(const pbio_trajectory_t *trj, int32_t time, int32_t *th, int32_t *w, int32_t *a) {
+    if (time < 0) {
+        // If we are here, we are before the start of the maneuver.
+        *w = trj->w0;
+        *th = -mul_w_by_t(trj->w0, -time);
+        *a = 0;
+    } else if (time - trj->t1 < 0 || (trj->t1 == 0 && time == 0)) {
+        // If we are here, then we are still in the acceleration phase.
+        // Includes conversion from microseconds to seconds, in two steps to
+        // avoid overflows and round off errors
+        *w = trj->w0 + mul_a_by_t(trj->a0, time);
+        *th = mul_w_by_t(trj->w0, time) + mul_a_by_t2(trj->a0, time);
+        *a = trj->a0;
+    } else if (time - trj->t2 < 0) {
+        // If we are here, then we are in the constant speed phase
+        *w = trj->w1;
+        *th = trj->th1 + mul_w_by_t(trj->w1, time - trj->t1);
+        *a = 0;
+    } else if (time - trj->t3 < 0) {
+        // If we are here, then we are in the deceleration phase
+        *w = trj->w1 + mul_a_by_t(trj->a2, time - trj->t2);
+        *th = trj->th2 + mul_w_by_t(trj->w1, time - trj->t2) + mul_a_by_t2(trj->a2, time - trj->t2);
+        *a = trj->a2;
+    } else {
+        // If we are here, we are in the constant speed phase after the
+        // maneuver completes
+        *w = trj->w3;
+        *th = trj->th3 + mul_w_by_t(trj->w3, time - trj->t3);
+        *a = 0;
+    }
+}
+
+#if PBIO_CONFIG_TRAJECTORY_INCREMENTAL
+
+/**
+ * Denominators of the fractions used by mul_w_by_t(), mul_a_by_t(), and
+ * mul_a_by_t2(), respectively. The last one divides by 100 and then by 2.
+ */
+#define INCREMENT_DENOMINATOR_WT (100)
+#define INCREMENT_DENOMINATOR_AT (1000)
+#define INCREMENT_DENOMINATOR_VT (200)
+
+/**
+ * Splits a nonnegative fraction into its whole part and remainder.
+ *
+ * @param [in]  numerator   The numerator.
+ * @param [in]  denominator The positive denominator.
+ * @param [out] fraction    The whole part and remainder.
+ */
+static void split_fraction(uint64_t numerator, uint32_t denominator, pbio_trajectory_fraction_t *fraction) {
+    uint64_t quotient = numerator / denominator;
+    assert(quotient <= INT32_MAX);
+    fraction->quotient = (int32_t)quotient;
+    fraction->remainder = (uint32_t)(numerator - quotient * denominator);
+}
+
+/**
+ * Adds a fraction split by split_fraction() to another one.
+ *
+ * @param [in, out] value       The fraction to add to.
+ * @param [in]      delta       The fraction to add.
+ * @param [in]      denominator The denominator of both fractions.
+ * @return                      True if the remainders added up to a whole.
+ */
+static inline bool add_fraction(pbio_trajectory_fraction_t *value, const pbio_trajectory_fraction_t *delta, uint32_t denominator) {
+    value->quotient += delta->quotient;
+    value->remainder += delta->remainder;
+    if (value->remainder >= denominator) {
+        value->remainder -= denominator;
+        value->quotient += 1;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Gets the reference from the incremental evaluation state.
+ *
+ * @param [in]  inc     The incremental evaluation state.
+ * @param [out] th      The angle in mdeg.
+ * @param [out] w       The speed in ddeg/s.
+ * @param [out] a       The acceleration in deg/s^2.
+ */
+static void pbio_trajectory_get_increment(const pbio_trajectory_increment_t *inc, int32_t *th, int32_t *w, int32_t *a) {
+    // The fractions hold magnitudes, so restore the sign of each product.
+    int32_t wt = inc->w < 0 ? -inc->wt.quotient : inc->wt.quotient;
+    int32_t at = inc->a < 0 ? -inc->at.quotient : inc->at.quotient;
+    int32_t vt = inc->a < 0 ? -inc->vt.quotient : inc->vt.quotient;
+    *th = inc->th + wt + vt;
+    *w = inc->w + at;
+    *a = inc->a;
+}
+
+/**
+ * Evaluates the trapezoidal trajectory in full and prepares the increments
+ * for evaluating it at the next time step.
+ *
+ * This uses 64-bit divisions, but only when a new phase begins or when the
+ * time step changes.
+ *
+ * @param [in]  trj     The trajectory instance.
+ * @param [in]  time    The time since the start of the trajectory in s*10^-4. May be negative.
+ * @param [in]  dt      The expected time step to the next evaluation, or 0 if not known.
+ * @param [out] th      The angle in mdeg.
+ * @param [out] w       The speed in ddeg/s.
+ * @param [out] a       The acceleration in deg/s^2.
+ */
+static void pbio_trajectory_start_increment(pbio_trajectory_t *trj, int32_t time, int32_t dt, int32_t *th, int32_t *w, int32_t *a) {
+
+    pbio_trajectory_increment_t *inc = &trj->increment;
+
+    pbio_trajectory_get_trapezoid_reference(trj, time, th, w, a);
+
+    inc->time = time;
+    inc->dt = dt;
+    inc->valid = true;
+
+    // Before the start, the time since the start of the phase decreases
+    // in magnitude, so this is always evaluated in full.
+    if (time < 0) {
+        return;
+    }
+
+    // Find the phase we are in, like pbio_trajectory_get_trapezoid_reference().
+    int32_t t_phase;
+    inc->final = false;
+    if (time - trj->t1 < 0 || (trj->t1 == 0 && time == 0)) {
+        t_phase = 0;
+        inc->th = 0;
+        inc->w = trj->w0;
+        inc->a = trj->a0;
+        inc->time_end = trj->t1;
+    } else if (time - trj->t2 < 0) {
+        t_phase = trj->t1;
+        inc->th = trj->th1;
+        inc->w = trj->w1;
+        inc->a = 0;
+        inc->time_end = trj->t2;
+    } else if (time - trj->t3 < 0) {
+        t_phase = trj->t2;
+        inc->th = trj->th2;
+        inc->w = trj->w1;
+        inc->a = trj->a2;
+        inc->time_end = trj->t3;
+    } else {
+        t_phase = trj->t3;
+        inc->th = trj->th3;
+        inc->w = trj->w3;
+        inc->a = 0;
+        inc->final = true;
+    }
+
+    // Magnitudes of the products at the current time.
+    uint64_t t = time - t_phase;
+    uint64_t w_abs = pbio_int_math_abs(inc->w);
+    uint64_t a_abs = pbio_int_math_abs(inc->a);
+    split_fraction(w_abs * t, INCREMENT_DENOMINATOR_WT, &inc->wt);
+    split_fraction(a_abs * t, INCREMENT_DENOMINATOR_AT, &inc->at);
+    uint64_t v = inc->at.quotient;
+    split_fraction(v * t, INCREMENT_DENOMINATOR_VT, &inc->vt);
+
+    // The whole part of the acceleration product grows by c or by c + 1 per
+    // step. The other products are needed to step the second order term.
+    split_fraction(w_abs * dt, INCREMENT_DENOMINATOR_WT, &inc->wt_step);
+    split_fraction(a_abs * dt, INCREMENT_DENOMINATOR_AT, &inc->at_step);
+    uint64_t c = inc->at_step.quotient;
+    split_fraction(v * dt, INCREMENT_DENOMINATOR_VT, &inc->vdt);
+    split_fraction(c * t, INCREMENT_DENOMINATOR_VT, &inc->ct);
+    split_fraction(c * dt, INCREMENT_DENOMINATOR_VT, &inc->ct_step);
+    split_fraction(t, INCREMENT_DENOMINATOR_VT, &inc->t);
+    split_fraction(dt, INCREMENT_DENOMINATOR_VT, &inc->t_step);
+
+    #ifndef NDEBUG
+    int32_t th_inc, w_inc, a_inc;
+    pbio_trajectory_get_increment(inc, &th_inc, &w_inc, &a_inc);
+    assert(th_inc == *th && w_inc == *w && a_inc == *a);
+    #endif
+}
+
+/**
+ * Steps the incremental evaluation state ahead by one time step.
+ *
+ * With v the whole part of the acceleration product and t the time since the
+ * start of the phase, the second order term changes by v' * dt + (v' - v) * t
+ * in each step, where v' is the new value.
+ *
+ * @param [in]  inc     The incremental evaluation state.
+ */
+static void pbio_trajectory_step_increment(pbio_trajectory_increment_t *inc) {
+    bool carry = add_fraction(&inc->at, &inc->at_step, INCREMENT_DENOMINATOR_AT);
+    add_fraction(&inc->vdt, &inc->ct_step, INCREMENT_DENOMINATOR_VT);
+    if (carry) {
+        add_fraction(&inc->vdt, &inc->t_step, INCREMENT_DENOMINATOR_VT);
+    }
+    add_fraction(&inc->vt, &inc->vdt, INCREMENT_DENOMINATOR_VT);
+    add_fraction(&inc->vt, &inc->ct, INCREMENT_DENOMINATOR_VT);
+    if (carry) {
+        add_fraction(&inc->vt, &inc->t, INCREMENT_DENOMINATOR_VT);
+    }
+    add_fraction(&inc->ct, &inc->ct_step, INCREMENT_DENOMINATOR_VT);
+    add_fraction(&inc->t, &inc->t_step, INCREMENT_DENOMINATOR_VT);
+    add_fraction(&inc->wt, &inc->wt_step, INCREMENT_DENOMINATOR_WT);
+    inc->time += inc->dt;
+}
+
+/**
+ * Gets the reference of the trapezoidal trajectory, stepping from the
+ * previous evaluation if possible.
+ *
+ * The result is identical to pbio_trajectory_get_trapezoid_reference().
+ *
+ * @param [in]  trj     The trajectory instance.
+ * @param [in]  time    The time since the start of the trajectory in s*10^-4. May be negative.
+ * @param [out] th      The angle in mdeg.
+ * @param [out] w       The speed in ddeg/s.
+ * @param [out] a       The acceleration in deg/s^2.
+ */
+static void pbio_trajectory_get_incremental_reference(pbio_trajectory_t *trj, int32_t time, int32_t *th, int32_t *w, int32_t *a) {
+
+    pbio_trajectory_increment_t *inc = &trj->increment;
+    int32_t dt = time - inc->time;
+
+    if (inc->valid && inc->time >= 0 && dt == inc->dt && dt > 0 && (inc->final || time - inc->time_end < 0)) {
+        // One step in the same phase, so just add the increments.
+        pbio_trajectory_step_increment(inc);
+    } else if (!inc->valid || inc->time < 0 || dt != 0) {
+        // Otherwise evaluate in full, expecting the same step next time.
+        pbio_trajectory_start_increment(trj, time, inc->valid && dt > 0 ? dt : 0, th, w, a);
+        return;
+    }
+
+    pbio_trajectory_get_increment(inc, th, w, a);
+}
+
+#endif // PBIO_CONFIG_TRAJECTORY_INCREMENTAL
+
+/**
+ * Gets the reference of the smoothed trajectory.
+ *
+ * The smoothed trajectory is the average of the trapezoidal trajectory over
+ * the preceding smoothing window, plus a fixed offset.
+ *
+ * @param [in]  trj     The trajectory instance.
+ * @param [in]  time    The time since the start of the trajectory in s*10^-4.
+ * @param [out] th      The angle in mdeg.
+ * @param [out] w       The speed in ddeg/s.
+ * @param [out] a       The acceleration in deg/s^2.
+ */
+static void pbio_trajectory_get_smoothed_reference(const pbio_trajectory_t *trj, int32_t time, int32_t *th, int32_t *w, int32_t *a) {
+
+    int32_t t_from = time - trj->tj;
+    int32_t th_from, w_from, a_from;
+    pbio_trajectory_get_trapezoid_reference(trj, t_from, &th_from, &w_from, &a_from);
+
+    // The average acceleration follows from the change in speed.
+    int32_t th_to, w_to, a_to;
+    pbio_trajectory_get_trapezoid_reference(trj, time, &th_to, &w_to, &a_to);
+    *a = div_w_by_t(w_to - w_from, trj->tj);
+
+    // End of each segment of the trapezoid and the acceleration within it.
+    const int32_t segment_end[] = { 0, trj->t1, trj->t2, trj->t3, time };
+    const int32_t segment_accel[] = { 0, trj->a0, 0, trj->a2, 0 };
+
+    // Integrate the angle and speed over the window, one segment at a time.
+    // The speed is linear within each segment, so the trapezoidal rule is
+    // exact. The speed at the end of the segment is computed from its start
+    // since the speed may step between segments. The angle is quadratic, so
+    // it needs a correction for the acceleration. Integrating the speed like
+    // this instead of using the change in angle avoids amplifying rounding
+    // errors in the angle. The speed sum is bounded by twice the maximum
+    // speed times ::TIME_JERK_MAX, so it is divided only once at the end.
+    int32_t th_sum = 0;
+    int32_t w_sum = 0;
+    for (uint32_t i = 0; i < PBIO_ARRAY_SIZE(segment_end); i++) {
+        int32_t t_to = pbio_int_math_min(segment_end[i], time);
+        int32_t dt = t_to - t_from;
+        if (dt <= 0) {
+            // This segment is not part of the window.
+            continue;
+        }
+        pbio_trajectory_get_trapezoid_reference(trj, t_to, &th_to, &w_to, &a_to);
+        th_sum += pbio_int_math_mult_then_div(th_from + th_to, dt, 2 * trj->tj) -
+            pbio_int_math_mult_then_div(mul_a_by_t2(segment_accel[i], dt), dt, 6 * trj->tj);
+        w_sum += (2 * w_from + mul_a_by_t(segment_accel[i], dt)) * dt;
+        t_from = t_to;
+        th_from = th_to;
+        w_from = w_to;
+    }
+    *th = trj->thj + th_sum;
+    *w = w_sum / (2 * trj->tj);
 }
 
 /**
@@ -931,49 +1464,35 @@ void pbio_trajectory_get_reference(pbio_trajectory_t *trj, uint32_t time_ref, pb
     int32_t w;
     int32_t a;
 
-    if (time - trj->t1 < 0 || (trj->t1 == 0 && time == 0)) {
-        // If we are here, then we are still in the acceleration phase.
-        // Includes conversion from microseconds to seconds, in two steps to
-        // avoid overflows and round off errors
-        w = trj->w0 + mul_a_by_t(trj->a0, time);
-        th = mul_w_by_t(trj->w0, time) + mul_a_by_t2(trj->a0, time);
-        a = trj->a0;
-    } else if (time - trj->t2 < 0) {
-        // If we are here, then we are in the constant speed phase
-        w = trj->w1;
-        th = trj->th1 + mul_w_by_t(trj->w1, time - trj->t1);
-        a = 0;
-    } else if (time - trj->t3 < 0) {
-        // If we are here, then we are in the deceleration phase
-        w = trj->w1 + mul_a_by_t(trj->a2, time - trj->t2);
-        th = trj->th2 + mul_w_by_t(trj->w1, time - trj->t2) + mul_a_by_t2(trj->a2, time - trj->t2);
-        a = trj->a2;
+    if (trj->tj == 0) {
+        #if PBIO_CONFIG_TRAJECTORY_INCREMENTAL
+        pbio_trajectory_get_incremental_reference(trj, time, &th, &w, &a);
+        #else
+        pbio_trajectory_get_trapezoid_reference(trj, time, &th, &w, &a);
+        #endif
     } else {
-        // If we are here, we are in the constant speed phase after the
-        // maneuver completes
-        w = trj->w3;
-        th = trj->th3 + mul_w_by_t(trj->w3, time - trj->t3);
-        a = 0;
-
-        // To avoid any overflows of the aforementioned time comparisons,
-        // rebase the trajectory if it has been running a long time.
-        if (time > PBIO_TRAJECTORY_DURATION_FOREVER_MS * PBIO_TRAJECTORY_TICKS_PER_MS) {
-            pbio_angle_t start = trj->start.position;
-            pbio_angle_add_mdeg(&start, th);
-
-            pbio_trajectory_command_t command = {
-                .time_start = time_ref,
-                .speed_target = to_control_speed(trj->w3),
-                .continue_running = true,
-                .position_start = start,
-            };
-            pbio_trajectory_make_constant(trj, &command);
-
-            // w, and a are already set above. Time and angle are 0, since this
-            // is the start of the new maneuver with its new starting point.
-            time = 0;
-            th = 0;
-        }
+        pbio_trajectory_get_smoothed_reference(trj, time, &th, &w, &a);
+    }
+
+    // To avoid any overflows of the time comparisons, rebase the trajectory
+    // if it has been running a long time in the constant speed phase after
+    // the maneuver completes.
+    if (time - trj->tj - trj->t3 >= 0 && time > PBIO_TRAJECTORY_DURATION_FOREVER_MS * PBIO_TRAJECTORY_TICKS_PER_MS) {
+        pbio_angle_t start = trj->start.position;
+        pbio_angle_add_mdeg(&start, th);
+
+        pbio_trajectory_command_t command = {
+            .time_start = time_ref,
+            .speed_target = to_control_speed(trj->w3),
+            .continue_running = true,
+            .position_start = start,
+        };
+        pbio_trajectory_make_constant(trj, &command);
+
+        // w, and a are already set above. Time and angle are 0, since this
+        // is the start of the new maneuver with its new starting point.
+        time = 0;
+        th = 0;
     }
 
     // Assert that results are bounded
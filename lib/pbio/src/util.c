@@ -1,9 +1,11 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2021 The Pybricks Authors
+// Copyright (c) 2021-2024 The Pybricks Authors
 
 #include <stdbool.h>
 #include <stdint.h>
 
+#include <pbio/util.h>
+
 /**
  * Compares two 128-bit UUIDs with opposite byte ordering for equality.
  *
@@ -51,3 +53,30 @@ bool pbio_oneshot(bool value, bool *state) {
 
     return ret;
 }
+
+/**
+ * Computes the CRC-32 checksum of @p data, as used by zlib and Ethernet.
+ *
+ * This uses a 16-entry lookup table, which is a good trade-off between
+ * speed and code size for the amounts of data that the hub checks.
+ *
+ * @param [in]  data    The data.
+ * @param [in]  size    The size of @p data in bytes.
+ * @return              The checksum.
+ */
+uint32_t pbio_crc32(const uint8_t *data, uint32_t size) {
+    static const uint32_t table[] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+        0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+        0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+    };
+
+    uint32_t crc = 0xFFFFFFFF;
+    for (uint32_t i = 0; i < size; i++) {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+    }
+    return ~crc;
+}
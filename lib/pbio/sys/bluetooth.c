@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2020-2023 The Pybricks Authors
+// Copyright (c) 2020-2024 The Pybricks Authors
 
 #include <pbsys/config.h>
 
@@ -16,6 +16,8 @@
 #include <pbdrv/bluetooth.h>
 #include <pbio/error.h>
 #include <pbio/event.h>
+#include <pbio/int_math.h>
+#include <pbio/logger.h>
 #include <pbio/protocol.h>
 #include <pbio/util.h>
 #include <pbsys/bluetooth.h>
@@ -26,8 +28,10 @@
 #include "light.h"
 #include "storage.h"
 
-// REVISIT: this can be the negotiated MTU - 3 to allow for better throughput
-#define MAX_CHAR_SIZE 20
+// Number of full size notifications that fit in the stdout buffer. Only one
+// notification is sent at a time. The rest of the buffer lets the program keep
+// printing while it is in flight, without waiting for each notification.
+#define STDOUT_NUM_PACKETS 3
 
 // REVISIT: this needs to be moved to a common place where it can be shared with USB
 static pbsys_bluetooth_stdin_event_callback_t stdin_event_callback;
@@ -38,13 +42,22 @@ typedef struct {
     list_t queue;
     pbdrv_bluetooth_send_context_t context;
     bool is_queued;
-    uint8_t payload[MAX_CHAR_SIZE];
+    uint8_t payload[PBDRV_BLUETOOTH_MAX_CHAR_SIZE];
 } send_msg_t;
 
 static send_msg_t stdout_msg;
 LIST(send_queue);
 static bool send_busy;
 
+#if PBIO_CONFIG_LOGGER
+// How often to check for new rows while a log is being streamed.
+#define LOG_STREAM_POLL_MS 10
+
+// Log that is drained in the background while it is being written, if any.
+static pbio_log_t *log_stream;
+static send_msg_t log_msg;
+#endif // PBIO_CONFIG_LOGGER
+
 PROCESS(pbsys_bluetooth_process, "Bluetooth");
 
 void pbsys_bluetooth_process_poll(void) {
@@ -55,11 +68,11 @@ void pbsys_bluetooth_process_poll(void) {
 
 /** Initializes Bluetooth. */
 void pbsys_bluetooth_init(void) {
-    // enough for two packets, one currently being sent and one to be ready
-    // as soon as the previous one completes + 1 byte for ring buf pointer
-    static uint8_t stdout_buf[MAX_CHAR_SIZE * 2 + 1];
+    // enough for one packet currently being sent and more to be ready as soon
+    // as the previous one completes + 1 byte for ring buf pointer
+    static uint8_t stdout_buf[PBDRV_BLUETOOTH_MAX_CHAR_SIZE * STDOUT_NUM_PACKETS + 1];
     // enough for one packet received + 1 byte for ring buf pointer
-    static uint8_t stdin_buf[PBDRV_BLUETOOTH_MAX_MTU_SIZE - 3 + 1];
+    static uint8_t stdin_buf[PBDRV_BLUETOOTH_MAX_CHAR_SIZE + 1];
 
     lwrb_init(&stdout_ring_buf, stdout_buf, PBIO_ARRAY_SIZE(stdout_buf));
     lwrb_init(&stdin_ring_buf, stdin_buf, PBIO_ARRAY_SIZE(stdin_buf));
@@ -183,7 +196,7 @@ pbio_error_t pbsys_bluetooth_tx(const uint8_t *data, uint32_t *size) {
     }
 
     // poke the process to start tx soon-ish. This way, we can accumulate up to
-    // MAX_CHAR_SIZE bytes before actually transmitting
+    // one full notification before actually transmitting
     pbsys_bluetooth_process_poll();
 
     return PBIO_SUCCESS;
@@ -204,8 +217,74 @@ bool pbsys_bluetooth_tx_is_idle(void) {
     return !send_busy && lwrb_get_full(&stdout_ring_buf) == 0;
 }
 
+/**
+ * Starts sending rows of a streaming log in the background.
+ *
+ * Rows are sent as ::PBIO_PYBRICKS_EVENT_WRITE_LOG events as soon as the
+ * background control loops add them to the log. This replaces any log that
+ * was already being streamed. The stream is detached when the connection is
+ * lost or the user program ends.
+ *
+ * @param [in]  log     Log started with pbio_logger_start_stream().
+ * @return              ::PBIO_SUCCESS if the log is now being streamed,
+ *                      ::PBIO_ERROR_INVALID_ARG if the log is not in streaming
+ *                      mode, ::PBIO_ERROR_INVALID_OP if there is not an active
+ *                      Bluetooth connection or ::PBIO_ERROR_NOT_SUPPORTED if
+ *                      this platform does not support logging.
+ */
+pbio_error_t pbsys_bluetooth_log_stream_start(pbio_log_t *log) {
+    #if PBIO_CONFIG_LOGGER
+    if (!pbio_logger_is_streaming(log)) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+
+    if (!pbdrv_bluetooth_is_connected(PBDRV_BLUETOOTH_CONNECTION_PYBRICKS)) {
+        return PBIO_ERROR_INVALID_OP;
+    }
+
+    pbsys_bluetooth_log_stream_stop();
+    log_stream = log;
+    pbsys_bluetooth_process_poll();
+
+    return PBIO_SUCCESS;
+    #else
+    return PBIO_ERROR_NOT_SUPPORTED;
+    #endif // PBIO_CONFIG_LOGGER
+}
+
+/**
+ * Stops sending rows of the streaming log, if any.
+ *
+ * The log itself is not stopped. Rows that have not been sent yet remain
+ * in the log.
+ */
+void pbsys_bluetooth_log_stream_stop(void) {
+    #if PBIO_CONFIG_LOGGER
+    log_stream = NULL;
+
+    // If the message is currently being sent, send_done() takes care of it.
+    if (log_msg.is_queued && !(send_busy && list_head(send_queue) == &log_msg)) {
+        list_remove(send_queue, &log_msg);
+        log_msg.is_queued = false;
+    }
+    #endif // PBIO_CONFIG_LOGGER
+}
+
 // Contiki process
 
+// Checks if a message should go back in the queue after it was sent.
+static bool send_msg_has_more_data(send_msg_t *msg) {
+    if (msg == &stdout_msg) {
+        return lwrb_get_full(&stdout_ring_buf) > 0;
+    }
+    #if PBIO_CONFIG_LOGGER
+    if (msg == &log_msg) {
+        return log_stream && pbio_logger_stream_get_num_rows_pending(log_stream) > 0;
+    }
+    #endif
+    return false;
+}
+
 static pbio_pybricks_error_t handle_receive(pbdrv_bluetooth_connection_t connection, const uint8_t *data, uint32_t size) {
     if (connection == PBDRV_BLUETOOTH_CONNECTION_PYBRICKS) {
         return pbsys_command(data, size);
@@ -223,7 +302,7 @@ static pbio_pybricks_error_t handle_receive(pbdrv_bluetooth_connection_t connect
 static void send_done(void) {
     send_msg_t *msg = list_pop(send_queue);
 
-    if (msg == &stdout_msg && lwrb_get_full(&stdout_ring_buf)) {
+    if (send_msg_has_more_data(msg)) {
         // If there is more buffered data to send, put the message back in the queue
         list_add(send_queue, msg);
     } else {
@@ -244,6 +323,10 @@ static void reset_all(void) {
 
     send_busy = false;
 
+    #if PBIO_CONFIG_LOGGER
+    log_stream = NULL;
+    #endif
+
     lwrb_reset(&stdin_ring_buf);
     lwrb_reset(&stdout_ring_buf);
 }
@@ -287,6 +370,9 @@ static PT_THREAD(pbsys_bluetooth_monitor_status(struct pt *pt)) {
 
 PROCESS_THREAD(pbsys_bluetooth_process, ev, data) {
     static struct etimer timer;
+    #if PBIO_CONFIG_LOGGER
+    static struct etimer log_timer;
+    #endif
     static struct pt status_monitor_pt;
 
     PROCESS_BEGIN();
@@ -366,18 +452,39 @@ PROCESS_THREAD(pbsys_bluetooth_process, ev, data) {
                 PT_INIT(&status_monitor_pt);
             }
 
+            #if PBIO_CONFIG_LOGGER
+            // Like stdout, the log data is only read when the message is
+            // actually sent, so that we can send as many rows as possible.
+            if (log_stream && !log_msg.is_queued && pbio_logger_stream_get_num_rows_pending(log_stream)) {
+                log_msg.context.connection = PBDRV_BLUETOOTH_CONNECTION_PYBRICKS;
+                list_add(send_queue, &log_msg);
+                log_msg.is_queued = true;
+            }
+            #endif // PBIO_CONFIG_LOGGER
+
             if (!send_busy) {
                 // msg is removed from queue in send_done callback rather than here
                 send_msg_t *msg = list_head(send_queue);
                 if (msg) {
                     msg->context.done = send_done;
 
+                    // Fill up to the negotiated MTU.
+                    uint32_t max_size = pbio_int_math_min(PBIO_ARRAY_SIZE(msg->payload),
+                        pbdrv_bluetooth_get_max_notification_size(msg->context.connection));
+
                     if (msg == &stdout_msg) {
                         msg->payload[0] = PBIO_PYBRICKS_EVENT_WRITE_STDOUT;
-                        // REVISIT: use negotiated MTU instead of minimum safe size
-                        msg->context.size = lwrb_read(&stdout_ring_buf, &msg->payload[1], PBIO_ARRAY_SIZE(msg->payload) - 1) + 1;
+                        msg->context.size = lwrb_read(&stdout_ring_buf, &msg->payload[1], max_size - 1) + 1;
                         assert(msg->context.size > 1);
                     }
+                    #if PBIO_CONFIG_LOGGER
+                    else if (msg == &log_msg) {
+                        msg->payload[0] = PBIO_PYBRICKS_EVENT_WRITE_LOG;
+                        msg->payload[1] = log_stream->num_cols;
+                        msg->context.size = pbio_logger_stream_read(log_stream, &msg->payload[2], max_size - 2) + 2;
+                        assert(msg->context.size > 2);
+                    }
+                    #endif // PBIO_CONFIG_LOGGER
 
                     msg->context.data = &msg->payload[0];
                     send_busy = true;
@@ -385,6 +492,14 @@ PROCESS_THREAD(pbsys_bluetooth_process, ev, data) {
                 }
             }
 
+            #if PBIO_CONFIG_LOGGER
+            // Rows are added by the motor process, which does not notify us,
+            // so check back periodically while a log is being streamed.
+            if (log_stream) {
+                etimer_set(&log_timer, LOG_STREAM_POLL_MS);
+            }
+            #endif // PBIO_CONFIG_LOGGER
+
             PROCESS_WAIT_EVENT();
         }
 
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2022-2023 The Pybricks Authors
+// Copyright (c) 2022-2024 The Pybricks Authors
 
 #include <assert.h>
 #include <stdint.h>
@@ -51,6 +51,9 @@ pbio_pybricks_error_t pbsys_command(const uint8_t *data, uint32_t size) {
             #endif
             // If no consumers are configured, goes to "/dev/null" without error
             return PBIO_PYBRICKS_ERROR_OK;
+        case PBIO_PYBRICKS_COMMAND_REUSE_USER_PROGRAM_MODULES:
+            return pbio_pybricks_error_from_pbio_error(pbsys_storage_reuse_program_modules(
+                &data[1], size - 1));
         default:
             return PBIO_PYBRICKS_ERROR_INVALID_COMMAND;
     }
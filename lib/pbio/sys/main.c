@@ -54,6 +54,7 @@ int main(int argc, char **argv) {
         // Get system back in idle state.
         pbsys_status_clear(PBIO_PYBRICKS_STATUS_USER_PROGRAM_RUNNING);
         pbsys_bluetooth_rx_set_callback(NULL);
+        pbsys_bluetooth_log_stream_stop();
         pbsys_program_stop_set_buttons(PBIO_BUTTON_CENTER);
         pbio_stop_all(true);
     }
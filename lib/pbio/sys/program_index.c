@@ -0,0 +1,139 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2024 The Pybricks Authors
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <pbio/util.h>
+#include <pbsys/main.h>
+#include <pbsys/program_index.h>
+
+/** Index entry for one module. */
+typedef struct {
+    /** Hash of the module name. */
+    uint32_t hash;
+    /** The module header. */
+    uint8_t *module;
+} pbsys_program_index_entry_t;
+
+// Index of the modules in the program data, sorted by name hash.
+static pbsys_program_index_entry_t *index_entries;
+static size_t index_len;
+
+// First module that did not fit in the index, or the end of the program.
+static uint8_t *unindexed_start;
+static uint8_t *code_end;
+
+static uint32_t get_hash(const char *name, size_t len) {
+    // Bernstein hash, like the one used for qstrs.
+    uint32_t hash = 5381;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash * 33) ^ (uint8_t)name[i];
+    }
+    return hash;
+}
+
+static const char *get_name(uint8_t *module) {
+    return (const char *)module + sizeof(uint32_t);
+}
+
+static uint8_t *get_next(uint8_t *module) {
+    return module + sizeof(uint32_t) + strlen(get_name(module)) + 1 + pbio_get_uint32_le(module);
+}
+
+/**
+ * Builds the index of modules in the program data.
+ *
+ * The index is placed in the free user RAM right after the program data, so
+ * this must be called before that memory is used for anything else. If there
+ * is not enough room to index all modules, the remaining modules are still
+ * found by pbsys_program_index_find(), but more slowly.
+ *
+ * @param [in]  program     The program data.
+ * @return                  The start of the free user RAM after the index.
+ */
+void *pbsys_program_index_init(pbsys_main_program_t *program) {
+
+    // Place the index right after the program data, aligned for its entries.
+    uintptr_t index_start = ((uintptr_t)program->code_end + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+    index_entries = (pbsys_program_index_entry_t *)index_start;
+    index_len = 0;
+    code_end = program->code_end;
+
+    uint8_t *module;
+    for (module = program->code_start; module < code_end; module = get_next(module)) {
+
+        // Stop if there is no space left. The remaining modules are not
+        // indexed and have to be searched one by one.
+        if ((uint8_t *)&index_entries[index_len + 1] > (uint8_t *)program->data_end) {
+            break;
+        }
+
+        // Insert sorted by hash. There are usually few modules, and they are
+        // indexed only once, so insertion sort is good enough. Entries with
+        // equal hashes stay in program order.
+        pbsys_program_index_entry_t entry = {
+            .hash = get_hash(get_name(module), strlen(get_name(module))),
+            .module = module,
+        };
+        size_t i = index_len++;
+        for (; i > 0 && index_entries[i - 1].hash > entry.hash; i--) {
+            index_entries[i] = index_entries[i - 1];
+        }
+        index_entries[i] = entry;
+    }
+    unindexed_start = module;
+
+    // Without an index, the aligned start may be past the end of user RAM.
+    if (index_len == 0) {
+        return program->code_end;
+    }
+    return &index_entries[index_len];
+}
+
+/**
+ * Finds a module in the program data.
+ *
+ * If more than one module has this name, the first one in the program data
+ * is found.
+ *
+ * @param [in]  name    The fully qualified name of the module.
+ * @param [in]  len     The length of @p name.
+ * @return              The module header or NULL if the module was not found.
+ */
+uint8_t *pbsys_program_index_find(const char *name, size_t len) {
+    uint32_t hash = get_hash(name, len);
+
+    // Find the first entry with this hash.
+    size_t lo = 0;
+    size_t hi = index_len;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (index_entries[mid].hash < hash) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    // Compare names of all entries with this hash.
+    for (size_t i = lo; i < index_len && index_entries[i].hash == hash; i++) {
+        const char *module_name = get_name(index_entries[i].module);
+        if (strncmp(module_name, name, len) == 0 && module_name[len] == '\0') {
+            return index_entries[i].module;
+        }
+    }
+
+    // Indexed modules come before the others, so only search the rest if the
+    // module is not indexed.
+    for (uint8_t *module = unindexed_start; module < code_end; module = get_next(module)) {
+        const char *module_name = get_name(module);
+        if (strncmp(module_name, name, len) == 0 && module_name[len] == '\0') {
+            return module;
+        }
+    }
+
+    return NULL;
+}
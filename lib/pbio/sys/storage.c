@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2022 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 #include <pbsys/config.h>
 
@@ -12,8 +12,11 @@
 #include <contiki.h>
 
 #include <pbdrv/block_device.h>
+#include <pbdrv/legodev.h>
+#include <pbio/int_math.h>
 #include <pbio/main.h>
 #include <pbio/protocol.h>
+#include <pbio/util.h>
 #include <pbio/version.h>
 #include <pbsys/main.h>
 #include <pbsys/storage.h>
@@ -175,6 +178,115 @@ pbio_error_t pbsys_storage_set_program_data(uint32_t offset, const void *data, u
     return PBIO_SUCCESS;
 }
 
+/**
+ * Maximum number of modules that can be reused in one command. Together with
+ * the command byte, this fits in the largest possible characteristic value
+ * of 512 bytes.
+ */
+#define PBSYS_STORAGE_MAX_REUSED_MODULES (63)
+
+/**
+ * Moves modules of the currently loaded program to where they should be in a
+ * new program, so that only modules that changed have to be written again.
+ *
+ * The program data is a concatenation of modules. Each one starts with its
+ * size (32-bit little-endian), followed by its zero-terminated name and data.
+ * Modules are identified by the CRC-32 of all of this, so a module is only
+ * reused if its name and contents are unchanged.
+ *
+ * All modules to reuse must be given at once, before writing any other data
+ * of the new program and before changing the program size, since this scans
+ * the program that is currently loaded. Modules must be given in the order in
+ * which they appear in both programs. This lets all modules be moved in place
+ * without overwriting each other.
+ *
+ * @param [in]  data        Pairs of module checksum and the offset of the
+ *                          module in the new program (both 32-bit
+ *                          little-endian).
+ * @param [in]  size        The size of @p data.
+ *
+ * @returns                 ::PBIO_ERROR_INVALID_ARG if a module is not found,
+ *                          if the modules are not in order, or if the new
+ *                          offsets are outside of the allocated user RAM.
+ *                          ::PBIO_ERROR_BUSY if the user program is running.
+ *                          Otherwise ::PBIO_SUCCESS.
+ */
+pbio_error_t pbsys_storage_reuse_program_modules(const uint8_t *data, uint32_t size) {
+
+    uint32_t num_modules = size / (2 * sizeof(uint32_t));
+    if (size % (2 * sizeof(uint32_t)) || num_modules > PBSYS_STORAGE_MAX_REUSED_MODULES) {
+        return PBIO_ERROR_INVALID_ARG;
+    }
+
+    // We can't allow this to be changed while a user program is running.
+    if (pbsys_status_test(PBIO_PYBRICKS_STATUS_USER_PROGRAM_RUNNING)) {
+        return PBIO_ERROR_BUSY;
+    }
+
+    // Offset and size of the requested modules in the loaded program. These
+    // are static to keep them off the stack of the command handler.
+    static uint32_t old_offsets[PBSYS_STORAGE_MAX_REUSED_MODULES];
+    static uint32_t sizes[PBSYS_STORAGE_MAX_REUSED_MODULES];
+    for (uint32_t i = 0; i < num_modules; i++) {
+        sizes[i] = 0;
+    }
+
+    // Find the requested modules in one pass over the loaded program, so each
+    // module is only checksummed once.
+    uint32_t program_size = pbio_int_math_min(map->program_size, PBSYS_STORAGE_MAX_PROGRAM_SIZE);
+    uint32_t offset = 0;
+    while (offset + sizeof(uint32_t) < program_size) {
+        uint8_t *module = map->program_data + offset;
+        uint32_t name_size = strnlen((char *)module + sizeof(uint32_t), program_size - offset - sizeof(uint32_t)) + 1;
+        uint32_t module_size = sizeof(uint32_t) + name_size + pbio_get_uint32_le(module);
+        if (module_size > program_size - offset) {
+            break;
+        }
+
+        uint32_t checksum = pbio_crc32(module, module_size);
+        for (uint32_t i = 0; i < num_modules; i++) {
+            if (sizes[i] == 0 && pbio_get_uint32_le(&data[i * 8]) == checksum) {
+                old_offsets[i] = offset;
+                sizes[i] = module_size;
+                break;
+            }
+        }
+        offset += module_size;
+    }
+
+    // Verify that all modules were found, that they are in order, and that
+    // they fit before moving anything.
+    for (uint32_t i = 0; i < num_modules; i++) {
+        uint32_t new_offset = pbio_get_uint32_le(&data[i * 8 + 4]);
+        if (sizes[i] == 0 || new_offset > PBSYS_STORAGE_MAX_PROGRAM_SIZE - sizes[i]) {
+            return PBIO_ERROR_INVALID_ARG;
+        }
+        if (i > 0 && (old_offsets[i] <= old_offsets[i - 1] ||
+                      new_offset < pbio_get_uint32_le(&data[i * 8 - 4]) + sizes[i - 1])) {
+            return PBIO_ERROR_INVALID_ARG;
+        }
+    }
+
+    // Modules that move towards the start are moved first, starting with the
+    // first one. Since modules stay in order, each one only overwrites data
+    // that was already moved or is not used. Likewise, modules that move
+    // towards the end are moved starting with the last one.
+    for (uint32_t i = 0; i < num_modules; i++) {
+        uint32_t new_offset = pbio_get_uint32_le(&data[i * 8 + 4]);
+        if (new_offset < old_offsets[i]) {
+            memmove(map->program_data + new_offset, map->program_data + old_offsets[i], sizes[i]);
+        }
+    }
+    for (uint32_t i = num_modules; i > 0; i--) {
+        uint32_t new_offset = pbio_get_uint32_le(&data[i * 8 - 4]);
+        if (new_offset > old_offsets[i - 1]) {
+            memmove(map->program_data + new_offset, map->program_data + old_offsets[i - 1], sizes[i - 1]);
+        }
+    }
+
+    return PBIO_SUCCESS;
+}
+
 /**
  * Asserts that the loaded/stored user program is valid and ready to run.
  *
@@ -258,6 +370,11 @@ PROCESS_THREAD(pbsys_storage_process, ev, data) {
     // Apply loaded settings as necesary.
     pbsys_storage_settings_apply_loaded_settings(&map->settings);
 
+    #if PBDRV_CONFIG_LEGODEV_INFO_CACHE
+    // Let devices use previously received info, and save it when it changes.
+    pbdrv_legodev_set_info_cache(&map->legodev_info_cache, pbsys_storage_request_write);
+    #endif
+
     // Poke processes that await on system settings to become available.
     data_map_is_loaded = true;
     process_post(PROCESS_BROADCAST, PROCESS_EVENT_COM, NULL);
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2022 The Pybricks Authors
+// Copyright (c) 2022-2024 The Pybricks Authors
 
 #ifndef _PBSYS_SYS_STORAGE_H_
 #define _PBSYS_SYS_STORAGE_H_
@@ -17,6 +17,7 @@ void pbsys_storage_init(void);
 void pbsys_storage_deinit(void);
 pbio_error_t pbsys_storage_set_program_size(uint32_t size);
 pbio_error_t pbsys_storage_set_program_data(uint32_t offset, const void *data, uint32_t size);
+pbio_error_t pbsys_storage_reuse_program_modules(const uint8_t *data, uint32_t size);
 pbio_error_t pbsys_storage_assert_program_valid(void);
 void pbsys_storage_get_program_data(pbsys_main_program_t *program);
 pbsys_storage_settings_t *pbsys_storage_settings_get_settings(void);
@@ -36,6 +37,9 @@ static inline pbio_error_t pbsys_storage_set_program_size(uint32_t size) {
 static inline pbio_error_t pbsys_storage_set_program_data(uint32_t offset, const void *data, uint32_t size) {
     return PBIO_ERROR_NOT_SUPPORTED;
 }
+static inline pbio_error_t pbsys_storage_reuse_program_modules(const uint8_t *data, uint32_t size) {
+    return PBIO_ERROR_NOT_SUPPORTED;
+}
 static inline pbio_error_t pbsys_storage_assert_program_valid(void) {
     return PBIO_ERROR_NOT_SUPPORTED;
 }
@@ -0,0 +1,355 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2024 The Pybricks Authors
+
+// Micro-benchmarks for the hot paths of the motor control loop.
+//
+// Each benchmark runs a function over a sweep of pseudo-random parameters and
+// prints one JSON object per line, so that results can be compared between
+// commits. The sweep uses a fixed seed, so the checksum of the results only
+// changes if the behavior of the benchmarked code changes.
+//
+// Usage: bench-pbio [name filter]
+//
+// Set PBIO_BENCH_SCALE to an integer to run more (or fewer) iterations.
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <pbdrv/legodev.h>
+#include <pbio/angle.h>
+#include <pbio/control.h>
+#include <pbio/differentiator.h>
+#include <pbio/int_math.h>
+#include <pbio/observer.h>
+#include <pbio/servo.h>
+#include <pbio/trajectory.h>
+#include <pbio/util.h>
+
+#define MDEG_PER_DEG (1000)
+
+// Number of parameter sets in each sweep.
+#define NUM_SWEEP (4096)
+
+// Iteration scale factor set by PBIO_BENCH_SCALE.
+static uint32_t scale = 1;
+
+// State of the pseudo-random number generator.
+static uint32_t rand_state;
+
+// Gets the next pseudo-random number (xorshift32).
+static uint32_t bench_rand(void) {
+    rand_state ^= rand_state << 13;
+    rand_state ^= rand_state >> 17;
+    rand_state ^= rand_state << 5;
+    return rand_state;
+}
+
+// Gets a pseudo-random number in the range [min, max].
+static int32_t bench_rand_range(int32_t min, int32_t max) {
+    return min + (int32_t)(bench_rand() % (uint32_t)(max - min + 1));
+}
+
+static uint64_t bench_time_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/**
+ * Result of one benchmark.
+ */
+typedef struct {
+    /** Number of calls to the benchmarked function. */
+    uint64_t calls;
+    /** Total time spent in the timed section. */
+    uint64_t time_ns;
+    /** Sum of results, to detect behavior changes and keep calls from being optimized out. */
+    uint32_t checksum;
+} bench_result_t;
+
+typedef void (*bench_func_t)(bench_result_t *result);
+
+// Motor types used in the sweeps.
+static const pbdrv_legodev_type_id_t motor_types[] = {
+    PBDRV_LEGODEV_TYPE_ID_INTERACTIVE_MOTOR,
+    PBDRV_LEGODEV_TYPE_ID_TECHNIC_L_MOTOR,
+    PBDRV_LEGODEV_TYPE_ID_SPIKE_S_MOTOR,
+    PBDRV_LEGODEV_TYPE_ID_TECHNIC_M_ANGULAR_MOTOR,
+    PBDRV_LEGODEV_TYPE_ID_TECHNIC_L_ANGULAR_MOTOR,
+};
+
+// Control loop times used in the sweeps (ms).
+static const uint32_t loop_times[] = { 1, 2, 5, 10 };
+
+// Gets a random motor model for a random loop time.
+static const pbio_observer_model_t *bench_rand_model(pbdrv_legodev_type_id_t *type, uint32_t *loop_time) {
+    for (;;) {
+        *type = motor_types[bench_rand() % PBIO_ARRAY_SIZE(motor_types)];
+        *loop_time = loop_times[bench_rand() % PBIO_ARRAY_SIZE(loop_times)];
+        const pbio_observer_model_t *model;
+        const pbio_servo_settings_reduced_t *settings = pbio_servo_get_reduced_settings(*type);
+        if (settings && pbio_servo_get_model(settings, *loop_time, &model) == PBIO_SUCCESS) {
+            return model;
+        }
+    }
+}
+
+// Gets a random but valid trajectory command. Speeds are whole degrees per
+// second, like the speeds that the control layer passes in.
+static void bench_rand_command(pbio_trajectory_command_t *command) {
+    int32_t speed_max = bench_rand_range(100, 2000);
+    *command = (pbio_trajectory_command_t) {
+        .time_start = bench_rand(),
+        .position_start = {
+            .rotations = bench_rand_range(-100, 100),
+            .millidegrees = bench_rand_range(-359999, 359999),
+        },
+        .position_end = {
+            .rotations = bench_rand_range(-100, 100),
+            .millidegrees = bench_rand_range(-359999, 359999),
+        },
+        .duration = bench_rand_range(0, 10000) * PBIO_TRAJECTORY_TICKS_PER_MS,
+        .speed_start = bench_rand_range(-speed_max, speed_max) * MDEG_PER_DEG,
+        .speed_target = bench_rand_range(-speed_max, speed_max) * MDEG_PER_DEG,
+        .speed_max = speed_max * MDEG_PER_DEG,
+        .acceleration = bench_rand_range(50, 20000) * MDEG_PER_DEG,
+        .deceleration = bench_rand_range(50, 20000) * MDEG_PER_DEG,
+        .speed_end = 0,
+        .jerk = bench_rand() % 2 ? 0 : bench_rand_range(1000, 200000) * MDEG_PER_DEG,
+        .continue_running = bench_rand() % 4 == 0,
+    };
+}
+
+static void bench_trajectory_new_angle_command(bench_result_t *result) {
+    static pbio_trajectory_command_t commands[NUM_SWEEP];
+    for (uint32_t i = 0; i < NUM_SWEEP; i++) {
+        bench_rand_command(&commands[i]);
+    }
+
+    pbio_trajectory_t trj;
+    uint64_t start = bench_time_ns();
+    for (uint32_t n = 0; n < 50 * scale; n++) {
+        for (uint32_t i = 0; i < NUM_SWEEP; i++) {
+            if (pbio_trajectory_new_angle_command(&trj, &commands[i]) == PBIO_SUCCESS) {
+                result->checksum += trj.t3 + trj.th3;
+            }
+        }
+    }
+    result->time_ns = bench_time_ns() - start;
+    result->calls = 50 * scale * NUM_SWEEP;
+}
+
+static void bench_trajectory_get_reference(bench_result_t *result) {
+    pbio_trajectory_command_t command;
+    pbio_trajectory_t trj;
+    pbio_trajectory_reference_t ref;
+
+    for (uint32_t i = 0; i < 50 * scale; i++) {
+        bench_rand_command(&command);
+        if (pbio_trajectory_new_angle_command(&trj, &command) != PBIO_SUCCESS) {
+            continue;
+        }
+
+        // Evaluate like the control loop does, plus some time after the end.
+        int32_t loop_time = loop_times[bench_rand() % PBIO_ARRAY_SIZE(loop_times)] * PBIO_TRAJECTORY_TICKS_PER_MS;
+        int32_t duration = pbio_int_math_min(pbio_int_math_abs(trj.t3), 20000 * PBIO_TRAJECTORY_TICKS_PER_MS) + 500 * PBIO_TRAJECTORY_TICKS_PER_MS;
+
+        uint64_t start = bench_time_ns();
+        for (int32_t t = 0; t < duration; t += loop_time) {
+            pbio_trajectory_get_reference(&trj, command.time_start + t, &ref);
+            result->checksum += ref.position.millidegrees + ref.speed;
+        }
+        result->time_ns += bench_time_ns() - start;
+        result->calls += (duration + loop_time - 1) / loop_time;
+    }
+}
+
+// Initializes controller settings the same way as servo.c does.
+static void bench_control_init(pbio_control_t *ctl, const pbio_observer_model_t *model, uint32_t loop_time) {
+    int32_t max_torque = pbio_observer_voltage_to_torque(model, 9000);
+    int32_t nominal_torque = pbio_observer_voltage_to_torque(model, 7500);
+    int32_t precision_profile = bench_rand_range(5, 20);
+
+    memset(ctl, 0, sizeof(pbio_control_t));
+    ctl->settings = (pbio_control_settings_t) {
+        .ctl_steps_per_app_step = MDEG_PER_DEG,
+        .stall_speed_limit = 20 * MDEG_PER_DEG,
+        .stall_time = pbio_control_time_ms_to_ticks(200),
+        .speed_max = 1000 * MDEG_PER_DEG,
+        .speed_default = 1000 * MDEG_PER_DEG,
+        .speed_tolerance = 50 * MDEG_PER_DEG,
+        .position_tolerance = precision_profile * MDEG_PER_DEG,
+        .acceleration = 2000 * MDEG_PER_DEG,
+        .deceleration = 2000 * MDEG_PER_DEG,
+        .actuation_max = max_torque,
+        .actuation_max_temporary = max_torque,
+        .pid_kp = nominal_torque / precision_profile,
+        .pid_ki = nominal_torque / precision_profile / 2,
+        .pid_kd = nominal_torque / precision_profile / 8,
+        .pid_kp_low_pct = 50,
+        .pid_kp_low_error_threshold = 5 * MDEG_PER_DEG,
+        .pid_kp_low_speed_threshold = 250 * MDEG_PER_DEG,
+        .integral_deadzone = 8 * MDEG_PER_DEG,
+        .integral_change_max = 15 * MDEG_PER_DEG,
+        .smart_passive_hold_time = pbio_control_time_ms_to_ticks(100),
+        .loop_time = loop_time,
+    };
+    pbio_control_reset(ctl);
+}
+
+static void bench_control_update(bench_result_t *result) {
+    pbio_control_t ctl;
+    pbio_control_state_t state = { 0 };
+    pbio_trajectory_reference_t ref;
+    pbio_dcmotor_actuation_t actuation;
+    int32_t control;
+    bool external_pause = false;
+
+    for (uint32_t i = 0; i < 20 * scale; i++) {
+        pbdrv_legodev_type_id_t type;
+        uint32_t loop_time;
+        const pbio_observer_model_t *model = bench_rand_model(&type, &loop_time);
+        bench_control_init(&ctl, model, loop_time);
+
+        // Run a series of random position commands from the same state.
+        uint32_t time = bench_rand();
+        for (uint32_t j = 0; j < 20; j++) {
+            int32_t target = pbio_control_settings_ctl_to_app_long(&ctl.settings, &state.position) + bench_rand_range(-720, 720);
+            int32_t speed = bench_rand_range(100, 1000);
+            if (pbio_control_start_position_control(&ctl, time, &state, target, speed, PBIO_CONTROL_ON_COMPLETION_HOLD) != PBIO_SUCCESS) {
+                continue;
+            }
+
+            // Update at a fixed interval while the system loosely follows
+            // the reference, like a motor under load would.
+            uint32_t steps = bench_rand_range(50, 1000);
+            uint64_t start = bench_time_ns();
+            for (uint32_t k = 0; k < steps; k++) {
+                pbio_control_update(&ctl, time, &state, &ref, &actuation, &control, &external_pause);
+                result->checksum += control + actuation;
+
+                time += loop_time * PBIO_TRAJECTORY_TICKS_PER_MS;
+                state.position = ref.position;
+                pbio_angle_add_mdeg(&state.position, bench_rand_range(-2000, 2000));
+                state.position_estimate = state.position;
+                state.speed = ref.speed + bench_rand_range(-20000, 20000);
+                state.speed_estimate = state.speed;
+            }
+            result->time_ns += bench_time_ns() - start;
+            result->calls += steps;
+        }
+    }
+}
+
+static void bench_observer_update(bench_result_t *result) {
+    pbio_observer_t obs;
+    pbio_angle_t angle;
+
+    for (uint32_t i = 0; i < 200 * scale; i++) {
+        pbdrv_legodev_type_id_t type;
+        uint32_t loop_time;
+        const pbio_observer_model_t *model = bench_rand_model(&type, &loop_time);
+
+        memset(&obs, 0, sizeof(obs));
+        obs.settings = (pbio_observer_settings_t) {
+            .stall_speed_limit = 20 * MDEG_PER_DEG,
+            .stall_time = pbio_control_time_ms_to_ticks(200),
+            .feedback_voltage_negligible = pbio_observer_torque_to_voltage(model, model->torque_friction) * 5 / 2,
+            .feedback_voltage_stall_ratio = 75,
+            .feedback_gain_low = 150,
+            .feedback_gain_high = 150 * 7,
+            .feedback_gain_threshold = 20 * MDEG_PER_DEG,
+            .coulomb_friction_speed_cutoff = 500,
+        };
+        angle.rotations = bench_rand_range(-100, 100);
+        angle.millidegrees = bench_rand_range(-359999, 359999);
+        pbio_observer_set_model(&obs, model, loop_time);
+        pbio_observer_reset(&obs, &angle);
+
+        // Apply random voltages and measured angles, including stalls.
+        uint32_t time = bench_rand();
+        int32_t speed = 0;
+        uint64_t start = bench_time_ns();
+        for (uint32_t k = 0; k < 500; k++) {
+            if (k % 50 == 0) {
+                speed = bench_rand_range(-1000, 1000) * MDEG_PER_DEG;
+            }
+            pbio_angle_add_mdeg(&angle, speed * (int32_t)loop_time / 1000);
+            int32_t voltage = bench_rand_range(-9000, 9000);
+            pbio_observer_update(&obs, time, &angle, PBIO_DCMOTOR_ACTUATION_VOLTAGE, voltage);
+            result->checksum += obs.speed + obs.current + obs.angle.millidegrees;
+            time += loop_time * PBIO_TRAJECTORY_TICKS_PER_MS;
+        }
+        result->time_ns += bench_time_ns() - start;
+        result->calls += 500;
+    }
+}
+
+static void bench_differentiator_update_and_get_speed(bench_result_t *result) {
+    static pbio_angle_t angles[NUM_SWEEP];
+    pbio_differentiator_t dif;
+
+    // Random walk with random speed changes.
+    int32_t speed = 0;
+    angles[0] = (pbio_angle_t) { .rotations = 0, .millidegrees = 0 };
+    for (uint32_t i = 1; i < NUM_SWEEP; i++) {
+        if (i % 64 == 0) {
+            speed = bench_rand_range(-10000, 10000);
+        }
+        angles[i] = angles[i - 1];
+        pbio_angle_add_mdeg(&angles[i], speed + bench_rand_range(-100, 100));
+    }
+
+    pbio_differentiator_reset(&dif, &angles[0]);
+    uint64_t start = bench_time_ns();
+    for (uint32_t n = 0; n < 200 * scale; n++) {
+        pbio_differentiator_set_loop_time(&dif, loop_times[n % PBIO_ARRAY_SIZE(loop_times)]);
+        for (uint32_t i = 0; i < NUM_SWEEP; i++) {
+            result->checksum += pbio_differentiator_update_and_get_speed(&dif, &angles[i]);
+        }
+    }
+    result->time_ns = bench_time_ns() - start;
+    result->calls = 200 * scale * NUM_SWEEP;
+}
+
+static const struct {
+    const char *name;
+    bench_func_t func;
+} benchmarks[] = {
+    { "trajectory_new_angle_command", bench_trajectory_new_angle_command },
+    { "trajectory_get_reference", bench_trajectory_get_reference },
+    { "control_update", bench_control_update },
+    { "observer_update", bench_observer_update },
+    { "differentiator_update_and_get_speed", bench_differentiator_update_and_get_speed },
+};
+
+int main(int argc, const char **argv) {
+    const char *filter = argc > 1 ? argv[1] : "";
+
+    const char *pbio_bench_scale = getenv("PBIO_BENCH_SCALE");
+    if (pbio_bench_scale) {
+        scale = atoi(pbio_bench_scale);
+    }
+
+    for (uint32_t i = 0; i < PBIO_ARRAY_SIZE(benchmarks); i++) {
+        if (!strstr(benchmarks[i].name, filter)) {
+            continue;
+        }
+
+        // Every benchmark gets the same sweep, regardless of which ones run.
+        rand_state = 0x12345678;
+        bench_result_t result = { 0 };
+        benchmarks[i].func(&result);
+
+        printf("{\"name\": \"%s\", \"calls\": %" PRIu64 ", \"ns_per_call\": %.2f, \"checksum\": %" PRIu32 "}\n",
+            benchmarks[i].name, result.calls,
+            result.calls ? (double)result.time_ns / result.calls : 0.0, result.checksum);
+    }
+
+    return 0;
+}
@@ -0,0 +1,204 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2024 The Pybricks Authors
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <tinytest.h>
+#include <tinytest_macros.h>
+
+#include <pbio/error.h>
+#include <pbio/util.h>
+#include <test-pbio.h>
+
+#include "../drv/block_device/block_device.h"
+
+// RAM-backed stand-in for the internal flash of a hub with 2K pages.
+#define PAGE_SIZE (2 * 1024)
+#define NUM_PAGES (8)
+#define STORAGE_SIZE (PAGE_SIZE * NUM_PAGES)
+
+static uint8_t flash[STORAGE_SIZE];
+
+// Pages that were erased and written since the last reset_flash_log().
+static bool page_written[NUM_PAGES];
+static uint32_t num_pages_written;
+
+// Error to return when writing, to simulate a failed erase.
+static pbio_error_t write_err;
+
+static pbio_error_t write_page(uint32_t offset, const uint8_t *data, uint32_t size) {
+    if (write_err != PBIO_SUCCESS) {
+        return write_err;
+    }
+
+    page_written[offset / PAGE_SIZE] = true;
+    num_pages_written++;
+
+    // Erase, then program.
+    memset(flash + offset, 0xFF, PAGE_SIZE);
+    if (size) {
+        memcpy(flash + offset, data, size);
+    }
+    return PBIO_SUCCESS;
+}
+
+static void reset_flash_log(void) {
+    memset(page_written, 0, sizeof(page_written));
+    num_pages_written = 0;
+    write_err = PBIO_SUCCESS;
+}
+
+static pbio_error_t store(const uint8_t *data, uint32_t size) {
+    return pbdrv_block_device_store_pages(flash, STORAGE_SIZE, PAGE_SIZE, data, size, write_page);
+}
+
+static void fill_image(uint8_t *image, uint32_t size, uint8_t seed) {
+    for (uint32_t i = 0; i < size; i++) {
+        image[i] = (uint8_t)(i * 7 + seed);
+    }
+}
+
+// Checks that the flash holds the data, and is blank after it.
+static bool flash_holds(const uint8_t *data, uint32_t size) {
+    if (memcmp(flash, data, size)) {
+        return false;
+    }
+    for (uint32_t i = size; i < STORAGE_SIZE; i++) {
+        if (flash[i] != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static uint8_t image[STORAGE_SIZE];
+
+static void test_block_device_unchanged_pages(void *env) {
+    // Three and a half pages of data.
+    const uint32_t size = PAGE_SIZE * 3 + PAGE_SIZE / 2;
+
+    memset(flash, 0xFF, sizeof(flash));
+    fill_image(image, size, 0);
+
+    // Only the pages with data are written to blank flash.
+    reset_flash_log();
+    tt_want_int_op(store(image, size), ==, PBIO_SUCCESS);
+    tt_want_int_op(num_pages_written, ==, 4);
+    tt_want(flash_holds(image, size));
+
+    // Storing the same data again writes nothing.
+    reset_flash_log();
+    tt_want_int_op(store(image, size), ==, PBIO_SUCCESS);
+    tt_want_int_op(num_pages_written, ==, 0);
+    tt_want(flash_holds(image, size));
+}
+
+static void test_block_device_changed_middle_page(void *env) {
+    const uint32_t size = PAGE_SIZE * 3 + PAGE_SIZE / 2;
+
+    memset(flash, 0xFF, sizeof(flash));
+    fill_image(image, size, 0);
+    tt_want_int_op(store(image, size), ==, PBIO_SUCCESS);
+
+    // Changing one byte only rewrites the page that holds it.
+    image[PAGE_SIZE + 100]++;
+    reset_flash_log();
+    tt_want_int_op(store(image, size), ==, PBIO_SUCCESS);
+    tt_want_int_op(num_pages_written, ==, 1);
+    tt_want(page_written[1]);
+    tt_want(flash_holds(image, size));
+}
+
+static void test_block_device_partial_last_page(void *env) {
+    const uint32_t size = PAGE_SIZE * 2 + 64;
+
+    // The data is already there, but the rest of the last page is not blank.
+    memset(flash, 0xFF, sizeof(flash));
+    fill_image(image, size, 0);
+    memcpy(flash, image, size);
+    flash[size + 8] = 0;
+
+    // Only the last page is rewritten, which clears the rest of it.
+    reset_flash_log();
+    tt_want_int_op(store(image, size), ==, PBIO_SUCCESS);
+    tt_want_int_op(num_pages_written, ==, 1);
+    tt_want(page_written[2]);
+    tt_want(flash_holds(image, size));
+}
+
+static void test_block_device_large_then_small(void *env) {
+    const uint32_t size_large = PAGE_SIZE * 6 + 200;
+    const uint32_t size_small = PAGE_SIZE * 2 + PAGE_SIZE / 2;
+
+    memset(flash, 0xFF, sizeof(flash));
+    fill_image(image, size_large, 0);
+    tt_want_int_op(store(image, size_large), ==, PBIO_SUCCESS);
+    tt_want(flash_holds(image, size_large));
+
+    // The small image starts with the same data. The first two pages are kept,
+    // the partial page is rewritten and the old data after it is erased.
+    reset_flash_log();
+    tt_want_int_op(store(image, size_small), ==, PBIO_SUCCESS);
+    tt_want(!page_written[0]);
+    tt_want(!page_written[1]);
+    for (uint32_t i = 2; i < 7; i++) {
+        tt_want(page_written[i]);
+    }
+    tt_want(!page_written[7]);
+    tt_want_int_op(num_pages_written, ==, 5);
+    tt_want(flash_holds(image, size_small));
+
+    // Once erased, the tail is left alone.
+    reset_flash_log();
+    tt_want_int_op(store(image, size_small), ==, PBIO_SUCCESS);
+    tt_want_int_op(num_pages_written, ==, 0);
+}
+
+static void test_block_device_write_error(void *env) {
+    const uint32_t size = PAGE_SIZE;
+
+    memset(flash, 0xFF, sizeof(flash));
+    fill_image(image, size, 0);
+
+    reset_flash_log();
+    write_err = PBIO_ERROR_IO;
+    tt_want_int_op(store(image, size), ==, PBIO_ERROR_IO);
+}
+
+static void test_block_device_page_differs(void *env) {
+    // The W25Qxx driver compares one 256-byte page of a sector at a time.
+    uint8_t page[256];
+    uint8_t data[256];
+
+    fill_image(data, sizeof(data), 3);
+    memcpy(page, data, sizeof(page));
+
+    // Whole page.
+    tt_want(!pbdrv_block_device_page_differs(page, sizeof(page), data, sizeof(data)));
+    page[255]++;
+    tt_want(pbdrv_block_device_page_differs(page, sizeof(page), data, sizeof(data)));
+
+    // Partial page with blank tail.
+    memset(page + 100, 0xFF, sizeof(page) - 100);
+    tt_want(!pbdrv_block_device_page_differs(page, sizeof(page), data, 100));
+    page[200] = 0;
+    tt_want(pbdrv_block_device_page_differs(page, sizeof(page), data, 100));
+
+    // Page after the data.
+    memset(page, 0xFF, sizeof(page));
+    tt_want(!pbdrv_block_device_page_differs(page, sizeof(page), NULL, 0));
+    page[0] = 0xFE;
+    tt_want(pbdrv_block_device_page_differs(page, sizeof(page), NULL, 0));
+}
+
+struct testcase_t pbdrv_block_device_tests[] = {
+    PBIO_TEST(test_block_device_unchanged_pages),
+    PBIO_TEST(test_block_device_changed_middle_page),
+    PBIO_TEST(test_block_device_partial_last_page),
+    PBIO_TEST(test_block_device_large_then_small),
+    PBIO_TEST(test_block_device_write_error),
+    PBIO_TEST(test_block_device_page_differs),
+    END_OF_TESTCASES
+};
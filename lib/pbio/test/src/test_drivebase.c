@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2020-2022 The Pybricks Authors
+// Copyright (c) 2020-2024 The Pybricks Authors
 
 #include <errno.h>
 #include <signal.h>
@@ -51,6 +51,14 @@ static PT_THREAD(test_drivebase_basics(struct pt *pt)) {
     static int32_t turn_acceleration;
     static int32_t turn_deceleration;
 
+    static int32_t pose_x;
+    static int32_t pose_y;
+    static int32_t pose_heading;
+
+    static int32_t angle_left;
+    static int32_t angle_right;
+    static int32_t speed;
+
     static bool stalled;
     static uint32_t stall_duration;
 
@@ -81,8 +89,11 @@ static PT_THREAD(test_drivebase_basics(struct pt *pt)) {
     tt_uint_op(pbio_servo_get_servo(legodev_right, &srv_right), ==, PBIO_SUCCESS);
     tt_uint_op(pbio_servo_setup(srv_right, id, PBIO_DIRECTION_CLOCKWISE, 1000, true, 0), ==, PBIO_SUCCESS);
 
-    // Set up the drivebase.
+    // Set up the drivebase. This undoes the decimation of the servos.
+    tt_uint_op(pbio_servo_set_decimation(srv_left, 2), ==, PBIO_SUCCESS);
     tt_uint_op(pbio_drivebase_get_drivebase(&db, srv_left, srv_right, 56000, 112000), ==, PBIO_SUCCESS);
+    tt_uint_op(srv_left->decimation, ==, 1);
+    tt_uint_op(pbio_servo_get_loop_time(srv_left), ==, pbio_motor_process_get_loop_time());
     tt_uint_op(pbio_drivebase_get_state_user(db, &drive_distance, &drive_speed, &turn_angle_start, &turn_rate), ==, PBIO_SUCCESS);
     tt_uint_op(pbio_drivebase_is_stalled(db, &stalled, &stall_duration), ==, PBIO_SUCCESS);
     tt_want(!stalled);
@@ -126,10 +137,50 @@ static PT_THREAD(test_drivebase_basics(struct pt *pt)) {
     tt_want(pbio_test_int_is_close(turn_angle, turn_angle_start, 5));
     tt_want(pbio_test_int_is_close(turn_rate, 0, 10));
 
+    // Pose should have moved straight ahead.
+    tt_uint_op(pbio_drivebase_get_pose(db, &pose_x, &pose_y, &pose_heading), ==, PBIO_SUCCESS);
+    tt_want(pbio_test_int_is_close(pose_x, 1000, 30));
+    tt_want(pbio_test_int_is_close(pose_y, 0, 10));
+    tt_want(pbio_test_int_is_close(pose_heading, 0, 5));
+
+    // Reset the pose as if the robot faces 90 degrees clockwise.
+    tt_uint_op(pbio_drivebase_reset_pose(db, 0, 0, 90), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_drivebase_get_pose(db, &pose_x, &pose_y, &pose_heading), ==, PBIO_SUCCESS);
+    tt_int_op(pose_x, ==, 0);
+    tt_int_op(pose_y, ==, 0);
+    tt_int_op(pose_heading, ==, 90);
+
+    // Resetting the motor angles is not counted as motion, even if the jump
+    // is small enough to be a plausible movement.
+    tt_uint_op(pbio_servo_get_state_user(srv_left, &angle_left, &speed), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_get_state_user(srv_right, &angle_right, &speed), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_reset_angle(srv_left, angle_left + 30, false), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_reset_angle(srv_right, angle_right - 60, false), ==, PBIO_SUCCESS);
+    pbio_test_sleep_ms(&timer, 100);
+    tt_uint_op(pbio_drivebase_get_pose(db, &pose_x, &pose_y, &pose_heading), ==, PBIO_SUCCESS);
+    tt_want(pbio_test_int_is_close(pose_x, 0, 2));
+    tt_want(pbio_test_int_is_close(pose_y, 0, 2));
+    tt_want(pbio_test_int_is_close(pose_heading, 90, 1));
+
+    // Resetting them back isn't either.
+    tt_uint_op(pbio_servo_reset_angle(srv_left, angle_left, false), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_reset_angle(srv_right, angle_right, false), ==, PBIO_SUCCESS);
+    pbio_test_sleep_ms(&timer, 100);
+    tt_uint_op(pbio_drivebase_get_pose(db, &pose_x, &pose_y, &pose_heading), ==, PBIO_SUCCESS);
+    tt_want(pbio_test_int_is_close(pose_x, 0, 2));
+    tt_want(pbio_test_int_is_close(pose_y, 0, 2));
+    tt_want(pbio_test_int_is_close(pose_heading, 90, 1));
+
     // Drive straight for a distance and keep driving.
     tt_uint_op(pbio_drivebase_drive_straight(db, 1000, PBIO_CONTROL_ON_COMPLETION_CONTINUE), ==, PBIO_SUCCESS);
     pbio_test_sleep_until(pbio_drivebase_is_done(db));
 
+    // Pose should have moved to the right of the initial heading.
+    tt_uint_op(pbio_drivebase_get_pose(db, &pose_x, &pose_y, &pose_heading), ==, PBIO_SUCCESS);
+    tt_want(pbio_test_int_is_close(pose_x, 0, 10));
+    tt_want(pbio_test_int_is_close(pose_y, 1000, 30));
+    tt_want(pbio_test_int_is_close(pose_heading, 90, 5));
+
     // Target should be moving at given speed and close to target.
     tt_uint_op(pbio_drivebase_get_state_user(db, &drive_distance, &drive_speed, &turn_angle, &turn_rate), ==, PBIO_SUCCESS);
     tt_want(pbio_test_int_is_close(drive_distance, 2000, 20));
@@ -0,0 +1,161 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2024 The Pybricks Authors
+
+#include <math.h>
+
+#include <pbio/geometry.h>
+#include <pbio/util.h>
+#include <test-pbio.h>
+
+#include <tinytest.h>
+#include <tinytest_macros.h>
+
+#define float_is_close(value, target, tolerance) (fabsf((value) - (target)) <= (tolerance))
+
+static float quaternion_norm(pbio_geometry_quaternion_t *q) {
+    return sqrtf(q->q1 * q->q1 + q->q2 * q->q2 + q->q3 * q->q3 + q->q4 * q->q4);
+}
+
+// Checks that mapping a vector gives the expected result.
+static bool maps_to(pbio_geometry_matrix_3x3_t *R, pbio_geometry_xyz_t input, pbio_geometry_xyz_t expected) {
+    pbio_geometry_xyz_t output;
+    pbio_geometry_vector_map(R, &input, &output);
+    for (uint8_t i = 0; i < 3; i++) {
+        if (!float_is_close(output.values[i], expected.values[i], 1e-6f)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void test_quaternion_to_rotation_matrix(void *env) {
+    pbio_geometry_matrix_3x3_t R;
+    float c = cosf((float)M_PI / 4);
+
+    // The unit quaternion gives the identity matrix.
+    pbio_geometry_quaternion_t q = { .q1 = 0.0f, .q2 = 0.0f, .q3 = 0.0f, .q4 = 1.0f };
+    pbio_geometry_quaternion_to_rotation_matrix(&q, &R);
+    for (uint8_t i = 0; i < 9; i++) {
+        tt_want(float_is_close(R.values[i], i % 4 == 0 ? 1.0f : 0.0f, 1e-6f));
+    }
+
+    // Rotating 90 degrees about Z maps X to Y and Y to -X.
+    q = (pbio_geometry_quaternion_t) { .q1 = 0.0f, .q2 = 0.0f, .q3 = c, .q4 = c };
+    pbio_geometry_quaternion_to_rotation_matrix(&q, &R);
+    tt_want(maps_to(&R, (pbio_geometry_xyz_t) { .x = 1.0f }, (pbio_geometry_xyz_t) { .y = 1.0f }));
+    tt_want(maps_to(&R, (pbio_geometry_xyz_t) { .y = 1.0f }, (pbio_geometry_xyz_t) { .x = -1.0f }));
+    tt_want(maps_to(&R, (pbio_geometry_xyz_t) { .z = 1.0f }, (pbio_geometry_xyz_t) { .z = 1.0f }));
+
+    // Rotating 90 degrees about X maps Y to Z and Z to -Y.
+    q = (pbio_geometry_quaternion_t) { .q1 = c, .q2 = 0.0f, .q3 = 0.0f, .q4 = c };
+    pbio_geometry_quaternion_to_rotation_matrix(&q, &R);
+    tt_want(maps_to(&R, (pbio_geometry_xyz_t) { .x = 1.0f }, (pbio_geometry_xyz_t) { .x = 1.0f }));
+    tt_want(maps_to(&R, (pbio_geometry_xyz_t) { .y = 1.0f }, (pbio_geometry_xyz_t) { .z = 1.0f }));
+    tt_want(maps_to(&R, (pbio_geometry_xyz_t) { .z = 1.0f }, (pbio_geometry_xyz_t) { .y = -1.0f }));
+}
+
+static void test_quaternion_from_gravity(void *env) {
+    pbio_geometry_quaternion_t q;
+    pbio_geometry_matrix_3x3_t R;
+
+    static const pbio_geometry_xyz_t ups[] = {
+        { .x = 0.0f, .y = 0.0f, .z = 1.0f },
+        { .x = 1.0f, .y = 0.0f, .z = 0.0f },
+        { .x = 0.0f, .y = -1.0f, .z = 0.0f },
+        { .x = 0.0f, .y = 0.0f, .z = -1.0f },
+        { .x = 0.48f, .y = -0.6f, .z = 0.64f },
+    };
+
+    // The resulting orientation maps the measured up direction to Z, so the
+    // last row of the matrix is the up direction in the body frame.
+    for (uint8_t i = 0; i < PBIO_ARRAY_SIZE(ups); i++) {
+        pbio_geometry_xyz_t up = ups[i];
+        pbio_geometry_quaternion_from_gravity_unit_vector(&up, &q);
+        tt_want(float_is_close(quaternion_norm(&q), 1.0f, 1e-6f));
+        pbio_geometry_quaternion_to_rotation_matrix(&q, &R);
+        tt_want(maps_to(&R, up, (pbio_geometry_xyz_t) { .z = 1.0f }));
+    }
+}
+
+static void test_quaternion_integrate(void *env) {
+    pbio_geometry_quaternion_t q = { .q1 = 0.0f, .q2 = 0.0f, .q3 = 0.0f, .q4 = 1.0f };
+    float c = cosf((float)M_PI / 4);
+
+    // Rotating at 90 deg/s about Z for one second gives a quarter turn.
+    pbio_geometry_xyz_t w = { .x = 0.0f, .y = 0.0f, .z = 90.0f };
+    for (uint32_t i = 0; i < 1000; i++) {
+        pbio_geometry_quaternion_integrate(&q, &w, 0.001f);
+    }
+    tt_want(float_is_close(q.q1, 0.0f, 1e-6f));
+    tt_want(float_is_close(q.q2, 0.0f, 1e-6f));
+    tt_want(float_is_close(q.q3, c, 1e-4f));
+    tt_want(float_is_close(q.q4, c, 1e-4f));
+
+    // The quaternion stays normalized, even with large steps.
+    w = (pbio_geometry_xyz_t) { .x = 200.0f, .y = -500.0f, .z = 1000.0f };
+    for (uint32_t i = 0; i < 10000; i++) {
+        pbio_geometry_quaternion_integrate(&q, &w, 0.01f);
+        if (!float_is_close(quaternion_norm(&q), 1.0f, 1e-6f)) {
+            tt_fail_msg("quaternion not normalized");
+            break;
+        }
+    }
+}
+
+static void test_tilt_correction(void *env) {
+    pbio_geometry_quaternion_t q = { .q1 = 0.0f, .q2 = 0.0f, .q3 = 0.0f, .q4 = 1.0f };
+    pbio_geometry_matrix_3x3_t R;
+    pbio_geometry_xyz_t correction;
+
+    // Measured gravity in mm/s^2, tilted 30 degrees from the estimate.
+    pbio_geometry_xyz_t gravity = {
+        .x = 9806.65f * sinf((float)M_PI / 6),
+        .y = 0.0f,
+        .z = 9806.65f * cosf((float)M_PI / 6),
+    };
+    pbio_geometry_xyz_t gravity_unit;
+    pbio_geometry_vector_normalize(&gravity, &gravity_unit);
+
+    // Apply the correction with a gain of 30 deg/s for 15 seconds, at the
+    // sample time of the Prime Hub IMU.
+    float error_prev = INFINITY;
+    for (uint32_t i = 0; i < 15 * 833; i++) {
+        pbio_geometry_quaternion_to_rotation_matrix(&q, &R);
+        pbio_geometry_xyz_t up = { .x = R.m31, .y = R.m32, .z = R.m33 };
+
+        // The error is the sine of the angle between the directions. It
+        // decreases on every step.
+        pbio_geometry_xyz_t cross;
+        pbio_geometry_vector_cross_product(&up, &gravity_unit, &cross);
+        float error = sqrtf(pbio_geometry_vector_dot_product(&cross, &cross));
+        if (error > error_prev + 1e-6f) {
+            tt_fail_msg("tilt error increased");
+            break;
+        }
+        error_prev = error;
+
+        // The time constant is about 2 seconds, so by then the error is
+        // down to about a third.
+        if (i == 2 * 833) {
+            tt_want(error > 0.15f && error < 0.22f);
+        }
+
+        pbio_geometry_get_tilt_correction(&gravity, &up, 30.0f, &correction);
+        pbio_geometry_quaternion_integrate(&q, &correction, 1.0f / 833);
+    }
+    tt_want(error_prev < 1e-3f);
+
+    // Once aligned, there is nothing left to correct.
+    pbio_geometry_get_tilt_correction(&gravity, &gravity_unit, 30.0f, &correction);
+    tt_want(float_is_close(correction.x, 0.0f, 1e-6f));
+    tt_want(float_is_close(correction.y, 0.0f, 1e-6f));
+    tt_want(float_is_close(correction.z, 0.0f, 1e-6f));
+}
+
+struct testcase_t pbio_geometry_tests[] = {
+    PBIO_TEST(test_quaternion_to_rotation_matrix),
+    PBIO_TEST(test_quaternion_from_gravity),
+    PBIO_TEST(test_quaternion_integrate),
+    PBIO_TEST(test_tilt_correction),
+    END_OF_TESTCASES
+};
@@ -0,0 +1,81 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2024 The Pybricks Authors
+
+#include <stdint.h>
+#include <string.h>
+
+#include <pbio/error.h>
+#include <pbio/inflate.h>
+#include <test-pbio.h>
+
+#include <tinytest.h>
+#include <tinytest_macros.h>
+
+static pbio_inflate_t z;
+
+// Inflates exactly @p size bytes, then checks that there is no more data.
+static pbio_error_t inflate_all(const uint8_t *data, uint32_t data_size, uint8_t *out, uint32_t size) {
+    pbio_inflate_init(&z, data, data_size);
+    for (uint32_t i = 0; i < size; i++) {
+        pbio_error_t err = pbio_inflate_byte(&z, &out[i]);
+        if (err != PBIO_SUCCESS) {
+            return err;
+        }
+    }
+    uint8_t extra;
+    return pbio_inflate_byte(&z, &extra) == PBIO_ERROR_INVALID_ARG ? PBIO_SUCCESS : PBIO_ERROR_FAILED;
+}
+
+static void test_inflate(void *env) {
+    uint8_t out[2 * PBIO_INFLATE_WINDOW_SIZE + 8];
+
+    // Literals followed by a match of the last 3 bytes, then more literals.
+    static const uint8_t simple[] = { 0x03, 'a', 'b', 'c', 'd', 0x80, 0x02, 0x00, 0x00, 'e' };
+    tt_want_int_op(inflate_all(simple, sizeof(simple), out, 8), ==, PBIO_SUCCESS);
+    tt_want(memcmp(out, "abcdbcde", 8) == 0);
+
+    // A match may overlap the bytes it produces, to repeat a pattern.
+    static const uint8_t repeat[] = { 0x01, 'x', 'y', 0x83, 0x01, 0x00 };
+    tt_want_int_op(inflate_all(repeat, sizeof(repeat), out, 8), ==, PBIO_SUCCESS);
+    tt_want(memcmp(out, "xyxyxyxy", 8) == 0);
+
+    // The longest match, from as far back as the window allows.
+    static uint8_t far[2 + 0x80 * 9 + 3];
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < 8; i++) {
+        far[n++] = 0x7F;
+        for (uint32_t j = 0; j < 0x80; j++) {
+            far[n++] = i * 0x80 + j;
+        }
+    }
+    far[n++] = 0xFF;
+    far[n++] = (PBIO_INFLATE_WINDOW_SIZE - 1) & 0xFF;
+    far[n++] = (PBIO_INFLATE_WINDOW_SIZE - 1) >> 8;
+    tt_want_int_op(inflate_all(far, n, out, PBIO_INFLATE_WINDOW_SIZE + 0x7F + 3), ==, PBIO_SUCCESS);
+    tt_want(memcmp(out + PBIO_INFLATE_WINDOW_SIZE, out, 0x7F + 3) == 0);
+
+    // A match may not refer to before the start.
+    static const uint8_t before_start[] = { 0x01, 'a', 'b', 0x80, 0x02, 0x00 };
+    tt_want_int_op(inflate_all(before_start, sizeof(before_start), out, 5), ==, PBIO_ERROR_INVALID_ARG);
+
+    // A match may not refer further back than the window.
+    far[n - 2] = PBIO_INFLATE_WINDOW_SIZE & 0xFF;
+    far[n - 1] = PBIO_INFLATE_WINDOW_SIZE >> 8;
+    tt_want_int_op(inflate_all(far, n, out, PBIO_INFLATE_WINDOW_SIZE + 0x7F + 3), ==, PBIO_ERROR_INVALID_ARG);
+
+    // Literals cut short.
+    static const uint8_t short_literals[] = { 0x03, 'a', 'b' };
+    tt_want_int_op(inflate_all(short_literals, sizeof(short_literals), out, 4), ==, PBIO_ERROR_INVALID_ARG);
+
+    // Match without a complete distance.
+    static const uint8_t short_match[] = { 0x00, 'a', 0x80, 0x00 };
+    tt_want_int_op(inflate_all(short_match, sizeof(short_match), out, 4), ==, PBIO_ERROR_INVALID_ARG);
+
+    // No data at all.
+    tt_want_int_op(inflate_all(NULL, 0, out, 1), ==, PBIO_ERROR_INVALID_ARG);
+}
+
+struct testcase_t pbio_inflate_tests[] = {
+    PBIO_TEST(test_inflate),
+    END_OF_TESTCASES
+};
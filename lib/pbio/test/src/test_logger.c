@@ -0,0 +1,137 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2024 The Pybricks Authors
+
+#include <stdint.h>
+#include <string.h>
+
+#include <pbio/logger.h>
+#include <pbio/util.h>
+
+#include <test-pbio.h>
+
+#include <tinytest.h>
+#include <tinytest_macros.h>
+
+#define NUM_COLS (3)
+#define NUM_ROWS (4)
+
+static void test_logger_stream(void *env) {
+
+    static int32_t buf[NUM_ROWS * NUM_COLS];
+    static pbio_log_t log;
+    uint8_t data[NUM_COLS * NUM_ROWS * sizeof(int32_t)];
+
+    pbio_logger_start_stream(&log, buf, NUM_ROWS, NUM_COLS, 1);
+    tt_want(pbio_logger_is_active(&log));
+    tt_want(pbio_logger_is_streaming(&log));
+    tt_want_uint_op(pbio_logger_stream_get_num_rows_pending(&log), ==, 0);
+    tt_want_uint_op(pbio_logger_stream_read(&log, data, sizeof(data)), ==, 0);
+
+    // One row is kept free, so only three rows fit.
+    for (int32_t i = 0; i < NUM_ROWS; i++) {
+        int32_t row[] = { i, -i };
+        pbio_logger_add_row(&log, row);
+    }
+    tt_want(pbio_logger_is_active(&log));
+    tt_want_uint_op(pbio_logger_stream_get_num_rows_pending(&log), ==, NUM_ROWS - 1);
+    tt_want_uint_op(log.num_rows_dropped, ==, 1);
+
+    // Reading only whole values may split a row.
+    tt_want_uint_op(pbio_logger_stream_read(&log, data, 9), ==, 2 * sizeof(int32_t));
+    tt_want_int_op((int32_t)pbio_get_uint32_le(&data[4]), ==, 0);
+    tt_want_uint_op(pbio_logger_stream_get_num_rows_pending(&log), ==, NUM_ROWS - 1);
+
+    // Reading the last value of the row frees it for the producer.
+    tt_want_uint_op(pbio_logger_stream_read(&log, data, 4), ==, sizeof(int32_t));
+    tt_want_uint_op(pbio_logger_stream_get_num_rows_pending(&log), ==, NUM_ROWS - 2);
+
+    // Rows wrap around the end of the buffer.
+    int32_t row[] = { 10, -10 };
+    pbio_logger_add_row(&log, row);
+    tt_want_uint_op(log.num_rows_dropped, ==, 1);
+    tt_want_uint_op(pbio_logger_stream_get_num_rows_pending(&log), ==, NUM_ROWS - 1);
+
+    tt_want_uint_op(pbio_logger_stream_read(&log, data, sizeof(data)), ==, (NUM_ROWS - 1) * NUM_COLS * sizeof(int32_t));
+    tt_want_int_op((int32_t)pbio_get_uint32_le(&data[4]), ==, 1);
+    tt_want_int_op((int32_t)pbio_get_uint32_le(&data[8]), ==, -1);
+    tt_want_int_op((int32_t)pbio_get_uint32_le(&data[16]), ==, 2);
+    tt_want_int_op((int32_t)pbio_get_uint32_le(&data[28]), ==, 10);
+    tt_want_int_op((int32_t)pbio_get_uint32_le(&data[32]), ==, -10);
+    tt_want_uint_op(pbio_logger_stream_get_num_rows_pending(&log), ==, 0);
+
+    // Restarting in normal mode stops streaming.
+    pbio_logger_start(&log, buf, NUM_ROWS, NUM_COLS, 1);
+    tt_want(!pbio_logger_is_streaming(&log));
+    tt_want_uint_op(pbio_logger_stream_get_num_rows_pending(&log), ==, 0);
+}
+
+static void test_logger_binary(void *env) {
+
+    static int32_t buf[NUM_ROWS * NUM_COLS];
+    static pbio_log_t log;
+
+    pbio_logger_set_loop_time(&log, PBIO_CONFIG_CONTROL_LOOP_TIME_MS);
+    pbio_logger_start(&log, buf, NUM_ROWS, NUM_COLS, 2);
+
+    int32_t rows[][NUM_COLS - 1] = {
+        { 0, 0 },
+        { 63, -64 },
+        { 64, INT32_MIN },
+        { -1, INT32_MAX },
+    };
+    for (uint32_t i = 0; i < PBIO_ARRAY_SIZE(rows) * 2; i++) {
+        pbio_logger_add_row(&log, rows[i / 2]);
+    }
+    tt_want_uint_op(pbio_logger_get_num_rows_used(&log), ==, NUM_ROWS);
+
+    uint8_t header[PBIO_LOGGER_BINARY_HEADER_SIZE];
+    tt_want_uint_op(pbio_logger_binary_encode_header(&log, header), ==, PBIO_LOGGER_BINARY_HEADER_SIZE);
+    tt_want_int_op(memcmp(header, "PBLG", 4), ==, 0);
+    tt_want_uint_op(header[4], ==, PBIO_LOGGER_BINARY_VERSION);
+    tt_want_uint_op(header[5], ==, NUM_COLS);
+    tt_want_uint_op(pbio_get_uint16_le(&header[6]), ==, 2 * PBIO_CONFIG_CONTROL_LOOP_TIME_MS);
+    tt_want_uint_op(pbio_get_uint32_le(&header[8]), ==, NUM_ROWS);
+
+    // Overwrite log time column for predictable results.
+    for (uint32_t i = 0; i < NUM_ROWS; i++) {
+        pbio_logger_get_row_data(&log, i)[0] = i * 10;
+    }
+
+    int32_t previous[NUM_COLS] = { 0 };
+    uint8_t data[NUM_COLS * PBIO_LOGGER_BINARY_MAX_VALUE_SIZE];
+
+    // First row is relative to zero.
+    tt_want_uint_op(pbio_logger_binary_encode_row(&log, 0, previous, data), ==, 3);
+    tt_want_uint_op(data[0], ==, 0);
+    tt_want_uint_op(data[1], ==, 0);
+    tt_want_uint_op(data[2], ==, 0);
+
+    // Small positive and negative differences fit in one byte.
+    tt_want_uint_op(pbio_logger_binary_encode_row(&log, 1, previous, data), ==, 3);
+    tt_want_uint_op(data[0], ==, 20);
+    tt_want_uint_op(data[1], ==, 126);
+    tt_want_uint_op(data[2], ==, 127);
+
+    // Larger differences take more bytes.
+    tt_want_uint_op(pbio_logger_binary_encode_row(&log, 2, previous, data), ==, 7);
+    tt_want_uint_op(data[0], ==, 20);
+    tt_want_uint_op(data[1], ==, 2);
+    tt_want_uint_op(data[2], ==, 0xff);
+    tt_want_uint_op(data[3], ==, 0xfe);
+    tt_want_uint_op(data[4], ==, 0xff);
+    tt_want_uint_op(data[5], ==, 0xff);
+    tt_want_uint_op(data[6], ==, 0x0f);
+
+    // Differences wrap around instead of overflowing.
+    tt_want_uint_op(pbio_logger_binary_encode_row(&log, 3, previous, data), ==, 4);
+    tt_want_uint_op(data[0], ==, 20);
+    tt_want_uint_op(data[1], ==, 0x81);
+    tt_want_uint_op(data[2], ==, 0x01);
+    tt_want_uint_op(data[3], ==, 1);
+}
+
+struct testcase_t pbio_logger_tests[] = {
+    PBIO_TEST(test_logger_stream),
+    PBIO_TEST(test_logger_binary),
+    END_OF_TESTCASES
+};
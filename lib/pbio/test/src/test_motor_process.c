@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2024 The Pybricks Authors
+
+#include <stdint.h>
+
+#include <contiki.h>
+#include <tinytest.h>
+#include <tinytest_macros.h>
+
+#include <pbio/motor_process.h>
+#include <test-pbio.h>
+
+#include "../drv/core.h"
+#include "../drv/clock/clock_test.h"
+#include "../drv/motor_driver/motor_driver_virtual_simulation.h"
+
+static PT_THREAD(test_motor_process_stats(struct pt *pt)) {
+
+    static struct timer timer;
+    static const pbio_motor_process_stats_t *stats;
+
+    // Start motor driver simulation process.
+    pbdrv_motor_driver_init_manual();
+
+    PT_BEGIN(pt);
+
+    // Wait for motor simulation process to be ready.
+    while (pbdrv_init_busy()) {
+        PT_YIELD(pt);
+    }
+
+    pbio_motor_process_start();
+    stats = pbio_motor_process_get_stats();
+
+    // Updates on time have no jitter and no overruns.
+    pbio_test_sleep_ms(&timer, PBIO_CONFIG_CONTROL_LOOP_TIME_MS * 10);
+    tt_want_uint_op(stats->num_updates, >=, 9);
+    tt_want_uint_op(stats->num_overruns, ==, 0);
+    tt_want_uint_op(stats->jitter_max, ==, 0);
+    tt_want_uint_op(stats->jitter_histogram[0], ==, stats->num_updates - 1);
+
+    // Each stage is recorded once per update.
+    for (uint32_t i = 0; i < PBIO_MOTOR_PROCESS_NUM_STAGES; i++) {
+        uint32_t count = 0;
+        for (uint32_t j = 0; j < PBIO_MOTOR_PROCESS_STATS_NUM_BINS; j++) {
+            count += stats->stage_histogram[i][j];
+        }
+        tt_want_uint_op(count, ==, stats->num_updates);
+    }
+
+    // Resetting starts counting from zero.
+    pbio_motor_process_reset_stats();
+    tt_want_uint_op(stats->num_updates, ==, 0);
+    pbio_test_sleep_ms(&timer, PBIO_CONFIG_CONTROL_LOOP_TIME_MS);
+    tt_want_uint_op(stats->num_updates, ==, 1);
+
+    // A long delay is an overrun and ends up in the last bin.
+    pbio_test_clock_tick(PBIO_CONFIG_CONTROL_LOOP_TIME_MS * 4);
+    PT_YIELD(pt);
+    tt_want_uint_op(stats->num_updates, ==, 2);
+    tt_want_uint_op(stats->num_overruns, ==, 1);
+    tt_want_uint_op(stats->jitter_max, >=, PBIO_CONFIG_CONTROL_LOOP_TIME_MS * 3000);
+    tt_want_uint_op(stats->jitter_histogram[PBIO_MOTOR_PROCESS_STATS_NUM_BINS - 1], ==, 1);
+
+    PT_END(pt);
+}
+
+struct testcase_t pbio_motor_process_tests[] = {
+    PBIO_PT_THREAD_TEST(test_motor_process_stats),
+    END_OF_TESTCASES
+};
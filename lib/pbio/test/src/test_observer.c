@@ -0,0 +1,113 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2024 The Pybricks Authors
+
+#include <stdint.h>
+
+#include <pbdrv/legodev.h>
+#include <pbio/int_math.h>
+#include <pbio/observer.h>
+#include <pbio/servo.h>
+#include <pbio/util.h>
+#include <test-pbio.h>
+
+#include <tinytest.h>
+#include <tinytest_macros.h>
+
+// Number of samples for each model term.
+#define NUM_SAMPLES (2000)
+
+/**
+ * Checks that scaling by the reciprocal matches dividing by the model term
+ * exactly, for the whole range of inputs.
+ */
+static void assert_reciprocal_matches(const pbio_observer_reciprocal_t *reciprocal, int32_t prescale, int32_t divisor, int32_t max) {
+    for (int32_t i = -NUM_SAMPLES; i <= NUM_SAMPLES; i++) {
+        // Sample evenly, plus some small values around zero.
+        int32_t value = (int64_t)max * i / NUM_SAMPLES + (i % 7);
+        int32_t expected = prescale * pbio_int_math_clamp(value, max) / divisor;
+        int32_t result = pbio_observer_reciprocal_scale(reciprocal, pbio_int_math_clamp(value, max));
+        tt_want_int_op(result, ==, expected);
+    }
+}
+
+static void test_reciprocal_init(void *env) {
+    pbio_observer_reciprocal_t r;
+
+    // Simple fractions should scale exactly for positive values.
+    pbio_observer_reciprocal_init(&r, 1, 4);
+    tt_want_int_op(pbio_observer_reciprocal_scale(&r, 1000), ==, 250);
+    pbio_observer_reciprocal_init(&r, 3, 1);
+    tt_want_int_op(pbio_observer_reciprocal_scale(&r, 1000), ==, 3000);
+    pbio_observer_reciprocal_init(&r, -5, 2);
+    tt_want_int_op(pbio_observer_reciprocal_scale(&r, 1000), ==, -2500);
+    pbio_observer_reciprocal_init(&r, 5, -2);
+    tt_want_int_op(pbio_observer_reciprocal_scale(&r, -1000), ==, 2500);
+
+    // Results round toward zero, like dividing.
+    pbio_observer_reciprocal_init(&r, 1, 3);
+    tt_want_int_op(pbio_observer_reciprocal_scale(&r, 10), ==, 10 / 3);
+    tt_want_int_op(pbio_observer_reciprocal_scale(&r, -10), ==, -10 / 3);
+    tt_want_int_op(pbio_observer_reciprocal_scale(&r, 9), ==, 3);
+    tt_want_int_op(pbio_observer_reciprocal_scale(&r, -9), ==, -3);
+    pbio_observer_reciprocal_init(&r, -2, 7);
+    tt_want_int_op(pbio_observer_reciprocal_scale(&r, 10), ==, -2 * 10 / 7);
+    tt_want_int_op(pbio_observer_reciprocal_scale(&r, -10), ==, -2 * -10 / 7);
+
+    // Zero numerator gives zero.
+    pbio_observer_reciprocal_init(&r, 0, 3);
+    tt_want_int_op(pbio_observer_reciprocal_scale(&r, 12345), ==, 0);
+}
+
+static void test_model_reciprocal(void *env) {
+
+    static const pbdrv_legodev_type_id_t ids[] = {
+        PBDRV_LEGODEV_TYPE_ID_EV3_MEDIUM_MOTOR,
+        PBDRV_LEGODEV_TYPE_ID_EV3_LARGE_MOTOR,
+        PBDRV_LEGODEV_TYPE_ID_MOVE_HUB_MOTOR,
+        PBDRV_LEGODEV_TYPE_ID_INTERACTIVE_MOTOR,
+        PBDRV_LEGODEV_TYPE_ID_TECHNIC_L_MOTOR,
+        PBDRV_LEGODEV_TYPE_ID_TECHNIC_XL_MOTOR,
+        PBDRV_LEGODEV_TYPE_ID_SPIKE_S_MOTOR,
+        PBDRV_LEGODEV_TYPE_ID_TECHNIC_L_ANGULAR_MOTOR,
+        PBDRV_LEGODEV_TYPE_ID_TECHNIC_M_ANGULAR_MOTOR,
+    };
+
+    static const uint32_t loop_times[] = { 1, 2, 5, 10 };
+
+    for (uint32_t i = 0; i < PBIO_ARRAY_SIZE(ids); i++) {
+        const pbio_servo_settings_reduced_t *settings = pbio_servo_get_reduced_settings(ids[i]);
+        tt_want(settings);
+        if (!settings) {
+            continue;
+        }
+
+        for (uint32_t j = 0; j < PBIO_ARRAY_SIZE(loop_times); j++) {
+            const pbio_observer_model_t *m;
+            if (pbio_servo_get_model(settings, loop_times[j], &m) != PBIO_SUCCESS) {
+                continue;
+            }
+
+            pbio_observer_model_reciprocal_t q;
+            pbio_observer_model_get_reciprocal(m, &q);
+
+            assert_reciprocal_matches(&q.d_angle_d_speed, PBIO_OBSERVER_PRESCALE_SPEED, m->d_angle_d_speed, PBIO_OBSERVER_MAX_NUM_SPEED);
+            assert_reciprocal_matches(&q.d_speed_d_speed, PBIO_OBSERVER_PRESCALE_SPEED, m->d_speed_d_speed, PBIO_OBSERVER_MAX_NUM_SPEED);
+            assert_reciprocal_matches(&q.d_current_d_speed, PBIO_OBSERVER_PRESCALE_SPEED, m->d_current_d_speed, PBIO_OBSERVER_MAX_NUM_SPEED);
+            assert_reciprocal_matches(&q.d_angle_d_current, PBIO_OBSERVER_PRESCALE_CURRENT, m->d_angle_d_current, PBIO_OBSERVER_MAX_NUM_CURRENT);
+            assert_reciprocal_matches(&q.d_speed_d_current, PBIO_OBSERVER_PRESCALE_CURRENT, m->d_speed_d_current, PBIO_OBSERVER_MAX_NUM_CURRENT);
+            assert_reciprocal_matches(&q.d_current_d_current, PBIO_OBSERVER_PRESCALE_CURRENT, m->d_current_d_current, PBIO_OBSERVER_MAX_NUM_CURRENT);
+            assert_reciprocal_matches(&q.d_angle_d_voltage, PBIO_OBSERVER_PRESCALE_VOLTAGE, m->d_angle_d_voltage, PBIO_OBSERVER_MAX_NUM_VOLTAGE);
+            assert_reciprocal_matches(&q.d_speed_d_voltage, PBIO_OBSERVER_PRESCALE_VOLTAGE, m->d_speed_d_voltage, PBIO_OBSERVER_MAX_NUM_VOLTAGE);
+            assert_reciprocal_matches(&q.d_current_d_voltage, PBIO_OBSERVER_PRESCALE_VOLTAGE, m->d_current_d_voltage, PBIO_OBSERVER_MAX_NUM_VOLTAGE);
+            assert_reciprocal_matches(&q.d_angle_d_torque, PBIO_OBSERVER_PRESCALE_TORQUE, m->d_angle_d_torque, PBIO_OBSERVER_MAX_NUM_TORQUE);
+            assert_reciprocal_matches(&q.d_speed_d_torque, PBIO_OBSERVER_PRESCALE_TORQUE, m->d_speed_d_torque, PBIO_OBSERVER_MAX_NUM_TORQUE);
+            assert_reciprocal_matches(&q.d_current_d_torque, PBIO_OBSERVER_PRESCALE_TORQUE, m->d_current_d_torque, PBIO_OBSERVER_MAX_NUM_TORQUE);
+        }
+    }
+}
+
+struct testcase_t pbio_observer_tests[] = {
+    PBIO_TEST(test_reciprocal_init),
+    PBIO_TEST(test_model_reciprocal),
+    END_OF_TESTCASES
+};
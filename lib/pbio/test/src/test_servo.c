@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2020-2022 The Pybricks Authors
+// Copyright (c) 2020-2024 The Pybricks Authors
 
 #include <errno.h>
 #include <signal.h>
@@ -219,9 +219,207 @@ end:
     PT_END(pt);
 }
 
+#if PBIO_CONFIG_CONTROL_QUEUE
+
+static PT_THREAD(test_servo_queue(struct pt *pt)) {
+
+    static struct timer timer;
+    static int32_t angle;
+    static int32_t speed;
+    static int32_t speed_min;
+    static uint32_t stall_duration;
+    static uint32_t i;
+
+    static pbio_servo_t *srv;
+    static pbdrv_legodev_dev_t *legodev;
+
+    // Start motor driver simulation process.
+    pbdrv_motor_driver_init_manual();
+
+    PT_BEGIN(pt);
+
+    // Wait for motor simulation process to be ready.
+    while (pbdrv_init_busy()) {
+        PT_YIELD(pt);
+    }
+
+    // Start motor control process manually.
+    pbio_motor_process_start();
+
+    pbdrv_legodev_type_id_t id = PBDRV_LEGODEV_TYPE_ID_ANY_ENCODED_MOTOR;
+    tt_uint_op(pbdrv_legodev_get_device(PBIO_PORT_ID_A, &id, &legodev), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_get_servo(legodev, &srv), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_setup(srv, id, PBIO_DIRECTION_CLOCKWISE, 1000, true, 0), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_reset_angle(srv, 0, false), ==, PBIO_SUCCESS);
+
+    // The first target starts right away, the others wait in the queue.
+    tt_uint_op(pbio_servo_queue_target(srv, 500, 90, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_queue_target(srv, 500, 180, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_queue_target(srv, 500, 270, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+    tt_want_uint_op(srv->control.queue_size, ==, 2);
+    tt_want_uint_op(pbio_servo_queue_target(srv, 0, 360, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_ERROR_INVALID_ARG);
+
+    // It should not slow down at the intermediate targets.
+    speed_min = INT32_MAX;
+    while (!pbio_control_is_done(&srv->control)) {
+        tt_uint_op(pbio_servo_get_state_user(srv, &angle, &speed), ==, PBIO_SUCCESS);
+        if (angle > 60 && angle < 210) {
+            speed_min = pbio_int_math_min(speed_min, speed);
+        }
+        pbio_test_clock_tick(1);
+        PT_YIELD(pt);
+    }
+    tt_want_int_op(speed_min, >, 300);
+    tt_want_uint_op(srv->control.queue_size, ==, 0);
+    pbio_test_sleep_ms(&timer, 500);
+    tt_uint_op(pbio_servo_get_state_user(srv, &angle, &speed), ==, PBIO_SUCCESS);
+    tt_want(pbio_test_int_is_close(angle, 270, 5));
+
+    // Reversing direction goes through standstill, but still reaches the end.
+    tt_uint_op(pbio_servo_queue_target(srv, 500, 360, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_queue_target(srv, 500, 180, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+    pbio_test_sleep_until(pbio_control_is_done(&srv->control));
+    pbio_test_sleep_ms(&timer, 500);
+    tt_uint_op(pbio_servo_get_state_user(srv, &angle, &speed), ==, PBIO_SUCCESS);
+    tt_want(pbio_test_int_is_close(angle, 180, 5));
+
+    // Segments can't be added once the queue is full.
+    tt_uint_op(pbio_servo_queue_target(srv, 500, 0, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+    for (i = 0; i < PBIO_CONTROL_QUEUE_SIZE; i++) {
+        tt_uint_op(pbio_servo_queue_target(srv, 500, i * 10, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+    }
+    tt_want_uint_op(pbio_servo_queue_target(srv, 500, 90, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_ERROR_BUSY);
+
+    // Starting a new command discards the queue.
+    tt_uint_op(pbio_servo_run_target(srv, 500, 45, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+    tt_want_uint_op(srv->control.queue_size, ==, 0);
+    pbio_test_sleep_until(pbio_control_is_done(&srv->control));
+    pbio_test_sleep_ms(&timer, 500);
+    tt_uint_op(pbio_servo_get_state_user(srv, &angle, &speed), ==, PBIO_SUCCESS);
+    tt_want(pbio_test_int_is_close(angle, 45, 5));
+
+    // A stall discards the queue. The motor on port C has end stops at
+    // about 142 degrees, so it stalls on the way to the first target.
+    id = PBDRV_LEGODEV_TYPE_ID_ANY_ENCODED_MOTOR;
+    tt_uint_op(pbdrv_legodev_get_device(PBIO_PORT_ID_C, &id, &legodev), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_get_servo(legodev, &srv), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_setup(srv, id, PBIO_DIRECTION_CLOCKWISE, 1000, true, 0), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_reset_angle(srv, 0, false), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_queue_target(srv, 500, 200, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_queue_target(srv, 500, 300, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_queue_target(srv, 500, 0, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+    tt_want_uint_op(srv->control.queue_size, ==, 2);
+    pbio_test_sleep_until(pbio_control_is_stalled(&srv->control, &stall_duration));
+    tt_want_uint_op(srv->control.queue_size, ==, 0);
+    pbio_test_sleep_ms(&timer, 2000);
+    tt_uint_op(pbio_servo_get_state_user(srv, &angle, &speed), ==, PBIO_SUCCESS);
+    tt_want_int_op(angle, >, 100);
+
+end:
+
+    PT_END(pt);
+}
+
+#endif // PBIO_CONFIG_CONTROL_QUEUE
+
+#if PBIO_CONFIG_CONTROL_LOOP_TIME_RUNTIME
+
+static PT_THREAD(test_servo_loop_time(struct pt *pt)) {
+
+    static struct timer timer;
+    static int32_t angle;
+    static int32_t speed;
+
+    static pbio_servo_t *srv_fast;
+    static pbio_servo_t *srv_slow;
+    static pbdrv_legodev_dev_t *legodev;
+
+    // Start motor driver simulation process.
+    pbdrv_motor_driver_init_manual();
+
+    PT_BEGIN(pt);
+
+    // Wait for motor simulation process to be ready.
+    while (pbdrv_init_busy()) {
+        PT_YIELD(pt);
+    }
+
+    // Start motor control process manually.
+    pbio_motor_process_start();
+
+    pbdrv_legodev_type_id_t id = PBDRV_LEGODEV_TYPE_ID_ANY_ENCODED_MOTOR;
+    tt_uint_op(pbdrv_legodev_get_device(PBIO_PORT_ID_A, &id, &legodev), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_get_servo(legodev, &srv_fast), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_setup(srv_fast, id, PBIO_DIRECTION_CLOCKWISE, 1000, true, 0), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_reset_angle(srv_fast, 0, false), ==, PBIO_SUCCESS);
+
+    id = PBDRV_LEGODEV_TYPE_ID_ANY_ENCODED_MOTOR;
+    tt_uint_op(pbdrv_legodev_get_device(PBIO_PORT_ID_E, &id, &legodev), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_get_servo(legodev, &srv_slow), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_setup(srv_slow, id, PBIO_DIRECTION_CLOCKWISE, 1000, true, 0), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_reset_angle(srv_slow, 0, false), ==, PBIO_SUCCESS);
+
+    // Only loop times with motor models are accepted.
+    tt_want_uint_op(pbio_motor_process_set_loop_time(3), ==, PBIO_ERROR_INVALID_ARG);
+    tt_want_uint_op(pbio_motor_process_get_loop_time(), ==, PBIO_CONFIG_CONTROL_LOOP_TIME_MS);
+
+    // Run the control loop faster, but update one servo at the default rate.
+    tt_uint_op(pbio_motor_process_set_loop_time(1), ==, PBIO_SUCCESS);
+    tt_want_uint_op(pbio_servo_get_loop_time(srv_fast), ==, 1);
+    tt_uint_op(pbio_servo_set_decimation(srv_slow, 5), ==, PBIO_SUCCESS);
+    tt_want_uint_op(pbio_servo_get_loop_time(srv_slow), ==, 5);
+
+    // There is no model for 3 ms.
+    tt_want_uint_op(pbio_servo_set_decimation(srv_slow, 3), ==, PBIO_ERROR_NOT_SUPPORTED);
+    tt_want_uint_op(pbio_servo_get_loop_time(srv_slow), ==, 5);
+
+    // Both should still reach their targets.
+    tt_uint_op(pbio_servo_run_target(srv_fast, 500, 90, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+    tt_uint_op(pbio_servo_run_target(srv_slow, 500, 90, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+    pbio_test_sleep_until(pbio_control_is_done(&srv_fast->control) && pbio_control_is_done(&srv_slow->control));
+    pbio_test_sleep_ms(&timer, 500);
+    tt_uint_op(pbio_servo_get_state_user(srv_fast, &angle, &speed), ==, PBIO_SUCCESS);
+    tt_want(pbio_test_int_is_close(angle, 90, 5));
+    tt_uint_op(pbio_servo_get_state_user(srv_slow, &angle, &speed), ==, PBIO_SUCCESS);
+    tt_want(pbio_test_int_is_close(angle, 90, 5));
+
+    // The loop time can only change if all servos support it.
+    tt_uint_op(pbio_motor_process_set_loop_time(10), ==, PBIO_ERROR_NOT_SUPPORTED);
+    tt_want_uint_op(pbio_motor_process_get_loop_time(), ==, 1);
+    tt_uint_op(pbio_motor_process_set_loop_time(2), ==, PBIO_SUCCESS);
+    tt_want_uint_op(pbio_servo_get_loop_time(srv_fast), ==, 2);
+    tt_want_uint_op(pbio_servo_get_loop_time(srv_slow), ==, 10);
+    tt_uint_op(pbio_servo_run_target(srv_slow, 500, 0, PBIO_CONTROL_ON_COMPLETION_HOLD), ==, PBIO_SUCCESS);
+    pbio_test_sleep_until(pbio_control_is_done(&srv_slow->control));
+    pbio_test_sleep_ms(&timer, 500);
+    tt_uint_op(pbio_servo_get_state_user(srv_slow, &angle, &speed), ==, PBIO_SUCCESS);
+    tt_want(pbio_test_int_is_close(angle, 0, 5));
+
+    // The default loop time is not supported while the servo is decimated,
+    // so the decimation must be undone first, like when a new program starts.
+    tt_want_uint_op(pbio_motor_process_set_loop_time(PBIO_CONFIG_CONTROL_LOOP_TIME_MS), ==, PBIO_ERROR_NOT_SUPPORTED);
+    tt_uint_op(pbio_servo_reset_decimation_all(), ==, PBIO_SUCCESS);
+    tt_want_uint_op(pbio_servo_get_loop_time(srv_slow), ==, 2);
+    tt_uint_op(pbio_motor_process_set_loop_time(PBIO_CONFIG_CONTROL_LOOP_TIME_MS), ==, PBIO_SUCCESS);
+    tt_want_uint_op(pbio_servo_get_loop_time(srv_fast), ==, PBIO_CONFIG_CONTROL_LOOP_TIME_MS);
+    tt_want_uint_op(pbio_servo_get_loop_time(srv_slow), ==, PBIO_CONFIG_CONTROL_LOOP_TIME_MS);
+
+end:
+
+    PT_END(pt);
+}
+
+#endif // PBIO_CONFIG_CONTROL_LOOP_TIME_RUNTIME
+
 struct testcase_t pbio_servo_tests[] = {
     PBIO_PT_THREAD_TEST(test_servo_basics),
     PBIO_PT_THREAD_TEST(test_servo_stall),
     PBIO_PT_THREAD_TEST(test_servo_gearing),
+    #if PBIO_CONFIG_CONTROL_QUEUE
+    PBIO_PT_THREAD_TEST(test_servo_queue),
+    #endif
+    #if PBIO_CONFIG_CONTROL_LOOP_TIME_RUNTIME
+    PBIO_PT_THREAD_TEST(test_servo_loop_time),
+    #endif
     END_OF_TESTCASES
 };
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2022 The Pybricks Authors
+// Copyright (c) 2022-2024 The Pybricks Authors
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -65,6 +65,61 @@ static void test_simple_trajectory(void *env) {
     tt_want_int_op(trj.a2, ==, -command.deceleration / MDEG_PER_DEG);
 }
 
+/**
+ * Tests the same trajectory as above, smoothed with a jerk limit.
+ */
+static void test_smooth_trajectory(void *env) {
+
+    // With a jerk of 20000 deg/s^3, reaching 2000 deg/s^2 takes 100 ms.
+    pbio_trajectory_command_t command = {
+        .time_start = 0,
+        .position_start = { .rotations = 0, .millidegrees = 0 },
+        .position_end = { .rotations = 27, .millidegrees = 280 * MDEG_PER_DEG },
+        .speed_start = 0,
+        .speed_target = 1000 * MDEG_PER_DEG,
+        .speed_max = 1000 * MDEG_PER_DEG,
+        .acceleration = 2000 * MDEG_PER_DEG,
+        .deceleration = 2000 * MDEG_PER_DEG,
+        .jerk = 20000 * MDEG_PER_DEG,
+        .continue_running = false,
+    };
+
+    pbio_trajectory_t trj;
+    pbio_error_t err = pbio_trajectory_new_angle_command(&trj, &command);
+    tt_want_int_op(err, ==, PBIO_SUCCESS);
+
+    // The trapezoid is the same as without smoothing, but the smoothed
+    // trajectory takes one smoothing window longer.
+    tt_want_int_op(trj.tj, ==, 100 * 10);
+    tt_want_int_op(trj.t3, ==, 10500 * 10);
+    tt_want_int_op(pbio_trajectory_get_duration(&trj), ==, 10600 * 10);
+
+    // Acceleration builds up gradually and reaches the nominal value.
+    pbio_trajectory_reference_t ref;
+    pbio_trajectory_get_reference(&trj, 0, &ref);
+    tt_want_int_op(ref.acceleration, ==, 0);
+    tt_want_int_op(ref.speed, ==, 0);
+    tt_want_int_op(pbio_angle_diff_mdeg(&ref.position, &command.position_start), ==, 0);
+    pbio_trajectory_get_reference(&trj, 50 * 10, &ref);
+    tt_want_int_op(ref.acceleration, ==, 1000 * MDEG_PER_DEG);
+    pbio_trajectory_get_reference(&trj, 200 * 10, &ref);
+    tt_want_int_op(ref.acceleration, ==, 2000 * MDEG_PER_DEG);
+
+    // It ends at the commanded position.
+    pbio_trajectory_get_reference(&trj, 10600 * 10, &ref);
+    tt_want_int_op(ref.speed, ==, 0);
+    tt_want_int_op(ref.acceleration, ==, 0);
+    tt_want_int_op(pbio_angle_diff_mdeg(&ref.position, &command.position_end), ==, 0);
+
+    // A timed command ends at the commanded time.
+    command.duration = 2000 * 10;
+    err = pbio_trajectory_new_time_command(&trj, &command);
+    tt_want_int_op(err, ==, PBIO_SUCCESS);
+    tt_want_int_op(pbio_trajectory_get_duration(&trj), ==, command.duration);
+    pbio_trajectory_get_reference(&trj, command.duration, &ref);
+    tt_want_int_op(ref.speed, ==, 0);
+}
+
 static void walk_trajectory(pbio_trajectory_t *trj) {
 
     // Get the starting reference.
@@ -94,7 +149,21 @@ static void walk_trajectory(pbio_trajectory_t *trj) {
 
         // Get current reference.
         uint32_t now = t + time_start;
+        #if PBIO_CONFIG_TRAJECTORY_INCREMENTAL
+        // Stepping through the trajectory should give the same result as
+        // evaluating it in full, which a copy without a valid incremental
+        // state does with pbio_trajectory_get_trapezoid_reference().
+        pbio_trajectory_t trj_full = *trj;
+        trj_full.increment.valid = false;
+        pbio_trajectory_reference_t ref_full;
+        pbio_trajectory_get_reference(&trj_full, now, &ref_full);
+        #endif
         pbio_trajectory_get_reference(trj, now, &ref_now);
+        #if PBIO_CONFIG_TRAJECTORY_INCREMENTAL
+        tt_want_int_op(pbio_angle_diff_mdeg(&ref_now.position, &ref_full.position), ==, 0);
+        tt_want_int_op(ref_now.speed, ==, ref_full.speed);
+        tt_want_int_op(ref_now.acceleration, ==, ref_full.acceleration);
+        #endif
 
         // Skip if current time equals start time. Then there is no previous
         // sample to compare to.
@@ -108,9 +177,21 @@ static void walk_trajectory(pbio_trajectory_t *trj) {
         // Check movement between samples.
         int32_t movement = pbio_angle_diff_mdeg(&ref_now.position, &ref_prev.position);
         int32_t movement_expected = (ref_now.speed + ref_prev.speed) / 2 * (increment / 10000.0f);
-        int32_t movement_threshold = ref_now.speed == ref_prev.speed ? 1000 : 5000;
+        // Only expect it to be precise in a constant speed phase, not when the
+        // speed just rounds to the same value at the end of another phase.
+        bool constant_speed = ref_now.speed == ref_prev.speed && ref_now.acceleration == ref_prev.acceleration;
+        int32_t movement_threshold = constant_speed ? 1000 : 5000;
         tt_want(pbio_int_math_abs(movement - movement_expected) < movement_threshold);
 
+        // For smoothed trajectories, the acceleration changes gradually. The
+        // acceleration of the trapezoid may step from a0 to a2, so the change
+        // over the smoothing window is at most twice the largest of the two.
+        if (trj->tj != 0) {
+            int32_t accel_max = pbio_int_math_max(pbio_int_math_abs(trj->a0), pbio_int_math_abs(trj->a2)) * MDEG_PER_DEG;
+            int32_t accel_change = pbio_int_math_abs(ref_now.acceleration - ref_prev.acceleration);
+            tt_want_int_op(accel_change, <=, 2 * accel_max / trj->tj * increment + 5 * MDEG_PER_DEG);
+        }
+
         // Check speed change between samples, but only within time segments.
         // To find out, compare starting point of segments of both samples.
         pbio_trajectory_reference_t last_vertex_now;
@@ -119,8 +200,9 @@ static void walk_trajectory(pbio_trajectory_t *trj) {
         pbio_trajectory_reference_t last_vertex_prev;
         pbio_trajectory_get_last_vertex(trj, now - increment, &last_vertex_prev);
 
-        // Now we can compare the speeds.
-        if (ref_now.acceleration == ref_prev.acceleration &&
+        // Now we can compare the speeds. Smoothed trajectories have no such
+        // segments, so their acceleration is checked above instead.
+        if (trj->tj == 0 && ref_now.acceleration == ref_prev.acceleration &&
             last_vertex_now.time == last_vertex_prev.time) {
             int32_t delta = ref_now.speed - ref_prev.speed;
             int32_t delta_expected = ref_now.acceleration * (increment / 10000.0f);
@@ -138,8 +220,11 @@ static void walk_trajectory(pbio_trajectory_t *trj) {
             int32_t movement = pbio_angle_diff_mdeg(&ref_now.position, &ref_prev.position);
             tt_want(pbio_int_math_sign_not_opposite(ref_prev.speed, movement / 1000));
 
-            // Speed increment should match acceleration direction.
-            tt_want(pbio_int_math_sign_not_opposite(ref_now.speed - ref_prev.speed, ref_prev.acceleration));
+            // Speed increment should match acceleration direction. Smoothed
+            // values are averaged over a window, so allow for rounding.
+            int32_t speed_change = ref_now.speed - ref_prev.speed;
+            tt_want(pbio_int_math_sign_not_opposite(speed_change, ref_prev.acceleration) ||
+                (trj->tj != 0 && pbio_int_math_abs(speed_change) <= 100));
         }
 
         // Set reference for next comparison.
@@ -278,7 +363,14 @@ static const uint32_t num_position_trajectories =
     PBIO_ARRAY_SIZE(speeds) * // For start speed.
     PBIO_ARRAY_SIZE(speeds) * // For target speed.
     PBIO_ARRAY_SIZE(start_times) * // For start time.
-    2; // For do or don't continue running.
+    3; // For stopping, continuing, or ending at a lower speed.
+
+// Jerk values in deg/s^3 for testing smoothed trajectories.
+static const int32_t jerks[] = {
+    0,
+    10000,
+    200000,
+};
 
 
 /**
@@ -288,8 +380,10 @@ static void get_position_command(uint32_t index, pbio_trajectory_command_t *c) {
 
     c->speed_max = 1000 * MDEG_PER_DEG;
 
-    c->continue_running = index % 2;
-    index /= 2;
+    c->continue_running = index % 3 == 1;
+    c->speed_end = 0;
+    bool lower_end_speed = index % 3 == 2;
+    index /= 3;
 
     c->position_start = angles[index % PBIO_ARRAY_SIZE(angles)];
     index /= PBIO_ARRAY_SIZE(angles);
@@ -311,6 +405,10 @@ static void get_position_command(uint32_t index, pbio_trajectory_command_t *c) {
 
     c->speed_target = speeds[index % PBIO_ARRAY_SIZE(speeds)] * MDEG_PER_DEG;
     index /= PBIO_ARRAY_SIZE(speeds);
+
+    if (lower_end_speed) {
+        c->speed_end = c->speed_target / 2;
+    }
 }
 
 static void test_position_trajectory(void *env) {
@@ -319,6 +417,9 @@ static void test_position_trajectory(void *env) {
 
     for (uint32_t i = 0; i < num_position_trajectories; i++) {
         get_position_command(i, &command);
+        // Vary the jerk along with the final angle and the other parameters,
+        // but not along with the start angle, which only offsets the result.
+        command.jerk = jerks[i / 3 / PBIO_ARRAY_SIZE(angles) % PBIO_ARRAY_SIZE(jerks)] * MDEG_PER_DEG;
 
         // Calculate the trajectory.
         pbio_trajectory_t trj;
@@ -350,6 +451,12 @@ static void test_position_trajectory(void *env) {
         // Verify that we maintain a constant speed when done.
         if (command.continue_running) {
             tt_want_int_op(trj.w3, ==, trj.w1);
+        } else if (command.speed_end != 0) {
+            // End speed is in the direction of motion and at most the
+            // requested end speed, unless it started too fast to slow down.
+            tt_want(pbio_int_math_sign_not_opposite(trj.w3, trj.th3));
+            tt_want_int_op(pbio_int_math_abs(trj.w3), <=, pbio_int_math_max(pbio_int_math_abs(command.speed_end), pbio_int_math_abs(command.speed_start)) / 100);
+            tt_want_int_op(pbio_int_math_abs(trj.w3), <=, pbio_int_math_abs(trj.w1));
         } else {
             tt_want_int_op(trj.w3, ==, 0);
         }
@@ -365,14 +472,97 @@ static void test_position_trajectory(void *env) {
             tt_want(pbio_int_math_sign_not_opposite(ref.speed, command.speed_start));
         }
 
-        // Walk the whole trajectory.
-        walk_trajectory(&trj);
+        // Walk the whole trajectory. Trajectories that end at a lower speed
+        // and run longer than the maximum duration are rebased right as their
+        // speed steps down to the end speed, so the segments can't be compared
+        // across that point. The continued ones cover the rebasing.
+        if (command.speed_end == 0 || pbio_trajectory_get_duration(&trj) < DURATION_FOREVER_TICKS) {
+            walk_trajectory(&trj);
+        }
+    }
+}
+
+#if PBIO_CONFIG_TRAJECTORY_INCREMENTAL
+
+/**
+ * Checks that evaluating a trajectory at @p time gives the same result as
+ * evaluating it in full, then returns that result.
+ */
+static void check_incremental_reference(pbio_trajectory_t *trj, const pbio_trajectory_t *original, int32_t time) {
+    uint32_t now = trj->start.time + time;
+
+    pbio_trajectory_t trj_full = *original;
+    trj_full.increment.valid = false;
+    pbio_trajectory_reference_t ref_full;
+    pbio_trajectory_get_reference(&trj_full, now, &ref_full);
+
+    pbio_trajectory_reference_t ref;
+    pbio_trajectory_get_reference(trj, now, &ref);
+
+    tt_want_int_op(pbio_angle_diff_mdeg(&ref.position, &ref_full.position), ==, 0);
+    tt_want_int_op(ref.speed, ==, ref_full.speed);
+    tt_want_int_op(ref.acceleration, ==, ref_full.acceleration);
+}
+
+/**
+ * Tests that stepping through trapezoidal trajectories gives the same result
+ * as evaluating them in full, around each phase boundary, for several time
+ * steps and for every offset from the boundary. References before the start
+ * can't be requested, so stepping across the start begins at the start.
+ */
+static void test_incremental_trajectory(void *env) {
+
+    static const int32_t time_steps[] = { 1, 13, 50 };
+
+    pbio_trajectory_command_t command;
+
+    // Checking all of them takes long, so check a spread of them.
+    for (uint32_t i = 0; i < num_position_trajectories; i += 97) {
+        get_position_command(i, &command);
+
+        pbio_trajectory_t trj;
+        if (pbio_trajectory_new_angle_command(&trj, &command) != PBIO_SUCCESS) {
+            continue;
+        }
+
+        // Step from the start until after the end.
+        int32_t end = trj.t3 + 10000;
+        if (end < DURATION_FOREVER_TICKS) {
+            pbio_trajectory_t trj_step = trj;
+            for (int32_t time = 0; time < end; time += 50) {
+                check_incremental_reference(&trj_step, &trj, time);
+            }
+        }
+
+        // Step across each boundary, starting at every offset from it.
+        const int32_t boundaries[] = { 0, trj.t1, trj.t2, trj.t3 };
+        for (uint32_t b = 0; b < PBIO_ARRAY_SIZE(boundaries); b++) {
+            for (uint32_t s = 0; s < PBIO_ARRAY_SIZE(time_steps); s++) {
+                int32_t dt = time_steps[s];
+                if (boundaries[b] + 3 * dt >= DURATION_FOREVER_TICKS) {
+                    continue;
+                }
+                for (int32_t offset = 0; offset < dt; offset++) {
+                    pbio_trajectory_t trj_step = trj;
+                    int32_t start = pbio_int_math_max(boundaries[b] - 3 * dt + offset, 0);
+                    for (int32_t time = start; time < boundaries[b] + 3 * dt; time += dt) {
+                        check_incremental_reference(&trj_step, &trj, time);
+                    }
+                }
+            }
+        }
     }
 }
 
+#endif // PBIO_CONFIG_TRAJECTORY_INCREMENTAL
+
 struct testcase_t pbio_trajectory_tests[] = {
     PBIO_TEST(test_simple_trajectory),
+    PBIO_TEST(test_smooth_trajectory),
     PBIO_TEST(test_position_trajectory),
     PBIO_TEST(test_infinite_trajectory),
+    #if PBIO_CONFIG_TRAJECTORY_INCREMENTAL
+    PBIO_TEST(test_incremental_trajectory),
+    #endif
     END_OF_TESTCASES
 };
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2019-2023 The Pybricks Authors
+// Copyright (c) 2019-2024 The Pybricks Authors
 
 #include <assert.h>
 #include <stdbool.h>
@@ -38,7 +38,9 @@ static struct {
     struct etimer rx_timer;
     uint8_t *rx_msg;
     uint8_t rx_msg_length;
-    pbio_error_t rx_msg_result;
+    const uint8_t *rx_data;
+    uint8_t rx_data_length;
+    uint8_t rx_data_pos;
     uint8_t *tx_msg;
     struct etimer tx_timer;
     uint8_t tx_msg_length;
@@ -48,37 +50,20 @@ static struct {
 PT_THREAD(simulate_rx_msg(struct pt *pt, const uint8_t *msg, uint8_t length, bool *ok)) {
     PT_BEGIN(pt);
 
-    // First uartdev reads one byte header
-    PT_WAIT_UNTIL(pt, ({
-        pbio_test_clock_tick(1);
-        test_uart_dev.rx_msg_result == PBIO_ERROR_AGAIN;
-    }));
-    tt_uint_op(test_uart_dev.rx_msg_length, ==, 1);
-    memcpy(test_uart_dev.rx_msg, msg, 1);
-    test_uart_dev.rx_msg_result = PBIO_SUCCESS;
+    // Make the message available to uartdev all at once, like a device does.
+    test_uart_dev.rx_data = msg;
+    test_uart_dev.rx_data_length = length;
+    test_uart_dev.rx_data_pos = 0;
     pbdrv_legodev_pup_uart_process_poll();
 
-    if (length == 1) {
-        *ok = true;
-        PT_EXIT(pt);
-    }
-
-    // then read rest of message
+    // Wait until uartdev has read all of it.
     PT_WAIT_UNTIL(pt, ({
         pbio_test_clock_tick(1);
-        test_uart_dev.rx_msg_result == PBIO_ERROR_AGAIN;
+        test_uart_dev.rx_data_pos == test_uart_dev.rx_data_length;
     }));
-    tt_uint_op(test_uart_dev.rx_msg_length, ==, length - 1);
-    memcpy(test_uart_dev.rx_msg, &msg[1], length - 1);
-    test_uart_dev.rx_msg_result = PBIO_SUCCESS;
-    pbdrv_legodev_pup_uart_process_poll();
 
     *ok = true;
     PT_END(pt);
-
-end:
-    *ok = false;
-    PT_EXIT(pt);
 }
 
 PT_THREAD(simulate_tx_msg(struct pt *pt, const uint8_t *msg, uint8_t length, bool *ok)) {
@@ -215,6 +200,7 @@ static PT_THREAD(test_boost_color_distance_sensor(struct pt *pt)) {
     static const uint8_t msg86[] = { 0xC0 | 0x18 | 0x06, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x21 }; // mode 6 data
 
     static const uint8_t msg87[] = { 0x43, 0x01, 0xBD }; // set mode 1
+    static const uint8_t msg88_partial[] = { 0xC1, 0x05 }; // truncated mode 1 data
     static const uint8_t msg88[] = { 0xC1, 0x00, 0x3E }; // mode 1 data
 
     static const uint8_t msg89[] = { 0x43, 0x08, 0xB4 }; // set mode 8
@@ -428,7 +414,9 @@ static PT_THREAD(test_boost_color_distance_sensor(struct pt *pt)) {
     // should be blocked since data with new mode has not been received yet
     tt_uint_op(pbdrv_legodev_is_ready(legodev), ==, PBIO_ERROR_AGAIN);
 
-    // data message with new mode
+    // data message with new mode, preceded by a partial message that should
+    // be skipped when its checksum fails
+    SIMULATE_RX_MSG(msg88_partial);
     SIMULATE_RX_MSG(msg88);
 
     PT_WAIT_WHILE(pt, ({
@@ -698,15 +686,33 @@ static PT_THREAD(test_technic_large_motor(struct pt *pt)) {
 
     static const uint8_t msg58[] = { 0x02 }; // NACK
 
+    static const uint8_t msg59[] = { 0x4C, 0x20, 0x00, 0x93 }; // clear mode combination
+
+    static const uint8_t msg60[] = { 0x5C, 0x23, 0x00, 0x10, 0x20, 0x30, 0x00, 0x00, 0x00, 0x80 }; // combine modes 1, 2, 3
+
+    static const uint8_t msg61[] = { 0xD9, 0x31, 0x67, 0x01, 0x00, 0x00, 0x59, 0x00, 0x00, 0x28 }; // combined data 49, 359, 89
+
+    static const uint8_t msg62[] = { 0xD9, 0x32, 0x68, 0x01, 0x00, 0x00, 0x5A, 0x00, 0x00, 0x27 }; // combined data 50, 360, 90
+
+    static const uint8_t msg63[] = { 0x43, 0x00, 0xBC }; // set mode 0
+
+    static const uint8_t msg64[] = { 0xC0, 0x00, 0x3F }; // mode 0, data 0
+
+    static const uint8_t msg65[] = { 0x46, 0x00, 0xB9, 0xC0, 0x05, 0x3A }; // write 5 to mode 0
+
+    static const uint8_t combi_modes[] = { 1, 2, 3 };
+
     // used in SIMULATE_RX/TX_MSG macros
     static struct pt child;
     static bool ok;
 
     static pbdrv_legodev_dev_t *legodev;
     static pbdrv_legodev_info_t *info;
+    static pbdrv_legodev_info_cache_t cache;
 
     PT_BEGIN(pt);
 
+    pbdrv_legodev_set_info_cache(&cache, NULL);
     pbdrv_legodev_test_start_process();
 
     // Expect no device at first.
@@ -829,6 +835,220 @@ static PT_THREAD(test_technic_large_motor(struct pt *pt)) {
     tt_want_uint_op(info->mode_info[5].data_type, ==, PBDRV_LEGODEV_DATA_TYPE_INT16);
     tt_want_uint_op(info->mode_info[5].writable, ==, 0);
 
+    tt_want_uint_op(info->mode_combos[0], ==, 0x000E);
+    tt_want_uint_op(info->mode_combos[1], ==, 0);
+
+    // info should be saved for the next time this device is connected
+    tt_want_uint_op(cache.entries[0].info.type_id, ==, PBDRV_LEGODEV_TYPE_ID_TECHNIC_L_MOTOR);
+    tt_want_uint_op(cache.entries[0].info.num_modes, ==, 6);
+    tt_want_uint_op(cache.entries[0].info.mode_info[5].num_values, ==, 14);
+    tt_want_uint_op(cache.entries[0].baud_rate, ==, 115200);
+    tt_want_uint_op(cache.entries[1].info.type_id, ==, PBDRV_LEGODEV_TYPE_ID_NONE);
+
+    // modes that are not in a supported combination can't be combined
+    static const uint8_t bad_combi_modes[] = { 1, 4 };
+    tt_uint_op(pbdrv_legodev_set_mode_combi(legodev, bad_combi_modes, PBIO_ARRAY_SIZE(bad_combi_modes)), ==, PBIO_ERROR_NOT_SUPPORTED);
+
+    // test reading speed, position and absolute position at once
+    static pbio_error_t err;
+    PT_WAIT_WHILE(pt, ({
+        pbio_test_clock_tick(1);
+        (err = pbdrv_legodev_set_mode_combi(legodev, combi_modes, PBIO_ARRAY_SIZE(combi_modes))) == PBIO_ERROR_AGAIN;
+    }));
+    tt_uint_op(err, ==, PBIO_SUCCESS);
+
+    // previous combination is cleared before setting the new one
+    SIMULATE_TX_MSG(msg59);
+    SIMULATE_TX_MSG(msg60);
+
+    // should be blocked since combined data has not been received yet
+    tt_uint_op(pbdrv_legodev_is_ready(legodev), ==, PBIO_ERROR_AGAIN);
+
+    // first combined data message is discarded
+    SIMULATE_RX_MSG(msg61);
+    tt_uint_op(pbdrv_legodev_is_ready(legodev), ==, PBIO_ERROR_AGAIN);
+    SIMULATE_RX_MSG(msg62);
+
+    PT_WAIT_WHILE(pt, ({
+        pbio_test_clock_tick(1);
+        (err = pbdrv_legodev_is_ready(legodev)) == PBIO_ERROR_AGAIN;
+    }));
+    tt_uint_op(err, ==, PBIO_SUCCESS);
+    tt_uint_op(pbdrv_legodev_get_info(legodev, &info), ==, PBIO_SUCCESS);
+    tt_uint_op(info->mode, ==, 1);
+
+    // each combined mode can be read without switching modes
+    static void *data;
+    tt_uint_op(pbdrv_legodev_set_mode(legodev, 2), ==, PBIO_SUCCESS);
+    tt_uint_op(pbdrv_legodev_is_ready(legodev), ==, PBIO_SUCCESS);
+    tt_uint_op(pbdrv_legodev_get_data(legodev, 1, &data), ==, PBIO_SUCCESS);
+    tt_want_int_op(*(int8_t *)data, ==, 50);
+    tt_uint_op(pbdrv_legodev_get_data(legodev, 2, &data), ==, PBIO_SUCCESS);
+    tt_want_int_op(pbio_get_uint32_le(data), ==, 360);
+    tt_uint_op(pbdrv_legodev_get_data(legodev, 3, &data), ==, PBIO_SUCCESS);
+    tt_want_int_op(pbio_get_uint16_le(data), ==, 90);
+
+    // modes outside the combination can't be read
+    tt_uint_op(pbdrv_legodev_get_data(legodev, 4, &data), ==, PBIO_ERROR_INVALID_OP);
+
+    // writing data to a single mode suspends the combination
+    static const int8_t value = 5;
+    tt_uint_op(pbdrv_legodev_set_mode_with_data(legodev, 0, &value, sizeof(value)), ==, PBIO_SUCCESS);
+    SIMULATE_TX_MSG(msg59);
+    SIMULATE_TX_MSG(msg63);
+    SIMULATE_RX_MSG(msg64);
+    SIMULATE_TX_MSG(msg65);
+
+    // combined modes can still be requested, but are not ready until the
+    // combination is set again
+    tt_uint_op(pbdrv_legodev_set_mode(legodev, 2), ==, PBIO_SUCCESS);
+    tt_uint_op(pbdrv_legodev_is_ready(legodev), ==, PBIO_ERROR_AGAIN);
+    SIMULATE_TX_MSG(msg59);
+    SIMULATE_TX_MSG(msg60);
+    SIMULATE_RX_MSG(msg61);
+    SIMULATE_RX_MSG(msg62);
+
+    PT_WAIT_WHILE(pt, ({
+        pbio_test_clock_tick(1);
+        (err = pbdrv_legodev_is_ready(legodev)) == PBIO_ERROR_AGAIN;
+    }));
+    tt_uint_op(err, ==, PBIO_SUCCESS);
+    tt_uint_op(pbdrv_legodev_get_data(legodev, 3, &data), ==, PBIO_SUCCESS);
+    tt_want_int_op(pbio_get_uint16_le(data), ==, 90);
+
+
+    PT_YIELD(pt);
+
+end:
+    PT_END(pt);
+}
+
+static PT_THREAD(test_technic_large_motor_cached_info(struct pt *pt)) {
+    static const uint8_t msg2[] = { 0x40, 0x2E, 0x91 }; // TYPE
+    static const uint8_t msg3[] = { 0x04 }; // ACK
+    static const uint8_t msg4[] = { 0x43, 0x04, 0xB8 }; // set default mode
+    static const uint8_t msg5[] = { 0xC0 | 0x10 | 0x04, 0x00, 0x00, 0x00, 0x00, 0x2B }; // mode 4, data 0, 0
+    static const uint8_t msg6[] = { 0x02 }; // NACK
+
+    // used in SIMULATE_RX/TX_MSG macros
+    static struct pt child;
+    static bool ok;
+
+    static pbdrv_legodev_dev_t *legodev;
+    static pbdrv_legodev_info_t *info;
+    static pbdrv_legodev_info_cache_t cache;
+
+    PT_BEGIN(pt);
+
+    // info as received from this device before
+    cache.entries[0].info.type_id = PBDRV_LEGODEV_TYPE_ID_TECHNIC_L_MOTOR;
+    cache.entries[0].info.num_modes = 6;
+    cache.entries[0].info.mode_info[4].num_values = 2;
+    cache.entries[0].info.mode_info[4].data_type = PBDRV_LEGODEV_DATA_TYPE_INT16;
+    cache.entries[0].info.mode_info[5].num_values = 14;
+    cache.entries[0].info.mode_info[5].data_type = PBDRV_LEGODEV_DATA_TYPE_INT16;
+    cache.entries[0].baud_rate = 115200;
+    // cache failed once before, and was skipped once since then
+    cache.entries[0].num_failed = 1;
+
+    pbdrv_legodev_set_info_cache(&cache, NULL);
+    pbdrv_legodev_test_start_process();
+
+    pbdrv_legodev_type_id_t id = PBDRV_LEGODEV_TYPE_ID_NONE;
+    tt_uint_op(pbdrv_legodev_get_device(PBIO_PORT_ID_D, &id, &legodev), ==, PBIO_SUCCESS);
+
+    PT_WAIT_UNTIL(pt, ({
+        pbio_test_clock_tick(1);
+        test_uart_dev.baud == 115200;
+    }));
+
+    SIMULATE_TX_MSG(msg_speed_115200);
+    SIMULATE_RX_MSG(msg_ack);
+
+    // device type is known, so info is acknowledged without waiting for it
+    SIMULATE_RX_MSG(msg2);
+    SIMULATE_TX_MSG(msg3);
+
+    PT_YIELD(pt);
+
+    SIMULATE_TX_MSG(msg4);
+
+    static int i;
+    for (i = 0; i < 10; i++) {
+        SIMULATE_TX_MSG(msg6);
+        SIMULATE_RX_MSG(msg5);
+    }
+
+    tt_uint_op(pbdrv_legodev_get_info(legodev, &info), ==, PBIO_SUCCESS);
+
+    tt_want_uint_op(info->type_id, ==, PBDRV_LEGODEV_TYPE_ID_TECHNIC_L_MOTOR);
+    tt_want_uint_op(info->num_modes, ==, 6);
+    tt_want_uint_op(info->mode, ==, PBDRV_LEGODEV_MODE_PUP_ABS_MOTOR__CALIB);
+    tt_want_uint_op(info->mode_info[5].num_values, ==, 14);
+    // data matched the cached info, so it is valid
+    tt_want_uint_op(cache.entries[0].num_failed, ==, 0);
+    tt_want_uint_op(cache.entries[0].num_skip, ==, 0);
+
+    PT_YIELD(pt);
+
+end:
+    PT_END(pt);
+}
+
+static PT_THREAD(test_technic_large_motor_cached_info_mismatch(struct pt *pt)) {
+    static const uint8_t msg2[] = { 0x40, 0x2E, 0x91 }; // TYPE
+    static const uint8_t msg3[] = { 0x04 }; // ACK
+    static const uint8_t msg4[] = { 0x43, 0x04, 0xB8 }; // set default mode
+    static const uint8_t msg5[] = { 0xC0 | 0x10 | 0x04, 0x00, 0x00, 0x00, 0x00, 0x2B }; // mode 4, data 0, 0
+
+    // used in SIMULATE_RX/TX_MSG macros
+    static struct pt child;
+    static bool ok;
+
+    static pbdrv_legodev_dev_t *legodev;
+    static pbdrv_legodev_info_cache_t cache;
+
+    PT_BEGIN(pt);
+
+    // info of another device that reported the same type
+    cache.entries[0].info.type_id = PBDRV_LEGODEV_TYPE_ID_TECHNIC_L_MOTOR;
+    cache.entries[0].info.num_modes = 6;
+    cache.entries[0].info.mode_info[4].num_values = 1;
+    cache.entries[0].info.mode_info[4].data_type = PBDRV_LEGODEV_DATA_TYPE_INT8;
+    cache.entries[0].baud_rate = 115200;
+
+    pbdrv_legodev_set_info_cache(&cache, NULL);
+    pbdrv_legodev_test_start_process();
+
+    pbdrv_legodev_type_id_t id = PBDRV_LEGODEV_TYPE_ID_NONE;
+    tt_uint_op(pbdrv_legodev_get_device(PBIO_PORT_ID_D, &id, &legodev), ==, PBIO_SUCCESS);
+
+    PT_WAIT_UNTIL(pt, ({
+        pbio_test_clock_tick(1);
+        test_uart_dev.baud == 115200;
+    }));
+
+    SIMULATE_TX_MSG(msg_speed_115200);
+    SIMULATE_RX_MSG(msg_ack);
+
+    SIMULATE_RX_MSG(msg2);
+    SIMULATE_TX_MSG(msg3);
+
+    PT_YIELD(pt);
+
+    SIMULATE_TX_MSG(msg4);
+
+    // data size does not match the cached info
+    SIMULATE_RX_MSG(msg5);
+
+    PT_WAIT_UNTIL(pt, ({
+        pbio_test_clock_tick(1);
+        cache.entries[0].num_skip > 0;
+    }));
+
+    // next connection receives all info, and the one after retries the cache
+    tt_want_uint_op(cache.entries[0].num_failed, ==, 1);
+    tt_want_uint_op(cache.entries[0].num_skip, ==, 1);
 
     PT_YIELD(pt);
 
@@ -1042,6 +1262,8 @@ struct testcase_t pbdrv_legodev_tests[] = {
     PBIO_PT_THREAD_TEST(test_boost_color_distance_sensor),
     PBIO_PT_THREAD_TEST(test_boost_interactive_motor),
     PBIO_PT_THREAD_TEST(test_technic_large_motor),
+    PBIO_PT_THREAD_TEST(test_technic_large_motor_cached_info),
+    PBIO_PT_THREAD_TEST(test_technic_large_motor_cached_info_mismatch),
     PBIO_PT_THREAD_TEST(test_technic_xl_motor),
     END_OF_TESTCASES
 };
@@ -1070,7 +1292,6 @@ pbio_error_t pbdrv_uart_read_begin(pbdrv_uart_dev_t *uart, uint8_t *msg, uint8_t
 
     test_uart_dev.rx_msg = msg;
     test_uart_dev.rx_msg_length = length;
-    test_uart_dev.rx_msg_result = PBIO_ERROR_AGAIN;
     etimer_set(&test_uart_dev.rx_timer, timeout);
 
     return PBIO_SUCCESS;
@@ -1079,21 +1300,39 @@ pbio_error_t pbdrv_uart_read_begin(pbdrv_uart_dev_t *uart, uint8_t *msg, uint8_t
 pbio_error_t pbdrv_uart_read_end(pbdrv_uart_dev_t *uart) {
     assert(test_uart_dev.rx_msg);
 
-    if (test_uart_dev.rx_msg_result == PBIO_ERROR_AGAIN && etimer_expired(&test_uart_dev.rx_timer)) {
-        test_uart_dev.rx_msg_result = PBIO_ERROR_TIMEDOUT;
+    if (test_uart_dev.rx_data_length - test_uart_dev.rx_data_pos < test_uart_dev.rx_msg_length) {
+        if (etimer_expired(&test_uart_dev.rx_timer)) {
+            test_uart_dev.rx_msg = NULL;
+            return PBIO_ERROR_TIMEDOUT;
+        }
+        return PBIO_ERROR_AGAIN;
     }
 
-    if (test_uart_dev.rx_msg_result != PBIO_ERROR_AGAIN) {
-        test_uart_dev.rx_msg = NULL;
-    }
+    memcpy(test_uart_dev.rx_msg, &test_uart_dev.rx_data[test_uart_dev.rx_data_pos], test_uart_dev.rx_msg_length);
+    test_uart_dev.rx_data_pos += test_uart_dev.rx_msg_length;
+    test_uart_dev.rx_msg = NULL;
 
-    return test_uart_dev.rx_msg_result;
+    return PBIO_SUCCESS;
 }
 
 void pbdrv_uart_read_cancel(pbdrv_uart_dev_t *uart) {
 
 }
 
+pbio_error_t pbdrv_uart_read_available(pbdrv_uart_dev_t *uart, uint8_t *msg, uint8_t size, uint8_t *length) {
+    *length = 0;
+
+    if (test_uart_dev.rx_msg) {
+        return PBIO_ERROR_AGAIN;
+    }
+
+    while (*length < size && test_uart_dev.rx_data_pos < test_uart_dev.rx_data_length) {
+        msg[(*length)++] = test_uart_dev.rx_data[test_uart_dev.rx_data_pos++];
+    }
+
+    return *length ? PBIO_SUCCESS : PBIO_ERROR_AGAIN;
+}
+
 pbio_error_t pbdrv_uart_write_begin(pbdrv_uart_dev_t *uart, uint8_t *msg, uint8_t length, uint32_t timeout) {
     if (test_uart_dev.tx_msg) {
         return PBIO_ERROR_AGAIN;
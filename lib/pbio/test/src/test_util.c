@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2021 The Pybricks Authors
+// Copyright (c) 2021-2024 The Pybricks Authors
 
 #include <stdio.h>
 #include <string.h>
@@ -63,9 +63,24 @@ static void test_oneshot(void *env) {
     tt_want(pbio_oneshot(true, &test_oneshot));
 }
 
+static void test_crc32(void *env) {
+    static const uint8_t check[] = "123456789";
+
+    // Standard check value for CRC-32.
+    tt_want_int_op(pbio_crc32(check, 9), ==, 0xCBF43926);
+
+    // Checksum of no data.
+    tt_want_int_op(pbio_crc32(check, 0), ==, 0);
+
+    // Checksum changes if one bit changes.
+    static const uint8_t check_flipped[] = "123456788";
+    tt_want_int_op(pbio_crc32(check_flipped, 9), !=, 0xCBF43926);
+}
+
 struct testcase_t pbio_util_tests[] = {
     PBIO_TEST(test_uuid128_reverse_compare),
     PBIO_TEST(test_uuid128_reverse_copy),
     PBIO_TEST(test_oneshot),
+    PBIO_TEST(test_crc32),
     END_OF_TESTCASES
 };
@@ -0,0 +1,150 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2024 The Pybricks Authors
+
+#include <stdint.h>
+#include <string.h>
+
+#include <tinytest.h>
+#include <tinytest_macros.h>
+
+#include <pbio/util.h>
+#include <pbsys/main.h>
+#include <pbsys/program_index.h>
+#include <test-pbio.h>
+
+// Adds a module with the given name and data size to a program, filling the
+// data with the given value so that modules with equal names can be told apart.
+static uint32_t add_module(uint8_t *program, uint32_t offset, const char *name, uint32_t data_size, uint8_t value) {
+    uint8_t *module = program + offset;
+    pbio_set_uint32_le(module, data_size);
+    strcpy((char *)module + sizeof(uint32_t), name);
+    uint32_t name_size = strlen(name) + 1;
+    memset(module + sizeof(uint32_t) + name_size, value, data_size);
+    return offset + sizeof(uint32_t) + name_size + data_size;
+}
+
+static uint8_t *find(const char *name) {
+    return pbsys_program_index_find(name, strlen(name));
+}
+
+// Gets the data value of a found module.
+static uint8_t get_value(uint8_t *module) {
+    return module[sizeof(uint32_t) + strlen((char *)module + sizeof(uint32_t)) + 1];
+}
+
+static const char *const names[] = {
+    "__main__", "robot", "robot.arm", "robot.drive", "helpers", "a", "b", "c",
+};
+
+static void test_program_index_find(void *env) {
+    // Aligned like user RAM.
+    static uint64_t ram[256];
+    uint8_t *program = (uint8_t *)ram;
+
+    uint32_t size = 0;
+    for (uint32_t i = 0; i < PBIO_ARRAY_SIZE(names); i++) {
+        size = add_module(program, size, names[i], 5 + i, i);
+    }
+
+    pbsys_main_program_t info = {
+        .code_start = program,
+        .code_end = program + size,
+        .data_end = program + sizeof(ram),
+    };
+
+    // The index goes after the program and all modules fit.
+    uint8_t *free_start = pbsys_program_index_init(&info);
+    tt_want(free_start >= program + size);
+    tt_want(free_start < program + sizeof(ram));
+
+    for (uint32_t i = 0; i < PBIO_ARRAY_SIZE(names); i++) {
+        uint8_t *module = find(names[i]);
+        tt_want(module);
+        if (module) {
+            tt_want_int_op(get_value(module), ==, i);
+            tt_want(strcmp((char *)module + sizeof(uint32_t), names[i]) == 0);
+        }
+    }
+
+    // Names must match exactly.
+    tt_want(!find("robo"));
+    tt_want(!find("robot.arms"));
+    tt_want(!find(""));
+    tt_want(pbsys_program_index_find("robot.arm", strlen("robot")) == find("robot"));
+}
+
+static void test_program_index_duplicates(void *env) {
+    static uint64_t ram[64];
+    uint8_t *program = (uint8_t *)ram;
+
+    // A program with the same module name more than once.
+    uint32_t size = 0;
+    size = add_module(program, size, "__main__", 4, 0);
+    uint32_t first = size;
+    size = add_module(program, size, "dup", 4, 1);
+    size = add_module(program, size, "other", 4, 2);
+    size = add_module(program, size, "dup", 4, 3);
+    size = add_module(program, size, "dup", 4, 4);
+
+    pbsys_main_program_t info = {
+        .code_start = program,
+        .code_end = program + size,
+        .data_end = program + sizeof(ram),
+    };
+    pbsys_program_index_init(&info);
+
+    // The first one in the program is found.
+    uint8_t *module = find("dup");
+    tt_want(module == program + first);
+    tt_want(module && get_value(module) == 1);
+    module = find("other");
+    tt_want(module && get_value(module) == 2);
+}
+
+static void test_program_index_fallback(void *env) {
+    static uint64_t ram[256];
+    uint8_t *program = (uint8_t *)ram;
+
+    uint32_t size = 0;
+    for (uint32_t i = 0; i < PBIO_ARRAY_SIZE(names); i++) {
+        size = add_module(program, size, names[i], 5 + i, i);
+    }
+    // Same name as an earlier module, so it should never be found.
+    size = add_module(program, size, "robot", 4, 0xFF);
+
+    // Leave room for only three index entries after the program.
+    uint32_t index_start = (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+    pbsys_main_program_t info = {
+        .code_start = program,
+        .code_end = program + size,
+        .data_end = program + index_start + 3 * 2 * sizeof(void *),
+    };
+
+    // The index does not grow past the end of user RAM.
+    uint8_t *free_start = pbsys_program_index_init(&info);
+    tt_want(free_start <= (uint8_t *)info.data_end);
+
+    // Modules that were not indexed are still found.
+    for (uint32_t i = 0; i < PBIO_ARRAY_SIZE(names); i++) {
+        uint8_t *module = find(names[i]);
+        tt_want(module && get_value(module) == i);
+    }
+    tt_want(!find("missing"));
+
+    // Same with no room for an index at all.
+    info.data_end = program + size;
+    free_start = pbsys_program_index_init(&info);
+    tt_want(free_start == program + size);
+    for (uint32_t i = 0; i < PBIO_ARRAY_SIZE(names); i++) {
+        uint8_t *module = find(names[i]);
+        tt_want(module && get_value(module) == i);
+    }
+    tt_want(!find("missing"));
+}
+
+struct testcase_t pbsys_program_index_tests[] = {
+    PBIO_TEST(test_program_index_find),
+    PBIO_TEST(test_program_index_duplicates),
+    PBIO_TEST(test_program_index_fallback),
+    END_OF_TESTCASES
+};
@@ -0,0 +1,99 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2024 The Pybricks Authors
+
+#include <stdint.h>
+#include <string.h>
+
+#include <tinytest.h>
+#include <tinytest_macros.h>
+
+#include <pbio/error.h>
+#include <pbio/util.h>
+#include <pbsys/main.h>
+#include <test-pbio.h>
+
+#include "../../sys/storage.h"
+
+// Adds a module with the given name and data size to a program, filling the
+// data with a pattern so that each module can be recognized after moving it.
+static uint32_t add_module(uint8_t *program, uint32_t offset, const char *name, uint32_t data_size, uint8_t pattern) {
+    uint8_t *module = program + offset;
+    pbio_set_uint32_le(module, data_size);
+    strcpy((char *)module + sizeof(uint32_t), name);
+    uint32_t name_size = strlen(name) + 1;
+    for (uint32_t i = 0; i < data_size; i++) {
+        module[sizeof(uint32_t) + name_size + i] = pattern + i;
+    }
+    return sizeof(uint32_t) + name_size + data_size;
+}
+
+static void set_pair(uint8_t *pairs, uint32_t index, const uint8_t *module, uint32_t size, uint32_t new_offset) {
+    pbio_set_uint32_le(&pairs[index * 8], pbio_crc32(module, size));
+    pbio_set_uint32_le(&pairs[index * 8 + 4], new_offset);
+}
+
+static void test_reuse_program_modules(void *env) {
+    static uint8_t old_program[256];
+    uint8_t pairs[64 * 8];
+    pbsys_main_program_t program;
+
+    // The loaded program has modules a, b, and c.
+    uint32_t a = 0;
+    uint32_t a_size = add_module(old_program, a, "a", 10, 0x10);
+    uint32_t b = a + a_size;
+    uint32_t b_size = add_module(old_program, b, "b", 4, 0x40);
+    uint32_t c = b + b_size;
+    uint32_t c_size = add_module(old_program, c, "c", 30, 0x80);
+    uint32_t old_size = c + c_size;
+
+    tt_uint_op(pbsys_storage_set_program_data(0, old_program, old_size), ==, PBIO_SUCCESS);
+    tt_uint_op(pbsys_storage_set_program_size(old_size), ==, PBIO_SUCCESS);
+    pbsys_storage_get_program_data(&program);
+
+    // The new program starts with a new module and drops b. So a moves
+    // towards the end, partly over itself and where b was, and c moves
+    // towards the start, partly over itself.
+    uint32_t new_a = 8;
+    uint32_t new_c = new_a + a_size;
+    set_pair(pairs, 0, old_program + a, a_size, new_a);
+    set_pair(pairs, 1, old_program + c, c_size, new_c);
+
+    // Modules must be given in order.
+    uint8_t swapped[2 * 8];
+    memcpy(swapped, pairs + 8, 8);
+    memcpy(swapped + 8, pairs, 8);
+    tt_uint_op(pbsys_storage_reuse_program_modules(swapped, sizeof(swapped)), ==, PBIO_ERROR_INVALID_ARG);
+    tt_want(memcmp(program.code_start, old_program, old_size) == 0);
+
+    // Modules that are not in the loaded program are not allowed.
+    uint8_t unknown[8];
+    memcpy(unknown, pairs, sizeof(unknown));
+    unknown[0] ^= 0xff;
+    tt_uint_op(pbsys_storage_reuse_program_modules(unknown, sizeof(unknown)), ==, PBIO_ERROR_INVALID_ARG);
+    tt_want(memcmp(program.code_start, old_program, old_size) == 0);
+
+    // Modules must fit in the program data.
+    uint8_t too_far[8];
+    set_pair(too_far, 0, old_program + c, c_size, (uint8_t *)program.data_end - (uint8_t *)program.code_start - c_size + 1);
+    tt_uint_op(pbsys_storage_reuse_program_modules(too_far, sizeof(too_far)), ==, PBIO_ERROR_INVALID_ARG);
+    tt_want(memcmp(program.code_start, old_program, old_size) == 0);
+
+    // At most 63 modules fit in one command.
+    memset(pairs + 2 * 8, 0, sizeof(pairs) - 2 * 8);
+    tt_uint_op(pbsys_storage_reuse_program_modules(pairs, 64 * 8), ==, PBIO_ERROR_INVALID_ARG);
+    tt_want(memcmp(program.code_start, old_program, old_size) == 0);
+
+    // Now move the modules in place.
+    tt_uint_op(pbsys_storage_reuse_program_modules(pairs, 2 * 8), ==, PBIO_SUCCESS);
+    tt_want(new_a + a_size > b && new_c < c && new_c + c_size > c);
+    tt_want(memcmp((uint8_t *)program.code_start + new_a, old_program + a, a_size) == 0);
+    tt_want(memcmp((uint8_t *)program.code_start + new_c, old_program + c, c_size) == 0);
+
+end:
+    ;
+}
+
+struct testcase_t pbsys_storage_tests[] = {
+    PBIO_TEST(test_reuse_program_modules),
+    END_OF_TESTCASES
+};
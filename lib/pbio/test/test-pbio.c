@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2019-2021 The Pybricks Authors
+// Copyright (c) 2019-2024 The Pybricks Authors
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -76,41 +76,57 @@ struct testcase_setup_t pbio_test_setup = {
     .cleanup_fn = cleanup,
 };
 
+extern struct testcase_t pbdrv_block_device_tests[];
 extern struct testcase_t pbdrv_bluetooth_tests[];
 extern struct testcase_t pbdrv_pwm_tests[];
 extern struct testcase_t pbio_angle_tests[];
 extern struct testcase_t pbio_battery_tests[];
 extern struct testcase_t pbio_color_tests[];
 extern struct testcase_t pbio_drivebase_tests[];
+extern struct testcase_t pbio_geometry_tests[];
 extern struct testcase_t pbio_light_animation_tests[];
 extern struct testcase_t pbio_color_light_tests[];
+extern struct testcase_t pbio_inflate_tests[];
 extern struct testcase_t pbio_light_matrix_tests[];
 extern struct testcase_t pbio_int_math_tests[];
+extern struct testcase_t pbio_logger_tests[];
+extern struct testcase_t pbio_motor_process_tests[];
+extern struct testcase_t pbio_observer_tests[];
 extern struct testcase_t pbio_servo_tests[];
 extern struct testcase_t pbio_task_tests[];
 extern struct testcase_t pbio_trajectory_tests[];
 extern struct testcase_t pbdrv_legodev_tests[];
 extern struct testcase_t pbio_util_tests[];
 extern struct testcase_t pbsys_bluetooth_tests[];
+extern struct testcase_t pbsys_program_index_tests[];
 extern struct testcase_t pbsys_status_tests[];
+extern struct testcase_t pbsys_storage_tests[];
 static struct testgroup_t test_groups[] = {
     { "drv/bluetooth/", pbdrv_bluetooth_tests },
+    { "drv/block_device/", pbdrv_block_device_tests },
     { "drv/pwm/", pbdrv_pwm_tests },
     { "src/angle/", pbio_angle_tests },
     { "src/battery/", pbio_battery_tests },
     { "src/color/", pbio_color_tests },
     { "src/drivebase/", pbio_drivebase_tests },
+    { "src/geometry/", pbio_geometry_tests },
+    { "src/inflate/", pbio_inflate_tests },
     { "src/light/", pbio_light_animation_tests },
     { "src/light/", pbio_color_light_tests },
     { "src/light/", pbio_light_matrix_tests },
+    { "src/logger/", pbio_logger_tests },
     { "src/math/", pbio_int_math_tests },
+    { "src/motor_process/", pbio_motor_process_tests },
+    { "src/observer/", pbio_observer_tests },
     { "src/servo/", pbio_servo_tests },
     { "src/task/", pbio_task_tests, },
     { "src/trajectory/", pbio_trajectory_tests },
     { "src/uartdev/", pbdrv_legodev_tests, },
     { "src/util/", pbio_util_tests, },
     { "sys/bluetooth/", pbsys_bluetooth_tests, },
+    { "sys/program_index/", pbsys_program_index_tests, },
     { "sys/status/", pbsys_status_tests, },
+    { "sys/storage/", pbsys_storage_tests, },
     END_OF_GROUPS
 };
 
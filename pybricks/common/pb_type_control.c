@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2023 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 #include <pbio/control.h>
 
@@ -87,19 +87,21 @@ static mp_obj_t pb_type_Control_limits(size_t n_args, const mp_obj_t *pos_args,
         pb_type_Control_obj_t, self,
         PB_ARG_DEFAULT_NONE(speed),
         PB_ARG_DEFAULT_NONE(acceleration),
-        PB_ARG_DEFAULT_NONE(torque));
+        PB_ARG_DEFAULT_NONE(torque),
+        PB_ARG_DEFAULT_NONE(jerk));
 
     // Read current values.
-    int32_t speed, acceleration, deceleration, torque;
-    pbio_control_settings_get_trajectory_limits(&self->control->settings, &speed, &acceleration, &deceleration);
+    int32_t speed, acceleration, deceleration, jerk, torque;
+    pbio_control_settings_get_trajectory_limits(&self->control->settings, &speed, &acceleration, &deceleration, &jerk);
     torque = pbio_control_settings_get_actuation_limit(&self->control->settings);
 
     // If all given values are none, return current values
-    if (speed_in == mp_const_none && acceleration_in == mp_const_none && torque_in == mp_const_none) {
+    if (speed_in == mp_const_none && acceleration_in == mp_const_none && torque_in == mp_const_none && jerk_in == mp_const_none) {
         mp_obj_t ret[] = {
             mp_obj_new_int(speed),
             make_acceleration_return_value(acceleration, deceleration),
             mp_obj_new_int(torque),
+            mp_obj_new_int(jerk),
         };
         return mp_obj_new_tuple(MP_ARRAY_SIZE(ret), ret);
     }
@@ -107,10 +109,11 @@ static mp_obj_t pb_type_Control_limits(size_t n_args, const mp_obj_t *pos_args,
     // Set user settings if given, else keep using current values.
     speed = pb_obj_get_default_abs_int(speed_in, speed);
     torque = pb_obj_get_default_abs_int(torque_in, torque);
+    jerk = pb_obj_get_default_abs_int(jerk_in, jerk);
     unpack_acceleration_value(acceleration_in, &acceleration, &deceleration);
 
     // Set new values.
-    pb_assert(pbio_control_settings_set_trajectory_limits(&self->control->settings, speed, acceleration, deceleration));
+    pb_assert(pbio_control_settings_set_trajectory_limits(&self->control->settings, speed, acceleration, deceleration, jerk));
     pb_assert(pbio_control_settings_set_actuation_limit(&self->control->settings, torque));
 
     return mp_const_none;
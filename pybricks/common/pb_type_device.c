@@ -1,17 +1,18 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2023 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 #include "py/mpconfig.h"
 
 #if PYBRICKS_PY_DEVICES
 
-#include <pbdrv/legodev.h>
 #include <pbdrv/legodev.h>
 
 #include <pybricks/common.h>
 #include <pybricks/pupdevices.h>
 #include <pybricks/common/pb_type_device.h>
 
+#include <pybricks/parameters.h>
+#include <pybricks/util_mp/pb_obj_helper.h>
 #include <pybricks/util_pb/pb_error.h>
 
 #include <py/runtime.h>
@@ -79,11 +80,49 @@ static bool pb_pup_device_test_completion(mp_obj_t self_in, uint32_t end_time) {
     return true;
 }
 
+/**
+ * Sets the sensor mode for @p method and returns an awaitable object, or the
+ * values directly if not inside the run loop.
+ *
+ * @param [in]  method      The sensor method.
+ * @param [in]  sensor_in   The sensor object instance.
+ * @param [in]  out_in      List to write the values into instead of
+ *                          allocating a new object, or None.
+ * @return                  Awaitable object or values.
+ */
+mp_obj_t pb_type_device_method_call_into(const pb_type_device_method_obj_t *method, mp_obj_t sensor_in, mp_obj_t out_in) {
+    if (out_in == mp_const_none) {
+        out_in = MP_OBJ_NULL;
+    } else if (!method->supports_out) {
+        mp_raise_TypeError(MP_ERROR_TEXT("out is not supported by this method"));
+    } else {
+        pb_assert_type(out_in, &mp_type_list);
+    }
+
+    pb_type_device_obj_base_t *sensor = MP_OBJ_TO_PTR(sensor_in);
+    pb_assert(pbdrv_legodev_set_mode(sensor->legodev, method->mode));
+
+    return pb_type_awaitable_await_or_wait_into(
+        sensor_in,
+        sensor->awaitables,
+        pb_type_awaitable_end_time_none,
+        pb_pup_device_test_completion,
+        method->get_values,
+        pb_type_awaitable_cancel_none,
+        PB_TYPE_AWAITABLE_OPT_NONE,
+        out_in);
+}
+
 /**
  * Implements calling of async sensor methods. This is called when a (constant)
  * entry of pb_type_device_method type in a sensor class is called. It is
  * responsible for setting the sensor mode and returning an awaitable object.
  *
+ * Methods that return a tuple or Color accept an optional out keyword
+ * argument, a list that the values are written into. This lets programs that
+ * read sensors in a loop avoid allocating a new tuple or Color on every call.
+ * Other methods raise TypeError if it is given.
+ *
  * This is also called in a few places where a simple constant sensor method
  * is not sufficient, where additional wrapping code is used to dynamically
  * set the mode or return mapping, such as in the multi-purpose PUPDevice, or
@@ -93,20 +132,69 @@ static bool pb_pup_device_test_completion(mp_obj_t self_in, uint32_t end_time) {
 mp_obj_t pb_type_device_method_call(mp_obj_t self_in, size_t n_args, size_t n_kw, const mp_obj_t *args) {
     assert(mp_obj_is_type(self_in, &pb_type_device_method));
     pb_type_device_method_obj_t *method = MP_OBJ_TO_PTR(self_in);
-    mp_arg_check_num(n_args, n_kw, 1, 1, false);
+    mp_arg_check_num(n_args, n_kw, 1, 1, true);
+
+    mp_obj_t out_in = mp_const_none;
+    for (size_t i = 0; i < n_kw; i++) {
+        if (args[n_args + 2 * i] != MP_OBJ_NEW_QSTR(MP_QSTR_out)) {
+            mp_raise_TypeError(MP_ERROR_TEXT("unexpected keyword argument"));
+        }
+        out_in = args[n_args + 2 * i + 1];
+    }
 
-    mp_obj_t sensor_in = args[0];
-    pb_type_device_obj_base_t *sensor = MP_OBJ_TO_PTR(sensor_in);
-    pb_assert(pbdrv_legodev_set_mode(sensor->legodev, method->mode));
+    return pb_type_device_method_call_into(method, args[0], out_in);
+}
 
-    return pb_type_awaitable_await_or_wait(
-        sensor_in,
-        sensor->awaitables,
-        pb_type_awaitable_end_time_none,
-        pb_pup_device_test_completion,
-        method->get_values,
-        pb_type_awaitable_cancel_none,
-        PB_TYPE_AWAITABLE_OPT_NONE);
+/**
+ * Creates the return value for sensor methods that return a tuple. If the
+ * method was called with an out list, the values are written into that list
+ * instead, which is then returned.
+ *
+ * Must only be called from a pb_type_device_method_obj_t get_values function.
+ *
+ * @param [in]  n           Number of values.
+ * @param [in]  items       The values.
+ * @return                  New tuple or the out list.
+ */
+mp_obj_t pb_type_device_new_tuple(size_t n, const mp_obj_t *items) {
+    mp_obj_t out_in = pb_type_awaitable_get_return_into();
+    if (out_in == MP_OBJ_NULL) {
+        return mp_obj_new_tuple(n, items);
+    }
+
+    mp_obj_list_t *out = MP_OBJ_TO_PTR(out_in);
+    if (out->len != n) {
+        pb_assert(PBIO_ERROR_INVALID_ARG);
+    }
+    for (size_t i = 0; i < n; i++) {
+        out->items[i] = items[i];
+    }
+    return out_in;
+}
+
+/**
+ * Creates the return value for sensor methods that return a Color. If the
+ * method was called with an out list, hue, saturation, and value are written
+ * into that list instead, which is then returned.
+ *
+ * Must only be called from a pb_type_device_method_obj_t get_values function.
+ *
+ * @param [in]  hsv         The measured color.
+ * @return                  New Color or the out list.
+ */
+mp_obj_t pb_type_device_new_color(const pbio_color_hsv_t *hsv) {
+    if (pb_type_awaitable_get_return_into() == MP_OBJ_NULL) {
+        pb_type_Color_obj_t *color = pb_type_Color_new_empty();
+        color->hsv = *hsv;
+        return MP_OBJ_FROM_PTR(color);
+    }
+
+    const mp_obj_t items[] = {
+        MP_OBJ_NEW_SMALL_INT(hsv->h),
+        MP_OBJ_NEW_SMALL_INT(hsv->s),
+        MP_OBJ_NEW_SMALL_INT(hsv->v),
+    };
+    return pb_type_device_new_tuple(MP_ARRAY_SIZE(items), items);
 }
 
 /**
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2023 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 #ifndef PYBRICKS_INCLUDED_PYBRICKS_TYPE_DEVICE_H
 #define PYBRICKS_INCLUDED_PYBRICKS_TYPE_DEVICE_H
@@ -10,7 +10,8 @@
 
 #include <pbdrv/legodev.h>
 
-#include <pbdrv/legodev.h>
+#include <pbio/color.h>
+
 #include <pybricks/tools/pb_type_awaitable.h>
 
 /**
@@ -36,6 +37,8 @@ typedef struct {
     mp_obj_base_t base;
     pb_type_awaitable_return_t get_values;
     uint8_t mode;
+    /** Whether get_values can write its values into an out list. */
+    bool supports_out;
 } pb_type_device_method_obj_t;
 
 /**
@@ -56,7 +59,19 @@ extern const mp_obj_type_t pb_type_device_method;
     const pb_type_device_method_obj_t obj_name = \
     {{&pb_type_device_method}, .mode = mode_id, .get_values = get_values_func}
 
+/**
+ * Like PB_DEFINE_CONST_TYPE_DEVICE_METHOD_OBJ, for methods whose mapping
+ * function creates its return value with pb_type_device_new_tuple() or
+ * pb_type_device_new_color(). These methods accept the out keyword argument.
+ */
+#define PB_DEFINE_CONST_TYPE_DEVICE_METHOD_OBJ_OUT(obj_name, mode_id, get_values_func) \
+    const pb_type_device_method_obj_t obj_name = \
+    {{&pb_type_device_method}, .mode = mode_id, .get_values = get_values_func, .supports_out = true}
+
 mp_obj_t pb_type_device_method_call(mp_obj_t self_in, size_t n_args, size_t n_kw, const mp_obj_t *args);
+mp_obj_t pb_type_device_method_call_into(const pb_type_device_method_obj_t *method, mp_obj_t sensor_in, mp_obj_t out_in);
+mp_obj_t pb_type_device_new_tuple(size_t n, const mp_obj_t *items);
+mp_obj_t pb_type_device_new_color(const pbio_color_hsv_t *hsv);
 mp_obj_t pb_type_pupdevices_method(mp_obj_t self_in, size_t n_args, size_t n_kw, const mp_obj_t *args);
 pbdrv_legodev_type_id_t pb_type_device_init_class(pb_type_device_obj_base_t *self, mp_obj_t port_in, pbdrv_legodev_type_id_t valid_id);
 mp_obj_t pb_type_device_set_data(pb_type_device_obj_base_t *sensor, uint8_t mode, const void *data, uint8_t size);
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2020-2023 The Pybricks Authors
+// Copyright (c) 2020-2024 The Pybricks Authors
 
 #include "py/mpconfig.h"
 
@@ -52,17 +52,17 @@ MP_DEFINE_CONST_FUN_OBJ_1(pb_type_imu_up_obj, pb_type_imu_up);
 // pybricks._common.IMU.tilt
 static mp_obj_t pb_type_imu_tilt(mp_obj_t self_in) {
 
-    // Read acceleration in the user frame.
-    pbio_geometry_xyz_t accl;
-    pbio_imu_get_acceleration(&accl);
+    // Read estimated up vector in the user frame.
+    pbio_geometry_xyz_t up;
+    pbio_imu_get_up_vector(&up);
 
     mp_obj_t tilt[2];
     // Pitch
-    float pitch = atan2f(-accl.x, sqrtf(accl.z * accl.z + accl.y * accl.y));
+    float pitch = atan2f(-up.x, sqrtf(up.z * up.z + up.y * up.y));
     tilt[0] = mp_obj_new_int_from_float(pitch * 57.296f);
 
     // Roll
-    float roll = atan2f(accl.y, accl.z);
+    float roll = atan2f(up.y, up.z);
     tilt[1] = mp_obj_new_int_from_float(roll * 57.296f);
     return mp_obj_new_tuple(2, tilt);
 }
@@ -85,11 +85,16 @@ static void pb_type_imu_extract_axis(mp_obj_t obj_in, pbio_geometry_xyz_t *vecto
 static mp_obj_t pb_type_imu_acceleration(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
         pb_type_imu_obj_t, self,
-        PB_ARG_DEFAULT_NONE(axis));
+        PB_ARG_DEFAULT_NONE(axis),
+        PB_ARG_DEFAULT_TRUE(gravity));
 
     (void)self;
     pbio_geometry_xyz_t acceleration;
-    pbio_imu_get_acceleration(&acceleration);
+    if (mp_obj_is_true(gravity_in)) {
+        pbio_imu_get_acceleration(&acceleration);
+    } else {
+        pbio_imu_get_linear_acceleration(&acceleration);
+    }
 
     // If no axis is specified, return a vector of values.
     if (axis_in == mp_const_none) {
@@ -149,6 +154,21 @@ static mp_obj_t pb_type_imu_rotation(size_t n_args, const mp_obj_t *pos_args, mp
 }
 static MP_DEFINE_CONST_FUN_OBJ_KW(pb_type_imu_rotation_obj, 1, pb_type_imu_rotation);
 
+// pybricks._common.IMU.orientation
+static mp_obj_t pb_type_imu_orientation(mp_obj_t self_in) {
+    (void)self_in;
+    pbio_geometry_matrix_3x3_t orientation;
+    pbio_imu_get_orientation(&orientation);
+
+    // Make it a 3x3 matrix.
+    mp_obj_t matrix = pb_type_Matrix_make_vector(MP_ARRAY_SIZE(orientation.values), orientation.values, false);
+    pb_type_Matrix_obj_t *matrix_obj = MP_OBJ_TO_PTR(matrix);
+    matrix_obj->m = 3;
+    matrix_obj->n = 3;
+    return matrix;
+}
+MP_DEFINE_CONST_FUN_OBJ_1(pb_type_imu_orientation_obj, pb_type_imu_orientation);
+
 // pybricks._common.IMU.ready
 static mp_obj_t pb_type_imu_ready(mp_obj_t self_in) {
     return mp_obj_new_bool(pbio_imu_is_ready());
@@ -201,11 +221,16 @@ static mp_obj_t pb_type_imu_settings(size_t n_args, const mp_obj_t *pos_args, mp
 static MP_DEFINE_CONST_FUN_OBJ_KW(pb_type_imu_settings_obj, 1, pb_type_imu_settings);
 
 // pybricks._common.IMU.heading
-static mp_obj_t pb_type_imu_heading(mp_obj_t self_in) {
-    (void)self_in;
-    return mp_obj_new_float(pbio_imu_get_heading());
+static mp_obj_t pb_type_imu_heading(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
+        pb_type_imu_obj_t, self,
+        PB_ARG_DEFAULT_FALSE(compensate_tilt));
+
+    (void)self;
+    pbio_imu_heading_type_t type = mp_obj_is_true(compensate_tilt_in) ? PBIO_IMU_HEADING_TYPE_3D : PBIO_IMU_HEADING_TYPE_1D;
+    return mp_obj_new_float(pbio_imu_get_heading(type));
 }
-MP_DEFINE_CONST_FUN_OBJ_1(pb_type_imu_heading_obj, pb_type_imu_heading);
+static MP_DEFINE_CONST_FUN_OBJ_KW(pb_type_imu_heading_obj, 1, pb_type_imu_heading);
 
 // pybricks._common.IMU.reset_heading
 static mp_obj_t pb_type_imu_reset_heading(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
@@ -247,6 +272,7 @@ static const mp_rom_map_elem_t pb_type_imu_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_acceleration),     MP_ROM_PTR(&pb_type_imu_acceleration_obj)    },
     { MP_ROM_QSTR(MP_QSTR_angular_velocity), MP_ROM_PTR(&pb_type_imu_angular_velocity_obj)},
     { MP_ROM_QSTR(MP_QSTR_heading),          MP_ROM_PTR(&pb_type_imu_heading_obj)         },
+    { MP_ROM_QSTR(MP_QSTR_orientation),      MP_ROM_PTR(&pb_type_imu_orientation_obj)     },
     { MP_ROM_QSTR(MP_QSTR_ready),            MP_ROM_PTR(&pb_type_imu_ready_obj)           },
     { MP_ROM_QSTR(MP_QSTR_reset_heading),    MP_ROM_PTR(&pb_type_imu_reset_heading_obj)   },
     { MP_ROM_QSTR(MP_QSTR_rotation),         MP_ROM_PTR(&pb_type_imu_rotation_obj)        },
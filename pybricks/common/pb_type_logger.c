@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2023 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 #include "py/mpconfig.h"
 
@@ -14,6 +14,7 @@
 #include <pbio/logger.h>
 #include <pbio/int_math.h>
 #include <pbio/servo.h>
+#include <pbsys/bluetooth.h>
 
 #include "py/obj.h"
 #include "py/runtime.h"
@@ -50,11 +51,19 @@ static mp_obj_t tools_Logger_start(size_t n_args, const mp_obj_t *pos_args, mp_m
     PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
         tools_Logger_obj_t, self,
         PB_ARG_REQUIRED(duration),
-        PB_ARG_DEFAULT_INT(down_sample, 1));
+        PB_ARG_DEFAULT_INT(down_sample, 1),
+        PB_ARG_DEFAULT_FALSE(stream));
 
     // Log only one row per divisor samples.
     mp_uint_t down_sample = pbio_int_math_max(pb_obj_get_int(down_sample_in), 1);
-    mp_uint_t num_rows = pb_obj_get_int(duration_in) / PBIO_CONFIG_CONTROL_LOOP_TIME_MS / down_sample;
+    mp_uint_t num_rows = pb_obj_get_int(duration_in) / self->log->loop_time / down_sample;
+
+    // In streaming mode, the duration sets how much data can be buffered
+    // while it is being sent. One more row is needed for the ring buffer.
+    bool stream = mp_obj_is_true(stream_in);
+    if (stream) {
+        num_rows = pbio_int_math_max(num_rows, 1) + 1;
+    }
 
     // Size is number of rows times column width. All data are int32.
     mp_int_t size = num_rows * self->num_cols;
@@ -62,7 +71,18 @@ static mp_obj_t tools_Logger_start(size_t n_args, const mp_obj_t *pos_args, mp_m
     self->last_size = size;
 
     // Indicates that background control loops may enter data in log.
-    pbio_logger_start(self->log, self->buf, num_rows, self->num_cols, down_sample);
+    if (!stream) {
+        pbio_logger_start(self->log, self->buf, num_rows, self->num_cols, down_sample);
+        return mp_const_none;
+    }
+
+    // Start logging and send rows in the background as they come in.
+    pbio_logger_start_stream(self->log, self->buf, num_rows, self->num_cols, down_sample);
+    pbio_error_t err = pbsys_bluetooth_log_stream_start(self->log);
+    if (err != PBIO_SUCCESS) {
+        pbio_logger_stop(self->log);
+        pb_assert(err);
+    }
 
     return mp_const_none;
 }
@@ -78,21 +98,93 @@ static mp_obj_t tools_Logger_stop(mp_obj_t self_in) {
 }
 static MP_DEFINE_CONST_FUN_OBJ_1(tools_Logger_stop_obj, tools_Logger_stop);
 
+/**
+ * Output state for writing binary log data.
+ */
+typedef struct _tools_Logger_binary_writer_t {
+    #if PYBRICKS_PY_COMMON_LOGGER_REAL_FILE
+    /**
+     * File to write to.
+     */
+    FILE *file;
+    #else
+    /**
+     * Pending bytes, written as one line of base64 text when full. This way,
+     * the binary data can share stdout with text, and each line can be
+     * decoded on its own.
+     */
+    uint8_t line[57];
+    /**
+     * Number of pending bytes.
+     */
+    size_t size;
+    #endif // PYBRICKS_PY_COMMON_LOGGER_REAL_FILE
+} tools_Logger_binary_writer_t;
+
+#if !PYBRICKS_PY_COMMON_LOGGER_REAL_FILE
+static void tools_Logger_binary_writer_flush(tools_Logger_binary_writer_t *writer) {
+    static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    if (writer->size == 0) {
+        return;
+    }
+
+    for (size_t i = 0; i < writer->size; i += 3) {
+        uint32_t n = writer->line[i] << 16;
+        n |= i + 1 < writer->size ? writer->line[i + 1] << 8 : 0;
+        n |= i + 2 < writer->size ? writer->line[i + 2] : 0;
+
+        char encoded[] = {
+            table[(n >> 18) & 0x3f],
+            table[(n >> 12) & 0x3f],
+            i + 1 < writer->size ? table[(n >> 6) & 0x3f] : '=',
+            i + 2 < writer->size ? table[n & 0x3f] : '=',
+        };
+        mp_print_strn(&mp_plat_print, encoded, sizeof(encoded), 0, 0, 0);
+    }
+    mp_print_str(&mp_plat_print, "\n");
+    writer->size = 0;
+}
+#endif // !PYBRICKS_PY_COMMON_LOGGER_REAL_FILE
+
+static pbio_error_t tools_Logger_binary_writer_write(tools_Logger_binary_writer_t *writer, const uint8_t *data, size_t size) {
+    #if PYBRICKS_PY_COMMON_LOGGER_REAL_FILE
+    if (fwrite(data, 1, size, writer->file) != size) {
+        return PBIO_ERROR_IO;
+    }
+    #else
+    for (size_t i = 0; i < size; i++) {
+        writer->line[writer->size++] = data[i];
+        if (writer->size == sizeof(writer->line)) {
+            tools_Logger_binary_writer_flush(writer);
+        }
+    }
+    #endif // PYBRICKS_PY_COMMON_LOGGER_REAL_FILE
+    return PBIO_SUCCESS;
+}
+
 static mp_obj_t tools_Logger_save(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
 
     PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
         tools_Logger_obj_t, self,
-        PB_ARG_DEFAULT_NONE(path));
+        PB_ARG_DEFAULT_NONE(path),
+        PB_ARG_DEFAULT_FALSE(binary));
 
     // Don't allow any more data to be added to logs.
     pbio_logger_stop(self->log);
 
+    // Streamed data has already been sent.
+    if (pbio_logger_is_streaming(self->log)) {
+        pb_assert(PBIO_ERROR_INVALID_OP);
+    }
+
     // Get log file path.
-    const char *path = path_in == mp_const_none ? "log.txt" : mp_obj_str_get_str(path_in);
+    bool binary = mp_obj_is_true(binary_in);
+    const char *path = path_in != mp_const_none ? mp_obj_str_get_str(path_in) : (binary ? "log.bin" : "log.txt");
 
     #if PYBRICKS_PY_COMMON_LOGGER_REAL_FILE
     // Create an empty log file locally.
-    FILE *log_file = fopen(path, "w");
+    FILE *log_file = fopen(path, binary ? "wb" : "w");
     if (log_file == NULL) {
         pb_assert(PBIO_ERROR_IO);
     }
@@ -104,24 +196,45 @@ static mp_obj_t tools_Logger_save(size_t n_args, const mp_obj_t *pos_args, mp_ma
 
     pbio_error_t err = PBIO_SUCCESS;
 
-    // Write data to file line by line
-    for (uint32_t row = 0; row < pbio_logger_get_num_rows_used(self->log); row++) {
-
-        int32_t *row_data = pbio_logger_get_row_data(self->log, row);
-
-        for (uint32_t col = 0; col < self->log->num_cols; col++) {
-
-            // Write "-12345, " or "-12345\n" for last value on row.
-            const char *format = col + 1 < self->log->num_cols ? "%d, " : "%d\n";
+    // In binary mode, each row is encoded as the difference from the
+    // previous row, so keep track of it.
+    tools_Logger_binary_writer_t writer = {
+        #if PYBRICKS_PY_COMMON_LOGGER_REAL_FILE
+        .file = log_file,
+        #endif
+    };
+    int32_t *previous = NULL;
+    uint8_t *encoded = NULL;
+    if (binary) {
+        previous = m_new0(int32_t, self->log->num_cols);
+        encoded = m_new(uint8_t, self->log->num_cols * PBIO_LOGGER_BINARY_MAX_VALUE_SIZE);
+        uint8_t header[PBIO_LOGGER_BINARY_HEADER_SIZE];
+        err = tools_Logger_binary_writer_write(&writer, header, pbio_logger_binary_encode_header(self->log, header));
+    }
 
-            // Write one value.
-            #if PYBRICKS_PY_COMMON_LOGGER_REAL_FILE
-            if (fprintf(log_file, format, row_data[col]) < 0) {
-                break;
+    // Write data to file line by line
+    for (uint32_t row = 0; row < pbio_logger_get_num_rows_used(self->log) && err == PBIO_SUCCESS; row++) {
+
+        if (binary) {
+            uint32_t size = pbio_logger_binary_encode_row(self->log, row, previous, encoded);
+            err = tools_Logger_binary_writer_write(&writer, encoded, size);
+        } else {
+            int32_t *row_data = pbio_logger_get_row_data(self->log, row);
+
+            for (uint32_t col = 0; col < self->log->num_cols; col++) {
+
+                // Write "-12345, " or "-12345\n" for last value on row.
+                const char *format = col + 1 < self->log->num_cols ? "%d, " : "%d\n";
+
+                // Write one value.
+                #if PYBRICKS_PY_COMMON_LOGGER_REAL_FILE
+                if (fprintf(log_file, format, row_data[col]) < 0) {
+                    break;
+                }
+                #else
+                mp_printf(&mp_plat_print, format, row_data[col]);
+                #endif // PYBRICKS_PY_COMMON_LOGGER_REAL_FILE
             }
-            #else
-            mp_printf(&mp_plat_print, format, row_data[col]);
-            #endif // PYBRICKS_PY_COMMON_LOGGER_REAL_FILE
         }
 
         // Writing data can take a while, so give system some time too.
@@ -135,9 +248,15 @@ static mp_obj_t tools_Logger_save(size_t n_args, const mp_obj_t *pos_args, mp_ma
         err = PBIO_ERROR_IO;
     }
     #else
+    tools_Logger_binary_writer_flush(&writer);
     mp_print_str(&mp_plat_print, "PB_EOF\n");
     #endif // PYBRICKS_PY_COMMON_LOGGER_REAL_FILE
 
+    if (binary) {
+        m_del(int32_t, previous, self->log->num_cols);
+        m_del(uint8_t, encoded, self->log->num_cols * PBIO_LOGGER_BINARY_MAX_VALUE_SIZE);
+    }
+
     pb_assert(err);
     return mp_const_none;
 }
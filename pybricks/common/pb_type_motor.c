@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2023 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 #include "py/mpconfig.h"
 
@@ -408,6 +408,26 @@ static mp_obj_t pb_type_Motor_run_target(size_t n_args, const mp_obj_t *pos_args
 }
 static MP_DEFINE_CONST_FUN_OBJ_KW(pb_type_Motor_run_target_obj, 1, pb_type_Motor_run_target);
 
+#if PBIO_CONFIG_CONTROL_QUEUE
+// pybricks.common.Motor.queue_target
+static mp_obj_t pb_type_Motor_queue_target(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
+        pb_type_Motor_obj_t, self,
+        PB_ARG_REQUIRED(speed),
+        PB_ARG_REQUIRED(target_angle),
+        PB_ARG_DEFAULT_OBJ(then, pb_Stop_HOLD_obj));
+
+    mp_int_t speed = pb_obj_get_int(speed_in);
+    mp_int_t target_angle = pb_obj_get_int(target_angle_in);
+    pbio_control_on_completion_t then = pb_type_enum_get_value(then_in, &pb_enum_type_Stop);
+
+    // Add to the queue without waiting. Use done() to see if all are complete.
+    pb_assert(pbio_servo_queue_target(self->srv, speed, target_angle, then));
+    return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_KW(pb_type_Motor_queue_target_obj, 1, pb_type_Motor_queue_target);
+#endif
+
 // pybricks.common.Motor.track_target
 static mp_obj_t pb_type_Motor_track_target(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
@@ -447,6 +467,28 @@ static mp_obj_t pb_type_Motor_load(mp_obj_t self_in) {
 }
 static MP_DEFINE_CONST_FUN_OBJ_1(pb_type_Motor_load_obj, pb_type_Motor_load);
 
+#if PBIO_CONFIG_CONTROL_LOOP_TIME_RUNTIME
+// pybricks.common.Motor.decimation
+static mp_obj_t pb_type_Motor_decimation(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
+        pb_type_Motor_obj_t, self,
+        PB_ARG_DEFAULT_NONE(decimation));
+
+    // Return the number of control loops between updates if no argument given.
+    if (decimation_in == mp_const_none) {
+        return mp_obj_new_int(self->srv->decimation);
+    }
+
+    mp_int_t decimation = pb_obj_get_positive_int(decimation_in);
+    if (decimation < 1 || decimation > UINT8_MAX) {
+        pb_assert(PBIO_ERROR_INVALID_ARG);
+    }
+    pb_assert(pbio_servo_set_decimation(self->srv, decimation));
+    return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_KW(pb_type_Motor_decimation_obj, 1, pb_type_Motor_decimation);
+#endif // PBIO_CONFIG_CONTROL_LOOP_TIME_RUNTIME
+
 #if PYBRICKS_PY_COMMON_CONTROL | PYBRICKS_PY_COMMON_LOGGER
 static const pb_attr_dict_entry_t pb_type_Motor_attr_dict[] = {
     #if PYBRICKS_PY_COMMON_CONTROL
@@ -484,10 +526,16 @@ static const mp_rom_map_elem_t pb_type_Motor_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_run_until_stalled), MP_ROM_PTR(&pb_type_Motor_run_until_stalled_obj) },
     { MP_ROM_QSTR(MP_QSTR_run_angle), MP_ROM_PTR(&pb_type_Motor_run_angle_obj) },
     { MP_ROM_QSTR(MP_QSTR_run_target), MP_ROM_PTR(&pb_type_Motor_run_target_obj) },
+    #if PBIO_CONFIG_CONTROL_QUEUE
+    { MP_ROM_QSTR(MP_QSTR_queue_target), MP_ROM_PTR(&pb_type_Motor_queue_target_obj) },
+    #endif
     { MP_ROM_QSTR(MP_QSTR_stalled), MP_ROM_PTR(&pb_type_Motor_stalled_obj) },
     { MP_ROM_QSTR(MP_QSTR_done), MP_ROM_PTR(&pb_type_Motor_done_obj) },
     { MP_ROM_QSTR(MP_QSTR_track_target), MP_ROM_PTR(&pb_type_Motor_track_target_obj) },
     { MP_ROM_QSTR(MP_QSTR_load), MP_ROM_PTR(&pb_type_Motor_load_obj) },
+    #if PBIO_CONFIG_CONTROL_LOOP_TIME_RUNTIME
+    { MP_ROM_QSTR(MP_QSTR_decimation), MP_ROM_PTR(&pb_type_Motor_decimation_obj) },
+    #endif
 };
 static MP_DEFINE_CONST_DICT(pb_type_Motor_locals_dict, pb_type_Motor_locals_dict_table);
 
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2023 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 #include "py/mpconfig.h"
 
@@ -79,9 +79,9 @@ static mp_obj_t get_rgb(mp_obj_t self_in) {
         rgb[i] = (rgb[i] < 0   ?   0 : rgb[i]);
         tup[i] = mp_obj_new_int(rgb[i]);
     }
-    return mp_obj_new_tuple(3, tup);
+    return pb_type_device_new_tuple(3, tup);
 }
-static PB_DEFINE_CONST_TYPE_DEVICE_METHOD_OBJ(get_rgb_obj, PBDRV_LEGODEV_MODE_EV3_COLOR_SENSOR__RGB_RAW, get_rgb);
+static PB_DEFINE_CONST_TYPE_DEVICE_METHOD_OBJ_OUT(get_rgb_obj, PBDRV_LEGODEV_MODE_EV3_COLOR_SENSOR__RGB_RAW, get_rgb);
 
 // dir(pybricks.ev3devices.ColorSensor)
 static const mp_rom_map_elem_t ev3devices_ColorSensor_locals_dict_table[] = {
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2023 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 #include "py/mpconfig.h"
 
@@ -139,14 +139,15 @@ static mp_obj_t get_pup_data_tuple(mp_obj_t self_in) {
         }
     }
 
-    return mp_obj_new_tuple(info->mode_info[info->mode].num_values, values);
+    return pb_type_device_new_tuple(info->mode_info[info->mode].num_values, values);
 }
 
 // pybricks.iodevices.PUPDevice.read
 static mp_obj_t iodevices_PUPDevice_read(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
         iodevices_PUPDevice_obj_t, self,
-        PB_ARG_REQUIRED(mode));
+        PB_ARG_REQUIRED(mode),
+        PB_ARG_DEFAULT_NONE(out));
 
     // Passive devices don't support reading.
     if (self->passive_id != PBDRV_LEGODEV_TYPE_ID_LPF2_UNKNOWN_UART) {
@@ -161,11 +162,12 @@ static mp_obj_t iodevices_PUPDevice_read(size_t n_args, const mp_obj_t *pos_args
         {&pb_type_device_method},
         .mode = self->last_mode,
         .get_values = get_pup_data_tuple,
+        .supports_out = true,
     };
 
     // This will take care of checking that the requested mode exist and raise
     // otherwise, so no need to check here.
-    return pb_type_device_method_call(MP_OBJ_FROM_PTR(&method), 1, 0, pos_args);
+    return pb_type_device_method_call_into(&method, MP_OBJ_FROM_PTR(self), out_in);
 }
 MP_DEFINE_CONST_FUN_OBJ_KW(iodevices_PUPDevice_read_obj, 1, iodevices_PUPDevice_read);
 
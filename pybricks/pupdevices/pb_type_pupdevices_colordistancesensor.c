@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2023 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 #include "py/mpconfig.h"
 
@@ -124,11 +124,11 @@ static PB_DEFINE_CONST_TYPE_DEVICE_METHOD_OBJ(get_ambient_obj, PBDRV_LEGODEV_MOD
 // pybricks.pupdevices.ColorDistanceSensor.hsv
 static mp_obj_t get_hsv(mp_obj_t self_in) {
     pupdevices_ColorDistanceSensor_obj_t *self = MP_OBJ_TO_PTR(self_in);
-    pb_type_Color_obj_t *color = pb_type_Color_new_empty();
-    get_hsv_data(self, &color->hsv);
-    return MP_OBJ_FROM_PTR(color);
+    pbio_color_hsv_t hsv;
+    get_hsv_data(self, &hsv);
+    return pb_type_device_new_color(&hsv);
 }
-static PB_DEFINE_CONST_TYPE_DEVICE_METHOD_OBJ(get_hsv_obj, PBDRV_LEGODEV_MODE_PUP_COLOR_DISTANCE_SENSOR__RGB_I, get_hsv);
+static PB_DEFINE_CONST_TYPE_DEVICE_METHOD_OBJ_OUT(get_hsv_obj, PBDRV_LEGODEV_MODE_PUP_COLOR_DISTANCE_SENSOR__RGB_I, get_hsv);
 
 static const pb_attr_dict_entry_t pupdevices_ColorDistanceSensor_attr_dict[] = {
     PB_DEFINE_CONST_ATTR_RO(MP_QSTR_light, pupdevices_ColorDistanceSensor_obj_t, light),
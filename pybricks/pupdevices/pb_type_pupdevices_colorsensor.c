@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2023 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 #include "py/mpconfig.h"
 
@@ -38,6 +38,16 @@ static mp_obj_t pupdevices_ColorSensor_make_new(const mp_obj_type_t *type, size_
     // Do one reading to make sure everything is working and to set default mode
     pb_type_device_get_data_blocking(MP_OBJ_FROM_PTR(self), PBDRV_LEGODEV_MODE_PUP_COLOR_SENSOR__RGB_I);
 
+    // If supported by the sensor, receive both modes at once so that mixing
+    // surface and non-surface measurements does not require mode switches.
+    static const uint8_t combi_modes[] = {
+        PBDRV_LEGODEV_MODE_PUP_COLOR_SENSOR__RGB_I,
+        PBDRV_LEGODEV_MODE_PUP_COLOR_SENSOR__SHSV,
+    };
+    if (pbdrv_legodev_set_mode_combi(self->device_base.legodev, combi_modes, MP_ARRAY_SIZE(combi_modes)) == PBIO_SUCCESS) {
+        pb_type_device_get_data_blocking(MP_OBJ_FROM_PTR(self), PBDRV_LEGODEV_MODE_PUP_COLOR_SENSOR__RGB_I);
+    }
+
     // Save default settings
     pb_color_map_save_default(&self->color_map);
 
@@ -88,19 +98,19 @@ static void get_hsv_ambient(mp_obj_t self_in, pbio_color_hsv_t *hsv) {
 
 // pybricks.pupdevices.ColorSensor.hsv(surface=True)
 static mp_obj_t get_hsv_surface_true(mp_obj_t self_in) {
-    pb_type_Color_obj_t *color = pb_type_Color_new_empty();
-    get_hsv_reflected(self_in, &color->hsv);
-    return MP_OBJ_FROM_PTR(color);
+    pbio_color_hsv_t hsv;
+    get_hsv_reflected(self_in, &hsv);
+    return pb_type_device_new_color(&hsv);
 }
-static PB_DEFINE_CONST_TYPE_DEVICE_METHOD_OBJ(get_hsv_surface_true_obj, PBDRV_LEGODEV_MODE_PUP_COLOR_SENSOR__RGB_I, get_hsv_surface_true);
+static PB_DEFINE_CONST_TYPE_DEVICE_METHOD_OBJ_OUT(get_hsv_surface_true_obj, PBDRV_LEGODEV_MODE_PUP_COLOR_SENSOR__RGB_I, get_hsv_surface_true);
 
 // pybricks.pupdevices.ColorSensor.hsv(surface=False)
 static mp_obj_t get_hsv_surface_false(mp_obj_t self_in) {
-    pb_type_Color_obj_t *color = pb_type_Color_new_empty();
-    get_hsv_ambient(self_in, &color->hsv);
-    return MP_OBJ_FROM_PTR(color);
+    pbio_color_hsv_t hsv;
+    get_hsv_ambient(self_in, &hsv);
+    return pb_type_device_new_color(&hsv);
 }
-static PB_DEFINE_CONST_TYPE_DEVICE_METHOD_OBJ(get_hsv_surface_false_obj, PBDRV_LEGODEV_MODE_PUP_COLOR_SENSOR__SHSV, get_hsv_surface_false);
+static PB_DEFINE_CONST_TYPE_DEVICE_METHOD_OBJ_OUT(get_hsv_surface_false_obj, PBDRV_LEGODEV_MODE_PUP_COLOR_SENSOR__SHSV, get_hsv_surface_false);
 
 // pybricks.pupdevices.ColorSensor.color(surface=True)
 static mp_obj_t get_color_surface_true(mp_obj_t self_in) {
@@ -124,13 +134,13 @@ static PB_DEFINE_CONST_TYPE_DEVICE_METHOD_OBJ(get_color_surface_false_obj, PBDRV
 static mp_obj_t get_hsv(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
         pupdevices_ColorSensor_obj_t, self,
-        PB_ARG_DEFAULT_TRUE(surface));
+        PB_ARG_DEFAULT_TRUE(surface),
+        PB_ARG_DEFAULT_NONE(out));
 
-    (void)self;
     if (mp_obj_is_true(surface_in)) {
-        return pb_type_device_method_call(MP_OBJ_FROM_PTR(&get_hsv_surface_true_obj), 1, 0, pos_args);
+        return pb_type_device_method_call_into(&get_hsv_surface_true_obj, MP_OBJ_FROM_PTR(self), out_in);
     }
-    return pb_type_device_method_call(MP_OBJ_FROM_PTR(&get_hsv_surface_false_obj), 1, 0, pos_args);
+    return pb_type_device_method_call_into(&get_hsv_surface_false_obj, MP_OBJ_FROM_PTR(self), out_in);
 }
 static MP_DEFINE_CONST_FUN_OBJ_KW(get_hsv_obj, 1, get_hsv);
 
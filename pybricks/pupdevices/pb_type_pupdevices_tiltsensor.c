@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2023 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 #include "py/mpconfig.h"
 
@@ -34,9 +34,9 @@ static mp_obj_t get_tilt(mp_obj_t self_in) {
     mp_obj_t ret[2];
     ret[0] = mp_obj_new_int(tilt[1]);
     ret[1] = mp_obj_new_int(tilt[0]);
-    return mp_obj_new_tuple(MP_ARRAY_SIZE(ret), ret);
+    return pb_type_device_new_tuple(MP_ARRAY_SIZE(ret), ret);
 }
-static PB_DEFINE_CONST_TYPE_DEVICE_METHOD_OBJ(get_tilt_obj, PBDRV_LEGODEV_MODE_PUP_WEDO2_TILT_SENSOR__ANGLE, get_tilt);
+static PB_DEFINE_CONST_TYPE_DEVICE_METHOD_OBJ_OUT(get_tilt_obj, PBDRV_LEGODEV_MODE_PUP_WEDO2_TILT_SENSOR__ANGLE, get_tilt);
 
 // dir(pybricks.pupdevices.TiltSensor)
 static const mp_rom_map_elem_t pupdevices_TiltSensor_locals_dict_table[] = {
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2023 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 #include "py/mpconfig.h"
 
@@ -35,6 +35,9 @@ struct _pb_type_DriveBase_obj_t {
     mp_obj_t heading_control;
     mp_obj_t distance_control;
     #endif
+    #if PBIO_CONFIG_DRIVEBASE_ODOMETRY && PYBRICKS_PY_COMMON_LOGGER
+    mp_obj_t pose_logger;
+    #endif
     mp_obj_t awaitables;
 };
 
@@ -80,6 +83,11 @@ static mp_obj_t pb_type_DriveBase_make_new(const mp_obj_type_t *type, size_t n_a
     self->distance_control = pb_type_Control_obj_make_new(&self->db->control_distance);
     #endif
 
+    #if PBIO_CONFIG_DRIVEBASE_ODOMETRY && PYBRICKS_PY_COMMON_LOGGER
+    // Create an instance of the Logger class for the pose
+    self->pose_logger = common_Logger_obj_make_new(&self->db->pose_log, PBIO_DRIVEBASE_POSE_LOGGER_NUM_COLS);
+    #endif
+
     // Reset drivebase state
     pb_type_DriveBase_reset(MP_OBJ_FROM_PTR(self));
 
@@ -275,6 +283,37 @@ static mp_obj_t pb_type_DriveBase_state(mp_obj_t self_in) {
 }
 MP_DEFINE_CONST_FUN_OBJ_1(pb_type_DriveBase_state_obj, pb_type_DriveBase_state);
 
+#if PBIO_CONFIG_DRIVEBASE_ODOMETRY
+// pybricks.robotics.DriveBase.pose
+static mp_obj_t pb_type_DriveBase_pose(mp_obj_t self_in) {
+    pb_type_DriveBase_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    int32_t x, y, heading;
+    pb_assert(pbio_drivebase_get_pose(self->db, &x, &y, &heading));
+
+    mp_obj_t ret[3];
+    ret[0] = mp_obj_new_int(x);
+    ret[1] = mp_obj_new_int(y);
+    ret[2] = mp_obj_new_int(heading);
+
+    return mp_obj_new_tuple(3, ret);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(pb_type_DriveBase_pose_obj, pb_type_DriveBase_pose);
+
+// pybricks.robotics.DriveBase.reset_pose
+static mp_obj_t pb_type_DriveBase_reset_pose(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    PB_PARSE_ARGS_METHOD(n_args, pos_args, kw_args,
+        pb_type_DriveBase_obj_t, self,
+        PB_ARG_DEFAULT_INT(x, 0),
+        PB_ARG_DEFAULT_INT(y, 0),
+        PB_ARG_DEFAULT_INT(heading, 0));
+
+    pb_assert(pbio_drivebase_reset_pose(self->db, pb_obj_get_int(x_in), pb_obj_get_int(y_in), pb_obj_get_int(heading_in)));
+    return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_KW(pb_type_DriveBase_reset_pose_obj, 1, pb_type_DriveBase_reset_pose);
+#endif // PBIO_CONFIG_DRIVEBASE_ODOMETRY
+
 // pybricks.robotics.DriveBase.done
 static mp_obj_t pb_type_DriveBase_done(mp_obj_t self_in) {
     pb_type_DriveBase_obj_t *self = MP_OBJ_TO_PTR(self_in);
@@ -358,6 +397,9 @@ static MP_DEFINE_CONST_FUN_OBJ_KW(pb_type_DriveBase_use_gyro_obj, 1, pb_type_Dri
 static const pb_attr_dict_entry_t pb_type_DriveBase_attr_dict[] = {
     PB_DEFINE_CONST_ATTR_RO(MP_QSTR_heading_control, pb_type_DriveBase_obj_t, heading_control),
     PB_DEFINE_CONST_ATTR_RO(MP_QSTR_distance_control, pb_type_DriveBase_obj_t, distance_control),
+    #if PBIO_CONFIG_DRIVEBASE_ODOMETRY && PYBRICKS_PY_COMMON_LOGGER
+    PB_DEFINE_CONST_ATTR_RO(MP_QSTR_pose_log, pb_type_DriveBase_obj_t, pose_logger),
+    #endif
     PB_ATTR_DICT_SENTINEL
 };
 #endif
@@ -380,6 +422,10 @@ static const mp_rom_map_elem_t pb_type_DriveBase_locals_dict_table[] = {
     #if PYBRICKS_PY_ROBOTICS_DRIVEBASE_GYRO
     { MP_ROM_QSTR(MP_QSTR_use_gyro),         MP_ROM_PTR(&pb_type_DriveBase_use_gyro_obj) },
     #endif
+    #if PBIO_CONFIG_DRIVEBASE_ODOMETRY
+    { MP_ROM_QSTR(MP_QSTR_pose),             MP_ROM_PTR(&pb_type_DriveBase_pose_obj)     },
+    { MP_ROM_QSTR(MP_QSTR_reset_pose),       MP_ROM_PTR(&pb_type_DriveBase_reset_pose_obj) },
+    #endif
 };
 // First N entries are common to both drive base classes.
 static MP_DEFINE_CONST_DICT(pb_type_DriveBase_locals_dict, pb_type_DriveBase_locals_dict_table);
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2023 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 #include "py/mpconfig.h"
 
@@ -13,6 +13,8 @@
 #include "py/stream.h"
 
 #include <pbio/int_math.h>
+#include <pbio/motor_process.h>
+#include <pbio/servo.h>
 #include <pbio/task.h>
 #include <pbsys/light.h>
 #include <pbsys/program_stop.h>
@@ -32,6 +34,19 @@
 // is called and cleared when it completes
 static bool run_loop_is_active;
 
+// Garbage collection statistics of the most recent run loop.
+static struct {
+    // Number of iterations of the run loop.
+    uint32_t num_iterations;
+    // Number of garbage collections done by the run loop.
+    uint32_t num_collections;
+    // Longest garbage collection (us).
+    uint32_t collect_time_max;
+} run_loop_gc_stats;
+
+// Default fraction of the heap that may be allocated between collections.
+#define RUN_LOOP_GC_HEAP_FRACTION (8)
+
 bool pb_module_tools_run_loop_is_active(void) {
     return run_loop_is_active;
 }
@@ -78,7 +93,7 @@ static mp_obj_t pb_module_tools_wait(size_t n_args, const mp_obj_t *pos_args, mp
         pb_module_tools_wait_test_completion,
         pb_type_awaitable_return_none,
         pb_type_awaitable_cancel_none,
-        PB_TYPE_AWAITABLE_OPT_NONE);
+        PB_TYPE_AWAITABLE_OPT_WAKE_AT_END_TIME);
 }
 static MP_DEFINE_CONST_FUN_OBJ_KW(pb_module_tools_wait_obj, 0, pb_module_tools_wait);
 
@@ -211,10 +226,48 @@ static mp_obj_t pb_module_tools_read_input_byte(size_t n_args, const mp_obj_t *p
 }
 static MP_DEFINE_CONST_FUN_OBJ_KW(pb_module_tools_read_input_byte_obj, 0, pb_module_tools_read_input_byte);
 
+/**
+ * Collects garbage if enough memory was allocated since the last collection.
+ *
+ * @param [in]  threshold   Number of bytes that may be allocated before
+ *                          collecting, or 0 to always collect.
+ */
+static void pb_module_tools_run_loop_collect(size_t threshold) {
+
+    #if MICROPY_GC_ALLOC_THRESHOLD
+    // This is reset on each collection, including those done automatically
+    // when an allocation fails.
+    if (MP_STATE_MEM(gc_alloc_amount) * MICROPY_BYTES_PER_GC_BLOCK < threshold) {
+        return;
+    }
+    #endif
+
+    uint32_t start = mp_hal_ticks_us();
+    gc_collect();
+    uint32_t time = mp_hal_ticks_us() - start;
+
+    run_loop_gc_stats.num_collections++;
+    if (time > run_loop_gc_stats.collect_time_max) {
+        run_loop_gc_stats.collect_time_max = time;
+    }
+}
+
+/**
+ * Runs a task until it completes.
+ *
+ * @param [in]  task            The task, or None to test if the run loop is
+ *                              active.
+ * @param [in]  loop_time       Time between iterations (ms).
+ * @param [in]  gc_threshold    Number of bytes that may be allocated before
+ *                              the garbage is collected in between two
+ *                              iterations. Choose 0 to collect on every
+ *                              iteration. Defaults to an eighth of the heap.
+ */
 static mp_obj_t pb_module_tools_run_task(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     PB_PARSE_ARGS_FUNCTION(n_args, pos_args, kw_args,
         PB_ARG_DEFAULT_NONE(task),
-        PB_ARG_DEFAULT_INT(loop_time, 10));
+        PB_ARG_DEFAULT_INT(loop_time, 10),
+        PB_ARG_DEFAULT_NONE(gc_threshold));
 
     // Without args, this function is used to test if the run loop is active.
     if (n_args == 0) {
@@ -231,6 +284,19 @@ static mp_obj_t pb_module_tools_run_task(size_t n_args, const mp_obj_t *pos_args
     uint32_t start_time = mp_hal_ticks_ms();
     uint32_t loop_time = pb_obj_get_positive_int(loop_time_in);
 
+    size_t gc_threshold;
+    if (gc_threshold_in == mp_const_none) {
+        gc_info_t info;
+        gc_info(&info);
+        gc_threshold = info.total / RUN_LOOP_GC_HEAP_FRACTION;
+    } else {
+        gc_threshold = pb_obj_get_positive_int(gc_threshold_in);
+    }
+
+    run_loop_gc_stats.num_iterations = 0;
+    run_loop_gc_stats.num_collections = 0;
+    run_loop_gc_stats.collect_time_max = 0;
+
     mp_obj_iter_buf_t iter_buf;
     mp_obj_t iterable = mp_getiter(task_in, &iter_buf);
 
@@ -239,7 +305,8 @@ static mp_obj_t pb_module_tools_run_task(size_t n_args, const mp_obj_t *pos_args
 
         while (mp_iternext(iterable) != MP_OBJ_STOP_ITERATION) {
 
-            gc_collect();
+            run_loop_gc_stats.num_iterations++;
+            pb_module_tools_run_loop_collect(gc_threshold);
 
             if (loop_time == 0) {
                 continue;
@@ -256,17 +323,123 @@ static mp_obj_t pb_module_tools_run_task(size_t n_args, const mp_obj_t *pos_args
         run_loop_is_active = false;
     } else {
         run_loop_is_active = false;
+        pb_type_awaitable_return_into_clear();
         nlr_jump(nlr.ret_val);
     }
     return mp_const_none;
 }
 static MP_DEFINE_CONST_FUN_OBJ_KW(pb_module_tools_run_task_obj, 0, pb_module_tools_run_task);
 
+/**
+ * Gets garbage collection statistics of the most recent run loop.
+ *
+ * @returns Tuple of the number of iterations, the number of garbage
+ *          collections and the longest collection time (us).
+ */
+static mp_obj_t pb_module_tools_run_task_gc_stats(void) {
+    mp_obj_t stats[] = {
+        mp_obj_new_int_from_uint(run_loop_gc_stats.num_iterations),
+        mp_obj_new_int_from_uint(run_loop_gc_stats.num_collections),
+        mp_obj_new_int_from_uint(run_loop_gc_stats.collect_time_max),
+    };
+    return mp_obj_new_tuple(MP_ARRAY_SIZE(stats), stats);
+}
+static MP_DEFINE_CONST_FUN_OBJ_0(pb_module_tools_run_task_gc_stats_obj, pb_module_tools_run_task_gc_stats);
+
+#if PBIO_CONFIG_MOTOR_PROCESS_STATS
+
+static mp_obj_t pb_module_tools_control_loop_stats_histogram(const uint32_t *histogram) {
+    mp_obj_t bins[PBIO_MOTOR_PROCESS_STATS_NUM_BINS];
+    for (size_t i = 0; i < MP_ARRAY_SIZE(bins); i++) {
+        bins[i] = mp_obj_new_int_from_uint(histogram[i]);
+    }
+    return mp_obj_new_tuple(MP_ARRAY_SIZE(bins), bins);
+}
+
+/**
+ * Gets timing statistics of the motor control loop.
+ *
+ * Histogram bin i counts times below 32 * 2**i microseconds, except for the
+ * last bin which counts everything else.
+ *
+ * @param [in]  reset   Choose @c True to reset the statistics after reading.
+ *
+ * @returns Tuple of the number of updates, the number of overruns, the maximum
+ *          period jitter, the jitter histogram, and a tuple with the average
+ *          time, maximum time and time histogram of the battery, drivebase
+ *          and servo update stages. All times are in microseconds.
+ */
+static mp_obj_t pb_module_tools_control_loop_stats(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    PB_PARSE_ARGS_FUNCTION(n_args, pos_args, kw_args,
+        PB_ARG_DEFAULT_FALSE(reset));
+
+    const pbio_motor_process_stats_t *stats = pbio_motor_process_get_stats();
+
+    mp_obj_t stages[PBIO_MOTOR_PROCESS_NUM_STAGES];
+    for (size_t i = 0; i < MP_ARRAY_SIZE(stages); i++) {
+        mp_obj_t stage[] = {
+            mp_obj_new_int_from_uint(stats->num_updates ? (mp_uint_t)(stats->stage_time_total[i] / stats->num_updates) : 0),
+            mp_obj_new_int_from_uint(stats->stage_time_max[i]),
+            pb_module_tools_control_loop_stats_histogram(stats->stage_histogram[i]),
+        };
+        stages[i] = mp_obj_new_tuple(MP_ARRAY_SIZE(stage), stage);
+    }
+
+    mp_obj_t ret[] = {
+        mp_obj_new_int_from_uint(stats->num_updates),
+        mp_obj_new_int_from_uint(stats->num_overruns),
+        mp_obj_new_int_from_uint(stats->jitter_max),
+        pb_module_tools_control_loop_stats_histogram(stats->jitter_histogram),
+        mp_obj_new_tuple(MP_ARRAY_SIZE(stages), stages),
+    };
+
+    if (mp_obj_is_true(reset_in)) {
+        pbio_motor_process_reset_stats();
+    }
+
+    return mp_obj_new_tuple(MP_ARRAY_SIZE(ret), ret);
+}
+static MP_DEFINE_CONST_FUN_OBJ_KW(pb_module_tools_control_loop_stats_obj, 0, pb_module_tools_control_loop_stats);
+
+#endif // PBIO_CONFIG_MOTOR_PROCESS_STATS
+
+#if PBIO_CONFIG_CONTROL_LOOP_TIME_RUNTIME
+
+/**
+ * Gets or sets the time between two updates of the motor control loop.
+ *
+ * @param [in]  time    Loop time in milliseconds: 1, 2, 5, or 10. Choose
+ *                      @c None to get the current value.
+ */
+static mp_obj_t pb_module_tools_control_loop_time(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    PB_PARSE_ARGS_FUNCTION(n_args, pos_args, kw_args,
+        PB_ARG_DEFAULT_NONE(time));
+
+    if (time_in == mp_const_none) {
+        return mp_obj_new_int_from_uint(pbio_motor_process_get_loop_time());
+    }
+
+    pb_assert(pbio_motor_process_set_loop_time(pb_obj_get_positive_int(time_in)));
+    return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_KW(pb_module_tools_control_loop_time_obj, 0, pb_module_tools_control_loop_time);
+
+#endif // PBIO_CONFIG_CONTROL_LOOP_TIME_RUNTIME
+
 // Reset global awaitable state when user program starts.
 void pb_module_tools_init(void) {
     MP_STATE_PORT(wait_awaitables) = mp_obj_new_list(0, NULL);
     MP_STATE_PORT(pbio_task_awaitables) = mp_obj_new_list(0, NULL);
     run_loop_is_active = false;
+    pb_type_awaitable_return_into_clear();
+
+    #if PBIO_CONFIG_CONTROL_LOOP_TIME_RUNTIME
+    // Each program starts with the default control loop time. Motors that
+    // still run from a previous program may be decimated to a loop time that
+    // has no model at the default, so undo that first.
+    pb_assert(pbio_servo_reset_decimation_all());
+    pb_assert(pbio_motor_process_set_loop_time(PBIO_CONFIG_CONTROL_LOOP_TIME_MS));
+    #endif
 }
 
 #if PYBRICKS_PY_TOOLS_HUB_MENU
@@ -371,6 +544,13 @@ static const mp_rom_map_elem_t tools_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_hub_menu),    MP_ROM_PTR(&pb_module_tools_hub_menu_obj)     },
     #endif // PYBRICKS_PY_TOOLS_HUB_MENU
     { MP_ROM_QSTR(MP_QSTR_run_task),    MP_ROM_PTR(&pb_module_tools_run_task_obj)     },
+    { MP_ROM_QSTR(MP_QSTR_run_task_gc_stats), MP_ROM_PTR(&pb_module_tools_run_task_gc_stats_obj) },
+    #if PBIO_CONFIG_MOTOR_PROCESS_STATS
+    { MP_ROM_QSTR(MP_QSTR_control_loop_stats), MP_ROM_PTR(&pb_module_tools_control_loop_stats_obj) },
+    #endif // PBIO_CONFIG_MOTOR_PROCESS_STATS
+    #if PBIO_CONFIG_CONTROL_LOOP_TIME_RUNTIME
+    { MP_ROM_QSTR(MP_QSTR_control_loop_time), MP_ROM_PTR(&pb_module_tools_control_loop_time_obj) },
+    #endif // PBIO_CONFIG_CONTROL_LOOP_TIME_RUNTIME
     { MP_ROM_QSTR(MP_QSTR_StopWatch),   MP_ROM_PTR(&pb_type_StopWatch)                },
     { MP_ROM_QSTR(MP_QSTR_multitask),   MP_ROM_PTR(&pb_type_Task)                     },
     #if MICROPY_PY_BUILTINS_FLOAT
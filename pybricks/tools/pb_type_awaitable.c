@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2022-2023 The Pybricks Authors
+// Copyright (c) 2022-2024 The Pybricks Authors
 
 #include "py/mpconfig.h"
 
@@ -40,8 +40,88 @@ struct _pb_type_awaitable_obj_t {
      * Called on cancellation.
      */
     pb_type_awaitable_cancel_t cancel;
+    /**
+     * Caller-owned list to write the return values into, or MP_OBJ_NULL.
+     */
+    mp_obj_t into;
+    /**
+     * Whether the operation cannot complete before the end time.
+     */
+    bool wake_at_end_time;
 };
 
+// Time at which the most recently yielded awaitable can complete, if known.
+static bool wakeup_known;
+static uint32_t wakeup_time;
+
+/**
+ * Forgets the wake-up time. Must be called before resuming a task, so that
+ * tasks that yield for any other reason are resumed every time.
+ */
+void pb_type_awaitable_wakeup_clear(void) {
+    wakeup_known = false;
+}
+
+/**
+ * Sets the time before which the task that is now yielding does not need to
+ * be resumed.
+ *
+ * @param [in]  time    Wall time in milliseconds.
+ */
+void pb_type_awaitable_wakeup_set(uint32_t time) {
+    wakeup_known = true;
+    wakeup_time = time;
+}
+
+/**
+ * Gets the time before which the task that just yielded does not need to be
+ * resumed.
+ *
+ * @param [out] time    Wall time in milliseconds.
+ * @return              True if the time is known, false if the task should
+ *                      be resumed on every iteration.
+ */
+bool pb_type_awaitable_wakeup_get(uint32_t *time) {
+    *time = wakeup_time;
+    return wakeup_known;
+}
+
+// Caller-owned list for the return value that is now being created, if any.
+static mp_obj_t return_into = MP_OBJ_NULL;
+
+/**
+ * Gets the caller-owned list that the return value function should write its
+ * values into instead of allocating a new object.
+ *
+ * @return              The list, or MP_OBJ_NULL if a new object is needed.
+ */
+mp_obj_t pb_type_awaitable_get_return_into(void) {
+    return return_into;
+}
+
+/**
+ * Clears the caller-owned list for the return value. This is called where
+ * exceptions that may have been raised by a return value function are
+ * handled, so that the list is not kept after the program ends.
+ */
+void pb_type_awaitable_return_into_clear(void) {
+    return_into = MP_OBJ_NULL;
+}
+
+/**
+ * Calls the return value function, making @p into available to it while
+ * it runs.
+ *
+ * This is always set before the function is called, so a list that was left
+ * behind by a function that raised is never used by the next one.
+ */
+static mp_obj_t pb_type_awaitable_get_return_value(pb_type_awaitable_return_t return_value_func, mp_obj_t obj, mp_obj_t into) {
+    return_into = into;
+    mp_obj_t ret = return_value_func(obj);
+    return_into = MP_OBJ_NULL;
+    return ret;
+}
+
 // close() cancels the awaitable.
 static mp_obj_t pb_type_awaitable_close(mp_obj_t self_in) {
     pb_type_awaitable_obj_t *self = MP_OBJ_TO_PTR(self_in);
@@ -64,6 +144,9 @@ static mp_obj_t pb_type_awaitable_iternext(mp_obj_t self_in) {
 
     // Keep going if not completed by returning None.
     if (!self->test_completion(self->obj, self->end_time)) {
+        if (self->wake_at_end_time) {
+            pb_type_awaitable_wakeup_set(self->end_time);
+        }
         return mp_const_none;
     }
 
@@ -76,7 +159,7 @@ static mp_obj_t pb_type_awaitable_iternext(mp_obj_t self_in) {
     }
 
     // Otherwise, set return value via stop iteration.
-    return mp_make_stop_iteration(self->return_value(self->obj));
+    return mp_make_stop_iteration(pb_type_awaitable_get_return_value(self->return_value, self->obj, self->into));
 }
 
 static const mp_rom_map_elem_t pb_type_awaitable_locals_dict_table[] = {
@@ -194,6 +277,26 @@ mp_obj_t pb_type_awaitable_await_or_wait(
     pb_type_awaitable_return_t return_value_func,
     pb_type_awaitable_cancel_t cancel_func,
     pb_type_awaitable_opt_t options) {
+    return pb_type_awaitable_await_or_wait_into(obj, awaitables_in, end_time,
+        test_completion_func, return_value_func, cancel_func, options, MP_OBJ_NULL);
+}
+
+/**
+ * Like pb_type_awaitable_await_or_wait(), but lets the return value function
+ * write its values into a caller-owned list instead of allocating a new
+ * object. See pb_type_awaitable_get_return_into().
+ *
+ * @param [in] into                  List for the return values, or MP_OBJ_NULL.
+ */
+mp_obj_t pb_type_awaitable_await_or_wait_into(
+    mp_obj_t obj,
+    mp_obj_t awaitables_in,
+    uint32_t end_time,
+    pb_type_awaitable_test_completion_t test_completion_func,
+    pb_type_awaitable_return_t return_value_func,
+    pb_type_awaitable_cancel_t cancel_func,
+    pb_type_awaitable_opt_t options,
+    mp_obj_t into) {
 
     // Within run loop, return the generator that user program will iterate.
     if (pb_module_tools_run_loop_is_active()) {
@@ -215,6 +318,8 @@ mp_obj_t pb_type_awaitable_await_or_wait(
         awaitable->return_value = return_value_func;
         awaitable->cancel = cancel_func;
         awaitable->end_time = end_time;
+        awaitable->into = into;
+        awaitable->wake_at_end_time = options & PB_TYPE_AWAITABLE_OPT_WAKE_AT_END_TIME;
         return MP_OBJ_FROM_PTR(awaitable);
     }
 
@@ -225,7 +330,7 @@ mp_obj_t pb_type_awaitable_await_or_wait(
     if (!return_value_func) {
         return mp_const_none;
     }
-    return return_value_func(obj);
+    return pb_type_awaitable_get_return_value(return_value_func, obj, into);
 }
 
 #endif // PYBRICKS_PY_TOOLS
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2023 The Pybricks Authors
+// Copyright (c) 2023-2024 The Pybricks Authors
 
 #ifndef PYBRICKS_INCLUDED_PYBRICKS_TOOLS_AWAITABLE_H
 #define PYBRICKS_INCLUDED_PYBRICKS_TOOLS_AWAITABLE_H
@@ -39,6 +39,12 @@ typedef enum _pb_type_awaitable_opt_t {
      * do not support graceful cancellation.
      */
     PB_TYPE_AWAITABLE_OPT_RAISE_ON_BUSY = 1 << 4,
+    /**
+     * The operation cannot complete before the end time, so the task that
+     * awaits it does not need to be resumed until then. Only used for
+     * awaitables that are never cancelled by other operations.
+     */
+    PB_TYPE_AWAITABLE_OPT_WAKE_AT_END_TIME = 1 << 5,
 } pb_type_awaitable_opt_t;
 
 /**
@@ -82,6 +88,13 @@ typedef void (*pb_type_awaitable_cancel_t)(mp_obj_t obj);
 
 #define pb_type_awaitable_cancel_none (NULL)
 
+void pb_type_awaitable_wakeup_clear(void);
+void pb_type_awaitable_wakeup_set(uint32_t time);
+bool pb_type_awaitable_wakeup_get(uint32_t *time);
+
+mp_obj_t pb_type_awaitable_get_return_into(void);
+void pb_type_awaitable_return_into_clear(void);
+
 void pb_type_awaitable_update_all(mp_obj_t awaitables_in, pb_type_awaitable_opt_t options);
 
 mp_obj_t pb_type_awaitable_await_or_wait(
@@ -93,6 +106,16 @@ mp_obj_t pb_type_awaitable_await_or_wait(
     pb_type_awaitable_cancel_t cancel_func,
     pb_type_awaitable_opt_t options);
 
+mp_obj_t pb_type_awaitable_await_or_wait_into(
+    mp_obj_t obj,
+    mp_obj_t awaitables_in,
+    uint32_t end_time,
+    pb_type_awaitable_test_completion_t test_completion_func,
+    pb_type_awaitable_return_t return_value_func,
+    pb_type_awaitable_cancel_t cancel_func,
+    pb_type_awaitable_opt_t options,
+    mp_obj_t into);
+
 #endif // PYBRICKS_PY_TOOLS
 
 #endif // PYBRICKS_INCLUDED_PYBRICKS_TOOLS_AWAITABLE_H
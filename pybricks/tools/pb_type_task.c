@@ -1,17 +1,19 @@
 // SPDX-License-Identifier: MIT
-// Copyright (c) 2018-2020 The Pybricks Authors
+// Copyright (c) 2018-2024 The Pybricks Authors
 
 #include "py/mpconfig.h"
 
 #if PYBRICKS_PY_TOOLS
 
 #include "py/builtin.h"
+#include "py/mphal.h"
 #include "py/objmodule.h"
 #include "py/runtime.h"
 
 #include <pybricks/parameters.h>
 #include <pybricks/common.h>
 #include <pybricks/tools.h>
+#include <pybricks/tools/pb_type_awaitable.h>
 
 #include <pybricks/util_mp/pb_kwarg_helper.h>
 #include <pybricks/util_mp/pb_obj_helper.h>
@@ -25,8 +27,19 @@ typedef struct {
     mp_obj_iter_buf_t iter_buf;
     mp_obj_t iterable;
     bool done;
+    /**
+     * Whether the task is waiting for an awaitable that cannot complete
+     * before wake_time, so it does not need to be resumed until then.
+     */
+    bool parked;
+    uint32_t wake_time;
 } pb_type_Task_progress_t;
 
+// Tests if time a comes before time b, accounting for wrapping.
+static bool pb_type_Task_time_before(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) < 0;
+}
+
 typedef struct {
     mp_obj_base_t base;
     /**
@@ -68,6 +81,14 @@ static MP_DEFINE_CONST_FUN_OBJ_1(pb_type_Task_close_obj, pb_type_Task_close);
 static mp_obj_t pb_type_Task_iternext(mp_obj_t self_in) {
     pb_type_Task_obj_t *self = MP_OBJ_TO_PTR(self_in);
 
+    uint32_t now = mp_hal_ticks_ms();
+
+    // Earliest time at which any task needs to be resumed, if known. This is
+    // used to park this collection if it is itself awaited by another task.
+    bool wakeup_known = true;
+    uint32_t wakeup_time = 0;
+    bool wakeup_set = false;
+
     // Do one iteration of each task.
     nlr_buf_t nlr;
     if (nlr_push(&nlr) == 0) {
@@ -84,11 +105,29 @@ static mp_obj_t pb_type_Task_iternext(mp_obj_t self_in) {
                 continue;
             }
 
+            // This task is waiting and cannot make progress yet, skip.
+            if (task->parked && pb_type_Task_time_before(now, task->wake_time)) {
+                if (!wakeup_set || pb_type_Task_time_before(task->wake_time, wakeup_time)) {
+                    wakeup_time = task->wake_time;
+                    wakeup_set = true;
+                }
+                continue;
+            }
+
             // Do one task iteration.
+            pb_type_awaitable_wakeup_clear();
             mp_obj_t result = mp_iternext(task->iterable);
 
             // Not done yet, try next time.
             if (result == mp_const_none) {
+                // Park the task if it is waiting until a known time.
+                task->parked = pb_type_awaitable_wakeup_get(&task->wake_time);
+                if (!task->parked) {
+                    wakeup_known = false;
+                } else if (!wakeup_set || pb_type_Task_time_before(task->wake_time, wakeup_time)) {
+                    wakeup_time = task->wake_time;
+                    wakeup_set = true;
+                }
                 continue;
             }
 
@@ -114,6 +153,11 @@ static mp_obj_t pb_type_Task_iternext(mp_obj_t self_in) {
 
         // If collection not done yet, indicate that it should run again.
         if (done_total < self->num_tasks_required) {
+            // If all remaining tasks are parked, so is this collection.
+            pb_type_awaitable_wakeup_clear();
+            if (wakeup_known && wakeup_set) {
+                pb_type_awaitable_wakeup_set(wakeup_time);
+            }
             return mp_const_none;
         }
 
@@ -150,6 +194,7 @@ static mp_obj_t pb_type_Task_new(const mp_obj_type_t *type, size_t n_args, size_
         task->return_val = mp_const_none;
         task->iterable = mp_getiter(args[i], &task->iter_buf);
         task->done = false;
+        task->parked = false;
     }
     return MP_OBJ_FROM_PTR(self);
 }
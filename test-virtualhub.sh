@@ -24,6 +24,10 @@ export MICROPY_MICROPYTHON="$BUILD_DIR/virtualhub-micropython"
 export PYTHONPATH="$PBIO_DIR/cpython"
 export PBIO_VIRTUAL_PLATFORM_MODULE=pbio_virtual.platform.robot
 
+# Run simulations as fast as possible and reproducibly, unless the caller
+# explicitly asks for real time by setting this to 0.
+export PBIO_VIRTUAL_CLOCK_LOCKSTEP=${PBIO_VIRTUAL_CLOCK_LOCKSTEP:-1}
+
 cd "$MP_TEST_DIR"
 ./run-tests.py --test-dirs $(find "$PB_TEST_DIR/virtualhub" -type d -and ! -wholename "*/build/*"  -and ! -wholename "*/run_test.py") "$@" || \
     (code=$?; ./run-tests.py --print-failures; exit $code)
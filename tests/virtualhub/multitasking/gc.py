@@ -0,0 +1,28 @@
+from pybricks.tools import run_task, run_task_gc_stats
+
+
+def count(n):
+    for i in range(n):
+        yield i
+
+
+# Collect garbage on every iteration.
+run_task(count(10), loop_time=0, gc_threshold=0)
+iterations, collections, _ = run_task_gc_stats()
+print(iterations, collections)
+
+# Nothing is allocated, so there is nothing to collect.
+run_task(count(10), loop_time=0, gc_threshold=100000)
+iterations, collections, _ = run_task_gc_stats()
+print(iterations, collections)
+
+
+# Allocating more than the threshold collects again.
+def allocate(n):
+    for i in range(n):
+        yield bytearray(1000)
+
+
+run_task(allocate(10), loop_time=0, gc_threshold=4000)
+iterations, collections, _ = run_task_gc_stats()
+print(iterations, 0 < collections < iterations)
@@ -0,0 +1,48 @@
+from pybricks.tools import multitask, run_task, wait, StopWatch
+
+watch = StopWatch()
+
+
+async def sleeper(name, time):
+    await wait(time)
+    # Waiting tasks are not resumed early, and not much later either.
+    print(name, time <= watch.time() < time + 50)
+
+
+def counted_sleeper(name, time):
+    # Steps through wait() by hand to count how often the task is resumed.
+    # A task that waits is parked until its end time, so it should only be
+    # resumed once to start waiting and once more when the time is up.
+    resumed = 0
+    awaitable = wait(time)
+    while True:
+        resumed += 1
+        try:
+            next(awaitable)
+        except StopIteration:
+            break
+        yield
+    print(name, resumed)
+
+
+def busy(time):
+    # Tasks that are not parked are resumed on every run loop iteration,
+    # which is every 10 ms by default.
+    iterations = 0
+    while watch.time() < time:
+        yield
+        iterations += 1
+    print("busy", time // 10 - 5 <= iterations <= time // 10 + 1)
+
+
+async def main():
+    await multitask(
+        sleeper("slow", 300),
+        multitask(sleeper("fast", 100), counted_sleeper("medium", 200)),
+        counted_sleeper("parked", 250),
+        busy(280),
+    )
+    print("all done")
+
+
+run_task(main())
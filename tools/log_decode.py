@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+
+"""Decode binary data logs saved with ``Logger.save(binary=True)``.
+
+The result is written in the same comma separated format as text logs.
+
+The hub writes the binary log as-is when it has a file system. Otherwise it
+is sent as lines of base64 text, which are decoded first. The ``PB_OF`` and
+``PB_EOF`` lines that mark the start and end of the file in the hub output are
+skipped, so the output can be saved without editing it.
+"""
+
+import argparse
+import base64
+import pathlib
+import struct
+import sys
+from typing import Iterator, List, TextIO, Tuple
+
+MAGIC = b"PBLG"
+VERSION = 1
+MARKERS = (b"PB_OF", b"PB_EOF")
+HEADER = struct.Struct("<4sBBHI")
+
+
+def read_log(path: pathlib.Path) -> bytes:
+    """Reads the binary log data from a raw or base64 encoded file."""
+    data = path.read_bytes()
+    if data.startswith(MAGIC):
+        return data
+    return b"".join(
+        base64.b64decode(line)
+        for line in data.split()
+        if not line.startswith(MARKERS)
+    )
+
+
+def read_varint(data: bytes, offset: int) -> Tuple[int, int]:
+    """Reads a variable length integer and returns it with the next offset."""
+    value = 0
+    shift = 0
+    while True:
+        byte = data[offset]
+        offset += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, offset
+
+
+def decode_rows(data: bytes) -> Iterator[List[int]]:
+    """Decodes the rows of a binary log.
+
+    Raises:
+        ValueError: If the data is not a supported binary log.
+    """
+    magic, version, num_cols, _, num_rows = HEADER.unpack_from(data)
+
+    if magic != MAGIC:
+        raise ValueError("not a binary log")
+
+    if version != VERSION:
+        raise ValueError(f"unsupported log version {version}")
+
+    offset = HEADER.size
+    row = [0] * num_cols
+
+    for _ in range(num_rows):
+        for col in range(num_cols):
+            zigzag, offset = read_varint(data, offset)
+            delta = (zigzag >> 1) ^ -(zigzag & 1)
+            # Values wrap around like 32-bit signed integers on the hub.
+            value = (row[col] + delta) & 0xFFFFFFFF
+            row[col] = value - (1 << 32) if value & 0x80000000 else value
+        yield list(row)
+
+
+def write_csv(rows: Iterator[List[int]], out: TextIO) -> None:
+    for row in rows:
+        out.write(", ".join(str(v) for v in row))
+        out.write("\n")
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("log", type=pathlib.Path, help="binary log file")
+    parser.add_argument(
+        "-o", "--output", type=pathlib.Path, help="output file (default: stdout)"
+    )
+    args = parser.parse_args()
+
+    rows = decode_rows(read_log(args.log))
+
+    if args.output:
+        with open(args.output, "w") as f:
+            write_csv(rows, f)
+    else:
+        write_csv(rows, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,135 @@
+#!/usr/bin/env python3
+
+"""Compress .mpy files for hubs that support compressed user programs.
+
+The hub inflates compressed modules while importing them, so they take up
+less space in the program storage and are faster to download. This costs
+heap memory on the hub, since uncompressed modules are used in place but the
+code of compressed modules is inflated into the heap.
+
+Compressed data starts with ``z``, followed by a sequence of tokens:
+
+- A token byte ``t`` below ``0x80`` is followed by ``t + 1`` literal bytes.
+- A token byte ``t`` of ``0x80`` or more is followed by a 16-bit little-endian
+  distance ``d``. It repeats ``(t & 0x7F) + 3`` bytes, starting ``d + 1``
+  bytes back in the inflated data. Matches may overlap the bytes they produce.
+
+Matches may not refer back further than the window size of the hub.
+"""
+
+import argparse
+import pathlib
+import struct
+import sys
+from typing import Dict, List
+
+MAGIC = b"z"
+WINDOW_SIZE = 1024
+MIN_MATCH = 3
+MAX_MATCH = 0x7F + MIN_MATCH
+MAX_LITERALS = 0x80
+
+
+def compress(data: bytes) -> bytes:
+    """Compresses the data with a greedy search for the longest match."""
+    out = bytearray(MAGIC)
+    literals = bytearray()
+    # Most recent positions of each 3-byte sequence.
+    positions: Dict[bytes, List[int]] = {}
+
+    def flush_literals() -> None:
+        while literals:
+            chunk = literals[:MAX_LITERALS]
+            out.append(len(chunk) - 1)
+            out.extend(chunk)
+            del literals[: len(chunk)]
+
+    def remember(pos: int) -> None:
+        key = data[pos : pos + MIN_MATCH]
+        if len(key) == MIN_MATCH:
+            positions.setdefault(key, []).append(pos)
+
+    i = 0
+    while i < len(data):
+        best_length = 0
+        best_distance = 0
+        for start in reversed(positions.get(data[i : i + MIN_MATCH], [])):
+            if i - start > WINDOW_SIZE:
+                break
+            length = 0
+            while (
+                length < MAX_MATCH
+                and i + length < len(data)
+                and data[start + length] == data[i + length]
+            ):
+                length += 1
+            if length > best_length:
+                best_length = length
+                best_distance = i - start
+                if length == MAX_MATCH:
+                    break
+
+        if best_length >= MIN_MATCH:
+            flush_literals()
+            out.append(0x80 | (best_length - MIN_MATCH))
+            out.extend(struct.pack("<H", best_distance - 1))
+            for pos in range(i, i + best_length):
+                remember(pos)
+            i += best_length
+        else:
+            literals.append(data[i])
+            remember(i)
+            i += 1
+
+    flush_literals()
+    return bytes(out)
+
+
+def decompress(data: bytes) -> bytes:
+    """Inflates compressed data, the same way as the hub does."""
+    if not data.startswith(MAGIC):
+        raise ValueError("not compressed data")
+    out = bytearray()
+    i = len(MAGIC)
+    while i < len(data):
+        token = data[i]
+        i += 1
+        if token < 0x80:
+            out.extend(data[i : i + token + 1])
+            i += token + 1
+        else:
+            (distance,) = struct.unpack_from("<H", data, i)
+            i += 2
+            for _ in range((token & 0x7F) + MIN_MATCH):
+                out.append(out[-distance - 1])
+    return bytes(out)
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("input", type=pathlib.Path, help=".mpy file to compress")
+    parser.add_argument(
+        "output",
+        type=pathlib.Path,
+        nargs="?",
+        help="compressed file, defaults to stdout",
+    )
+    args = parser.parse_args()
+
+    data = args.input.read_bytes()
+    compressed = compress(data)
+    assert decompress(compressed) == data
+
+    if args.output:
+        args.output.write_bytes(compressed)
+    else:
+        sys.stdout.buffer.write(compressed)
+
+    print(
+        f"{len(data)} -> {len(compressed)} bytes",
+        file=sys.stderr,
+    )
+
+
+if __name__ == "__main__":
+    main()